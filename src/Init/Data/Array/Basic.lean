@@ -504,7 +504,19 @@ macro_rules
 namespace Array
 
 -- TODO(Leo): cleanup
-@[specialize]
+/-- See comment at `forInUnsafe` -/
+@[inline] unsafe def isEqvAuxUnsafe (a b : Array α) (hsz : a.size = b.size) (p : α → α → Bool) (i : Nat) : Bool :=
+  let rec @[specialize] loop (i : USize) (sz : USize) : Bool :=
+    if i < sz then
+      p (a.uget i lcProof) (b.uget i lcProof) && loop (i+1) sz
+    else
+      true
+  if i ≤ a.size then
+    loop (USize.ofNat i) (USize.ofNat a.size)
+  else
+    true
+
+@[implemented_by isEqvAuxUnsafe]
 def isEqvAux (a b : Array α) (hsz : a.size = b.size) (p : α → α → Bool) (i : Nat) : Bool :=
   if h : i < a.size then
      have : i < b.size := hsz ▸ h
@@ -609,6 +621,20 @@ end Array
 -- CLEANUP the following code
 namespace Array
 
+/-- See comment at `forInUnsafe` -/
+unsafe def indexOfAuxUnsafe [BEq α] (a : Array α) (v : α) (i : Nat) : Option (Fin a.size) :=
+  let rec loop (i : USize) (sz : USize) : Option (Fin a.size) :=
+    if i < sz then
+      if a.uget i lcProof == v then some ⟨i.toNat, lcProof⟩
+      else loop (i+1) sz
+    else
+      none
+  if i ≤ a.size then
+    loop (USize.ofNat i) (USize.ofNat a.size)
+  else
+    none
+
+@[implemented_by indexOfAuxUnsafe]
 def indexOfAux [BEq α] (a : Array α) (v : α) (i : Nat) : Option (Fin a.size) :=
   if h : i < a.size then
     let idx : Fin a.size := ⟨i, h⟩;
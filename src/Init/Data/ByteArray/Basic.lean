@@ -102,6 +102,19 @@ partial def toList (bs : ByteArray) : List UInt8 :=
       none
   loop start
 
+/-- Index of the first occurrence of the byte `b` at or after `start`, if any.
+    Unlike `findIdx?` with a predicate, this searches in bulk at the runtime level. -/
+@[extern "lean_byte_array_find"]
+def findByteIdx? (a : @& ByteArray) (b : UInt8) (start : Nat := 0) : Option Nat :=
+  a.findIdx? (· == b) start
+
+/-- An opaque `ByteArray` hash function. -/
+@[extern "lean_byte_array_hash"]
+protected opaque hash (a : @& ByteArray) : UInt64
+
+instance : Hashable ByteArray where
+  hash := ByteArray.hash
+
 /--
   We claim this unsafe implementation is correct because an array cannot have more than `usizeSz` elements in our runtime.
   This is similar to the `Array` version.
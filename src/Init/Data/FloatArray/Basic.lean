@@ -158,6 +158,23 @@ def foldlM {β : Type v} {m : Type v → Type w} [Monad m] (f : β → Float →
 def foldl {β : Type v} (f : β → Float → β) (init : β) (as : FloatArray) (start := 0) (stop := as.size) : β :=
   Id.run <| as.foldlM f init start stop
 
+/-- Sum of the elements of `as`. The runtime implementation uses several
+    accumulators so the loop is not serialized on the addition latency; the
+    accumulation order is therefore unspecified, and the function is `opaque`. -/
+@[extern "lean_float_array_sum"]
+opaque sum (as : @& FloatArray) : Float
+
+/-- Dot product of `as` and `bs`, over the common prefix when the sizes differ.
+    The accumulation order is unspecified; see `sum`. -/
+@[extern "lean_float_array_dot"]
+opaque dot (as bs : @& FloatArray) : Float
+
+/-- Multiply every element of `as` by `s`. The runtime implementation updates an
+    exclusive array in place. -/
+@[extern "lean_float_array_scale"]
+def scale (s : Float) (as : FloatArray) : FloatArray :=
+  as.foldl (fun r v => r.push (s * v)) (FloatArray.mkEmpty as.size)
+
 end FloatArray
 
 def List.toFloatArray (ds : List Float) : FloatArray :=
@@ -111,13 +111,29 @@ private structure SpaceResult where
     let r₂ := r₂ (w - r₁.space);
     { r₂ with space := r₁.space + r₂.space }
 
+/-- Space up to the first newline in `s`, scanning at most `w + 1` characters.
+Measurement results are only ever compared against the width budget `w`, so as
+soon as the prefix is provably wider than `w` the exact size cannot affect any
+flattening decision. This keeps the cost of each look-ahead proportional to the
+width instead of the text size; without the cutoff, a large single-line `text`
+node is re-scanned in full by every enclosing group. -/
+private partial def textSpaceUptoLine (s : String) (flatten : Bool) (w : Nat) : SpaceResult :=
+  go 0 {}
+where
+  go (space : Nat) (p : String.Pos) : SpaceResult :=
+    if s.atEnd p then
+      { space := space }
+    else if s.get p == '\n' then
+      { foundLine := true, foundFlattenedHardLine := flatten, space := space }
+    else if space > w then
+      { space := space }
+    else
+      go (space + 1) (s.next p)
+
 private def spaceUptoLine : Format → Bool → Nat → SpaceResult
   | nil,          _,       _ => {}
   | line,         flatten, _ => if flatten then { space := 1 } else { foundLine := true }
-  | text s,       flatten, _ =>
-    let p := s.posOf '\n';
-    let off := s.offsetOfPos p;
-    { foundLine := p != s.endPos, foundFlattenedHardLine := flatten && p != s.endPos, space := off }
+  | text s,       flatten, w => textSpaceUptoLine s flatten w
   | append f₁ f₂, flatten, w => merge w (spaceUptoLine f₁ flatten w) (spaceUptoLine f₂ flatten)
   | nest _ f,     flatten, w => spaceUptoLine f flatten w
   | group f _,    _,       w => spaceUptoLine f true w
@@ -265,7 +281,9 @@ private structure State where
 instance : MonadPrettyFormat (StateM State) where
   -- We avoid a structure instance update, and write these functions using pattern matching because of issue #316
   pushOutput s       := modify fun ⟨out, col⟩ => ⟨out ++ s, col + s.length⟩
-  pushNewline indent := modify fun ⟨out, _⟩ => ⟨out ++ "\n".pushn ' ' indent, indent⟩
+  -- push directly into the (exclusive, hence in-place) output buffer instead of
+  -- materializing the newline+indent prefix as a separate string first
+  pushNewline indent := modify fun ⟨out, _⟩ => ⟨(out.push '\n').pushn ' ' indent, indent⟩
   currColumn         := return (← get).column
   startTag _         := return ()
   endTags _          := return ()
@@ -727,6 +727,18 @@ theorem not_gt_eq (a b : Nat) : (¬ (a > b)) = (a ≤ b) :=
     | succ m, n => by rw [repeatTR.loop, succ_add]; exact go m (succ n)
   (go n 0).symm
 
+/-- `acc + a`. At runtime, when `acc` is an unshared bignum, the addition is performed
+in place reusing `acc`'s storage, so accumulation loops over big numbers avoid
+allocating a fresh result per step. -/
+@[extern "lean_nat_add_acc"]
+def addAcc (acc : Nat) (a : @& Nat) : Nat :=
+  acc + a
+
+/-- `acc * a`, reusing `acc`'s bignum storage when it is unshared, see `Nat.addAcc`. -/
+@[extern "lean_nat_mul_acc"]
+def mulAcc (acc : Nat) (a : @& Nat) : Nat :=
+  acc * a
+
 end Nat
 
 namespace Prod
@@ -159,4 +159,15 @@ theorem div_add_mod (m n : Nat) : n * (m / n) + m % n = m := by
     rw [Nat.left_distrib, Nat.mul_one, Nat.add_assoc, Nat.add_left_comm, ih, Nat.add_comm, Nat.sub_add_cancel h.2]
 decreasing_by apply div_rec_lemma; assumption
 
+/-- `a * b % n` without a boxed intermediate for the product. -/
+@[extern "lean_nat_mulmod"]
+def mulMod (a b n : @& Nat) : Nat :=
+  a * b % n
+
+/-- `a ^ b % n` via modular exponentiation: intermediates stay bounded by `n`
+instead of growing with the full power. -/
+@[extern "lean_nat_powmod"]
+def powMod (a b n : @& Nat) : Nat :=
+  a ^ b % n
+
 end Nat
@@ -133,7 +133,8 @@ def toDigitsCore (base : Nat) : Nat → Nat → List Char → List Char
 def toDigits (base : Nat) (n : Nat) : List Char :=
   toDigitsCore base (n+1) n []
 
-protected def repr (n : Nat) : String :=
+@[extern "lean_nat_repr"]
+protected def repr (n : @& Nat) : String :=
   (toDigits 10 n).asString
 
 def superDigitChar (n : Nat) : Char :=
@@ -167,7 +168,9 @@ end Nat
 instance : Repr Nat where
   reprPrec n _ := Nat.repr n
 
-def Int.repr : Int → String
+@[extern "lean_int_repr"]
+def Int.repr (i : @& Int) : String :=
+  match i with
     | ofNat m   => Nat.repr m
     | negSucc m => "-" ++ Nat.repr (succ m)
 
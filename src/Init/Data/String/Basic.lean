@@ -111,6 +111,21 @@ def back (s : String) : Char :=
 def atEnd : (@& String) → (@& Pos) → Bool
   | s, p => p.byteIdx ≥ utf8ByteSize s
 
+private partial def decodeBatchAux (s : String) (n : Nat) (p : Pos) (cs : Array Char) : Array Char × Pos :=
+  if n == 0 || s.atEnd p then (cs, p)
+  else decodeBatchAux s (n - 1) (s.next p) (cs.push (s.get p))
+
+/--
+  Decode up to `n` characters starting at position `p`, returning them together
+  with the position after the last decoded character. Equivalent to iterating
+  `get`/`next`, but the runtime decodes the whole batch in one call, with a
+  vectorized fast path over ASCII runs, so bulk consumers (lexers, scanners)
+  should prefer it over per-character iteration.
+-/
+@[extern "lean_string_utf8_decode_batch"]
+def decodeBatch (s : @& String) (p : @& Pos) (n : @& Nat) : Array Char × Pos :=
+  decodeBatchAux s n p (Array.mkEmpty n)
+
 /- TODO: remove `partial` keywords after we restore the tactic
   framework and wellfounded recursion support -/
 
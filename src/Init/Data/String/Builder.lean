@@ -0,0 +1,63 @@
+/-
+Copyright (c) 2026 Microsoft Corporation. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+-/
+prelude
+import Init.Data.String.Basic
+
+namespace String
+
+/-- Allocate an empty string with space reserved for `capacity` bytes. -/
+@[extern "lean_mk_empty_string"]
+def mkEmpty (_capacity : @& Nat) : String := ""
+
+/--
+  An incremental string builder with amortized O(1) `push`/`append` per byte.
+
+  `Builder` is a single-field structure, so at runtime it is represented by the
+  underlying string itself. Using a builder linearly keeps that string unshared,
+  and the runtime updates unshared strings with spare capacity in place, so a
+  chain of appends never re-copies the bytes already produced (unlike repeated
+  `s₁ ++ s₂` on a shared `s₁`, which degrades to quadratic copying).
+-/
+structure Builder where
+  private str : String
+
+namespace Builder
+
+/-- An empty builder with space reserved for `capacity` bytes. -/
+def mkEmpty (capacity : Nat) : Builder :=
+  ⟨String.mkEmpty capacity⟩
+
+def empty : Builder :=
+  mkEmpty 0
+
+instance : Inhabited Builder :=
+  ⟨empty⟩
+
+def push (b : Builder) (c : Char) : Builder :=
+  ⟨b.str.push c⟩
+
+def append (b : Builder) (s : String) : Builder :=
+  ⟨b.str ++ s⟩
+
+instance : HAppend Builder String Builder :=
+  ⟨append⟩
+
+/-- The string built so far. O(1): the underlying string is returned as is. -/
+def toString (b : Builder) : String :=
+  b.str
+
+instance : ToString Builder :=
+  ⟨toString⟩
+
+/-- Number of bytes built so far. -/
+def utf8ByteSize (b : Builder) : Nat :=
+  b.str.utf8ByteSize
+
+def isEmpty (b : Builder) : Bool :=
+  b.str.isEmpty
+
+end Builder
+
+end String
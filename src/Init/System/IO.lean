@@ -219,6 +219,122 @@ local macro "nonempty_list" : tactic =>
 /-- Helper method for implementing "deterministic" timeouts. It is the number of "small" memory allocations performed by the current execution thread. -/
 @[extern "lean_io_get_num_heartbeats"] opaque getNumHeartbeats : BaseIO Nat
 
+/--
+Limits the total number of small memory allocations (the counter behind
+`IO.getNumHeartbeats`, tracked per task across all of its execution steps) the
+current task may perform; `0` removes the limit. A task exceeding its budget is
+cancelled cooperatively, exactly as by `IO.cancel`: it keeps running until its
+next `IO.checkCanceled` (or other cancellation poll point). Subtasks spawned
+while a budget is active inherit it as their own cap, so a bounded elaboration
+cannot escape its limit by spawning helpers. Outside a task context this is a
+no-op. A process-wide default budget for every task can be set with the
+`LEAN_TASK_ALLOC_BUDGET` environment variable (in thousands of allocations),
+bounding the damage one runaway task can do to a shared server. -/
+@[extern "lean_io_set_task_max_allocs"] opaque setTaskMaxAllocs (maxAllocs : @& Nat) : BaseIO Unit
+
+/--
+Number of `Nat` to `USize` or `UInt64` conversions that wrapped because the
+source value did not fit in the target type, across all threads since process
+start. The conversions are specified to reduce modulo the target size, but an
+unintended wrap -- e.g. an index that fits on a 64-bit development machine and
+truncates on a 32-bit target -- is otherwise invisible; this counter keeps such
+overflow observable in production. In-range conversions are not counted and pay
+no extra cost. -/
+@[extern "lean_nat_conversion_wrap_count"] opaque natConversionWrapCount : BaseIO Nat
+
+/--
+Snapshot of the runtime allocator's statistics, see `IO.allocatorStats`.
+The global counters are only maintained when the runtime is compiled with
+`LEAN_RUNTIME_STATS` and read as zero otherwise; the per-size-class page
+counts describe the calling thread's heap and are always available. -/
+structure AllocStats where
+  numAlloc : Nat
+  numSmallAlloc : Nat
+  numDealloc : Nat
+  numSmallDealloc : Nat
+  numSegments : Nat
+  numPages : Nat
+  numRecycledPages : Nat
+  numExports : Nat
+  /-- Number of pages currently servicing allocations, indexed by size class. -/
+  livePages : Array Nat
+  /-- Number of mostly-free pages awaiting reuse, indexed by size class. -/
+  freePages : Array Nat
+  deriving Inhabited
+
+/--
+Returns a snapshot of the runtime allocator's statistics, so the memory
+behavior of long-running processes can be monitored while they run instead of
+only post-mortem. -/
+@[extern "lean_allocator_stats"] opaque allocatorStats : BaseIO AllocStats
+
+/--
+Returns the memory of all completely free pages of the calling thread's
+allocator heap to the operating system, so the resident set size of a
+long-running process can be shed after a large batch of work completes.
+Memory freed this way is reclaimed lazily and transparently by the allocator
+when needed again. Only the calling thread's heap is trimmed; on platforms
+without support for returning memory this is a no-op. -/
+@[extern "lean_heap_trim"] opaque heapTrim : BaseIO Unit
+
+/--
+Marks the object graph reachable from `a` as multi-threaded, so it can be
+shared across threads. Subsequent reference-count updates on it use atomic
+operations. This happens automatically when a value is captured by a `Task`. -/
+@[extern "lean_runtime_mark_multi_threaded"] def Runtime.markMultiThreaded (a : α) : BaseIO α :=
+  return a
+
+/--
+Marks the object graph reachable from `a` as persistent: all subsequent
+reference-count updates on it become no-ops, and it is never freed. For
+read-only data shared across many threads (e.g. a snapshot taken after
+elaboration), this removes the atomic reference-count traffic that
+multi-threaded marking would otherwise impose forever. Use with care:
+persistent objects live until the process exits. -/
+@[extern "lean_runtime_mark_persistent"] def Runtime.markPersistent (a : α) : BaseIO α :=
+  return a
+
+/--
+Maximizes sharing in the object graph reachable from `a` using multiple threads and
+process-wide sharing tables, and returns the maximally shared representative. Unlike
+`ShareCommon.shareCommon`, the tables persist across calls: subgraphs already processed
+by an earlier call are reused wholesale instead of being traversed again. The
+representatives (and the input graph) are marked multi-threaded and stay alive for the
+rest of the process, so this is intended for long-lived data that is about to be shared
+across threads or marked persistent (e.g. an environment snapshot), not for transient
+values. -/
+@[extern "lean_sharecommon_mt"] def Runtime.shareCommon (a : α) : BaseIO α :=
+  return a
+
+/--
+Census of the object graph reachable from a value, see `Runtime.heapCensus`.
+`countByTag` and `bytesByTag` are indexed by runtime object tag: tags `0` to
+`244` are constructor objects (indexed by constructor tag, summed over all
+types), followed by closures (`245`), arrays (`246`), struct arrays (`247`),
+scalar arrays (`248`), strings (`249`), big numbers (`250`), thunks (`251`),
+tasks (`252`), refs (`253`) and external objects (`254`). The size histograms
+use power-of-two buckets: bucket `0` counts size `0`, bucket `i > 0` counts
+sizes `s` with `2^(i-1) ≤ s < 2^i`. -/
+structure Runtime.HeapCensus where
+  countByTag : Array Nat
+  bytesByTag : Array Nat
+  /-- Histogram of `Array` lengths. -/
+  arraySizes : Array Nat
+  /-- Histogram of scalar array (e.g. `ByteArray`, `FloatArray`) lengths. -/
+  scalarArraySizes : Array Nat
+  /-- Histogram of `String` byte sizes. -/
+  stringSizes : Array Nat
+  deriving Inhabited
+
+/--
+Walks the object graph reachable from `a` and returns object counts and bytes
+by tag together with size histograms, so the composition of a large live heap
+(e.g. a server environment) can be inspected from within the process instead
+of from a core dump. The walk does not modify the graph and does not force
+pending thunks or tasks (an unfinished task contributes only its task object);
+its cost is proportional to the number of reachable objects. -/
+@[extern "lean_runtime_heap_census"] opaque Runtime.heapCensus (a : @& α) : BaseIO Runtime.HeapCensus
+
 inductive FS.Mode where
   | read | write | readWrite | append
 
@@ -291,6 +407,17 @@ Note that EOF does not actually close a handle, so further reads may block and r
 -/
 @[extern "lean_io_prim_handle_read"] opaque read (h : @& Handle) (bytes : USize) : IO ByteArray
 @[extern "lean_io_prim_handle_write"] opaque write (h : @& Handle) (buffer : @& ByteArray) : IO Unit
+/--
+Write all given buffers to the handle while taking the stream lock only once,
+so many small writes do not pay a lock/unlock per fragment.
+-/
+@[extern "lean_io_prim_handle_write_batch"] opaque writeBatch (h : @& Handle) (buffers : @& Array ByteArray) : IO Unit
+/--
+Resize the handle's user-space stream buffer. A larger buffer lets
+small-write-heavy workloads issue fewer system calls. Must be called before
+the first read or write on the handle.
+-/
+@[extern "lean_io_prim_handle_set_buffer_size"] opaque setBufferSize (h : @& Handle) (size : USize) : IO Unit
 
 /--
 Read text up to (including) the next line break from the handle.
@@ -345,6 +472,19 @@ def readBinFile (fname : FilePath) : IO ByteArray := do
   let h ← Handle.mk fname Mode.read true
   h.readBinToEnd
 
+/--
+Read the entire contents of `fname` in one step. On POSIX systems the file is
+memory-mapped, so the bytes are copied only once and the read shares the OS
+page cache with other processes. Prefer this over `readBinFile` for large
+files. -/
+@[extern "lean_io_read_bin_file_mmap"] opaque readBinFileMmap (fname : @& FilePath) : IO ByteArray
+
+/--
+Read the entire contents of `fname` without blocking the current thread.
+The read runs on a dedicated IO worker thread and completes into the returned
+task, so waiting on many files does not park task runtime workers. -/
+@[extern "lean_io_read_bin_file_async"] opaque readBinFileAsync (fname : @& FilePath) : IO (Task (Except IO.Error ByteArray))
+
 def readFile (fname : FilePath) : IO String := do
   let h ← Handle.mk fname Mode.read false
   h.readToEnd
@@ -12,10 +12,23 @@ namespace Platform
 @[extern "lean_system_platform_windows"] opaque getIsWindows : Unit → Bool
 @[extern "lean_system_platform_osx"] opaque getIsOSX : Unit → Bool
 @[extern "lean_system_platform_emscripten"] opaque getIsEmscripten : Unit → Bool
+@[extern "lean_system_platform_cpu_features"] opaque getCpuFeatures : Unit → UInt64
 
 def isWindows : Bool := getIsWindows ()
 def isOSX : Bool := getIsOSX ()
 def isEmscripten : Bool := getIsEmscripten ()
 
+/--
+Mask of the CPU features detected by the runtime at startup, for `@[extern]`
+kernels that pick a vectorized implementation once and cache the choice.
+The bit assignments are stable and defined in `src/runtime/platform.h`
+(`LEAN_CPU_FEATURE_*`): bits 0-6 are x86-64 features (SSE2, SSSE3, SSE4.2,
+AVX2, AVX-512F, BMI2, ADX), bits 16-17 are AArch64 features (NEON, CRC32).
+A bit is only set when the operating system also preserves the corresponding
+register state. The mask is `0` on targets without detection support (e.g.
+WebAssembly).
+-/
+def cpuFeatures : UInt64 := getCpuFeatures ()
+
 end Platform
 end System
@@ -71,6 +71,21 @@ opaque Ref.swap {σ α} (r : @& Ref σ α) (a : α) : ST σ α := inhabitedFromR
 unsafe opaque Ref.take {σ α} (r : @& Ref σ α) : ST σ α := inhabitedFromRef r
 @[extern "lean_st_ref_ptr_eq"]
 opaque Ref.ptrEq {σ α} (r1 r2 : @& Ref σ α) : ST σ Bool
+/--
+Store `a` as a read-mostly snapshot. The value is marked as persistent, so subsequent
+`Ref.getSnapshot` calls read it without any atomic read-modify-write operation, even when
+the ref is shared across many threads. Superseded snapshots are never deallocated; use
+this only for long-lived, rarely updated state (e.g. global configuration).
+-/
+@[extern "lean_st_ref_publish"]
+opaque Ref.publish {σ α} (r : @& Ref σ α) (a : α) : ST σ Unit
+/--
+Contention-free read of a ref whose current value was stored with `Ref.publish`; it
+returns the snapshot with a single load. Falls back to `Ref.get` if the current value
+was not published.
+-/
+@[extern "lean_st_ref_get_snapshot"]
+opaque Ref.getSnapshot {σ α} (r : @& Ref σ α) : ST σ α := inhabitedFromRef r
 
 @[inline] unsafe def Ref.modifyUnsafe {σ α : Type} (r : Ref σ α) (f : α → α) : ST σ Unit := do
   let v ← Ref.take r
@@ -105,6 +120,8 @@ variable {σ : Type} {m : Type → Type} [Monad m] [MonadLiftT (ST σ) m]
 @[inline] def Ref.swap {α : Type} (r : Ref σ α) (a : α) : m α := liftM <| Prim.Ref.swap r a
 @[inline] unsafe def Ref.take {α : Type} (r : Ref σ α) : m α := liftM <| Prim.Ref.take r
 @[inline] def Ref.ptrEq {α : Type} (r1 r2 : Ref σ α) : m Bool := liftM <| Prim.Ref.ptrEq r1 r2
+@[inline] def Ref.publish {α : Type} (r : Ref σ α) (a : α) : m Unit := liftM <| Prim.Ref.publish r a
+@[inline] def Ref.getSnapshot {α : Type} (r : Ref σ α) : m α := liftM <| Prim.Ref.getSnapshot r
 @[inline] def Ref.modify {α : Type} (r : Ref σ α) (f : α → α) : m Unit := liftM <| Prim.Ref.modify r f
 @[inline] def Ref.modifyGet {α : Type} {β : Type} (r : Ref σ α) (f : α → β × α) : m β := liftM <| Prim.Ref.modifyGet r f
 
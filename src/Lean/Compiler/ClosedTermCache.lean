@@ -12,11 +12,20 @@ structure ClosedTermCache where
   constNames : NameSet := {}
   deriving Inhabited
 
-builtin_initialize closedTermCacheExt : EnvExtension ClosedTermCache ← registerEnvExtension (pure {})
+private def addClosedTerm (s : ClosedTermCache) : Expr × Name → ClosedTermCache
+  | (e, n) => { s with map := s.map.insert e n, constNames := s.constNames.insert n }
+
+/-- The cache is persistent so that a module reuses the closed terms already extracted by
+    its imports instead of generating (and initializing) its own copy of each duplicate. -/
+builtin_initialize closedTermCacheExt : SimplePersistentEnvExtension (Expr × Name) ClosedTermCache ←
+  registerSimplePersistentEnvExtension {
+    addEntryFn    := addClosedTerm
+    addImportedFn := mkStateFromImportedEntries addClosedTerm {}
+  }
 
 @[export lean_cache_closed_term_name]
 def cacheClosedTermName (env : Environment) (e : Expr) (n : Name) : Environment :=
-  closedTermCacheExt.modifyState env fun s => { s with map := s.map.insert e n, constNames := s.constNames.insert n }
+  closedTermCacheExt.addEntry env (e, n)
 
 @[export lean_get_closed_term_name]
 def getClosedTermName? (env : Environment) (e : Expr) : Option Name :=
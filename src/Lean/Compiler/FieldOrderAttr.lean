@@ -0,0 +1,53 @@
+/-
+Copyright (c) 2023 Microsoft Corporation. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+-/
+import Lean.Meta.Basic
+import Lean.Attributes
+
+namespace Lean.Compiler
+
+private def getFieldOrderCtorName (declName : Name) : AttrM Name := do
+  match (← getConstInfo declName) with
+  | .ctorInfo _ => return declName
+  | .inductInfo val =>
+    match val.ctors with
+    | [ctorName] => return ctorName
+    | _ => throwError "invalid 'field_order' attribute, '{declName}' has multiple constructors; apply the attribute to the individual constructors"
+  | _ => throwError "invalid 'field_order' attribute, '{declName}' is not a constructor or an inductive type"
+
+private def elabFieldOrder (ctorName : Name) (args : Array Syntax) : MetaM (Array Name) := do
+  if args.isEmpty then
+    throwError "invalid 'field_order' attribute, at least one field name expected"
+  let ctorVal ← getConstInfoCtor ctorName
+  Meta.forallTelescopeReducing ctorVal.type fun xs _ => do
+    let fieldNames ← (xs.extract ctorVal.numParams xs.size).mapM (·.fvarId!.getUserName)
+    let mut result := #[]
+    for arg in args do
+      let fieldName := arg.getId
+      unless fieldNames.contains fieldName do
+        throwErrorAt arg "invalid 'field_order' field name '{fieldName}', '{ctorName}' has no such field"
+      if result.contains fieldName then
+        throwErrorAt arg "invalid 'field_order' field name '{fieldName}', it has already been specified"
+      result := result.push fieldName
+    return result
+
+/-- Prioritize frequently accessed constructor fields when the code generator assigns
+    object slots and scalar offsets. Fields listed in the attribute come first *within
+    their kind* (pointer, `USize`, other scalar); the kinds themselves keep their fixed
+    relative layout, which the runtime relies on. The attribute must be applied in the
+    module declaring the constructor so that all importers agree on the layout. -/
+builtin_initialize fieldOrderAttr : ParametricAttribute (Array Name) ←
+  registerParametricAttribute {
+    name  := `field_order
+    descr := "prioritize frequently accessed constructor fields in the memory layout"
+    getParam := fun declName stx => do
+      let ctorName ← getFieldOrderCtorName declName
+      elabFieldOrder ctorName stx[1].getArgs |>.run'
+  }
+
+@[export lean_get_field_order]
+def getFieldOrder? (env : Environment) (declName : Name) : Option (Array Name) :=
+  fieldOrderAttr.getParam? env declName
+
+end Lean.Compiler
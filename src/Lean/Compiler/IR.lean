@@ -29,6 +29,11 @@ register_builtin_option compiler.reuse : Bool := {
   descr    := "heuristically insert reset/reuse instruction pairs"
 }
 
+register_builtin_option compiler.reuseAcrossTypes : Bool := {
+  defValue := false
+  descr    := "allow reset/reuse pairs to reuse memory cells across constructors of different types with the same layout (the constructor tag is overwritten at runtime)"
+}
+
 private def compileAux (decls : Array Decl) : CompilerM Unit := do
   logDecls `init decls
   checkDecls decls
@@ -37,7 +42,8 @@ private def compileAux (decls : Array Decl) : CompilerM Unit := do
   decls := decls.map Decl.pushProj
   logDecls `push_proj decls
   if compiler.reuse.get (← read) then
-    decls := decls.map Decl.insertResetReuse
+    let acrossTypes := compiler.reuseAcrossTypes.get (← read)
+    decls := decls.map (Decl.insertResetReuse · acrossTypes)
     logDecls `reset_reuse decls
   decls := decls.map Decl.elimDead
   logDecls `elim_dead decls
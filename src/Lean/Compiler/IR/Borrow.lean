@@ -33,7 +33,18 @@ def OwnedSet.contains (s : OwnedSet) (k : OwnedSet.Key) : Bool   := HashMap.cont
    Join points are viewed as local functions, and are identified using
    their local id + the name of the surrounding function.
    We keep a mapping from function and joint points to parameters (`Array Param`).
-   Recall that `Param` contains the field `borrow`. -/
+   Recall that `Param` contains the field `borrow`.
+
+   Note that this is already a cross-block dataflow analysis: join-point
+   parameters start as borrowed and are only downgraded to owned when some `jmp`
+   predecessor or the join-point body forces ownership, iterating
+   (`whileModifing`) until a fixpoint over the whole mutual block. `ExplicitRC`
+   then consults the resulting `borrow` flags at each `jmp`, so an argument whose
+   ownership merely flows through a join point is passed borrowed and incurs no
+   `inc` on the edge nor matching `dec` in the join point. An `inc` that remains
+   at a `jmp` is one where ownership genuinely must be duplicated (the value is
+   consumed by the join point and still live after the jump, or packed for
+   reset/reuse). -/
 namespace ParamMap
 inductive Key where
   | decl (name : FunId)
@@ -90,11 +90,84 @@ def toCInitName (n : Name) : M String := do
 def emitCInitName (n : Name) : M Unit :=
   toCInitName n >>= emit
 
+/-! ## Static closed terms
+
+A closed term whose body is a straight-line sequence of constructor
+applications over boxed literals, string literals, and previously built
+values has a shape that is fully known at emission time. We emit such terms
+as `static const` C object definitions with a zero reference count (the
+runtime treats RC 0 as "not reference counted", see `lean_set_non_heap_header`
+in `lean.h`), so they live in the read-only data segment: no initialization
+code runs, nothing is heap-allocated, and the pages are shared across forked
+processes. All other closed terms keep the lazily initialized `_force_`
+accessor. -/
+
+inductive StaticNode where
+  /-- a constructor object with object fields only -/
+  | ctor (c : CtorInfo) (args : Array Arg)
+  /-- a string literal -/
+  | str (s : String)
+
+structure StaticTerm where
+  /-- object definitions in dependency (emission) order -/
+  nodes   : Array (VarId × StaticNode)
+  /-- variables bound to boxed scalar constants -/
+  scalars : HashMap VarId Nat
+  /-- the variable returned by the body; always bound in `nodes` -/
+  result  : VarId
+
+/-- Largest literal embeddable as a boxed scalar in a static initializer:
+    `lean_box` must not overflow `size_t` on 32-bit targets. -/
+def maxStaticScalar : Nat := 2^31
+
+partial def staticTerm? (b : FnBody) : Option StaticTerm :=
+  go b #[] {}
+where
+  go (b : FnBody) (nodes : Array (VarId × StaticNode)) (scalars : HashMap VarId Nat) : Option StaticTerm :=
+    match b with
+    | .vdecl x t v b =>
+      let argOk (a : Arg) : Bool :=
+        match a with
+        | .var y      => scalars.contains y || nodes.any (·.1 == y)
+        | .irrelevant => true
+      match v with
+      | .lit (.num n) =>
+        if t.isObj && n < maxStaticScalar then go b nodes (scalars.insert x n) else none
+      | .lit (.str s) =>
+        go b (nodes.push (x, .str s)) scalars
+      | .ctor c ys =>
+        -- scalar fields would require byte-level layout in the initializer; leave
+        -- constructors carrying them to the regular initialization path
+        if c.usize == 0 && c.ssize == 0 && ys.all argOk then
+          if c.size == 0 then go b nodes (scalars.insert x c.cidx)
+          else go b (nodes.push (x, .ctor c ys)) scalars
+        else none
+      | _ => none
+    | .ret (.var x) =>
+      if nodes.any (·.1 == x) then some ⟨nodes, scalars, x⟩ else none
+    | _ => none
+
+def isStaticClosedTerm (d : Decl) : Bool :=
+  match d with
+  | .fdecl (body := b) .. => (staticTerm? b).isSome
+  | _                     => false
+
 def emitFnDeclAux (decl : Decl) (cppBaseName : String) (isExternal : Bool) : M Unit := do
   let ps := decl.params
   let env ← getEnv
   if ps.isEmpty then
-    if isClosedTermName env decl.name then emit "static "
+    if isClosedTermName env decl.name && decl.resultType.isObj then
+      -- Closed terms are initialized lazily on first access: the data symbol stays
+      -- module-private and all uses (including from importing modules, via the
+      -- persistent `closedTermCacheExt`) go through the exported `_force_` accessor.
+      if isExternal then
+        emitLn ("lean_object* _force_" ++ cppBaseName ++ "();")
+      else
+        -- statically emitted terms need no state variable, only the accessor
+        unless isStaticClosedTerm decl do
+          emitLn ("static lean_object* " ++ cppBaseName ++ ";")
+        emitLn ("LEAN_EXPORT lean_object* _force_" ++ cppBaseName ++ "();")
+      return ()
     else if isExternal then emit "extern "
     else emit "LEAN_EXPORT "
   else
@@ -275,6 +348,13 @@ def isIf (alts : Array Alt) : Option (Nat × FnBody × FnBody) :=
     | Alt.ctor c b => some (c.cidx, b, alts[1]!.body)
     | _            => none
 
+/-- An arm consisting solely of `unreachable` compiles to a `lean_internal_panic_unreachable()`
+    call and is never taken in a well-typed program; we annotate the dispatch accordingly so
+    the C compiler keeps the panic call out of the hot code layout. -/
+def isUnreachableBranch : FnBody → Bool
+  | FnBody.unreachable => true
+  | _                  => false
+
 def emitInc (x : VarId) (n : Nat) (checkRef : Bool) : M Unit := do
   emit $
     if checkRef then (if n == 1 then "lean_inc" else "lean_inc_n")
@@ -422,9 +502,14 @@ def emitFullApp (z : VarId) (f : FunId) (ys : Array Arg) : M Unit := do
   match decl with
   | Decl.extern _ ps _ extData => emitExternCall f ps extData ys
   | _ =>
-    emitCName f
-    if ys.size > 0 then emit "("; emitArgs ys; emit ")"
-    emitLn ";"
+    let env ← getEnv
+    if ys.isEmpty && isClosedTermName env f && decl.resultType.isObj then
+      -- force the lazily initialized closed term
+      emit "_force_"; emitCName f; emitLn "();"
+    else
+      emitCName f
+      if ys.size > 0 then emit "("; emitArgs ys; emit ")"
+      emitLn ";"
 
 def emitPartialApp (z : VarId) (f : FunId) (ys : Array Arg) : M Unit := do
   let decl ← getDecl f
@@ -434,8 +519,17 @@ def emitPartialApp (z : VarId) (f : FunId) (ys : Array Arg) : M Unit := do
     let y := ys[i]!
     emit "lean_closure_set("; emit z; emit ", "; emit i; emit ", "; emitArg y; emitLn ");"
 
+/--
+The runtime provides specialized `lean_apply_<n>` entry points up to this arity; beyond
+it, the arguments are packed into an array and passed to `lean_apply_m`. Note that this
+bound is independent of `closureMaxArgs`: functions of larger arity keep the boxed
+`lean_object**` calling convention, the specialized stubs merely spare the caller from
+materializing the argument array at every application site.
+-/
+def maxSpecializedApplyArgs : Nat := 32
+
 def emitApp (z : VarId) (f : VarId) (ys : Array Arg) : M Unit :=
-  if ys.size > closureMaxArgs then do
+  if ys.size > maxSpecializedApplyArgs then do
     emit "{ lean_object* _aargs[] = {"; emitArgs ys; emitLn "};";
     emitLhs z; emit "lean_apply_m("; emit f; emit ", "; emit ys.size; emitLn ", _aargs); }"
   else do
@@ -500,7 +594,7 @@ def emitLit (z : VarId) (t : IRType) (v : LitVal) : M Unit := do
   emitLhs z;
   match v with
   | LitVal.num v => emitNumLit t v; emitLn ";"
-  | LitVal.str v => emit "lean_mk_string_from_bytes("; emit (quoteString v); emit ", "; emit v.utf8ByteSize; emitLn ");"
+  | LitVal.str v => emit "lean_mk_string_literal("; emit (quoteString v); emit ", "; emit v.utf8ByteSize; emitLn ");"
 
 def emitVDecl (z : VarId) (t : IRType) (v : Expr) : M Unit :=
   match v with
@@ -577,10 +671,43 @@ def emitTailCall (v : Expr) : M Unit :=
     emitLn "goto _start;"
   | _ => throw "bug at emitTailCall"
 
+/--
+Return `true` if `x := v; ret x` is a tail call whose callee has exactly the same C
+signature as the enclosing function. Such calls are emitted as `LEAN_MUSTTAIL return f(...);`,
+so mutual tail recursion (e.g. state machines with one function per state) runs in constant
+stack space where the attribute is available, instead of depending on the C compiler's
+sibling-call optimization. The matching-signature restriction comes from `musttail` itself.
+-/
+def isMustTailCall (x : VarId) (v : Expr) (b : FnBody) : M Bool := do
+  match v, b with
+  | Expr.fap f ys, FnBody.ret (Arg.var y) =>
+    -- nullary functions are emitted as global constants, not calls
+    if x != y || ys.isEmpty then return false
+    let ctx ← read
+    match (← getDecl f) with
+    | Decl.fdecl (xs := ps) (type := t) .. =>
+      let curr ← getDecl ctx.mainFn
+      return toCType t == toCType curr.resultType
+        && ps.size == ctx.mainParams.size
+        && ps.size.all fun i => toCType ps[i]!.ty == toCType ctx.mainParams[i]!.ty
+    | _ => return false
+  | _, _ => return false
+
+def emitMustTailCall (v : Expr) : M Unit :=
+  match v with
+  | Expr.fap f ys => do
+    emit "LEAN_MUSTTAIL return "; emitCName f; emit "("; emitArgs ys; emitLn ");"
+  | _ => throw "bug at emitMustTailCall"
+
 mutual
 
 partial def emitIf (x : VarId) (xType : IRType) (tag : Nat) (t : FnBody) (e : FnBody) : M Unit := do
-  emit "if ("; emitTag x xType; emit " == "; emit tag; emitLn ")";
+  if isUnreachableBranch t then
+    emit "if (LEAN_UNLIKELY("; emitTag x xType; emit " == "; emit tag; emitLn "))"
+  else if isUnreachableBranch e then
+    emit "if (LEAN_LIKELY("; emitTag x xType; emit " == "; emit tag; emitLn "))"
+  else
+    emit "if ("; emitTag x xType; emit " == "; emit tag; emitLn ")"
   emitFnBody t;
   emitLn "else";
   emitFnBody e
@@ -604,6 +731,8 @@ partial def emitBlock (b : FnBody) : M Unit := do
     let ctx ← read
     if isTailCallTo ctx.mainFn d then
       emitTailCall v
+    else if (← isMustTailCall x v b) then
+      emitMustTailCall v
     else
       emitVDecl x t v
       emitBlock b
@@ -638,6 +767,45 @@ partial def emitFnBody (b : FnBody) : M Unit := do
 
 end
 
+def staticObjCName (baseName : String) (x : VarId) : String :=
+  "_static_" ++ baseName ++ "_" ++ toString x.idx
+
+def emitStaticArg (baseName : String) (st : StaticTerm) (a : Arg) : M Unit :=
+  match a with
+  | .irrelevant => emit "LEAN_BOX_CONST(0)"
+  | .var y =>
+    match st.scalars.find? y with
+    | some n => do emit "LEAN_BOX_CONST("; emit n; emit ")"
+    | none   => do emit "(lean_object*)&"; emit (staticObjCName baseName y)
+
+def emitStaticClosedTerm (baseName : String) (st : StaticTerm) : M Unit := do
+  for (x, node) in st.nodes do
+    let objName := staticObjCName baseName x
+    match node with
+    | .ctor c args =>
+      emit "static struct { lean_object m_header; lean_object * m_objs["
+      emit c.size; emit "]; } const "; emit objName
+      -- the header mirrors `lean_set_non_heap_header`: RC 0, `m_cs_sz` holds the object size
+      emit " = {{0, sizeof(lean_object) + sizeof(void*)*"
+      emit c.size; emit ", "; emit c.size; emit ", "; emit c.cidx; emit "}, {"
+      args.size.forM fun i => do
+        if i > 0 then emit ", "
+        emitStaticArg baseName st args[i]!
+      emitLn "}};"
+    | .str s =>
+      let n := s.utf8ByteSize + 1
+      emit "static struct { lean_object m_header; size_t m_size; size_t m_capacity; size_t m_length; char m_data["
+      emit n; emit "]; } const "; emit objName
+      -- `m_cs_sz` is 1 for statically sized big objects, see `lean_set_non_heap_header_for_big`
+      emit " = {{0, 1, 0, LeanString}, "
+      emit n; emit ", "; emit n; emit ", "; emit s.length; emit ", "
+      emit (quoteString s)
+      emitLn "};"
+  emitLns [
+    "LEAN_EXPORT lean_object* _force_" ++ baseName ++ "() {",
+    "return (lean_object*)&" ++ staticObjCName baseName st.result ++ ";",
+    "}"]
+
 def emitDeclAux (d : Decl) : M Unit := do
   let env ← getEnv
   let (_, jpMap) := mkVarJPMaps d
@@ -646,6 +814,11 @@ def emitDeclAux (d : Decl) : M Unit := do
     match d with
     | .fdecl (f := f) (xs := xs) (type := t) (body := b) .. =>
       let baseName ← toCName f;
+      if xs.size == 0 && isClosedTermName env d.name && t.isObj then
+        if let some st := staticTerm? b then
+          -- the term lives in the read-only data segment; no `_init_` function needed
+          emitStaticClosedTerm baseName st
+          return ()
       if xs.size == 0 then
         emit "static "
       else
@@ -672,6 +845,20 @@ def emitDeclAux (d : Decl) : M Unit := do
       emitLn "_start:";
       withReader (fun ctx => { ctx with mainFn := f, mainParams := xs }) (emitFnBody b);
       emitLn "}"
+      if xs.size == 0 && isClosedTermName env d.name && t.isObj then
+        /- Lazy forcing accessor. Concurrent first accesses may build the value more than
+           once; all results are structurally equal persistent objects, so the losing
+           stores merely leak one copy (persistent objects are never freed anyway). -/
+        emitLns [
+          "LEAN_EXPORT lean_object* _force_" ++ baseName ++ "() {",
+          "lean_object * r = " ++ baseName ++ ";",
+          "if (LEAN_UNLIKELY(r == NULL)) {",
+          "r = _init_" ++ baseName ++ "();",
+          "lean_mark_persistent(r);",
+          baseName ++ " = r;",
+          "}",
+          "return r;",
+          "}"]
     | _ => pure ()
 
 def emitDecl (d : Decl) : M Unit := do
@@ -712,7 +899,11 @@ def emitDeclInit (d : Decl) : M Unit := do
       if getBuiltinInitFnNameFor? env d.name |>.isSome then
         emit "}"
     | _ =>
-      emitCName n; emit " = "; emitCInitName n; emitLn "();"; emitMarkPersistent d n
+      if isClosedTermName env n && d.resultType.isObj then
+        -- initialized lazily on first access via its `_force_` accessor
+        pure ()
+      else
+        emitCName n; emit " = "; emitCInitName n; emitLn "();"; emitMarkPersistent d n
 
 def emitInitFn : M Unit := do
   let env ← getEnv
@@ -722,7 +913,9 @@ def emitInitFn : M Unit := do
     "static bool _G_initialized = false;",
     "LEAN_EXPORT lean_object* " ++ mkModuleInitializationFunctionName modName ++ "(uint8_t builtin, lean_object* w) {",
     "lean_object * res;",
-    "if (_G_initialized) return lean_io_result_mk_ok(lean_box(0));",
+    -- The fast path below runs once per edge of the import DAG; the shared persistent
+    -- unit result avoids one allocation per edge during startup.
+    "if (_G_initialized) return lean_io_unit_result_ok();",
     "_G_initialized = true;"
   ]
   env.imports.forM fun imp => emitLns [
@@ -731,7 +924,7 @@ def emitInitFn : M Unit := do
     "lean_dec_ref(res);"]
   let decls := getDecls env
   decls.reverse.forM emitDeclInit
-  emitLns ["return lean_io_result_mk_ok(lean_box(0));", "}"]
+  emitLns ["return lean_io_unit_result_ok();", "}"]
 
 def main : M Unit := do
   emitFileHeader
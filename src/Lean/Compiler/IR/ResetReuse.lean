@@ -25,30 +25,33 @@ namespace Lean.IR.ResetReuse
     does not occur in a function body. See example at `livevars.lean`.
 -/
 
-private def mayReuse (c₁ c₂ : CtorInfo) : Bool :=
+private def mayReuse (c₁ c₂ : CtorInfo) (acrossTypes : Bool) : Bool :=
   c₁.size == c₂.size && c₁.usize == c₂.usize && c₁.ssize == c₂.ssize &&
   /- The following condition is a heuristic.
      We don't want to reuse cells from different types even when they are compatible
-     because it produces counterintuitive behavior. -/
-  c₁.name.getPrefix == c₂.name.getPrefix
+     because it produces counterintuitive behavior. Transformation-heavy workloads
+     that destruct one type and allocate another with the same layout can opt into
+     cross-type reuse with `compiler.reuseAcrossTypes`; the cell's tag is
+     overwritten at runtime whenever it differs. -/
+  (acrossTypes || c₁.name.getPrefix == c₂.name.getPrefix)
 
-private partial def S (w : VarId) (c : CtorInfo) : FnBody → FnBody
+private partial def S (w : VarId) (c : CtorInfo) (acrossTypes : Bool) : FnBody → FnBody
   | FnBody.vdecl x t v@(Expr.ctor c' ys) b   =>
-    if mayReuse c c' then
+    if mayReuse c c' acrossTypes then
       let updtCidx := c.cidx != c'.cidx
       FnBody.vdecl x t (Expr.reuse w c' updtCidx ys) b
     else
-      FnBody.vdecl x t v (S w c b)
+      FnBody.vdecl x t v (S w c acrossTypes b)
   | FnBody.jdecl j ys v b   =>
-    let v' := S w c v
-    if v == v' then FnBody.jdecl j ys v (S w c b)
+    let v' := S w c acrossTypes v
+    if v == v' then FnBody.jdecl j ys v (S w c acrossTypes b)
     else FnBody.jdecl j ys v' b
-  | FnBody.case tid x xType alts    => FnBody.case tid x xType <| alts.map fun alt => alt.modifyBody (S w c)
+  | FnBody.case tid x xType alts    => FnBody.case tid x xType <| alts.map fun alt => alt.modifyBody (S w c acrossTypes)
   | b =>
     if b.isTerminal then b
     else let
       (instr, b) := b.split
-      instr.setBody (S w c b)
+      instr.setBody (S w c acrossTypes b)
 
 /-- We use `Context` to track join points in scope. -/
 abbrev M := ReaderT LocalContext (StateT Index Id)
@@ -57,15 +60,15 @@ private def mkFresh : M VarId := do
   let idx ← getModify (fun n => n + 1)
   pure { idx := idx }
 
-private def tryS (x : VarId) (c : CtorInfo) (b : FnBody) : M FnBody := do
+private def tryS (x : VarId) (c : CtorInfo) (acrossTypes : Bool) (b : FnBody) : M FnBody := do
   let w ← mkFresh
-  let b' := S w c b
+  let b' := S w c acrossTypes b
   if b == b' then pure b
   else pure $ FnBody.vdecl w IRType.object (Expr.reset c.size x) b'
 
-private def Dfinalize (x : VarId) (c : CtorInfo) : FnBody × Bool → M FnBody
+private def Dfinalize (x : VarId) (c : CtorInfo) (acrossTypes : Bool) : FnBody × Bool → M FnBody
   | (b, true)  => pure b
-  | (b, false) => tryS x c b
+  | (b, false) => tryS x c acrossTypes b
 
 private def argsContainsVar (ys : Array Arg) (x : VarId) : Bool :=
   ys.any fun arg => match arg with
@@ -83,17 +86,17 @@ private def isCtorUsing (b : FnBody) (x : VarId) : Bool :=
    Note that, in the function `D` defined in the paper, for each `let x := e; F`,
    `D` checks whether `x` is live in `F` or not. This is great for clarity but it
    is expensive: `O(n^2)` where `n` is the size of the function body. -/
-private partial def Dmain (x : VarId) (c : CtorInfo) : FnBody → M (FnBody × Bool)
+private partial def Dmain (x : VarId) (c : CtorInfo) (acrossTypes : Bool) : FnBody → M (FnBody × Bool)
   | e@(FnBody.case tid y yType alts) => do
     let ctx ← read
     if e.hasLiveVar ctx x then do
       /- If `x` is live in `e`, we recursively process each branch. -/
-      let alts ← alts.mapM fun alt => alt.mmodifyBody fun b => Dmain x c b >>= Dfinalize x c
+      let alts ← alts.mapM fun alt => alt.mmodifyBody fun b => Dmain x c acrossTypes b >>= Dfinalize x c acrossTypes
       pure (FnBody.case tid y yType alts, true)
     else pure (e, false)
   | FnBody.jdecl j ys v b   => do
-    let (b, found) ← withReader (fun ctx => ctx.addJP j ys v) (Dmain x c b)
-    let (v, _ /- found' -/) ← Dmain x c v
+    let (b, found) ← withReader (fun ctx => ctx.addJP j ys v) (Dmain x c acrossTypes b)
+    let (v, _ /- found' -/) ← Dmain x c acrossTypes v
     /- If `found' == true`, then `Dmain b` must also have returned `(b, true)` since
        we assume the IR does not have dead join points. So, if `x` is live in `j` (i.e., `v`),
        then it must also live in `b` since `j` is reachable from `b` with a `jmp`.
@@ -111,48 +114,48 @@ private partial def Dmain (x : VarId) (c : CtorInfo) : FnBody → M (FnBody × B
            It may work only if the new cell is consumed, but we ignore this case. -/
         pure (e, true)
       else
-        let (b, found) ← Dmain x c b
+        let (b, found) ← Dmain x c acrossTypes b
         /- Remark: it is fine to use `hasFreeVar` instead of `hasLiveVar`
            since `instr` is not a `FnBody.jmp` (it is not a terminal) nor it is a `FnBody.jdecl`. -/
         if found || !instr.hasFreeVar x then
           pure (instr.setBody b, found)
         else
-          let b ← tryS x c b
+          let b ← tryS x c acrossTypes b
           pure (instr.setBody b, true)
 
-private def D (x : VarId) (c : CtorInfo) (b : FnBody) : M FnBody :=
-  Dmain x c b >>= Dfinalize x c
+private def D (x : VarId) (c : CtorInfo) (acrossTypes : Bool) (b : FnBody) : M FnBody :=
+  Dmain x c acrossTypes b >>= Dfinalize x c acrossTypes
 
-partial def R : FnBody → M FnBody
+partial def R (acrossTypes : Bool) : FnBody → M FnBody
   | FnBody.case tid x xType alts   => do
       let alts ← alts.mapM fun alt => do
-        let alt ← alt.mmodifyBody R
+        let alt ← alt.mmodifyBody (R acrossTypes)
         match alt with
         | Alt.ctor c b =>
           if c.isScalar then pure alt
-          else Alt.ctor c <$> D x c b
+          else Alt.ctor c <$> D x c acrossTypes b
         | _            => pure alt
       pure $ FnBody.case tid x xType alts
   | FnBody.jdecl j ys v b   => do
-    let v ← R v
-    let b ← withReader (fun ctx => ctx.addJP j ys v) (R b)
+    let v ← R acrossTypes v
+    let b ← withReader (fun ctx => ctx.addJP j ys v) (R acrossTypes b)
     pure $ FnBody.jdecl j ys v b
   | e => do
     if e.isTerminal then pure e
     else do
       let (instr, b) := e.split
-      let b ← R b
+      let b ← R acrossTypes b
       pure (instr.setBody b)
 
 end ResetReuse
 
 open ResetReuse
 
-def Decl.insertResetReuse (d : Decl) : Decl :=
+def Decl.insertResetReuse (d : Decl) (acrossTypes : Bool := false) : Decl :=
   match d with
   | .fdecl (body := b) ..=>
     let nextIndex := d.maxIndex + 1
-    let bNew      := (R b {}).run' nextIndex
+    let bNew      := (R acrossTypes b {}).run' nextIndex
     d.updateBody! bNew
   | other => other
 
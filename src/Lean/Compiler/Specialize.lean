@@ -104,6 +104,12 @@ def switch : SpecState → SpecState
 
 end SpecState
 
+/--
+Persistent state of the specializer. Both kinds of entry are exported to the .olean:
+`info` entries so that importers specialize applications of imported functions with the
+right argument mask, and `cache` entries so that a specialization generated in one module
+is reused (instead of regenerated) by every module importing it.
+-/
 builtin_initialize specExtension : SimplePersistentEnvExtension SpecEntry SpecState ←
   registerSimplePersistentEnvExtension {
     addEntryFn    := SpecState.addEntry,
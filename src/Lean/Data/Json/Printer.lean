@@ -94,6 +94,67 @@ where go (acc : String) : List Json.CompressWorkItem → String
   | objectEnd :: is                    => go (acc ++ "}") is
   | comma :: is                        => go (acc ++ ",") is
 
+/-!
+Streaming encoder: primitives that append JSON fragments directly into a
+`ByteArray` output buffer. The C implementations write into the buffer in
+place when it is exclusive, so serialization runs at buffer-append speed
+instead of allocating one intermediate `String` per fragment.
+-/
+
+@[extern "lean_json_write_null"]
+def writeNull (buf : ByteArray) : ByteArray :=
+  buf ++ "null".toUTF8
+
+@[extern "lean_json_write_bool"]
+def writeBool (buf : ByteArray) (b : Bool) : ByteArray :=
+  buf ++ (if b then "true" else "false").toUTF8
+
+@[extern "lean_json_write_str"]
+def writeString (buf : ByteArray) (s : @& String) : ByteArray :=
+  buf ++ (renderString s).toUTF8
+
+@[extern "lean_json_write_nat"]
+def writeNat (buf : ByteArray) (n : @& Nat) : ByteArray :=
+  buf ++ (toString n).toUTF8
+
+@[extern "lean_json_write_int"]
+def writeInt (buf : ByteArray) (i : @& Int) : ByteArray :=
+  buf ++ (toString i).toUTF8
+
+/-- Appends the shortest decimal representation of `f` that round-trips.
+Non-finite values are encoded as `null`, as in JavaScript's `JSON.stringify`. -/
+@[extern "lean_json_write_float"]
+opaque writeFloat (buf : ByteArray) (f : Float) : ByteArray
+
+def writeNumber (buf : ByteArray) (n : JsonNumber) : ByteArray :=
+  if n.exponent == 0 then
+    writeInt buf n.mantissa
+  else
+    buf ++ (toString n).toUTF8
+
+open Json.CompressWorkItem in
+/-- Serializes `j` into `buf` in the `compress` format without building
+intermediate `String`s. -/
+partial def writeCompressed (j : Json) (buf : ByteArray := .empty) : ByteArray :=
+  go buf [json j]
+where go (acc : ByteArray) : List Json.CompressWorkItem → ByteArray
+  | []               => acc
+  | json j :: is =>
+    match j with
+    | null       => go (writeNull acc) is
+    | bool b     => go (writeBool acc b) is
+    | num n      => go (writeNumber acc n) is
+    | str s      => go (writeString acc s) is
+    | arr elems  => go (acc.push '['.toNat.toUInt8) (elems.toList.map arrayElem ++ [arrayEnd] ++ is)
+    | obj kvs    => go (acc.push '{'.toNat.toUInt8) (kvs.fold (init := []) (fun acc k j => objectField k j :: acc) ++ [objectEnd] ++ is)
+  | arrayElem j :: arrayEnd :: is      => go acc (json j :: arrayEnd :: is)
+  | arrayElem j :: is                  => go acc (json j :: comma :: is)
+  | arrayEnd :: is                     => go (acc.push ']'.toNat.toUInt8) is
+  | objectField k j :: objectEnd :: is => go (writeString acc k |>.push ':'.toNat.toUInt8) (json j :: objectEnd :: is)
+  | objectField k j :: is              => go (writeString acc k |>.push ':'.toNat.toUInt8) (json j :: comma :: is)
+  | objectEnd :: is                    => go (acc.push '}'.toNat.toUInt8) is
+  | comma :: is                        => go (acc.push ','.toNat.toUInt8) is
+
 instance : ToFormat Json := ⟨render⟩
 instance : ToString Json := ⟨pretty⟩
 
@@ -24,7 +24,8 @@ namespace String
 private def csize16 (c : Char) : Nat :=
   c.utf16Size.toNat
 
-def utf16Length (s : String) : Nat :=
+@[extern "lean_string_utf16_length"]
+def utf16Length (s : @& String) : Nat :=
   s.foldr (fun c acc => csize16 c + acc) 0
 
 private def codepointPosToUtf16PosFromAux (s : String) : Nat → Pos → Nat → Nat
@@ -34,7 +35,8 @@ private def codepointPosToUtf16PosFromAux (s : String) : Nat → Pos → Nat →
 /-- Computes the UTF-16 offset of the `n`-th Unicode codepoint
 in the substring of `s` starting at UTF-8 offset `off`.
 Yes, this is actually useful.-/
-def codepointPosToUtf16PosFrom (s : String) (n : Nat) (off : Pos) : Nat :=
+@[extern "lean_string_codepoint_pos_to_utf16_pos_from"]
+def codepointPosToUtf16PosFrom (s : @& String) (n : @& Nat) (off : @& Pos) : Nat :=
   codepointPosToUtf16PosFromAux s n off 0
 
 def codepointPosToUtf16Pos (s : String) (pos : Nat) : Nat :=
@@ -46,16 +48,21 @@ private partial def utf16PosToCodepointPosFromAux (s : String) : Nat → Pos →
 
 /-- Computes the position of the Unicode codepoint at UTF-16 offset
 `utf16pos` in the substring of `s` starting at UTF-8 offset `off`. -/
-def utf16PosToCodepointPosFrom (s : String) (utf16pos : Nat) (off : Pos) : Nat :=
+@[extern "lean_string_utf16_pos_to_codepoint_pos_from"]
+def utf16PosToCodepointPosFrom (s : @& String) (utf16pos : @& Nat) (off : @& Pos) : Nat :=
   utf16PosToCodepointPosFromAux s utf16pos off 0
 
 def utf16PosToCodepointPos (s : String) (pos : Nat) : Nat :=
   utf16PosToCodepointPosFrom s pos 0
 
-/-- Starting at `utf8pos`, finds the UTF-8 offset of the `p`-th codepoint. -/
-def codepointPosToUtf8PosFrom (s : String) : String.Pos → Nat → String.Pos
+private def codepointPosToUtf8PosFromAux (s : String) : String.Pos → Nat → String.Pos
   | utf8pos, 0 => utf8pos
-  | utf8pos, p+1 => codepointPosToUtf8PosFrom s (s.next utf8pos) p
+  | utf8pos, p+1 => codepointPosToUtf8PosFromAux s (s.next utf8pos) p
+
+/-- Starting at `utf8pos`, finds the UTF-8 offset of the `p`-th codepoint. -/
+@[extern "lean_string_codepoint_pos_to_utf8_pos_from"]
+def codepointPosToUtf8PosFrom (s : @& String) (utf8pos : @& String.Pos) (p : @& Nat) : String.Pos :=
+  codepointPosToUtf8PosFromAux s utf8pos p
 
 end String
 
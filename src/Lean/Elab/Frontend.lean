@@ -102,10 +102,22 @@ def runFrontend
     (mainModuleName : Name)
     (trustLevel : UInt32 := 0)
     (ileanFileName? : Option String := none)
+    (reuseEnv? : Option Environment := none)
     : IO (Environment × Bool) := do
   let inputCtx := Parser.mkInputContext input fileName
   let (header, parserState, messages) ← Parser.parseHeader inputCtx
-  let (env, messages) ← processHeader header opts messages inputCtx trustLevel
+  /- `reuseEnv?` is an environment whose imports were loaded ahead of time
+     (e.g. by the driver's `--zygote` mode, where forked workers inherit the
+     parent's fixed-up compacted regions copy-on-write). It can only stand in
+     for importing when the file's header requests exactly the pre-loaded
+     closure; otherwise we import as usual. -/
+  let (env, messages) ← match reuseEnv? with
+    | some env =>
+      if (headerToImports header).toArray == env.header.imports then
+        pure (env, messages)
+      else
+        processHeader header opts messages inputCtx trustLevel
+    | none => processHeader header opts messages inputCtx trustLevel
   let env := env.setMainModule mainModuleName
   let mut commandState := Command.mkState env messages opts
 
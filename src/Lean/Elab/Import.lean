@@ -40,6 +40,34 @@ def printImports (input : String) (fileName : Option String) : IO Unit := do
     let fname ← findOLean dep.module
     IO.println fname
 
+structure ImportPathState where
+  visited : NameSet := {}
+  paths   : Array String := #[]
+
+/--
+Paths of the `.olean` files of the transitive import closure of the given
+source, in import post-order. Used by the driver's content-addressed cache
+mode (`--cache`): together with the source text, these files determine the
+elaboration result, so hashing their contents yields a reuse key that is
+insensitive to timestamps. The compacted regions backing the module headers
+read here are not freed; the driver either exits on a cache hit or imports
+the same modules again right away. -/
+@[export lean_import_closure_paths]
+partial def importClosurePaths (input : String) (fileName : Option String) : IO (Array String) := do
+  let (deps, _, _) ← parseImports input fileName
+  let (_, s) ← go deps |>.run {}
+  return s.paths
+where
+  go (is : List Import) : StateRefT ImportPathState IO Unit := do
+    for i in is do
+      if i.runtimeOnly || (← get).visited.contains i.module then
+        continue
+      modify fun s => { s with visited := s.visited.insert i.module }
+      let mFile ← findOLean i.module
+      let (mod, _) ← readModuleData mFile
+      go mod.imports.toList
+      modify fun s => { s with paths := s.paths.push mFile.toString }
+
 deriving instance ToJson for Import
 
 structure PrintImportResult where
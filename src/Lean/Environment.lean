@@ -6,6 +6,7 @@ Authors: Leonardo de Moura
 import Lean.Data.HashMap
 import Lean.ImportingFlag
 import Lean.Data.SMap
+import Lean.Data.PersistentArray
 import Lean.Declaration
 import Lean.LocalContext
 import Lean.Util.Path
@@ -34,6 +35,8 @@ structure Import where
 
 instance : ToString Import := ⟨fun imp => toString imp.module ++ if imp.runtimeOnly then " (runtime)" else ""⟩
 
+deriving instance BEq for Import
+
 /--
   A compacted region holds multiple Lean objects in a contiguous memory region, which can be read/written to/from disk.
   Objects inside the region do not have reference counters and cannot be freed individually. The contents of .olean
@@ -125,8 +128,12 @@ structure Environment where
   constants    : ConstMap
   /--
   Environment extensions. It also includes user-defined extensions.
+
+  Stored as a persistent array: updating one extension state path-copies a few small
+  nodes and structurally shares the rest, instead of copying (and retraversing the
+  reference counts of) one slot per registered extension on every update.
   -/
-  extensions   : Array EnvExtensionState
+  extensions   : PArray EnvExtensionState
   /--
   Constant names to be saved in the field `extraConstNames` at `ModuleData`.
   It contains auxiliary declaration names created by the code generator which are not in `constants`.
@@ -198,6 +205,42 @@ def isConstructor (env : Environment) (declName : Name) : Bool :=
 def getModuleIdx? (env : Environment) (moduleName : Name) : Option ModuleIdx :=
   env.header.moduleNames.findIdx? (· == moduleName)
 
+/--
+Create a snapshot of `env` for a speculative branch (e.g. proof search
+exploring several elaboration alternatives in parallel).
+
+`Environment` is a persistent value: imported constants live in a hash map
+that is frozen after `finalizeImport` and shared by all copies, and local
+additions go into persistent overlays. A branch is therefore O(1) to create,
+and abandoning a failed branch is O(1) as well — dropping the snapshot frees
+only the overlay nodes the branch itself allocated; no maps are cloned.
+This definition exists to make that contract explicit at call sites.
+-/
+@[inline] def branch (env : Environment) : Environment :=
+  env
+
+/--
+Return the constants present in `branchEnv` but missing from `baseEnv`,
+where `branchEnv` was created from `baseEnv` using `branch`. Only the
+overlay of the constant map is traversed, so the cost is proportional to
+the number of declarations added after the imports were finalized, not to
+the total size of the environment.
+-/
+def diffConsts (baseEnv branchEnv : Environment) : Array ConstantInfo :=
+  branchEnv.constants.foldStage2
+    (fun cs n info => if baseEnv.constants.contains n then cs else cs.push info) #[]
+
+/--
+Merge the declarations produced by a successful branch back into `env`.
+The constants are inserted without re-checking since they have already been
+checked by the kernel when they were added to the branch. Extension state is
+not merged; callers that update extensions inside a branch must re-apply
+those updates to the merged environment.
+-/
+def replayConsts (env : Environment) (consts : Array ConstantInfo) : Environment :=
+  consts.foldl (init := env) fun env info =>
+    if env.constants.contains info.name then env else env.addAux info
+
 end Environment
 
 /-- Exceptions that can be raised by the Kernel when type checking new declarations. -/
@@ -221,6 +264,15 @@ namespace Environment
 @[extern "lean_add_decl"]
 opaque addDecl (env : Environment) (decl : @& Declaration) : Except KernelException Environment
 
+/--
+Type check the given declarations in order and add them to the environment.
+The batch commits the underlying environment record once instead of once per
+declaration, which matters when code generators add declarations in large bursts.
+Later declarations may refer to earlier ones.
+-/
+@[extern "lean_add_decls"]
+opaque addDecls (env : Environment) (decls : @& List Declaration) : Except KernelException Environment
+
 end Environment
 
 namespace ConstantInfo
@@ -288,8 +340,8 @@ where
 private def invalidExtMsg := "invalid environment extension has been accessed"
 
 unsafe def setState {σ} (ext : Ext σ) (env : Environment) (s : σ) : Environment :=
-  if h : ext.idx < env.extensions.size then
-    { env with extensions := env.extensions.set ⟨ext.idx, h⟩ (unsafeCast s) }
+  if ext.idx < env.extensions.size then
+    { env with extensions := env.extensions.set ext.idx (unsafeCast s) }
   else
     panic! invalidExtMsg
 
@@ -304,8 +356,8 @@ unsafe def setState {σ} (ext : Ext σ) (env : Environment) (s : σ) : Environme
     panic! invalidExtMsg
 
 unsafe def getState {σ} [Inhabited σ] (ext : Ext σ) (env : Environment) : σ :=
-  if h : ext.idx < env.extensions.size then
-    let s : EnvExtensionState := env.extensions.get ⟨ext.idx, h⟩
+  if ext.idx < env.extensions.size then
+    let s : EnvExtensionState := env.extensions.get! ext.idx
     unsafeCast s
   else
     panic! invalidExtMsg
@@ -374,7 +426,7 @@ def mkEmptyEnvironment (trustLevel : UInt32 := 0) : IO Environment := do
     constants       := {}
     header          := { trustLevel := trustLevel }
     extraConstNames := {}
-    extensions      := exts
+    extensions      := exts.toPArray'
   }
 
 structure PersistentEnvExtensionState (α : Type) (σ : Type) where
@@ -726,7 +778,7 @@ partial def importModules (imports : List Import) (opts : Options) (trustLevel :
       const2ModIdx    := const2ModIdx
       constants       := constants
       extraConstNames := {}
-      extensions      := exts
+      extensions      := exts.toPArray'
       header          := {
         quotInit     := !imports.isEmpty -- We assume `core.lean` initializes quotient module
         trustLevel   := trustLevel
@@ -740,24 +792,38 @@ partial def importModules (imports : List Import) (opts : Options) (trustLevel :
     let env ← finalizePersistentExtensions env s.moduleData opts
     pure env
 where
-  importMods : List Import → StateRefT ImportState IO Unit
-  | []    => pure ()
-  | i::is => do
-    if i.runtimeOnly || (← get).moduleNameSet.contains i.module then
-      importMods is
-    else do
-      modify fun s => { s with moduleNameSet := s.moduleNameSet.insert i.module }
+  /--
+  Import the modules in `is` and (recursively) their imports. The reads of all
+  not-yet-imported modules in `is` are spawned as tasks up front, so sibling subtrees
+  load and fix up their compacted regions on `Task` workers in parallel, while the
+  post-order traversal below consumes the results sequentially and produces exactly
+  the same `moduleData` order as a fully serial import. A module prefetched here may
+  turn out to have been imported by an earlier sibling's subtree in the meantime; in
+  that case we drop the duplicate data and only keep its region so it is freed
+  together with the environment.
+  -/
+  importMods (is : List Import) : StateRefT ImportState IO Unit := do
+    let mut tasks := #[]
+    for i in is do
+      if i.runtimeOnly || (← get).moduleNameSet.contains i.module then
+        continue
       let mFile ← findOLean i.module
       unless (← mFile.pathExists) do
         throw <| IO.userError s!"object file '{mFile}' of module {i.module} does not exist"
-      let (mod, region) ← readModuleData mFile
-      importMods mod.imports.toList
-      modify fun s => { s with
-        moduleData  := s.moduleData.push mod
-        regions     := s.regions.push region
-        moduleNames := s.moduleNames.push i.module
-      }
-      importMods is
+      tasks := tasks.push (i, ← IO.asTask (readModuleData mFile))
+    for (i, t) in tasks do
+      if (← get).moduleNameSet.contains i.module then
+        let (_, region) ← IO.ofExcept t.get
+        modify fun s => { s with regions := s.regions.push region }
+      else
+        modify fun s => { s with moduleNameSet := s.moduleNameSet.insert i.module }
+        let (mod, region) ← IO.ofExcept t.get
+        importMods mod.imports.toList
+        modify fun s => { s with
+          moduleData  := s.moduleData.push mod
+          regions     := s.regions.push region
+          moduleNames := s.moduleNames.push i.module
+        }
 
 /--
   Create environment object from imports and free compacted regions after calling `act`. No live references to the
@@ -15,3 +15,13 @@ Note that Lean never unloads libraries.
 -/
 @[extern "lean_load_dynlib"]
 opaque loadDynlib (path : @& System.FilePath) : IO Unit
+
+/--
+Dynamically loads a shared library that bundles the native code of many
+precompiled modules. The library is loaded with a single `dlopen`, and the
+interpreter resolves symbols against its handle directly instead of scanning
+every loaded library, which is significantly faster when many dynlibs are
+loaded.
+-/
+@[extern "lean_load_dynlib_bundle"]
+opaque loadDynlibBundle (path : @& System.FilePath) : IO Unit
@@ -43,6 +43,7 @@ namespace Attr
 @[builtin_attr_parser] def «instance»       := leading_parser "instance" >> optional priorityParser
 @[builtin_attr_parser] def default_instance := leading_parser nonReservedSymbol "default_instance " >> optional priorityParser
 @[builtin_attr_parser] def «specialize»     := leading_parser (nonReservedSymbol "specialize") >> many (ident <|> numLit)
+@[builtin_attr_parser] def field_order      := leading_parser (nonReservedSymbol "field_order") >> many ident
 
 def externEntry := leading_parser optional ident >> optional (nonReservedSymbol "inline ") >> strLit
 @[builtin_attr_parser] def extern     := leading_parser nonReservedSymbol "extern " >> optional numLit >> many externEntry
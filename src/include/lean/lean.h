@@ -35,10 +35,25 @@ extern "C" {
 #define LEAN_UNLIKELY(x) (__builtin_expect((x), 0))
 #define LEAN_LIKELY(x) (__builtin_expect((x), 1))
 #define LEAN_ALWAYS_INLINE __attribute__((always_inline))
+/* Paths calling a `cold` function are treated as unlikely and laid out away from the hot
+   code (e.g. in `.text.unlikely`), keeping panic/rollback sequences out of the icache. */
+#define LEAN_COLD __attribute__((cold))
 #else
 #define LEAN_UNLIKELY(x) (x)
 #define LEAN_LIKELY(x) (x)
 #define LEAN_ALWAYS_INLINE
+#define LEAN_COLD
+#endif
+
+/* Guaranteed tail call, used by the code generator for mutual tail recursion. Falls back
+   to a plain `return`, which relies on the C compiler's sibling-call optimization. */
+#if defined(__clang__) && defined(__has_attribute)
+#if __has_attribute(musttail)
+#define LEAN_MUSTTAIL __attribute__((musttail))
+#endif
+#endif
+#ifndef LEAN_MUSTTAIL
+#define LEAN_MUSTTAIL
 #endif
 
 #ifndef assert
@@ -209,6 +224,29 @@ typedef struct {
     // If true, task will not be freed until finished
     uint8_t              m_keep_alive;
     uint8_t              m_deleted;
+    /* True once the task has exhausted its cooperative timeslice (see
+       `LEAN_TASK_TIMESLICE`); it is then scheduled at background priority. */
+    uint8_t              m_demoted;
+    /* Heartbeats consumed by the task's completed execution steps, maintained by
+       the task manager when timeslice or allocation-budget accounting is enabled. */
+    size_t               m_elapsed;
+    /* Allocation budget (in heartbeats, i.e. small allocations) for the whole task;
+       0 means unlimited. Exceeding it cancels the task cooperatively, see
+       `IO.setTaskMaxAllocs`. */
+    size_t               m_max_allocs;
+    /* Optional backtrace captured when the task was spawned (LEAN_TASK_BACKTRACE),
+       reported on panic so asynchronous failures show their logical causality. */
+    void **              m_spawn_bt;
+    uint32_t             m_spawn_bt_size;
+    /* Structured cancellation scope: a task created while another task is running is
+       recorded as a child of that task, so cancelling a task cancels the whole subtree
+       of tasks it spawned (see `lean_io_cancel`). The links below are protected by the
+       task manager mutex and severed when either endpoint finishes or is deactivated;
+       they do not contribute to reference counts. */
+    struct lean_task *   m_parent;
+    struct lean_task *   m_head_child;
+    struct lean_task *   m_next_sibling;
+    struct lean_task *   m_prev_sibling;
 } lean_task_imp;
 
 /* Object of type `Task _`. The lifetime of a `lean_task` object can be represented as a state machine with atomic
@@ -288,17 +326,21 @@ typedef struct {
 static inline bool lean_is_scalar(lean_object * o) { return ((size_t)(o) & 1) == 1; }
 static inline lean_object * lean_box(size_t n) { return (lean_object*)(((size_t)(n) << 1) | 1); }
 static inline size_t lean_unbox(lean_object * o) { return (size_t)(o) >> 1; }
+/* `lean_box` as a constant expression, for use in static initializers.
+   The compiler uses it when emitting closed terms of statically known shape
+   as `static const` object definitions. */
+#define LEAN_BOX_CONST(n) ((lean_object*)(((size_t)(n) << 1) | 1))
 
 LEAN_SHARED void lean_set_exit_on_panic(bool flag);
 /* Enable/disable panic messages */
 LEAN_SHARED void lean_set_panic_messages(bool flag);
 
-LEAN_SHARED lean_object * lean_panic_fn(lean_object * default_val, lean_object * msg);
+LEAN_SHARED LEAN_COLD lean_object * lean_panic_fn(lean_object * default_val, lean_object * msg);
 
-LEAN_SHARED __attribute__((noreturn)) void lean_internal_panic(char const * msg);
-LEAN_SHARED __attribute__((noreturn)) void lean_internal_panic_out_of_memory();
-LEAN_SHARED __attribute__((noreturn)) void lean_internal_panic_unreachable();
-LEAN_SHARED __attribute__((noreturn)) void lean_internal_panic_rc_overflow();
+LEAN_SHARED LEAN_COLD __attribute__((noreturn)) void lean_internal_panic(char const * msg);
+LEAN_SHARED LEAN_COLD __attribute__((noreturn)) void lean_internal_panic_out_of_memory();
+LEAN_SHARED LEAN_COLD __attribute__((noreturn)) void lean_internal_panic_unreachable();
+LEAN_SHARED LEAN_COLD __attribute__((noreturn)) void lean_internal_panic_rc_overflow();
 
 static inline size_t lean_align(size_t v, size_t a) {
     return (v / a)*a + a * (v % a != 0);
@@ -312,8 +354,16 @@ static inline unsigned lean_get_slot_idx(unsigned sz) {
 
 LEAN_SHARED void * lean_alloc_small(unsigned sz, unsigned slot_idx);
 LEAN_SHARED void lean_free_small(void * p);
+/* Free a batch of small objects, splicing runs that live in the same page
+   into the page free list in one step. */
+LEAN_SHARED void lean_free_small_batch(void ** os, unsigned num);
 LEAN_SHARED unsigned lean_small_mem_size(void * p);
 LEAN_SHARED void lean_inc_heartbeat();
+/* Cheap stack probe: compares the stack pointer against the bound cached in TLS for the
+   current thread and aborts with a report on imminent overflow. A load and a comparison
+   on the fast path, no syscalls; intended to be inserted by the compiler into deeply
+   recursive code so overflows are caught without relying on the guard page. */
+LEAN_SHARED void lean_check_stack();
 
 #ifndef __cplusplus
 void * malloc(size_t);  // avoid including big `stdlib.h`
@@ -497,6 +547,52 @@ static inline bool lean_is_shared(lean_object * o) {
 LEAN_SHARED void lean_mark_mt(lean_object * o);
 LEAN_SHARED void lean_mark_persistent(lean_object * o);
 
+/* Pin scopes: scoped reference-count amortization for C extensions.
+
+   `lean_pin(o)` consumes one RC token of `o` and transfers it to the innermost
+   scope opened with `lean_pin_scope_begin` on the current thread; the object is
+   guaranteed to stay alive until the matching `lean_pin_scope_end`, which releases
+   all tokens pinned in the scope at once. Inside the scope the object can be
+   stored and passed as a borrowed reference (`b_lean_obj_arg`) with no further
+   inc/dec, which removes per-call RC traffic from high-frequency FFI callbacks.
+   Scopes nest like a stack and must be balanced on the same thread.
+
+   `lean_pin_array` additionally returns a pointer to the array's elements; the
+   elements are borrowed from the pinned array and hence valid until scope end. */
+LEAN_SHARED void lean_pin_scope_begin();
+LEAN_SHARED b_lean_obj_res lean_pin(lean_obj_arg o);
+LEAN_SHARED lean_object * const * lean_pin_array(lean_obj_arg a);
+LEAN_SHARED void lean_pin_scope_end();
+
+/* Weak references: non-owning cells for C extensions that key caches by object
+   identity without retaining the keys.
+
+   `lean_weak_ref_create(o)` returns a cell observing `o` without taking an RC
+   token. When `o`'s count reaches zero, the deletion walk nulls every cell
+   observing it before freeing any memory. `lean_weak_ref_get` returns `o` with
+   a fresh RC token while it is still alive, and NULL after it died; release
+   the cell itself with `lean_weak_ref_free`. Cells observing scalars always
+   succeed. A target shared between threads must be `lean_mark_mt`ed, like any
+   shared object; targets that may later be `lean_mark_persistent`ed should not
+   be observed weakly (the runtime conservatively reports them as dead).
+
+   `lean_register_finalizer(o, fn, arg)` runs `fn(arg)` after `o` died; the
+   callback is queued at deletion time and drained at safe points -- after each
+   task-manager step, or explicitly via `lean_run_pending_finalizers` -- so it
+   may acquire locks and free memory, but must not access `o`. Together these
+   let a memoization cache evict entries for dead keys instead of leaking them.
+
+   Tracking is engaged lazily: until the first cell or finalizer is registered
+   the deletion fast path pays one predictable branch. */
+typedef struct lean_weak_ref lean_weak_ref;
+LEAN_SHARED lean_weak_ref * lean_weak_ref_create(b_lean_obj_arg o);
+LEAN_SHARED lean_obj_res lean_weak_ref_get(lean_weak_ref * w);
+LEAN_SHARED void lean_weak_ref_free(lean_weak_ref * w);
+
+typedef void (*lean_finalizer_proc)(void *);
+LEAN_SHARED void lean_register_finalizer(b_lean_obj_arg o, lean_finalizer_proc fn, void * arg);
+LEAN_SHARED void lean_run_pending_finalizers();
+
 static inline void lean_set_st_header(lean_object * o, unsigned tag, unsigned other) {
     o->m_rc       = 1;
     o->m_tag      = tag;
@@ -668,9 +764,29 @@ LEAN_SHARED lean_object* lean_apply_13(lean_object* f, lean_object* a1, lean_obj
 LEAN_SHARED lean_object* lean_apply_14(lean_object* f, lean_object* a1, lean_object* a2, lean_object* a3, lean_object* a4, lean_object* a5, lean_object* a6, lean_object* a7, lean_object* a8, lean_object* a9, lean_object* a10, lean_object* a11, lean_object* a12, lean_object* a13, lean_object* a14);
 LEAN_SHARED lean_object* lean_apply_15(lean_object* f, lean_object* a1, lean_object* a2, lean_object* a3, lean_object* a4, lean_object* a5, lean_object* a6, lean_object* a7, lean_object* a8, lean_object* a9, lean_object* a10, lean_object* a11, lean_object* a12, lean_object* a13, lean_object* a14, lean_object* a15);
 LEAN_SHARED lean_object* lean_apply_16(lean_object* f, lean_object* a1, lean_object* a2, lean_object* a3, lean_object* a4, lean_object* a5, lean_object* a6, lean_object* a7, lean_object* a8, lean_object* a9, lean_object* a10, lean_object* a11, lean_object* a12, lean_object* a13, lean_object* a14, lean_object* a15, lean_object* a16);
+LEAN_SHARED lean_object* lean_apply_17(lean_object* f, lean_object* a1, lean_object* a2, lean_object* a3, lean_object* a4, lean_object* a5, lean_object* a6, lean_object* a7, lean_object* a8, lean_object* a9, lean_object* a10, lean_object* a11, lean_object* a12, lean_object* a13, lean_object* a14, lean_object* a15, lean_object* a16, lean_object* a17);
+LEAN_SHARED lean_object* lean_apply_18(lean_object* f, lean_object* a1, lean_object* a2, lean_object* a3, lean_object* a4, lean_object* a5, lean_object* a6, lean_object* a7, lean_object* a8, lean_object* a9, lean_object* a10, lean_object* a11, lean_object* a12, lean_object* a13, lean_object* a14, lean_object* a15, lean_object* a16, lean_object* a17, lean_object* a18);
+LEAN_SHARED lean_object* lean_apply_19(lean_object* f, lean_object* a1, lean_object* a2, lean_object* a3, lean_object* a4, lean_object* a5, lean_object* a6, lean_object* a7, lean_object* a8, lean_object* a9, lean_object* a10, lean_object* a11, lean_object* a12, lean_object* a13, lean_object* a14, lean_object* a15, lean_object* a16, lean_object* a17, lean_object* a18, lean_object* a19);
+LEAN_SHARED lean_object* lean_apply_20(lean_object* f, lean_object* a1, lean_object* a2, lean_object* a3, lean_object* a4, lean_object* a5, lean_object* a6, lean_object* a7, lean_object* a8, lean_object* a9, lean_object* a10, lean_object* a11, lean_object* a12, lean_object* a13, lean_object* a14, lean_object* a15, lean_object* a16, lean_object* a17, lean_object* a18, lean_object* a19, lean_object* a20);
+LEAN_SHARED lean_object* lean_apply_21(lean_object* f, lean_object* a1, lean_object* a2, lean_object* a3, lean_object* a4, lean_object* a5, lean_object* a6, lean_object* a7, lean_object* a8, lean_object* a9, lean_object* a10, lean_object* a11, lean_object* a12, lean_object* a13, lean_object* a14, lean_object* a15, lean_object* a16, lean_object* a17, lean_object* a18, lean_object* a19, lean_object* a20, lean_object* a21);
+LEAN_SHARED lean_object* lean_apply_22(lean_object* f, lean_object* a1, lean_object* a2, lean_object* a3, lean_object* a4, lean_object* a5, lean_object* a6, lean_object* a7, lean_object* a8, lean_object* a9, lean_object* a10, lean_object* a11, lean_object* a12, lean_object* a13, lean_object* a14, lean_object* a15, lean_object* a16, lean_object* a17, lean_object* a18, lean_object* a19, lean_object* a20, lean_object* a21, lean_object* a22);
+LEAN_SHARED lean_object* lean_apply_23(lean_object* f, lean_object* a1, lean_object* a2, lean_object* a3, lean_object* a4, lean_object* a5, lean_object* a6, lean_object* a7, lean_object* a8, lean_object* a9, lean_object* a10, lean_object* a11, lean_object* a12, lean_object* a13, lean_object* a14, lean_object* a15, lean_object* a16, lean_object* a17, lean_object* a18, lean_object* a19, lean_object* a20, lean_object* a21, lean_object* a22, lean_object* a23);
+LEAN_SHARED lean_object* lean_apply_24(lean_object* f, lean_object* a1, lean_object* a2, lean_object* a3, lean_object* a4, lean_object* a5, lean_object* a6, lean_object* a7, lean_object* a8, lean_object* a9, lean_object* a10, lean_object* a11, lean_object* a12, lean_object* a13, lean_object* a14, lean_object* a15, lean_object* a16, lean_object* a17, lean_object* a18, lean_object* a19, lean_object* a20, lean_object* a21, lean_object* a22, lean_object* a23, lean_object* a24);
+LEAN_SHARED lean_object* lean_apply_25(lean_object* f, lean_object* a1, lean_object* a2, lean_object* a3, lean_object* a4, lean_object* a5, lean_object* a6, lean_object* a7, lean_object* a8, lean_object* a9, lean_object* a10, lean_object* a11, lean_object* a12, lean_object* a13, lean_object* a14, lean_object* a15, lean_object* a16, lean_object* a17, lean_object* a18, lean_object* a19, lean_object* a20, lean_object* a21, lean_object* a22, lean_object* a23, lean_object* a24, lean_object* a25);
+LEAN_SHARED lean_object* lean_apply_26(lean_object* f, lean_object* a1, lean_object* a2, lean_object* a3, lean_object* a4, lean_object* a5, lean_object* a6, lean_object* a7, lean_object* a8, lean_object* a9, lean_object* a10, lean_object* a11, lean_object* a12, lean_object* a13, lean_object* a14, lean_object* a15, lean_object* a16, lean_object* a17, lean_object* a18, lean_object* a19, lean_object* a20, lean_object* a21, lean_object* a22, lean_object* a23, lean_object* a24, lean_object* a25, lean_object* a26);
+LEAN_SHARED lean_object* lean_apply_27(lean_object* f, lean_object* a1, lean_object* a2, lean_object* a3, lean_object* a4, lean_object* a5, lean_object* a6, lean_object* a7, lean_object* a8, lean_object* a9, lean_object* a10, lean_object* a11, lean_object* a12, lean_object* a13, lean_object* a14, lean_object* a15, lean_object* a16, lean_object* a17, lean_object* a18, lean_object* a19, lean_object* a20, lean_object* a21, lean_object* a22, lean_object* a23, lean_object* a24, lean_object* a25, lean_object* a26, lean_object* a27);
+LEAN_SHARED lean_object* lean_apply_28(lean_object* f, lean_object* a1, lean_object* a2, lean_object* a3, lean_object* a4, lean_object* a5, lean_object* a6, lean_object* a7, lean_object* a8, lean_object* a9, lean_object* a10, lean_object* a11, lean_object* a12, lean_object* a13, lean_object* a14, lean_object* a15, lean_object* a16, lean_object* a17, lean_object* a18, lean_object* a19, lean_object* a20, lean_object* a21, lean_object* a22, lean_object* a23, lean_object* a24, lean_object* a25, lean_object* a26, lean_object* a27, lean_object* a28);
+LEAN_SHARED lean_object* lean_apply_29(lean_object* f, lean_object* a1, lean_object* a2, lean_object* a3, lean_object* a4, lean_object* a5, lean_object* a6, lean_object* a7, lean_object* a8, lean_object* a9, lean_object* a10, lean_object* a11, lean_object* a12, lean_object* a13, lean_object* a14, lean_object* a15, lean_object* a16, lean_object* a17, lean_object* a18, lean_object* a19, lean_object* a20, lean_object* a21, lean_object* a22, lean_object* a23, lean_object* a24, lean_object* a25, lean_object* a26, lean_object* a27, lean_object* a28, lean_object* a29);
+LEAN_SHARED lean_object* lean_apply_30(lean_object* f, lean_object* a1, lean_object* a2, lean_object* a3, lean_object* a4, lean_object* a5, lean_object* a6, lean_object* a7, lean_object* a8, lean_object* a9, lean_object* a10, lean_object* a11, lean_object* a12, lean_object* a13, lean_object* a14, lean_object* a15, lean_object* a16, lean_object* a17, lean_object* a18, lean_object* a19, lean_object* a20, lean_object* a21, lean_object* a22, lean_object* a23, lean_object* a24, lean_object* a25, lean_object* a26, lean_object* a27, lean_object* a28, lean_object* a29, lean_object* a30);
+LEAN_SHARED lean_object* lean_apply_31(lean_object* f, lean_object* a1, lean_object* a2, lean_object* a3, lean_object* a4, lean_object* a5, lean_object* a6, lean_object* a7, lean_object* a8, lean_object* a9, lean_object* a10, lean_object* a11, lean_object* a12, lean_object* a13, lean_object* a14, lean_object* a15, lean_object* a16, lean_object* a17, lean_object* a18, lean_object* a19, lean_object* a20, lean_object* a21, lean_object* a22, lean_object* a23, lean_object* a24, lean_object* a25, lean_object* a26, lean_object* a27, lean_object* a28, lean_object* a29, lean_object* a30, lean_object* a31);
+LEAN_SHARED lean_object* lean_apply_32(lean_object* f, lean_object* a1, lean_object* a2, lean_object* a3, lean_object* a4, lean_object* a5, lean_object* a6, lean_object* a7, lean_object* a8, lean_object* a9, lean_object* a10, lean_object* a11, lean_object* a12, lean_object* a13, lean_object* a14, lean_object* a15, lean_object* a16, lean_object* a17, lean_object* a18, lean_object* a19, lean_object* a20, lean_object* a21, lean_object* a22, lean_object* a23, lean_object* a24, lean_object* a25, lean_object* a26, lean_object* a27, lean_object* a28, lean_object* a29, lean_object* a30, lean_object* a31, lean_object* a32);
 LEAN_SHARED lean_object* lean_apply_n(lean_object* f, unsigned n, lean_object** args);
 /* Pre: n > 16 */
 LEAN_SHARED lean_object* lean_apply_m(lean_object* f, unsigned n, lean_object** args);
+/* Like `lean_apply_n`, but optimized for callers that statically know the argument
+   count: an exactly saturating call to a closure with no fixed arguments invokes the
+   function pointer directly, skipping the arity dispatch. */
+LEAN_SHARED lean_object* lean_closure_direct_call_n(lean_object* f, unsigned n, lean_object** args);
 
 /* Arrays of objects (low level API) */
 static inline lean_obj_res lean_alloc_array(size_t size, size_t capacity) {
@@ -823,6 +939,7 @@ static inline lean_object * lean_array_swap(lean_obj_arg a, b_lean_obj_arg i, b_
 
 LEAN_SHARED lean_object * lean_array_push(lean_obj_arg a, lean_obj_arg v);
 LEAN_SHARED lean_object * lean_mk_array(lean_obj_arg n, lean_obj_arg v);
+LEAN_SHARED lean_obj_res lean_array_map_inplace(lean_obj_arg f, lean_obj_arg a);
 
 /* Array of scalars */
 
@@ -883,6 +1000,17 @@ static inline uint8_t lean_byte_array_fget(b_lean_obj_arg a, b_lean_obj_arg i) {
 }
 
 LEAN_SHARED lean_obj_res lean_byte_array_push(lean_obj_arg a, uint8_t b);
+LEAN_SHARED lean_obj_res lean_byte_array_find(b_lean_obj_arg a, uint8_t b, lean_obj_arg start);
+LEAN_SHARED uint64_t lean_byte_array_hash(b_lean_obj_arg a);
+
+/* Streaming JSON encoder: append a JSON fragment to a `ByteArray` used as an
+   output buffer, without building intermediate strings. */
+LEAN_SHARED lean_obj_res lean_json_write_null(lean_obj_arg a);
+LEAN_SHARED lean_obj_res lean_json_write_bool(lean_obj_arg a, uint8_t b);
+LEAN_SHARED lean_obj_res lean_json_write_str(lean_obj_arg a, b_lean_obj_arg s);
+LEAN_SHARED lean_obj_res lean_json_write_nat(lean_obj_arg a, b_lean_obj_arg n);
+LEAN_SHARED lean_obj_res lean_json_write_int(lean_obj_arg a, b_lean_obj_arg i);
+LEAN_SHARED lean_obj_res lean_json_write_float(lean_obj_arg a, double f);
 
 static inline lean_object * lean_byte_array_uset(lean_obj_arg a, size_t i, uint8_t v) {
     lean_obj_res r;
@@ -948,6 +1076,9 @@ static inline double lean_float_array_get(b_lean_obj_arg a, b_lean_obj_arg i) {
 }
 
 LEAN_SHARED lean_obj_res lean_float_array_push(lean_obj_arg a, double d);
+LEAN_SHARED double lean_float_array_sum(b_lean_obj_arg a);
+LEAN_SHARED double lean_float_array_dot(b_lean_obj_arg a, b_lean_obj_arg b);
+LEAN_SHARED lean_obj_res lean_float_array_scale(double s, lean_obj_arg a);
 
 static inline lean_obj_res lean_float_array_uset(lean_obj_arg a, size_t i, double d) {
     lean_obj_res r;
@@ -987,12 +1118,26 @@ static inline lean_obj_res lean_alloc_string(size_t size, size_t capacity, size_
 }
 LEAN_SHARED size_t lean_utf8_strlen(char const * str);
 LEAN_SHARED size_t lean_utf8_n_strlen(char const * str, size_t n);
+LEAN_SHARED size_t lean_utf8_n_strlen16(char const * str, size_t n);
 static inline size_t lean_string_capacity(lean_object * o) { return lean_to_string(o)->m_capacity; }
 static inline size_t lean_string_byte_size(lean_object * o) { return sizeof(lean_string_object) + lean_string_capacity(o); }
 /* instance : inhabited char := ⟨'A'⟩ */
 static inline uint32_t lean_char_default_value() { return 'A'; }
 LEAN_SHARED lean_obj_res lean_mk_string_from_bytes(char const * s, size_t sz);
+/* Like `lean_mk_string_from_bytes`, but returns a canonical persistent object shared by
+   all occurrences of the same literal in the process. The compiler uses it to materialize
+   string literals during module initialization. The result must not be freed. */
+LEAN_SHARED lean_obj_res lean_mk_string_literal(char const * s, size_t sz);
 LEAN_SHARED lean_obj_res lean_mk_string(char const * s);
+/* Allocate an empty string with space reserved for `capacity` bytes. `lean_string_push` and
+   `lean_string_append` update exclusive strings with spare capacity in place, so reserving
+   capacity up front makes incremental string construction amortized O(1) per byte. */
+static inline lean_obj_res lean_mk_empty_string(b_lean_obj_arg capacity) {
+    if (!lean_is_scalar(capacity)) lean_internal_panic_out_of_memory();
+    lean_obj_res r = lean_alloc_string(1, lean_unbox(capacity) + 1, 0);
+    lean_to_string(r)->m_data[0] = 0;
+    return r;
+}
 static inline char const * lean_string_cstr(b_lean_obj_arg o) {
     assert(lean_is_string(o));
     return lean_to_string(o)->m_data;
@@ -1025,8 +1170,12 @@ LEAN_SHARED uint64_t lean_string_hash(b_lean_obj_arg);
 
 /* Thunks */
 
+/* Thunk and task object headers have the same size and are allocated through a
+   dedicated per-thread recycling pool in the runtime; see `object.cpp`. */
+LEAN_SHARED lean_object * lean_alloc_thunk_task_object();
+
 static inline lean_obj_res lean_mk_thunk(lean_obj_arg c) {
-    lean_thunk_object * o = (lean_thunk_object*)lean_alloc_small_object(sizeof(lean_thunk_object));
+    lean_thunk_object * o = (lean_thunk_object*)lean_alloc_thunk_task_object();
     lean_set_st_header((lean_object*)o, LeanThunk, 0);
     o->m_value   = (lean_object*)0;
     o->m_closure = c;
@@ -1035,7 +1184,7 @@ static inline lean_obj_res lean_mk_thunk(lean_obj_arg c) {
 
 /* Thunk.pure : A -> Thunk A */
 static inline lean_obj_res lean_thunk_pure(lean_obj_arg v) {
-    lean_thunk_object * o = (lean_thunk_object*)lean_alloc_small_object(sizeof(lean_thunk_object));
+    lean_thunk_object * o = (lean_thunk_object*)lean_alloc_thunk_task_object();
     lean_set_st_header((lean_object*)o, LeanThunk, 0);
     o->m_value   = v;
     o->m_closure = (lean_object*)0;
@@ -1062,12 +1211,20 @@ static inline lean_obj_res lean_thunk_get_own(b_lean_obj_arg t) {
 LEAN_SHARED void lean_init_task_manager();
 LEAN_SHARED void lean_init_task_manager_using(unsigned num_workers);
 LEAN_SHARED void lean_finalize_task_manager();
+/* Replace the task manager in a child created by fork(2); the parent's manager is
+   abandoned since its worker threads do not exist in the child. Only safe right
+   after fork, before the child spawns any task. */
+LEAN_SHARED void lean_reinit_task_manager_after_fork(unsigned num_workers);
 
 LEAN_SHARED lean_obj_res lean_task_spawn_core(lean_obj_arg c, unsigned prio, bool keep_alive);
 /* Run a closure `Unit -> A` as a `Task A` */
 static inline lean_obj_res lean_task_spawn(lean_obj_arg c, lean_obj_arg prio) { return lean_task_spawn_core(c, lean_unbox(prio), false); }
 /* Convert a value `a : A` into `Task A` */
 LEAN_SHARED lean_obj_res lean_task_pure(lean_obj_arg a);
+/* Spawn an array of `Unit -> A` closures as tasks with a single scheduler entry.
+   Consumes `cs` and returns the array of the corresponding tasks, in order. */
+LEAN_SHARED lean_obj_res lean_task_spawn_batch_core(lean_obj_arg cs, unsigned prio, bool keep_alive);
+static inline lean_obj_res lean_task_spawn_batch(lean_obj_arg cs, lean_obj_arg prio) { return lean_task_spawn_batch_core(cs, lean_unbox(prio), false); }
 LEAN_SHARED lean_obj_res lean_task_bind_core(lean_obj_arg x, lean_obj_arg f, unsigned prio, bool keep_alive);
 /* Task.bind (x : Task A) (f : A -> Task B) (prio : Nat) : Task B */
 static inline lean_obj_res lean_task_bind(lean_obj_arg x, lean_obj_arg f, lean_obj_arg prio) { return lean_task_bind_core(x, f, lean_unbox(prio), false); }
@@ -1131,6 +1288,8 @@ LEAN_SHARED lean_object * lean_nat_big_xor(lean_object * a1, lean_object * a2);
 LEAN_SHARED lean_obj_res lean_cstr_to_nat(char const * n);
 LEAN_SHARED lean_obj_res lean_big_usize_to_nat(size_t n);
 LEAN_SHARED lean_obj_res lean_big_uint64_to_nat(uint64_t n);
+LEAN_SHARED lean_obj_res lean_nat_repr(b_lean_obj_arg n);
+LEAN_SHARED lean_obj_res lean_int_repr(b_lean_obj_arg i);
 static inline lean_obj_res lean_usize_to_nat(size_t n) {
     if (LEAN_LIKELY(n <= LEAN_MAX_SMALL_NAT))
         return lean_box(n);
@@ -1284,6 +1443,13 @@ LEAN_SHARED lean_obj_res lean_nat_shiftl(b_lean_obj_arg a1, b_lean_obj_arg a2);
 LEAN_SHARED lean_obj_res lean_nat_shiftr(b_lean_obj_arg a1, b_lean_obj_arg a2);
 LEAN_SHARED lean_obj_res lean_nat_pow(b_lean_obj_arg a1, b_lean_obj_arg a2);
 LEAN_SHARED lean_obj_res lean_nat_gcd(b_lean_obj_arg a1, b_lean_obj_arg a2);
+LEAN_SHARED lean_obj_res lean_nat_mulmod(b_lean_obj_arg a, b_lean_obj_arg b, b_lean_obj_arg n);
+LEAN_SHARED lean_obj_res lean_nat_powmod(b_lean_obj_arg a, b_lean_obj_arg b, b_lean_obj_arg n);
+/* `acc + a` resp. `acc * a`, consuming `acc`: when `acc` is an unshared bignum, the
+   result is computed in place reusing its storage, so accumulation loops avoid an
+   allocation per step. */
+LEAN_SHARED lean_obj_res lean_nat_add_acc(lean_obj_arg acc, b_lean_obj_arg a);
+LEAN_SHARED lean_obj_res lean_nat_mul_acc(lean_obj_arg acc, b_lean_obj_arg a);
 LEAN_SHARED lean_obj_res lean_nat_log2(b_lean_obj_arg a);
 
 /* Integers */
@@ -1770,6 +1936,10 @@ static inline b_lean_obj_res lean_io_result_get_value(b_lean_obj_arg r) { assert
 static inline b_lean_obj_res lean_io_result_get_error(b_lean_obj_arg r) { assert(lean_io_result_is_error(r)); return lean_ctor_get(r, 0); }
 LEAN_SHARED void lean_io_result_show_error(b_lean_obj_arg r);
 LEAN_SHARED void lean_io_mark_end_initialization();
+/* Returns a shared persistent `EStateM.Result.ok () ()` value. RC operations on it are
+   no-ops, so hot paths that would otherwise allocate a fresh unit result per call (e.g.
+   the re-entry fast path of every module initializer) can return it for free. */
+LEAN_SHARED lean_obj_res lean_io_unit_result_ok();
 static inline lean_obj_res lean_io_result_mk_ok(lean_obj_arg a) {
     lean_object * r = lean_alloc_ctor(0, 2, 0);
     lean_ctor_set(r, 0, a);
@@ -1816,6 +1986,8 @@ LEAN_SHARED lean_obj_res lean_st_ref_get(b_lean_obj_arg, lean_obj_arg);
 LEAN_SHARED lean_obj_res lean_st_ref_set(b_lean_obj_arg, lean_obj_arg, lean_obj_arg);
 LEAN_SHARED lean_obj_res lean_st_ref_reset(b_lean_obj_arg, lean_obj_arg);
 LEAN_SHARED lean_obj_res lean_st_ref_swap(b_lean_obj_arg, lean_obj_arg, lean_obj_arg);
+LEAN_SHARED lean_obj_res lean_st_ref_publish(b_lean_obj_arg, lean_obj_arg, lean_obj_arg);
+LEAN_SHARED lean_obj_res lean_st_ref_get_snapshot(b_lean_obj_arg, lean_obj_arg);
 
 /* pointer address unsafe primitive  */
 static inline size_t lean_ptr_addr(b_lean_obj_arg a) { return (size_t)a; }
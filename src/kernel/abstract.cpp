@@ -8,6 +8,7 @@ Author: Leonardo de Moura
 #include <utility>
 #include <vector>
 #include "kernel/abstract.h"
+#include "kernel/instantiate.h"
 #include "kernel/replace_fn.h"
 
 namespace lean {
@@ -15,9 +16,16 @@ expr abstract(expr const & e, unsigned n, expr const * subst) {
     lean_assert(std::all_of(subst, subst+n, [](expr const & e) { return !has_loose_bvars(e) && is_fvar(e); }));
     if (!has_fvar(e))
         return e;
+    /* Bloom summary of the variables being abstracted; subtrees whose own summary
+       does not intersect it cannot contain any of them and are not visited. */
+    uint64 mask = 0;
+    for (unsigned i = 0; i < n; i++)
+        mask |= fvar_bloom_bit(fvar_name(subst[i]));
+    if ((get_fvar_bloom(e) & mask) == 0)
+        return e;
     return replace(e, [=](expr const & m, unsigned offset) -> optional<expr> {
-            if (!has_fvar(m))
-                return some_expr(m); // expression m does not contain free variables
+            if (!has_fvar(m) || (get_fvar_bloom(m) & mask) == 0)
+                return some_expr(m); // expression m does not contain the abstracted free variables
             if (is_fvar(m)) {
                 unsigned i = n;
                 while (i > 0) {
@@ -43,9 +51,25 @@ static object * lean_expr_abstract_core(object * e0, size_t n, object * subst) {
         lean_inc(e0);
         return e0;
     }
+    /* Bloom summary of the free variables being abstracted. Metavariables are not
+       summarized, so a subtree can only be pruned by the mask if `subst` contains
+       no metavariables or the subtree contains none. */
+    uint64 fvar_mask = 0;
+    bool   mvar_in_subst = false;
+    for (size_t i = 0; i < n; i++) {
+        object * v = lean_array_get_core(subst, i);
+        if (is_fvar_core(v))
+            fvar_mask |= fvar_bloom_bit(fvar_name_core(v));
+        else if (is_mvar_core(v))
+            mvar_in_subst = true;
+    }
+    if ((!has_fvar(e) || (get_fvar_bloom(e) & fvar_mask) == 0) && !(mvar_in_subst && has_mvar(e))) {
+        lean_inc(e0);
+        return e0;
+    }
     expr r = replace(e, [=](expr const & m, unsigned offset) -> optional<expr> {
-            if (!has_fvar(m) && !has_mvar(m))
-                return some_expr(m); // expression m does not contain free/meta variables
+            if ((!has_fvar(m) || (get_fvar_bloom(m) & fvar_mask) == 0) && !(mvar_in_subst && has_mvar(m)))
+                return some_expr(m); // expression m cannot contain the abstracted free/meta variables
             bool fv = is_fvar(m);
             bool mv = is_mvar(m);
             if (fv || mv) {
@@ -75,4 +99,75 @@ extern "C" LEAN_EXPORT object * lean_expr_abstract_range(object * e, object * n,
 extern "C" LEAN_EXPORT object * lean_expr_abstract(object * e, object * subst) {
     return lean_expr_abstract_core(e, lean_array_size(subst), subst);
 }
+
+/* Fused implementation of `Expr.replaceFVars`, i.e. of
+   `(e.abstract fvars).instantiateRev vs`. The composition traverses `e` twice and
+   materializes the intermediate abstracted term; metaprograms replacing k variables one
+   at a time even pay k full round trips. Here a single traversal substitutes the
+   variables directly: an occurrence of `fvars[i]` becomes `vs[i]` (lifted by the binder
+   offset), and loose bvars are treated exactly as the composition would, so the result
+   is structurally identical, including when `fvars` and `vs` have different sizes or
+   `fvars` contains metavariables (which `abstract` also matches). Subtrees containing
+   neither a candidate variable nor a loose bvar at the current offset are not visited,
+   and `replace` supplies the pooled per-thread cache for shared subterms. */
+extern "C" LEAN_EXPORT object * lean_expr_replace_fvars(object * e0, object * fvars, object * vs) {
+    size_t n = lean_array_size(fvars);
+    size_t m = lean_array_size(vs);
+    expr const & e = reinterpret_cast<expr const &>(e0);
+    uint64 fvar_mask = 0;
+    bool   mvar_in_subst = false;
+    for (size_t i = 0; i < n; i++) {
+        object * v = lean_array_get_core(fvars, i);
+        if (is_fvar_core(v))
+            fvar_mask |= fvar_bloom_bit(fvar_name_core(v));
+        else if (is_mvar_core(v))
+            mvar_in_subst = true;
+    }
+    if ((!has_fvar(e) || (get_fvar_bloom(e) & fvar_mask) == 0) && !(mvar_in_subst && has_mvar(e)) &&
+        !has_loose_bvars(e)) {
+        lean_inc(e0);
+        return e0;
+    }
+    expr r = replace(e, [=](expr const & c, unsigned offset) -> optional<expr> {
+            bool no_vars = (!has_fvar(c) || (get_fvar_bloom(c) & fvar_mask) == 0) && !(mvar_in_subst && has_mvar(c));
+            if (no_vars && offset >= get_loose_bvar_range(c))
+                return some_expr(c); // expression c contains no candidate variable and no loose bvar with idx >= offset
+            bool fv = is_fvar(c);
+            bool mv = is_mvar(c);
+            if (fv || mv) {
+                size_t i = n;
+                while (i > 0) {
+                    --i;
+                    object * v = lean_array_get_core(fvars, i);
+                    if ((fv && is_fvar_core(v) && fvar_name_core(v) == fvar_name(c)) ||
+                        (mv && is_mvar_core(v) && mvar_name_core(v) == mvar_name(c))) {
+                        /* `abstract` would produce the bvar `offset + n - i - 1`, which
+                           `instantiateRev vs` then resolves at the same offset. */
+                        size_t j = n - i - 1;
+                        if (j < m) {
+                            object * w = lean_array_get_core(vs, m - j - 1);
+                            return some_expr(lift_loose_bvars(TO_REF(expr, w), offset));
+                        } else {
+                            return some_expr(mk_bvar(nat::of_size_t(offset + j - m)));
+                        }
+                    }
+                }
+                return none_expr();
+            }
+            if (is_bvar(c)) {
+                /* mirror the bvar rule of `instantiateRev`: loose bvars of `e` are left
+                   alone by `abstract` and then substituted or shifted by `vs.size` */
+                nat const & vidx = bvar_idx(c);
+                size_t h = offset + m;
+                if (h < offset /* overflow, h is bigger than any vidx */ || (vidx.is_small() && vidx.get_small_value() < h)) {
+                    object * w = lean_array_get_core(vs, m - (vidx.get_small_value() - offset) - 1);
+                    return some_expr(lift_loose_bvars(TO_REF(expr, w), offset));
+                } else {
+                    return some_expr(mk_bvar(vidx - nat::of_size_t(m)));
+                }
+            }
+            return none_expr();
+        });
+    return r.steal();
+}
 }
@@ -57,10 +57,28 @@ void environment::mark_quot_initialized() {
     m_obj = lean_environment_mark_quot_init(m_obj);
 }
 
+/* Lookup cost note: the constant map lives on the Lean side (`Environment.constants`,
+   an `SMap Name ConstantInfo`), which is already a two-tier structure: imported
+   declarations are loaded into a flat `HashMap` that is frozen after `finalizeImport`
+   (`SMap.switch`), and only declarations added in the current file go into the
+   persistent overlay. `Environment.find?` probes the frozen table first (`SMap.find?'`,
+   sound because entries are never overwritten), so the dominant case -- an imported
+   constant -- is a single hash probe, not a persistent-map walk. A perfect-hash
+   snapshot over the frozen tier would only save the open-addressing probe sequence
+   of that one lookup. */
 optional<constant_info> environment::find(name const & n) const {
     return to_optional<constant_info>(lean_environment_find(to_obj_arg(), n.to_obj_arg()));
 }
 
+optional<constant_info> const & constant_handle::find(environment const & env, name const & n) {
+    if (m_env && is_eqp(*m_env, env) && n == m_name)
+        return m_info;
+    m_info = env.find(n);
+    m_env  = optional<environment>(env);
+    m_name = n;
+    return m_info;
+}
+
 constant_info environment::get(name const & n) const {
     object * o = lean_environment_find(to_obj_arg(), n.to_obj_arg());
     if (is_scalar(o))
@@ -245,12 +263,100 @@ environment environment::add(declaration const & d, bool check) const {
     lean_unreachable();
 }
 
+environment environment::add_batch(std::vector<declaration> const & ds, bool check) const {
+    /* `add_core` consumes the working environment's reference, so after the first
+       declaration `new_env` holds the only reference to its record and the Lean-side
+       `addAux` updates it destructively: the whole batch commits to one record. The
+       checks below mirror the corresponding `add_*` member functions; they run against
+       the growing environment, so each member may depend on the preceding ones. */
+    environment new_env(*this);
+    for (declaration const & d : ds) {
+        switch (d.kind()) {
+        case declaration_kind::Axiom: {
+            axiom_val const & v = d.to_axiom_val();
+            if (check)
+                check_constant_val(new_env, v.to_constant_val(), !d.is_unsafe());
+            new_env.add_core(constant_info(d));
+            break;
+        }
+        case declaration_kind::Definition: {
+            definition_val const & v = d.to_definition_val();
+            if (v.is_unsafe()) {
+                /* Meta definition can be recursive; check the header, add, then check the body. */
+                if (check) {
+                    type_checker checker(new_env, false);
+                    check_constant_val(new_env, v.to_constant_val(), checker);
+                }
+                new_env.add_core(constant_info(d));
+                if (check) {
+                    type_checker checker(new_env, false);
+                    check_no_metavar_no_fvar(new_env, v.get_name(), v.get_value());
+                    expr val_type = checker.check(v.get_value(), v.get_lparams());
+                    if (!checker.is_def_eq(val_type, v.get_type()))
+                        throw definition_type_mismatch_exception(new_env, d, val_type);
+                }
+            } else {
+                if (check) {
+                    type_checker checker(new_env);
+                    check_constant_val(new_env, v.to_constant_val(), checker);
+                    check_no_metavar_no_fvar(new_env, v.get_name(), v.get_value());
+                    expr val_type = checker.check(v.get_value(), v.get_lparams());
+                    if (!checker.is_def_eq(val_type, v.get_type()))
+                        throw definition_type_mismatch_exception(new_env, d, val_type);
+                }
+                new_env.add_core(constant_info(d));
+            }
+            break;
+        }
+        case declaration_kind::Theorem: {
+            theorem_val const & v = d.to_theorem_val();
+            if (check) {
+                type_checker checker(new_env);
+                check_constant_val(new_env, v.to_constant_val(), checker);
+                check_no_metavar_no_fvar(new_env, v.get_name(), v.get_value());
+                expr val_type = checker.check(v.get_value(), v.get_lparams());
+                if (!checker.is_def_eq(val_type, v.get_type()))
+                    throw definition_type_mismatch_exception(new_env, d, val_type);
+            }
+            new_env.add_core(constant_info(d));
+            break;
+        }
+        case declaration_kind::Opaque: {
+            opaque_val const & v = d.to_opaque_val();
+            if (check) {
+                type_checker checker(new_env);
+                check_constant_val(new_env, v.to_constant_val(), checker);
+                expr val_type = checker.check(v.get_value(), v.get_lparams());
+                if (!checker.is_def_eq(val_type, v.get_type()))
+                    throw definition_type_mismatch_exception(new_env, d, val_type);
+            }
+            new_env.add_core(constant_info(d));
+            break;
+        }
+        default:
+            /* mutual/inductive/quot keep their dedicated multi-step paths */
+            new_env = new_env.add(d, check);
+            break;
+        }
+    }
+    return new_env;
+}
+
 extern "C" LEAN_EXPORT object * lean_add_decl(object * env, object * decl) {
     return catch_kernel_exceptions<environment>([&]() {
             return environment(env).add(declaration(decl, true));
         });
 }
 
+extern "C" LEAN_EXPORT object * lean_add_decls(object * env, object * decls) {
+    return catch_kernel_exceptions<environment>([&]() {
+            std::vector<declaration> ds;
+            for (object * it = decls; !is_scalar(it); it = cnstr_get(it, 1))
+                ds.push_back(declaration(cnstr_get(it, 0), true));
+            return environment(env).add_batch(ds);
+        });
+}
+
 void environment::for_each_constant(std::function<void(constant_info const & d)> const & f) const {
     smap_foreach(cnstr_get(raw(), 1), [&](object *, object * v) {
             constant_info cinfo(v, true);
@@ -74,6 +74,14 @@ public:
     /** \brief Extends the current environment with the given declaration */
     environment add(declaration const & d, bool check = true) const;
 
+    /** \brief Extends the current environment with a burst of declarations.
+
+        Unlike repeated \c add calls, the batch works on a single exclusive environment
+        object, so the per-declaration record copy is paid once per batch instead of
+        once per member. Members are checked sequentially against the growing
+        environment; later members may depend on earlier ones. */
+    environment add_batch(std::vector<declaration> const & ds, bool check = true) const;
+
     /** \brief Apply the function \c f to each constant */
     void for_each_constant(std::function<void(constant_info const & d)> const & f) const;
 
@@ -85,6 +93,31 @@ public:
     void display_stats() const;
 };
 
+/** \brief Inline cache for `environment::find`.
+
+    Elaborator, compiler and kernel passes resolve the same few constants over
+    and over (`Nat.add` alone is looked up thousands of times per file). A
+    handle remembers the last `(environment, name, result)` triple; a repeated
+    lookup against the same environment object is then a pointer compare plus
+    a name compare instead of a hash probe of the constant map. Environments
+    are immutable values, so a cached resolution is only invalidated by
+    switching to a different environment object (e.g. after the local overlay
+    gained a declaration), which the pointer compare detects. The handle keeps
+    the cached environment alive until the next miss or `reset`. */
+class constant_handle {
+    optional<environment>   m_env;
+    name                    m_name;
+    optional<constant_info> m_info;
+public:
+    constant_handle() {}
+    explicit constant_handle(name const & n):m_name(n) {}
+    /** \brief `env.find(n)`, served from the cache when `env` and `n` match the previous call. */
+    optional<constant_info> const & find(environment const & env, name const & n);
+    /** \brief `find` with the name the handle was constructed with. */
+    optional<constant_info> const & find(environment const & env) { return find(env, m_name); }
+    void reset() { m_env = optional<environment>(); m_info = optional<constant_info>(); }
+};
+
 void check_no_metavar_no_fvar(environment const & env, name const & n, expr const & e);
 
 void initialize_environment();
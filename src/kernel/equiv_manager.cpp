@@ -23,7 +23,11 @@ auto equiv_manager::find(node_ref n) -> node_ref {
         node_ref p = m_nodes[n].m_parent;
         if (p == n)
             return p;
-        n = p;
+        /* path halving: point n at its grandparent, so repeated lookups of the
+           same chain keep shortening it */
+        node_ref gp = m_nodes[p].m_parent;
+        m_nodes[n].m_parent = gp;
+        n = gp;
     }
 }
 
@@ -59,8 +63,11 @@ bool equiv_manager::is_equiv_core(expr const & a, expr const & b) {
     if (is_bvar(a) && is_bvar(b))          return bvar_idx(a) == bvar_idx(b);
     node_ref r1 = find(to_node(a));
     node_ref r2 = find(to_node(b));
-    if (r1 == r2)
+    if (r1 == r2) {
+        m_hits++;
         return true;
+    }
+    m_misses++;
     // fall back to structural equality
     if (a.kind() != b.kind())
         return false;
@@ -115,10 +122,19 @@ bool equiv_manager::is_equiv_core(expr const & a, expr const & b) {
 }
 
 bool equiv_manager::is_equiv(expr const & a, expr const & b, bool use_hash) {
+    if (m_nodes.size() >= m_capacity)
+        clear();
     flet<bool> set(m_use_hash, use_hash);
     return is_equiv_core(a, b);
 }
 
+void equiv_manager::clear() {
+    /* the table only caches re-derivable equivalences, so resetting it is sound;
+       the counters deliberately survive so they describe the whole lifetime */
+    m_nodes.clear();
+    m_to_node.clear();
+}
+
 void equiv_manager::add_equiv(expr const & e1, expr const & e2) {
     node_ref r1 = to_node(e1);
     node_ref r2 = to_node(e2);
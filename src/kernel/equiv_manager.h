@@ -8,7 +8,17 @@ Author: Leonardo de Moura
 #include <vector>
 #include "kernel/expr_maps.h"
 
+#ifndef LEAN_EQUIV_MANAGER_CAPACITY
+#define LEAN_EQUIV_MANAGER_CAPACITY 1024*16
+#endif
+
 namespace lean {
+/* Union-find over expressions recording equivalences discovered by def-eq checks.
+   It lives in a type_checker::state, so the equivalences persist across all checker
+   invocations sharing that state; when the table reaches its capacity it is reset
+   wholesale (the content is only a cache of re-derivable facts, so dropping it is
+   always sound). The hit/miss counters cover the union-find lookup itself and can
+   be used to size the capacity for a given workload. */
 class equiv_manager {
     typedef unsigned node_ref;
 
@@ -20,6 +30,9 @@ class equiv_manager {
     std::vector<node>  m_nodes;
     expr_map<node_ref> m_to_node;
     bool               m_use_hash;
+    unsigned           m_capacity;
+    uint64             m_hits;
+    uint64             m_misses;
 
     node_ref mk_node();
     node_ref find(node_ref n);
@@ -27,8 +40,12 @@ class equiv_manager {
     node_ref to_node(expr const & e);
     bool is_equiv_core(expr const & e1, expr const & e2);
 public:
-    equiv_manager():m_use_hash(false) {}
+    equiv_manager(unsigned capacity = LEAN_EQUIV_MANAGER_CAPACITY):
+        m_use_hash(false), m_capacity(capacity), m_hits(0), m_misses(0) {}
     bool is_equiv(expr const & e1, expr const & e2, bool use_hash = false);
     void add_equiv(expr const & e1, expr const & e2);
+    void clear();
+    uint64 get_num_hits() const { return m_hits; }
+    uint64 get_num_misses() const { return m_misses; }
 };
 }
@@ -12,9 +12,13 @@ Author: Leonardo de Moura
 #include <limits>
 #include "runtime/hash.h"
 #include "runtime/buffer.h"
+#include "runtime/thread.h"
+#include "runtime/interrupt.h"
 #include "util/list_fn.h"
 #include "kernel/expr.h"
+#include "kernel/expr_maps.h"
 #include "kernel/expr_eq_fn.h"
+#include "kernel/expr_interner.h"
 #include "kernel/expr_sets.h"
 #include "kernel/for_each_fn.h"
 #include "kernel/replace_fn.h"
@@ -101,6 +105,53 @@ bool has_univ_param(expr const & e) { return lean_expr_has_level_param(e.to_obj_
 extern "C" unsigned lean_expr_loose_bvar_range(object * e);
 unsigned get_loose_bvar_range(expr const & e) { return lean_expr_loose_bvar_range(e.to_obj_arg()); }
 
+// =======================================
+// Free-variable occurrence summaries
+
+/* Capacity of the per-thread Bloom summary cache. The cache is generation-bounded
+   (see `expr_gen_map`), so memory stays bounded while summaries of recently-traversed
+   shared subterms survive across `abstract` calls. */
+#define LEAN_FVAR_BLOOM_CACHE_CAPACITY (1u << 14)
+
+MK_THREAD_LOCAL_GET(expr_gen_map<uint64>, get_fvar_bloom_cache, LEAN_FVAR_BLOOM_CACHE_CAPACITY);
+
+uint64 get_fvar_bloom(expr const & e) {
+    /* The `has_fvar` header bit bounds the traversal: subtrees without free
+       variables have an empty summary and are not visited at all. */
+    if (!has_fvar(e))
+        return 0;
+    if (is_fvar(e))
+        return fvar_bloom_bit(fvar_name(e));
+    expr_gen_map<uint64> & cache = get_fvar_bloom_cache();
+    if (uint64 const * r = cache.find(e))
+        return *r;
+    check_system("fvar_bloom");
+    uint64 r = 0;
+    switch (e.kind()) {
+    case expr_kind::BVar:   case expr_kind::Lit:
+    case expr_kind::MVar:   case expr_kind::Const:
+    case expr_kind::Sort:   case expr_kind::FVar:
+        lean_unreachable(); // LCOV_EXCL_LINE
+    case expr_kind::MData:
+        r = get_fvar_bloom(mdata_expr(e));
+        break;
+    case expr_kind::Proj:
+        r = get_fvar_bloom(proj_expr(e));
+        break;
+    case expr_kind::App:
+        r = get_fvar_bloom(app_fn(e)) | get_fvar_bloom(app_arg(e));
+        break;
+    case expr_kind::Lambda: case expr_kind::Pi:
+        r = get_fvar_bloom(binding_domain(e)) | get_fvar_bloom(binding_body(e));
+        break;
+    case expr_kind::Let:
+        r = get_fvar_bloom(let_type(e)) | get_fvar_bloom(let_value(e)) | get_fvar_bloom(let_body(e));
+        break;
+    }
+    cache.insert(e, r);
+    return r;
+}
+
 // =======================================
 // Constructors
 
@@ -138,19 +189,30 @@ extern "C" object * lean_expr_mk_const(obj_arg n, obj_arg ls);
 expr mk_const(name const & n, levels const & ls) { return expr(lean_expr_mk_const(n.to_obj_arg(), ls.to_obj_arg())); }
 
 extern "C" object * lean_expr_mk_app(obj_arg f, obj_arg a);
-expr mk_app(expr const & f, expr const & a) { return expr(lean_expr_mk_app(f.to_obj_arg(), a.to_obj_arg())); }
+expr mk_app(expr const & f, expr const & a) {
+    expr r(lean_expr_mk_app(f.to_obj_arg(), a.to_obj_arg()));
+    if (is_expr_interning_enabled())
+        return intern_expr_node(r);
+    return r;
+}
 
 extern "C" object * lean_expr_mk_sort(obj_arg l);
 expr mk_sort(level const & l) { return expr(lean_expr_mk_sort(l.to_obj_arg())); }
 
 extern "C" object * lean_expr_mk_lambda(obj_arg n, obj_arg t, obj_arg e, uint8 bi);
 expr mk_lambda(name const & n, expr const & t, expr const & e, binder_info bi) {
-    return expr(lean_expr_mk_lambda(n.to_obj_arg(), t.to_obj_arg(), e.to_obj_arg(), static_cast<uint8>(bi)));
+    expr r(lean_expr_mk_lambda(n.to_obj_arg(), t.to_obj_arg(), e.to_obj_arg(), static_cast<uint8>(bi)));
+    if (is_expr_interning_enabled())
+        return intern_expr_node(r);
+    return r;
 }
 
 extern "C" object * lean_expr_mk_forall(obj_arg n, obj_arg t, obj_arg e, uint8 bi);
 expr mk_pi(name const & n, expr const & t, expr const & e, binder_info bi) {
-    return expr(lean_expr_mk_forall(n.to_obj_arg(), t.to_obj_arg(), e.to_obj_arg(), static_cast<uint8>(bi)));
+    expr r(lean_expr_mk_forall(n.to_obj_arg(), t.to_obj_arg(), e.to_obj_arg(), static_cast<uint8>(bi)));
+    if (is_expr_interning_enabled())
+        return intern_expr_node(r);
+    return r;
 }
 
 static name * g_default_name = nullptr;
@@ -132,6 +132,16 @@ bool has_fvar(expr const & e);
 bool has_univ_param(expr const & e);
 unsigned get_loose_bvar_range(expr const & e);
 
+/** \brief Bloom filter bit for the free variable name \c n, see \c get_fvar_bloom. */
+inline uint64 fvar_bloom_bit(name const & n) { return static_cast<uint64>(1) << (n.hash() & 63); }
+/** \brief Approximate summary of the free variables occurring in \c e: a 64-bit Bloom
+    filter with one bit per free variable name. If
+    <tt>(get_fvar_bloom(e) & fvar_bloom_bit(n)) == 0</tt>, then \c n does not occur free
+    in \c e; the converse may fail due to hash collisions. Summaries are memoized in a
+    thread-local cache, so traversals such as \c abstract can prune shared subtrees
+    without descending into them. */
+uint64 get_fvar_bloom(expr const & e);
+
 struct expr_hash { unsigned operator()(expr const & e) const { return hash(e); } };
 struct expr_pair_hash {
     unsigned operator()(expr_pair const & p) const { return hash(hash(p.first), hash(p.second)); }
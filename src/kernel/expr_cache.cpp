@@ -9,7 +9,7 @@ Author: Leonardo de Moura
 namespace lean {
 expr * expr_cache::find(expr const & e) {
     unsigned i = hash(e) % m_capacity;
-    if (m_cache[i].m_expr && is_bi_equal(*m_cache[i].m_expr, e))
+    if (m_cache[i].m_stamp == m_stamp && m_cache[i].m_expr && is_bi_equal(*m_cache[i].m_expr, e))
         return &m_cache[i].m_result;
     else
         return nullptr;
@@ -17,17 +17,20 @@ expr * expr_cache::find(expr const & e) {
 
 void expr_cache::insert(expr const & e, expr const & v) {
     unsigned i = hash(e) % m_capacity;
-    if (!m_cache[i].m_expr)
-        m_used.push_back(i);
     m_cache[i].m_expr   = e;
     m_cache[i].m_result = v;
+    m_cache[i].m_stamp  = m_stamp;
 }
 
 void expr_cache::clear() {
-    for (unsigned i : m_used) {
-        m_cache[i].m_expr   = none_expr();
-        m_cache[i].m_result = expr();
+    m_stamp++;
+    if (m_stamp == 0) {
+        /* the stamp wrapped around; purge so entries stamped in the previous
+           era can never be taken for current ones */
+        for (entry & e : m_cache) {
+            e.m_expr   = none_expr();
+            e.m_result = expr();
+        }
     }
-    m_used.clear();
 }
 }
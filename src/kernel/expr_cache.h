@@ -13,17 +13,26 @@ namespace lean {
 
     \warning The insert(k, v) method overwrites andy entry (k1, v1) when
     hash(k) == hash(k1)
-*/
+
+    Invalidation is by generation stamp: `clear` bumps `m_stamp` instead of
+    walking the used slots, so releasing the cache is O(1) regardless of how
+    full it got; a slot only counts as a hit while its stamp matches. The
+    price is that stale entries keep their key/result expressions alive until
+    the slot is overwritten (or the 32-bit stamp wraps around, which purges
+    everything); these caches are small, thread-local and permanently pooled
+    (see cache_stack.h), so the bounded retention is cheaper than the clear
+    walk that used to show up in profiles. */
 class expr_cache {
     struct entry {
         optional<expr> m_expr;
         expr           m_result;
+        uint32         m_stamp{0};
     };
-    unsigned              m_capacity;
-    std::vector<entry>    m_cache;
-    std::vector<unsigned> m_used;
+    unsigned           m_capacity;
+    uint32             m_stamp;
+    std::vector<entry> m_cache;
 public:
-    expr_cache(unsigned c):m_capacity(c), m_cache(c) {}
+    expr_cache(unsigned c):m_capacity(c), m_stamp(0), m_cache(c) {}
     void insert(expr const & e, expr const & v);
     expr * find(expr const & e);
     void clear();
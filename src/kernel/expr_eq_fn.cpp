@@ -6,10 +6,13 @@ Author: Leonardo de Moura
 */
 #include <vector>
 #include <memory>
+#include <utility>
 #include "runtime/interrupt.h"
 #include "runtime/thread.h"
+#include "runtime/buffer.h"
 #include "kernel/expr.h"
 #include "kernel/expr_sets.h"
+#include "kernel/cache_stack.h"
 
 #ifndef LEAN_EQ_CACHE_CAPACITY
 #define LEAN_EQ_CACHE_CAPACITY 1024*8
@@ -20,37 +23,50 @@ struct eq_cache {
     struct entry {
         object * m_a;
         object * m_b;
+        uint32   m_stamp{0};
         entry():m_a(nullptr), m_b(nullptr) {}
     };
-    unsigned              m_capacity;
-    std::vector<entry>    m_cache;
-    std::vector<unsigned> m_used;
-    eq_cache():m_capacity(LEAN_EQ_CACHE_CAPACITY), m_cache(LEAN_EQ_CACHE_CAPACITY) {}
+    unsigned           m_capacity;
+    uint32             m_stamp;
+    std::vector<entry> m_cache;
+    eq_cache(unsigned c):m_capacity(c), m_stamp(0), m_cache(c) {}
 
     bool check(expr const & a, expr const & b) {
         if (!is_shared(a) || !is_shared(b))
             return false;
         unsigned i = hash(hash(a), hash(b)) % m_capacity;
-        if (m_cache[i].m_a == a.raw() && m_cache[i].m_b == b.raw()) {
+        if (m_cache[i].m_stamp == m_stamp && m_cache[i].m_a == a.raw() && m_cache[i].m_b == b.raw()) {
             return true;
         } else {
-            if (m_cache[i].m_a == nullptr)
-                m_used.push_back(i);
-            m_cache[i].m_a = a.raw();
-            m_cache[i].m_b = b.raw();
+            m_cache[i].m_a     = a.raw();
+            m_cache[i].m_b     = b.raw();
+            m_cache[i].m_stamp = m_stamp;
             return false;
         }
     }
 
+    /* O(1) generation-stamp release; reference-free entries, as in
+       for_each_cache. */
     void clear() {
-        for (unsigned i : m_used)
-            m_cache[i].m_a = nullptr;
-        m_used.clear();
+        m_stamp++;
+        if (m_stamp == 0) {
+            for (entry & e : m_cache)
+                e.m_a = nullptr;
+        }
     }
 };
 
-/* CACHE_RESET: No */
-MK_THREAD_LOCAL_GET_DEF(eq_cache, get_eq_cache);
+/* CACHE_RESET: No
+
+   The cache insertion in `check` is optimistic: a pair is recorded before its
+   comparison has finished, so a hit is only sound while the enclosing top-level
+   comparison is still running (a `false` anywhere makes the whole result `false`,
+   so a stale "equal" entry is never consulted afterwards). This is why each
+   `expr_eq_fn` must get its own cache and clear it when it is done: a comparison
+   nested inside another one (e.g. via `mdata_data` equality) must not see, or wipe,
+   the entries of the outer one. The cache stack gives every live instance a pooled
+   cache of its own. */
+MK_CACHE_STACK(eq_cache, LEAN_EQ_CACHE_CAPACITY)
 
 /** \brief Functional object for comparing expressions.
 
@@ -58,71 +74,97 @@ MK_THREAD_LOCAL_GET_DEF(eq_cache, get_eq_cache);
     binder information attached to lambda and Pi expressions */
 template<bool CompareBinderInfo>
 class expr_eq_fn {
-    eq_cache & m_cache;
+    eq_cache_ref m_cache;
 
     static void check_system() { ::lean::check_system("expression equality test"); }
 
-    bool apply(expr const & a, expr const & b) {
-        if (is_eqp(a, b))          return true;
-        if (hash(a) != hash(b))    return false;
-        if (a.kind() != b.kind())  return false;
-        if (is_bvar(a))            return bvar_idx(a) == bvar_idx(b);
-        if (m_cache.check(a, b))
-            return true;
-        /*
-           We increase the number of heartbeats here because some code (e.g., `simp`) may spend a lot of time comparing
-           `Expr`s (e.g., checking a cache with many collisions) without allocating any significant amount of memory.
-         */
-        lean_inc_heartbeat();
-        switch (a.kind()) {
-        case expr_kind::BVar:
-            lean_unreachable(); // LCOV_EXCL_LINE
-        case expr_kind::MData:
-            return
-                apply(mdata_expr(a), mdata_expr(b)) &&
-                mdata_data(a) == mdata_data(b);
-        case expr_kind::Proj:
-            return
-                apply(proj_expr(a), proj_expr(b)) &&
-                proj_sname(a) == proj_sname(b) &&
-                proj_idx(a) == proj_idx(b);
-        case expr_kind::Lit:
-            return lit_value(a) == lit_value(b);
-        case expr_kind::Const:
-            return
-                const_name(a) == const_name(b) &&
-                compare(const_levels(a), const_levels(b), [](level const & l1, level const & l2) { return l1 == l2; });
-        case expr_kind::MVar:
-            return mvar_name(a) == mvar_name(b);
-        case expr_kind::FVar:
-            return fvar_name(a) == fvar_name(b);
-        case expr_kind::App:
-            check_system();
-            return
-                apply(app_fn(a), app_fn(b)) &&
-                apply(app_arg(a), app_arg(b));
-        case expr_kind::Lambda: case expr_kind::Pi:
-            check_system();
-            return
-                apply(binding_domain(a), binding_domain(b)) &&
-                apply(binding_body(a), binding_body(b)) &&
-                (!CompareBinderInfo || binding_name(a) == binding_name(b)) &&
-                (!CompareBinderInfo || binding_info(a) == binding_info(b));
-        case expr_kind::Let:
-            check_system();
-            return
-                apply(let_type(a), let_type(b)) &&
-                apply(let_value(a), let_value(b)) &&
-                apply(let_body(a), let_body(b)) &&
-                (!CompareBinderInfo || let_name(a) == let_name(b));
-        case expr_kind::Sort:
-            return sort_level(a) == sort_level(b);
+    /* The traversal is an explicit worklist instead of native recursion: deeply nested
+       applications produced by generated code would otherwise run into the stack guard
+       and abort a comparison that is otherwise cheap. Scalar fields are compared before
+       the children of a node are pushed; any mismatch decides the whole comparison. */
+    bool apply(expr const & a0, expr const & b0) {
+        buffer<pair<expr const &, expr const &>> todo;
+        todo.emplace_back(a0, b0);
+        while (!todo.empty()) {
+            auto p = todo.back();
+            todo.pop_back();
+            expr const & a = p.first;
+            expr const & b = p.second;
+            if (is_eqp(a, b))         continue;
+            if (hash(a) != hash(b))   return false;
+            if (a.kind() != b.kind()) return false;
+            if (is_bvar(a)) {
+                if (bvar_idx(a) != bvar_idx(b))
+                    return false;
+                continue;
+            }
+            if (m_cache->check(a, b))
+                continue;
+            /*
+               We increase the number of heartbeats here because some code (e.g., `simp`) may spend a lot of time comparing
+               `Expr`s (e.g., checking a cache with many collisions) without allocating any significant amount of memory.
+             */
+            lean_inc_heartbeat();
+            switch (a.kind()) {
+            case expr_kind::BVar:
+                lean_unreachable(); // LCOV_EXCL_LINE
+            case expr_kind::MData:
+                if (!(mdata_data(a) == mdata_data(b)))
+                    return false;
+                todo.emplace_back(mdata_expr(a), mdata_expr(b));
+                break;
+            case expr_kind::Proj:
+                if (!(proj_sname(a) == proj_sname(b)) || proj_idx(a) != proj_idx(b))
+                    return false;
+                todo.emplace_back(proj_expr(a), proj_expr(b));
+                break;
+            case expr_kind::Lit:
+                if (!(lit_value(a) == lit_value(b)))
+                    return false;
+                break;
+            case expr_kind::Const:
+                if (!(const_name(a) == const_name(b)) ||
+                    !compare(const_levels(a), const_levels(b), [](level const & l1, level const & l2) { return l1 == l2; }))
+                    return false;
+                break;
+            case expr_kind::MVar:
+                if (!(mvar_name(a) == mvar_name(b)))
+                    return false;
+                break;
+            case expr_kind::FVar:
+                if (!(fvar_name(a) == fvar_name(b)))
+                    return false;
+                break;
+            case expr_kind::App:
+                check_system();
+                todo.emplace_back(app_arg(a), app_arg(b));
+                todo.emplace_back(app_fn(a), app_fn(b));
+                break;
+            case expr_kind::Lambda: case expr_kind::Pi:
+                check_system();
+                if (CompareBinderInfo &&
+                    (!(binding_name(a) == binding_name(b)) || binding_info(a) != binding_info(b)))
+                    return false;
+                todo.emplace_back(binding_body(a), binding_body(b));
+                todo.emplace_back(binding_domain(a), binding_domain(b));
+                break;
+            case expr_kind::Let:
+                check_system();
+                if (CompareBinderInfo && !(let_name(a) == let_name(b)))
+                    return false;
+                todo.emplace_back(let_body(a), let_body(b));
+                todo.emplace_back(let_value(a), let_value(b));
+                todo.emplace_back(let_type(a), let_type(b));
+                break;
+            case expr_kind::Sort:
+                if (!(sort_level(a) == sort_level(b)))
+                    return false;
+                break;
+            }
         }
-        lean_unreachable(); // LCOV_EXCL_LINE
+        return true;
     }
 public:
-    expr_eq_fn():m_cache(get_eq_cache()) {}
-    ~expr_eq_fn() { m_cache.clear(); }
     bool operator()(expr const & a, expr const & b) { return apply(a, b); }
 };
 
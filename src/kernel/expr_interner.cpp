@@ -0,0 +1,89 @@
+/*
+Copyright (c) 2026 Microsoft Corporation. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#include <unordered_set>
+#include "runtime/thread.h"
+#include "runtime/interrupt.h"
+#include "kernel/expr_interner.h"
+#include "kernel/expr_eq_fn.h"
+
+namespace lean {
+/* The table is sharded by the (cached) expression hash so that concurrent
+   interning threads rarely contend on the same mutex. */
+#define LEAN_EXPR_INTERNER_NUM_SHARDS 16
+
+struct expr_interner_shard {
+    mutex m_mutex;
+    std::unordered_set<expr, expr_hash, is_bi_equal_proc> m_table;
+};
+
+static expr_interner_shard * g_shards = nullptr;
+LEAN_THREAD_VALUE(bool, g_interning, false);
+
+bool is_expr_interning_enabled() {
+    return g_interning;
+}
+
+scoped_expr_interner::scoped_expr_interner():m_old(g_interning) {
+    g_interning = true;
+}
+
+scoped_expr_interner::~scoped_expr_interner() {
+    g_interning = m_old;
+}
+
+expr intern_expr_node(expr const & e) {
+    expr_interner_shard & s = g_shards[hash(e) % LEAN_EXPR_INTERNER_NUM_SHARDS];
+    lock_guard<mutex> lock(s.m_mutex);
+    auto it = s.m_table.find(e);
+    if (it != s.m_table.end())
+        return *it;
+    /* `e` was built by this thread and is still thread-local, so it is safe to
+       mark it (and any still single-threaded subterms) multi-threaded before
+       publishing it to other interning threads. */
+    mark_mt(e.raw());
+    s.m_table.insert(e);
+    return e;
+}
+
+expr intern_expr(expr const & e) {
+    check_system("intern_expr");
+    switch (e.kind()) {
+    case expr_kind::BVar: case expr_kind::Lit:
+    case expr_kind::MVar: case expr_kind::FVar:
+    case expr_kind::Const: case expr_kind::Sort:
+        return intern_expr_node(e);
+    case expr_kind::MData:
+        return intern_expr_node(update_mdata(e, intern_expr(mdata_expr(e))));
+    case expr_kind::Proj:
+        return intern_expr_node(update_proj(e, intern_expr(proj_expr(e))));
+    case expr_kind::App: {
+        expr new_f = intern_expr(app_fn(e));
+        expr new_a = intern_expr(app_arg(e));
+        return intern_expr_node(update_app(e, new_f, new_a));
+    }
+    case expr_kind::Lambda: case expr_kind::Pi: {
+        expr new_d = intern_expr(binding_domain(e));
+        expr new_b = intern_expr(binding_body(e));
+        return intern_expr_node(update_binding(e, new_d, new_b));
+    }
+    case expr_kind::Let: {
+        expr new_t = intern_expr(let_type(e));
+        expr new_v = intern_expr(let_value(e));
+        expr new_b = intern_expr(let_body(e));
+        return intern_expr_node(update_let(e, new_t, new_v, new_b));
+    }
+    }
+    lean_unreachable(); // LCOV_EXCL_LINE
+}
+
+void initialize_expr_interner() {
+    g_shards = new expr_interner_shard[LEAN_EXPR_INTERNER_NUM_SHARDS];
+}
+
+void finalize_expr_interner() {
+    delete[] g_shards;
+    g_shards = nullptr;
+}
+}
@@ -0,0 +1,43 @@
+/*
+Copyright (c) 2026 Microsoft Corporation. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#pragma once
+#include "kernel/expr.h"
+
+namespace lean {
+/**
+   \brief Opt-in global expression interning (hash-consing).
+
+   While a thread holds a `scoped_expr_interner`, the C++ constructors
+   `mk_app`, `mk_lambda` and `mk_pi` consult a process-wide sharded table and
+   return the canonical representative of each node they build. Terms built
+   inside an interning scope are therefore maximally shared from the start,
+   and pointer-equality tests (`is_eqp`) fire without invoking `max_sharing`.
+
+   Interned expressions are marked multi-threaded before being published, so
+   the table may be consulted concurrently from several threads; each shard is
+   protected by its own mutex. The table holds strong references: canonical
+   nodes stay alive for the lifetime of the process.
+*/
+class scoped_expr_interner {
+    bool m_old;
+public:
+    scoped_expr_interner();
+    ~scoped_expr_interner();
+};
+
+/** \brief Return true iff the current thread is inside a `scoped_expr_interner`. */
+bool is_expr_interning_enabled();
+
+/** \brief Return the canonical representative for the single node \c e.
+    Children of \c e are compared structurally, so this is cheap when they are
+    already canonical. */
+expr intern_expr_node(expr const & e);
+
+/** \brief Intern \c e and all of its subterms. */
+expr intern_expr(expr const & e);
+
+void initialize_expr_interner();
+void finalize_expr_interner();
+}
@@ -8,6 +8,7 @@ Author: Leonardo de Moura
 #include <unordered_map>
 #include <functional>
 #include "kernel/expr.h"
+#include "kernel/flat_expr_map.h"
 
 namespace lean {
 // Maps based on structural equality. That is, two keys are equal iff they are structurally equal
@@ -23,4 +24,40 @@ public:
     expr_cond_bi_map(bool use_bi = false):
         std::unordered_map<expr, T, expr_hash, is_cond_bi_equal_proc>(10, expr_hash(), is_cond_bi_equal_proc(use_bi)) {}
 };
+
+/* Generation-bounded variant of expr_map. Entries are inserted into the current
+   generation; when it reaches the capacity, it becomes the previous generation
+   and the old previous generation is discarded. Lookups probe both generations
+   and promote hits, so recently-touched entries survive rotations while memory
+   stays bounded by two generations. Used for the caches of long-lived
+   type_checker states. The generations are flat_expr_maps, so the hot probe
+   path stays within one contiguous array. */
+template<typename T>
+class expr_gen_map {
+    flat_expr_map<T> m_curr;
+    flat_expr_map<T> m_prev;
+    unsigned         m_capacity;
+public:
+    explicit expr_gen_map(unsigned capacity):m_capacity(capacity) {}
+    T const * find(expr const & e) {
+        if (T const * r = m_curr.find(e))
+            return r;
+        if (T const * r = m_prev.find(e)) {
+            /* promote to the current generation */
+            return m_curr.insert(e, *r);
+        }
+        return nullptr;
+    }
+    void insert(expr const & e, T const & v) {
+        if (m_curr.size() >= m_capacity) {
+            m_prev = std::move(m_curr);
+            m_curr.clear();
+        }
+        m_curr.insert(e, v);
+    }
+    void clear() {
+        m_curr.clear();
+        m_prev.clear();
+    }
+};
 };
@@ -8,9 +8,57 @@ Author: Leonardo de Moura
 #include <unordered_set>
 #include <utility>
 #include <functional>
+#include <vector>
+#include <cstdint>
 #include "runtime/hash.h"
 #include "kernel/expr.h"
 
 namespace lean {
 typedef std::unordered_set<expr, expr_hash, std::equal_to<expr>> expr_set;
+
+/* Generation-bounded set of expression pairs with a Bloom pre-filter, the
+   set analogue of expr_gen_map. The intended use is negative caches (e.g. the
+   def-eq failure set of the type checker) where almost every query misses:
+   the miss is answered by two Bloom words without touching the backing sets,
+   and a false positive merely costs the hash-set probe it would have cost
+   anyway. Each generation has its own filter, so discarding the old
+   generation does not leave stale bits behind. */
+class expr_pair_gen_set {
+    typedef std::unordered_set<expr_pair, expr_pair_hash, expr_pair_eq> expr_pair_set;
+    static constexpr unsigned bloom_words = 1024; /* 8KB per generation */
+    unsigned              m_capacity;
+    std::vector<uint64_t> m_bloom_curr;
+    std::vector<uint64_t> m_bloom_prev;
+    expr_pair_set         m_curr;
+    expr_pair_set         m_prev;
+    static uint64_t bloom_mask(unsigned h) {
+        /* two bit positions from independent parts of the hash */
+        return (UINT64_C(1) << (h & 63)) | (UINT64_C(1) << ((h >> 6) & 63));
+    }
+    static unsigned bloom_word(unsigned h) { return (h >> 12) % bloom_words; }
+public:
+    explicit expr_pair_gen_set(unsigned capacity):
+        m_capacity(capacity), m_bloom_curr(bloom_words, 0), m_bloom_prev(bloom_words, 0) {}
+    bool contains(expr_pair const & p) const {
+        unsigned h = expr_pair_hash()(p);
+        uint64_t m = bloom_mask(h);
+        unsigned w = bloom_word(h);
+        bool in_curr = (m_bloom_curr[w] & m) == m;
+        bool in_prev = (m_bloom_prev[w] & m) == m;
+        if (!in_curr && !in_prev)
+            return false;
+        return (in_curr && m_curr.count(p) != 0) || (in_prev && m_prev.count(p) != 0);
+    }
+    void insert(expr_pair const & p) {
+        if (m_curr.size() >= m_capacity) {
+            m_prev = std::move(m_curr);
+            m_curr.clear();
+            std::swap(m_bloom_prev, m_bloom_curr);
+            std::fill(m_bloom_curr.begin(), m_bloom_curr.end(), 0);
+        }
+        unsigned h = expr_pair_hash()(p);
+        m_bloom_curr[bloom_word(h)] |= bloom_mask(h);
+        m_curr.insert(p);
+    }
+};
 }
@@ -0,0 +1,105 @@
+/*
+Copyright (c) 2026 Microsoft Corporation. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#pragma once
+#include <vector>
+#include <utility>
+#include "kernel/expr.h"
+
+namespace lean {
+/**
+   \brief Open-addressing hash map from expr to T for the kernel's hot caches.
+
+   Entries live in one contiguous, power-of-two sized array probed linearly,
+   so a lookup touches one or two cache lines instead of chasing a bucket
+   chain the way std::unordered_map does. The (cached) expression hash is
+   stored next to each slot and compared before the structural key comparison.
+
+   The map supports find/insert/clear but not erase; kernel caches never
+   remove individual entries, and the absence of tombstones keeps probe
+   sequences short.
+*/
+template<typename T>
+class flat_expr_map {
+    struct entry {
+        unsigned m_hash{0};
+        bool     m_occupied{false};
+        expr     m_key;
+        T        m_val;
+    };
+    std::vector<entry> m_entries;
+    size_t             m_size{0};
+
+    static size_t initial_capacity() { return 64; }
+
+    size_t probe_start(unsigned h) const { return h & (m_entries.size() - 1); }
+
+    entry & locate(unsigned h, expr const & e) {
+        size_t mask = m_entries.size() - 1;
+        size_t i    = h & mask;
+        while (true) {
+            entry & en = m_entries[i];
+            if (!en.m_occupied || (en.m_hash == h && en.m_key == e))
+                return en;
+            i = (i + 1) & mask;
+        }
+    }
+
+    void grow() {
+        std::vector<entry> old;
+        old.swap(m_entries);
+        m_entries.resize(old.empty() ? initial_capacity() : old.size() * 2);
+        for (entry & en : old) {
+            if (en.m_occupied) {
+                entry & dst = locate(en.m_hash, en.m_key);
+                dst = std::move(en);
+            }
+        }
+    }
+
+public:
+    flat_expr_map() {}
+
+    size_t size() const { return m_size; }
+
+    T const * find(expr const & e) const {
+        if (m_entries.empty())
+            return nullptr;
+        unsigned h  = hash(e);
+        size_t mask = m_entries.size() - 1;
+        size_t i    = h & mask;
+        while (true) {
+            entry const & en = m_entries[i];
+            if (!en.m_occupied)
+                return nullptr;
+            if (en.m_hash == h && en.m_key == e)
+                return &en.m_val;
+            i = (i + 1) & mask;
+        }
+    }
+
+    /** \brief Insert (e, v), overwriting any existing entry for \c e.
+        Return a pointer to the stored value (valid until the next insert). */
+    T const * insert(expr const & e, T const & v) {
+        /* grow at 3/4 load to keep probe sequences short */
+        if (m_entries.empty() || m_size + 1 > m_entries.size() - m_entries.size() / 4)
+            grow();
+        unsigned h = hash(e);
+        entry & en = locate(h, e);
+        if (!en.m_occupied) {
+            en.m_hash     = h;
+            en.m_occupied = true;
+            en.m_key      = e;
+            m_size++;
+        }
+        en.m_val = v;
+        return &en.m_val;
+    }
+
+    void clear() {
+        m_entries.clear();
+        m_size = 0;
+    }
+};
+}
@@ -6,9 +6,15 @@ Author: Leonardo de Moura
 */
 #include <vector>
 #include <utility>
+#include <deque>
+#include <memory>
+#include <algorithm>
+#include <unordered_set>
 #include "runtime/memory.h"
 #include "runtime/interrupt.h"
 #include "runtime/flet.h"
+#include "runtime/thread.h"
+#include "runtime/stackinfo.h"
 #include "kernel/for_each_fn.h"
 #include "kernel/cache_stack.h"
 
@@ -21,30 +27,34 @@ struct for_each_cache {
     struct entry {
         object const *    m_cell;
         unsigned          m_offset;
+        uint32            m_stamp{0};
         entry():m_cell(nullptr) {}
     };
-    unsigned              m_capacity;
-    std::vector<entry>    m_cache;
-    std::vector<unsigned> m_used;
-    for_each_cache(unsigned c):m_capacity(c), m_cache(c) {}
+    unsigned           m_capacity;
+    uint32             m_stamp;
+    std::vector<entry> m_cache;
+    for_each_cache(unsigned c):m_capacity(c), m_stamp(0), m_cache(c) {}
 
     bool visited(expr const & e, unsigned offset) {
         unsigned i = hash(hash(e), offset) % m_capacity;
-        if (m_cache[i].m_cell == e.raw() && m_cache[i].m_offset == offset) {
+        if (m_cache[i].m_stamp == m_stamp && m_cache[i].m_cell == e.raw() && m_cache[i].m_offset == offset) {
             return true;
         } else {
-            if (m_cache[i].m_cell == nullptr)
-                m_used.push_back(i);
             m_cache[i].m_cell   = e.raw();
             m_cache[i].m_offset = offset;
+            m_cache[i].m_stamp  = m_stamp;
             return false;
         }
     }
 
+    /* O(1) generation-stamp release; the entries hold no references, so there
+       is nothing to retain (see expr_cache.h). */
     void clear() {
-        for (unsigned i : m_used)
-            m_cache[i].m_cell = nullptr;
-        m_used.clear();
+        m_stamp++;
+        if (m_stamp == 0) {
+            for (entry & e : m_cache)
+                e.m_cell = nullptr;
+        }
     }
 };
 
@@ -121,4 +131,219 @@ public:
 void for_each(expr const & e, std::function<bool(expr const &, unsigned)> && f) { // NOLINT
     return for_each_fn(f)(e);
 }
+
+// =======================================
+// Parallel traversal
+
+/* Number of shards of the shared visited set. Sharding by node hash keeps workers
+   from contending on a single mutex (cf. the expr_interner shards). */
+#define LEAN_PAR_FOR_EACH_NUM_SHARDS       16
+/* Upper bound on the number of worker threads; beyond this the shared-queue and
+   visited-set synchronization dominates over extra parallelism. */
+#define LEAN_PAR_FOR_EACH_MAX_WORKERS      8
+/* The frontier is expanded sequentially until it holds this many nodes per worker
+   before any thread is spawned; small terms finish during seeding and pay nothing. */
+#define LEAN_PAR_FOR_EACH_SEED_FACTOR      4
+/* A worker donates half of its local stack to the shared queue when the stack
+   exceeds this size and other workers look starved. */
+#define LEAN_PAR_FOR_EACH_DONATE_THRESHOLD 64
+
+class par_for_each_fn {
+    struct node {
+        object const * m_cell;
+        unsigned       m_offset;
+    };
+    struct node_hash {
+        size_t operator()(std::pair<object const *, unsigned> const & p) const {
+            return hash(static_cast<unsigned>(reinterpret_cast<size_t>(p.first) >> 3), p.second);
+        }
+    };
+    struct visited_shard {
+        mutex                                                             m_mutex;
+        std::unordered_set<std::pair<object const *, unsigned>, node_hash> m_set;
+    };
+    std::function<bool(expr const &, unsigned)> const & m_f;
+    visited_shard       m_shards[LEAN_PAR_FOR_EACH_NUM_SHARDS];
+    std::deque<node>    m_queue;        // shared frontier, protected by m_queue_mutex
+    mutex               m_queue_mutex;
+    condition_variable  m_queue_cv;
+    atomic<unsigned>    m_queue_size{0}; // lock-free starvation hint, mirrors m_queue.size()
+    atomic<bool>        m_stop{false};
+    unsigned            m_num_workers{0};
+    unsigned            m_idle{0};       // protected by m_queue_mutex
+    bool                m_done{false};   // protected by m_queue_mutex
+
+    /* Exact check-and-mark; unlike the sequential `for_each_cache` it never forgets a
+       node, so every shared subterm is processed by exactly one worker. */
+    bool visited(object const * cell, unsigned offset) {
+        visited_shard & s = m_shards[hash(static_cast<unsigned>(reinterpret_cast<size_t>(cell) >> 3), offset)
+                                     % LEAN_PAR_FOR_EACH_NUM_SHARDS];
+        lock_guard<mutex> lock(s.m_mutex);
+        return !s.m_set.insert(std::make_pair(cell, offset)).second;
+    }
+
+    /* Process one node: invoke `m_f` and push the children to `local`.
+       Mirrors the sequential `for_each_fn::apply` step. */
+    void process(node const & n, std::vector<node> & local) {
+        object * o      = const_cast<object *>(n.m_cell);
+        expr const & e  = TO_REF(expr, o);
+        unsigned offset = n.m_offset;
+
+        switch (e.kind()) {
+        case expr_kind::Const: case expr_kind::BVar:
+        case expr_kind::Sort:
+            m_f(e, offset);
+            return;
+        default:
+            break;
+        }
+
+        if (is_shared(e) && visited(e.raw(), offset))
+            return;
+
+        if (!m_f(e, offset))
+            return;
+
+        switch (e.kind()) {
+        case expr_kind::Const: case expr_kind::BVar:
+        case expr_kind::Sort:  case expr_kind::Lit:
+        case expr_kind::MVar:  case expr_kind::FVar:
+            return;
+        case expr_kind::MData:
+            local.push_back(node{mdata_expr(e).raw(), offset});
+            return;
+        case expr_kind::Proj:
+            local.push_back(node{proj_expr(e).raw(), offset});
+            return;
+        case expr_kind::App:
+            local.push_back(node{app_arg(e).raw(), offset});
+            local.push_back(node{app_fn(e).raw(), offset});
+            return;
+        case expr_kind::Lambda: case expr_kind::Pi:
+            local.push_back(node{binding_body(e).raw(), offset + 1});
+            local.push_back(node{binding_domain(e).raw(), offset});
+            return;
+        case expr_kind::Let:
+            local.push_back(node{let_body(e).raw(), offset + 1});
+            local.push_back(node{let_value(e).raw(), offset});
+            local.push_back(node{let_type(e).raw(), offset});
+            return;
+        }
+    }
+
+    void finish() {
+        unique_lock<mutex> lock(m_queue_mutex);
+        m_done = true;
+        m_queue_cv.notify_all();
+    }
+
+    void donate(std::vector<node> & local) {
+        unique_lock<mutex> lock(m_queue_mutex);
+        unsigned half = local.size() / 2;
+        /* Donate the bottom half: those nodes are closest to the root and hence the
+           biggest subtrees. */
+        for (unsigned i = 0; i < half; i++)
+            m_queue.push_back(local[i]);
+        local.erase(local.begin(), local.begin() + half);
+        m_queue_size.store(static_cast<unsigned>(m_queue.size()));
+        m_queue_cv.notify_all();
+    }
+
+    void worker() {
+        save_stack_info(false);
+        std::vector<node> local;
+        while (true) {
+            if (m_stop.load()) {
+                finish();
+                return;
+            }
+            node n;
+            if (!local.empty()) {
+                n = local.back();
+                local.pop_back();
+            } else {
+                unique_lock<mutex> lock(m_queue_mutex);
+                m_idle++;
+                while (m_queue.empty()) {
+                    if (m_done || m_stop.load() || m_idle == m_num_workers) {
+                        m_done = true;
+                        m_queue_cv.notify_all();
+                        return;
+                    }
+                    m_queue_cv.wait(lock);
+                }
+                m_idle--;
+                n = m_queue.front();
+                m_queue.pop_front();
+                m_queue_size.store(static_cast<unsigned>(m_queue.size()));
+            }
+            process(n, local);
+            if (local.size() > LEAN_PAR_FOR_EACH_DONATE_THRESHOLD && m_queue_size.load() < m_num_workers)
+                donate(local);
+        }
+    }
+
+public:
+    par_for_each_fn(std::function<bool(expr const &, unsigned)> const & f):m_f(f) {}
+
+    void request_stop() { m_stop.store(true); }
+
+    void operator()(expr const & e) {
+        unsigned nw = std::min(hardware_concurrency(), unsigned(LEAN_PAR_FOR_EACH_MAX_WORKERS));
+        if (nw <= 1) {
+            for_each_fn seq(m_f);
+            seq(e);
+            return;
+        }
+        /* Seed the frontier sequentially; small terms complete here without
+           spawning a single thread. */
+        std::vector<node> frontier;
+        process(node{e.raw(), 0}, frontier);
+        while (!frontier.empty() && frontier.size() < nw * LEAN_PAR_FOR_EACH_SEED_FACTOR && !m_stop.load()) {
+            node n = frontier.back();
+            frontier.pop_back();
+            process(n, frontier);
+        }
+        if (frontier.empty() || m_stop.load())
+            return;
+        m_num_workers = nw;
+        for (node const & n : frontier)
+            m_queue.push_back(n);
+        m_queue_size.store(static_cast<unsigned>(m_queue.size()));
+        std::vector<std::unique_ptr<lthread>> threads;
+        for (unsigned i = 0; i < nw; i++)
+            threads.push_back(std::unique_ptr<lthread>(new lthread([this]() { worker(); })));
+        for (auto & t : threads)
+            t->join();
+    }
+};
+
+void par_for_each(expr const & e, std::function<bool(expr const &, unsigned)> const & f) { // NOLINT
+    par_for_each_fn fn(f);
+    fn(e);
+}
+
+optional<expr> par_find(expr const & e, std::function<bool(expr const &, unsigned)> const & p) { // NOLINT
+    atomic<object const *> found(nullptr);
+    par_for_each_fn * fn_ptr = nullptr;
+    std::function<bool(expr const &, unsigned)> f = [&](expr const & m, unsigned offset) {
+        if (found.load() != nullptr)
+            return false;
+        if (p(m, offset)) {
+            object const * expected = nullptr;
+            found.compare_exchange_strong(expected, m.raw());
+            fn_ptr->request_stop();
+            return false;
+        }
+        return true;
+    };
+    par_for_each_fn fn(f);
+    fn_ptr = &fn;
+    fn(e);
+    /* All workers have been joined; taking a reference to the matched subterm is
+       single-threaded again and the root keeps it alive. */
+    if (object const * r = found.load())
+        return some_expr(expr(const_cast<object *>(r), true));
+    return none_expr();
+}
 }
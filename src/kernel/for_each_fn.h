@@ -24,4 +24,23 @@ namespace lean {
     The \c offset is the number of binders under which \c e occurs.
 */
 void for_each(expr const & e, std::function<bool(expr const &, unsigned)> && f); // NOLINT
+
+/** \brief Parallel variant of \c for_each for read-only predicates over very large terms.
+
+    The DAG frontier is partitioned across worker threads that share an exact concurrent
+    visited set, so every shared subterm is still visited exactly once. Small terms are
+    fully processed while seeding the frontier and never spawn a thread; without
+    multi-threading support the traversal degrades to the sequential \c for_each.
+
+    \remark \c f is invoked concurrently, so it must be thread-safe, and it must not
+    retain references to subterms (the term may use non-atomic reference counting).
+    Visit order is unspecified. */
+void par_for_each(expr const & e, std::function<bool(expr const &, unsigned)> const & f); // NOLINT
+
+/** \brief Parallel variant of \c find (see \c find_fn.h) with cooperative early exit:
+    once some worker finds a match, the remaining workers stop at the next node
+    boundary. Returns an arbitrary (not necessarily the first in traversal order)
+    subexpression satisfying \c p. The same thread-safety requirements as
+    \c par_for_each apply to \c p. */
+optional<expr> par_find(expr const & e, std::function<bool(expr const &, unsigned)> const & p); // NOLINT
 }
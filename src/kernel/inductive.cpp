@@ -6,6 +6,7 @@ Author: Leonardo de Moura
 */
 #include "runtime/sstream.h"
 #include "runtime/utf8.h"
+#include "runtime/interrupt.h"
 #include "util/name_generator.h"
 #include "kernel/environment.h"
 #include "kernel/type_checker.h"
@@ -125,6 +126,14 @@ class add_inductive_fn {
     environment            m_env;
     name_generator         m_ngen;
     local_ctx              m_lctx;
+    /* Shared type checker state. The whnf/infer/instantiation caches and the def-eq
+       failure set are reused across every check performed while adding the
+       declaration; code-generated inductives with hundreds of constructors repeat
+       the same parameter telescopes and motive applications over and over, and a
+       fresh state per query (the previous behavior of `tc()`) made each of them pay
+       full price. Reuse across the `add_core` steps is sound because the
+       environment only grows while the declaration is added. */
+    type_checker::state    m_st;
     names      m_lparams;
     unsigned               m_nparams;
     bool                   m_is_unsafe;
@@ -159,7 +168,7 @@ class add_inductive_fn {
 
 public:
     add_inductive_fn(environment const & env, inductive_decl const & decl, bool is_nested):
-        m_env(env), m_ngen(*g_ind_fresh), m_lparams(decl.get_lparams()), m_is_unsafe(decl.is_unsafe()),
+        m_env(env), m_ngen(*g_ind_fresh), m_st(env), m_lparams(decl.get_lparams()), m_is_unsafe(decl.is_unsafe()),
         m_is_nested(is_nested) {
         if (!decl.get_nparams().is_small())
             throw kernel_exception(env, "invalid inductive datatype, number of parameters is too big");
@@ -167,7 +176,12 @@ public:
         to_buffer(decl.get_types(), m_ind_types);
     }
 
-    type_checker tc() { return type_checker(m_env, m_lctx, !m_is_unsafe); }
+    type_checker tc() {
+        /* the environment is extended in stages (types, constructors, recursors);
+           refresh the state's copy so later checks see the new constants */
+        m_st.env() = m_env;
+        return type_checker(m_st, m_lctx, !m_is_unsafe);
+    }
 
     /** Return type of the parameter at position `i` */
     expr get_param_type(unsigned i) const {
@@ -267,6 +281,7 @@ public:
             for (constructor const & cnstr : ind_type.get_cnstrs()) {
                 expr t = constructor_type(cnstr);
                 while (is_pi(t)) {
+                    check_system_batched("inductive declaration");
                     if (find(binding_domain(t), [&](expr const & e, unsigned) {
                                 if (is_constant(e)) {
                                     for (expr const & I : m_ind_cnsts)
@@ -296,6 +311,7 @@ public:
             for (constructor const & cnstr : ind_type.get_cnstrs()) {
                 expr t = constructor_type(cnstr);
                 while (is_pi(t)) {
+                    check_system_batched("inductive declaration");
                     expr arg_type = binding_domain(t);
                     if (is_pi(arg_type) && has_ind_occ(arg_type))
                         return true;
@@ -379,6 +395,7 @@ public:
 
     /** \brief Check if \c t contains only positive occurrences of the inductive datatypes being declared. */
     void check_positivity(expr t, name const & cnstr_name, int arg_idx) {
+        check_system_batched("inductive declaration");
         t = whnf(t);
         if (!has_ind_occ(t)) {
             // nonrecursive argument
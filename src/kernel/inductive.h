@@ -72,9 +72,10 @@ inline expr to_cnstr_when_structure(environment const & env, name const & induct
     return expand_eta_struct(env, e_type, e);
 }
 
-template<typename WHNF, typename INFER, typename IS_DEF_EQ>
+template<typename WHNF, typename INFER, typename IS_DEF_EQ, typename INST>
 inline optional<expr> inductive_reduce_rec(environment const & env, expr const & e,
-                                           WHNF const & whnf, INFER const & infer_type, IS_DEF_EQ const & is_def_eq) {
+                                           WHNF const & whnf, INFER const & infer_type, IS_DEF_EQ const & is_def_eq,
+                                           INST const & inst_lparams) {
     expr const & rec_fn   = get_app_fn(e);
     if (!is_constant(rec_fn)) return none_expr();
     optional<constant_info> rec_info = env.find(const_name(rec_fn));
@@ -101,7 +102,7 @@ inline optional<expr> inductive_reduce_rec(environment const & env, expr const &
     get_app_args(major, major_args);
     if (rule->get_nfields() > major_args.size()) return none_expr();
     if (length(const_levels(rec_fn)) != length(rec_info->get_lparams())) return none_expr();
-    expr rhs = instantiate_lparams(rule->get_rhs(), rec_info->get_lparams(), const_levels(rec_fn));
+    expr rhs = inst_lparams(rule->get_rhs(), rec_info->get_lparams(), const_levels(rec_fn));
     /* apply parameters, motives and minor premises from recursor application. */
     rhs      = mk_app(rhs, rec_val.get_nparams() + rec_val.get_nmotives() + rec_val.get_nminors(), rec_args.data());
     /* The number of parameters in the constructor is not necessarily
@@ -118,6 +119,15 @@ inline optional<expr> inductive_reduce_rec(environment const & env, expr const &
     return some_expr(rhs);
 }
 
+template<typename WHNF, typename INFER, typename IS_DEF_EQ>
+inline optional<expr> inductive_reduce_rec(environment const & env, expr const & e,
+                                           WHNF const & whnf, INFER const & infer_type, IS_DEF_EQ const & is_def_eq) {
+    return inductive_reduce_rec(env, e, whnf, infer_type, is_def_eq,
+                                [](expr const & rhs, names const & lps, levels const & ls) {
+                                    return instantiate_lparams(rhs, lps, ls);
+                                });
+}
+
 template<typename WHNF, typename IS_STUCK>
 optional<expr> inductive_is_stuck(environment const & env, expr const & e, WHNF const & whnf, IS_STUCK const & is_stuck) {
     expr const & rec_fn   = get_app_fn(e);
@@ -7,16 +7,20 @@ Author: Leonardo de Moura
 #include "kernel/environment.h"
 #include "kernel/type_checker.h"
 #include "kernel/expr.h"
+#include "kernel/expr_interner.h"
 #include "kernel/level.h"
 #include "kernel/declaration.h"
 #include "kernel/local_ctx.h"
 #include "kernel/inductive.h"
 #include "kernel/quot.h"
+#include "kernel/instantiate.h"
 
 namespace lean {
 void initialize_kernel_module() {
     initialize_level();
     initialize_expr();
+    initialize_expr_interner();
+    initialize_instantiate();
     initialize_declaration();
     initialize_type_checker();
     initialize_environment();
@@ -32,6 +36,8 @@ void finalize_kernel_module() {
     finalize_environment();
     finalize_type_checker();
     finalize_declaration();
+    finalize_instantiate();
+    finalize_expr_interner();
     finalize_expr();
     finalize_level();
 }
@@ -6,15 +6,139 @@ Author: Leonardo de Moura
 */
 #include <algorithm>
 #include <limits>
+#include <vector>
+#include <unordered_map>
+#include "runtime/thread.h"
 #include "kernel/replace_fn.h"
+#include "kernel/cache_stack.h"
 #include "kernel/declaration.h"
 #include "kernel/kernel_exception.h"
 #include "kernel/instantiate.h"
 
+#ifndef LEAN_DEFAULT_INSTANTIATE_CACHE_CAPACITY
+#define LEAN_DEFAULT_INSTANTIATE_CACHE_CAPACITY 1024*8
+#endif
+
 namespace lean {
+struct instantiate_cache {
+    struct entry {
+        object  *  m_cell;
+        unsigned   m_offset;
+        expr       m_result;
+        uint32     m_stamp{0};
+        entry():m_cell(nullptr) {}
+    };
+    unsigned           m_capacity;
+    uint32             m_stamp;
+    std::vector<entry> m_cache;
+    instantiate_cache(unsigned c):m_capacity(c), m_stamp(0), m_cache(c) {}
+
+    expr * find(expr const & e, unsigned offset) {
+        unsigned i = hash(hash(e), offset) % m_capacity;
+        if (m_cache[i].m_stamp == m_stamp && m_cache[i].m_cell == e.raw() && m_cache[i].m_offset == offset)
+            return &m_cache[i].m_result;
+        else
+            return nullptr;
+    }
+
+    void insert(expr const & e, unsigned offset, expr const & v) {
+        unsigned i = hash(hash(e), offset) % m_capacity;
+        m_cache[i].m_cell   = e.raw();
+        m_cache[i].m_offset = offset;
+        m_cache[i].m_result = v;
+        m_cache[i].m_stamp  = m_stamp;
+    }
+
+    /* O(1) generation-stamp release, as in replace_cache. */
+    void clear() {
+        m_stamp++;
+        if (m_stamp == 0) {
+            for (entry & e : m_cache) {
+                e.m_cell   = nullptr;
+                e.m_result = expr();
+            }
+        }
+    }
+};
+
+/* CACHE_RESET: NO */
+MK_CACHE_STACK(instantiate_cache, LEAN_DEFAULT_INSTANTIATE_CACHE_CAPACITY)
+
+/* Bulk substitution of the `n` loose bvars with the smallest indices, specialized from
+   the generic `replace` machinery. Instantiating the body of an applied lambda telescope
+   is one of the hottest kernel operations (see the beta case of
+   `type_checker::whnf_core`), and the generic traversal pays an indirect `std::function`
+   call per visited node and probes the cache even for subtrees the loose-bvar range
+   already rules out. Here the range check prunes a subtree before anything else, and the
+   dispatch on the node kind is direct. The cache serves the same purpose as in
+   `replace_fn.cpp`: shared subterms (the common representation of large telescopes) are
+   processed once per binder offset. */
+class instantiate_fn {
+    instantiate_cache_ref m_cache;
+    expr const *          m_subst;
+    unsigned              m_n;
+    bool                  m_rev;
+
+    expr const & subst(unsigned i) const { return m_rev ? m_subst[m_n - i - 1] : m_subst[i]; }
+
+    expr apply(expr const & e, unsigned offset) {
+        if (offset >= get_loose_bvar_range(e))
+            return e; /* expression e does not contain loose bound variables with idx >= offset */
+        if (is_bvar(e)) {
+            /* the loose-bvar range of a bvar is its index plus one, so the prune above
+               guarantees `bvar_idx(e) >= offset` */
+            nat const & vidx = bvar_idx(e);
+            unsigned h = offset + m_n;
+            if (h < offset /* overflow, h is bigger than any vidx */ || (vidx.is_small() && vidx.get_small_value() < h)) {
+                return lift_loose_bvars(subst(vidx.get_small_value() - offset), offset);
+            } else {
+                return mk_bvar(vidx - nat(m_n));
+            }
+        }
+        bool shared = is_shared(e);
+        if (shared) {
+            if (expr * r = m_cache->find(e, offset))
+                return *r;
+        }
+        check_system("instantiate");
+        expr r;
+        switch (e.kind()) {
+        case expr_kind::Const: case expr_kind::Sort:
+        case expr_kind::BVar:  case expr_kind::Lit:
+        case expr_kind::MVar:  case expr_kind::FVar:
+            /* unreachable: atomic expressions are pruned by the range check above */
+            r = e;
+            break;
+        case expr_kind::MData:
+            r = update_mdata(e, apply(mdata_expr(e), offset));
+            break;
+        case expr_kind::Proj:
+            r = update_proj(e, apply(proj_expr(e), offset));
+            break;
+        case expr_kind::App:
+            r = update_app(e, apply(app_fn(e), offset), apply(app_arg(e), offset));
+            break;
+        case expr_kind::Pi: case expr_kind::Lambda:
+            r = update_binding(e, apply(binding_domain(e), offset), apply(binding_body(e), offset+1));
+            break;
+        case expr_kind::Let:
+            r = update_let(e, apply(let_type(e), offset), apply(let_value(e), offset), apply(let_body(e), offset+1));
+            break;
+        }
+        if (shared)
+            m_cache->insert(e, offset, r);
+        return r;
+    }
+public:
+    instantiate_fn(unsigned n, expr const * subst, bool rev):m_subst(subst), m_n(n), m_rev(rev) {}
+    expr operator()(expr const & e) { return apply(e, 0); }
+};
+
 expr instantiate(expr const & a, unsigned s, unsigned n, expr const * subst) {
     if (s >= get_loose_bvar_range(a) || n == 0)
         return a;
+    if (s == 0)
+        return instantiate_fn(n, subst, false)(a);
     return replace(a, [=](expr const & m, unsigned offset) -> optional<expr> {
             unsigned s1 = s + offset;
             if (s1 < s)
@@ -58,6 +182,12 @@ static object * lean_expr_instantiate_core(b_obj_arg a0, size_t n, object** subs
         lean_inc(a0);
         return a0;
     }
+    if (n <= std::numeric_limits<unsigned>::max()) {
+        /* `expr` is a plain wrapper around an object pointer (see TO_REF), so the array
+           of borrowed substituents can be viewed as an array of expressions. */
+        expr r = instantiate_fn(static_cast<unsigned>(n), reinterpret_cast<expr const *>(subst), false)(a);
+        return r.steal();
+    }
     expr r = replace(a, [=](expr const & m, unsigned offset) -> optional<expr> {
             if (offset >= get_loose_bvar_range(m))
                 return some_expr(m); // expression m does not contain loose bound variables with idx >= offset
@@ -97,32 +227,22 @@ extern "C" LEAN_EXPORT object * lean_expr_instantiate_range(b_obj_arg a, b_obj_a
 }
 
 expr instantiate_rev(expr const & a, unsigned n, expr const * subst) {
-    if (!has_loose_bvars(a))
+    if (!has_loose_bvars(a) || n == 0)
         return a;
-    return replace(a, [=](expr const & m, unsigned offset) -> optional<expr> {
-            if (offset >= get_loose_bvar_range(m))
-                return some_expr(m); // expression m does not contain loose bound variables with idx >= offset
-            if (is_bvar(m)) {
-                nat const & vidx = bvar_idx(m);
-                if (vidx >= offset) {
-                    size_t h = offset + n;
-                    if (h < offset /* overflow, h is bigger than any vidx */ || (vidx.is_small() && vidx.get_small_value() < h)) {
-                        return some_expr(lift_loose_bvars(subst[n - (vidx.get_small_value() - offset) - 1], offset));
-                    } else {
-                        return some_expr(mk_bvar(vidx - nat(n)));
-                    }
-                }
-            }
-            return none_expr();
-        });
+    return instantiate_fn(n, subst, true)(a);
 }
 
 static object * lean_expr_instantiate_rev_core(object * a0, size_t n, object ** subst) {
     expr const & a = reinterpret_cast<expr const &>(a0);
-    if (!has_loose_bvars(a)) {
+    if (!has_loose_bvars(a) || n == 0) {
         lean_inc(a0);
         return a0;
     }
+    if (n <= std::numeric_limits<unsigned>::max()) {
+        /* see comment at `lean_expr_instantiate_core` */
+        expr r = instantiate_fn(static_cast<unsigned>(n), reinterpret_cast<expr const *>(subst), true)(a);
+        return r.steal();
+    }
     expr r = replace(a, [=](expr const & m, unsigned offset) -> optional<expr> {
             if (offset >= get_loose_bvar_range(m))
                 return some_expr(m); // expression m does not contain loose bound variables with idx >= offset
@@ -229,6 +349,90 @@ expr instantiate_lparams(expr const & e, names const & lps, levels const & ls) {
         });
 }
 
+/* Process-wide cache of universe instantiations, shared by all type-checker
+   states: a server session runs thousands of checker instances that instantiate
+   the same constant values with the same levels (`Eq.rec`, `congrArg`, ...),
+   and the per-state memos (see `type_checker::instantiate_lparams_memo`) cannot
+   share the resulting terms. Keys compare the generic value by pointer
+   identity — values are owned by environments, which keep them alive and
+   pointer-stable across checkers — and the levels structurally. The table is
+   sharded by key hash so concurrent checkers rarely contend on the same mutex;
+   each shard is generation-bounded like the per-state caches (see
+   `expr_gen_map`), so recently-used instantiations survive rotations while
+   memory stays bounded without per-hit LRU bookkeeping. */
+#define LEAN_INSTANTIATION_CACHE_NUM_SHARDS     16
+#define LEAN_INSTANTIATION_CACHE_SHARD_CAPACITY (1u << 10)
+
+struct instantiation_cache_key {
+    expr   m_value;
+    levels m_ls;
+};
+struct instantiation_cache_key_hash {
+    unsigned operator()(instantiation_cache_key const & k) const {
+        unsigned h = hash(k.m_value);
+        for (level const & l : k.m_ls)
+            h = hash(h, hash(l));
+        return h;
+    }
+};
+struct instantiation_cache_key_eq {
+    bool operator()(instantiation_cache_key const & k1, instantiation_cache_key const & k2) const {
+        return is_eqp(k1.m_value, k2.m_value) && k1.m_ls == k2.m_ls;
+    }
+};
+
+struct instantiation_cache_shard {
+    typedef std::unordered_map<instantiation_cache_key, expr, instantiation_cache_key_hash, instantiation_cache_key_eq> map;
+    mutex m_mutex;
+    map   m_curr;
+    map   m_prev;
+};
+
+static instantiation_cache_shard * g_instantiation_cache = nullptr;
+
+expr instantiate_lparams_cached(expr const & e, names const & ps, levels const & ls) {
+    if (is_nil(ls) || !has_param_univ(e))
+        return e;
+    instantiation_cache_key k{e, ls};
+    instantiation_cache_shard & s = g_instantiation_cache[instantiation_cache_key_hash()(k) % LEAN_INSTANTIATION_CACHE_NUM_SHARDS];
+    {
+        lock_guard<mutex> lock(s.m_mutex);
+        auto it = s.m_curr.find(k);
+        if (it != s.m_curr.end())
+            return it->second;
+        it = s.m_prev.find(k);
+        if (it != s.m_prev.end()) {
+            /* promote to the current generation */
+            return s.m_curr.insert(*it).first->second;
+        }
+    }
+    expr r = instantiate_lparams(e, ps, ls);
+    /* Entries may be dropped (generation rotation) or returned on any thread,
+       so the whole key/value graph must use atomic reference counts before it
+       is published. The result and the levels were built by this thread and
+       are still thread-local; the value usually is multi-threaded already
+       (environments are shared across tasks). */
+    mark_mt(r.raw());
+    mark_mt(k.m_value.raw());
+    mark_mt(k.m_ls.raw());
+    lock_guard<mutex> lock(s.m_mutex);
+    if (s.m_curr.size() >= LEAN_INSTANTIATION_CACHE_SHARD_CAPACITY) {
+        s.m_prev = std::move(s.m_curr);
+        s.m_curr.clear();
+    }
+    /* If another checker raced us to the same instantiation, keep its term. */
+    return s.m_curr.insert(mk_pair(k, r)).first->second;
+}
+
+void initialize_instantiate() {
+    g_instantiation_cache = new instantiation_cache_shard[LEAN_INSTANTIATION_CACHE_NUM_SHARDS];
+}
+
+void finalize_instantiate() {
+    delete[] g_instantiation_cache;
+    g_instantiation_cache = nullptr;
+}
+
 expr instantiate_type_lparams(constant_info const & info, levels const & ls) {
     if (info.get_num_lparams() != length(ls))
         lean_internal_panic("#universes mismatch at instantiateTypeLevelParams");
@@ -34,6 +34,11 @@ expr cheap_beta_reduce(expr const & e);
 /** \brief Instantiate the universe level parameters \c ps occurring in \c e with the levels \c ls.
     \pre length(ps) == length(ls) */
 expr instantiate_lparams(expr const & e, names const & ps, levels const & ls);
+/** \brief Like `instantiate_lparams`, but backed by a process-wide sharded cache keyed by
+    (value identity, levels), so repeated instantiations of the same value share one result
+    term across type-checker states.
+    \pre `e` is owned by an environment (pointer-stable and kept alive by the callers). */
+expr instantiate_lparams_cached(expr const & e, names const & ps, levels const & ls);
 
 class constant_info;
 /** \brief Instantiate the universe level parameters of the type of the given constant.
@@ -42,4 +47,7 @@ expr instantiate_type_lparams(constant_info const & info, levels const & ls);
 /** \brief Instantiate the universe level parameters of the value of the given constant.
     \pre d.get_num_lparams() == length(ls) */
 expr instantiate_value_lparams(constant_info const & info, levels const & ls);
+
+void initialize_instantiate();
+void finalize_instantiate();
 }
@@ -8,10 +8,12 @@ Author: Leonardo de Moura
 #include <algorithm>
 #include <vector>
 #include <unordered_set>
+#include <unordered_map>
 #include "runtime/debug.h"
 #include "runtime/interrupt.h"
 #include "runtime/hash.h"
 #include "runtime/buffer.h"
+#include "runtime/mutex.h"
 #include "util/list.h"
 #include "kernel/level.h"
 #include "kernel/environment.h"
@@ -106,6 +108,93 @@ level mk_imax(level const & l1, level const & l2) {
         return mk_imax_core(l1, l2);
 }
 
+/* Hash-consing pool for universe levels.
+
+   The universe algebra occurring in practice has few distinct terms, but they
+   are re-created and re-normalized constantly, in particular when is_def_eq
+   compares universe-polymorphic constants. We intern levels in a small bounded
+   global pool: pooled levels are marked persistent, so they are never
+   deallocated, may be shared freely across threads, and their addresses are
+   stable. Repeated normal forms then become pointer-equal (the is_eqp fast
+   path in operator==), and `normalize` can memoize on the interned address.
+   When the pool is full we simply stop interning; it then keeps acting as a
+   cache for the common terms without bounding the universe algebra itself. */
+#define LEAN_LEVEL_POOL_CAPACITY 1024
+static mutex * g_level_pool_mutex = nullptr;
+static std::unordered_set<level, level_hash, level_eq> * g_level_pool = nullptr;
+static std::unordered_map<object *, level> * g_normalize_cache = nullptr;
+
+/* Rebuild `n` as a thread-private graph: non-persistent nodes (including the
+   string components) are freshly allocated, persistent nodes are reused as-is
+   (`mark_persistent` does not descend into them). Returns none when a
+   component cannot be rebuilt (big numeral components). */
+static optional<name> copy_unshared(name const & n) {
+    if (n.is_anonymous() || !lean_has_rc(n.raw()))
+        return optional<name>(n);
+    optional<name> p = copy_unshared(n.get_prefix());
+    if (!p)
+        return optional<name>();
+    if (n.is_string())
+        return optional<name>(name(*p, n.get_string().data()));
+    nat const & k = n.get_numeral();
+    if (!is_scalar(k.raw()) && lean_has_rc(k.raw()))
+        return optional<name>();
+    return optional<name>(name(*p, k));
+}
+
+/* Likewise for levels. */
+static optional<level> copy_unshared(level const & l) {
+    if (is_scalar(l.raw()) || !lean_has_rc(l.raw()))
+        return some_level(l);
+    switch (kind(l)) {
+    case level_kind::Zero:
+        lean_unreachable(); // LCOV_EXCL_LINE (scalar)
+    case level_kind::Succ: {
+        optional<level> c = copy_unshared(succ_of(l));
+        return c ? some_level(mk_succ(*c)) : none_level();
+    }
+    case level_kind::Max: case level_kind::IMax: {
+        optional<level> c1 = copy_unshared(level_lhs(l));
+        if (!c1) return none_level();
+        optional<level> c2 = copy_unshared(level_rhs(l));
+        if (!c2) return none_level();
+        return some_level(kind(l) == level_kind::Max ? mk_max_core(*c1, *c2) : mk_imax_core(*c1, *c2));
+    }
+    case level_kind::Param: case level_kind::MVar: {
+        optional<name> id = copy_unshared(level_id(l));
+        if (!id) return none_level();
+        return some_level(kind(l) == level_kind::Param ? mk_univ_param(*id) : mk_univ_mvar(*id));
+    }}
+    lean_unreachable(); // LCOV_EXCL_LINE
+}
+
+/* Return the pooled representative of `l`, interning it if the pool still has
+   room. The result is structurally equal to `l`, and persistent (hence
+   pointer-stable) iff it is pooled.
+
+   Levels reaching here are routinely multi-threaded (constant types of
+   environments shared across tasks), and `mark_persistent` is a non-atomic
+   RC store over the whole subgraph that would race with concurrent RC
+   operations on such objects. So we never mark `l` itself: what gets pooled
+   is a fresh thread-private copy, which only shares already-persistent
+   subterms with the outside world. */
+static level intern_level(level const & l) {
+    if (!g_level_pool || is_scalar(l.raw()))
+        return l;
+    lock_guard<mutex> lock(*g_level_pool_mutex);
+    auto it = g_level_pool->find(l);
+    if (it != g_level_pool->end())
+        return *it;
+    if (g_level_pool->size() >= LEAN_LEVEL_POOL_CAPACITY)
+        return l;
+    optional<level> c = copy_unshared(l);
+    if (!c)
+        return l;
+    mark_persistent(c->raw());
+    g_level_pool->insert(*c);
+    return *c;
+}
+
 static level * g_level_zero = nullptr;
 static level * g_level_one  = nullptr;
 level const & mk_level_zero() { return *g_level_zero; }
@@ -480,7 +569,7 @@ level mk_succ(level l, unsigned k) {
     return l;
 }
 
-level normalize(level const & l) {
+static level normalize_core(level const & l) {
     auto p = to_offset(l);
     level const & r = p.first;
     switch (kind(r)) {
@@ -544,6 +633,30 @@ level normalize(level const & l) {
     lean_unreachable(); // LCOV_EXCL_LINE
 }
 
+level normalize(level const & l) {
+    if (!g_normalize_cache)
+        return normalize_core(l);
+    level li = intern_level(l);
+    if (is_scalar(li.raw()) || !lean_is_persistent(li.raw())) {
+        /* Not pooled: the address is not stable, so it cannot be a memo key. */
+        return normalize_core(li);
+    }
+    {
+        lock_guard<mutex> lock(*g_level_pool_mutex);
+        auto it = g_normalize_cache->find(li.raw());
+        if (it != g_normalize_cache->end())
+            return it->second;
+    }
+    level r = intern_level(normalize_core(li));
+    if (is_scalar(r.raw()) || lean_is_persistent(r.raw())) {
+        /* Only persistent (or scalar) values may be stored in a table shared
+           across threads; RC operations on them are no-ops. */
+        lock_guard<mutex> lock(*g_level_pool_mutex);
+        g_normalize_cache->emplace(li.raw(), r);
+    }
+    return r;
+}
+
 bool is_equivalent(level const & lhs, level const & rhs) {
     check_system("level constraints");
     return lhs == rhs || normalize(lhs) == normalize(rhs);
@@ -582,15 +695,23 @@ level::level():level(*g_level_zero) {
 }
 
 void initialize_level() {
+    g_level_pool_mutex = new mutex();
+    g_level_pool       = new std::unordered_set<level, level_hash, level_eq>();
+    g_normalize_cache  = new std::unordered_map<object *, level>();
     g_level_zero = new level(lean_level_mk_zero(box(0)));
     mark_persistent(g_level_zero->raw());
     g_level_one  = new level(mk_succ(*g_level_zero));
     mark_persistent(g_level_one->raw());
+    intern_level(*g_level_zero);
+    intern_level(*g_level_one);
 }
 
 void finalize_level() {
     delete g_level_one;
     delete g_level_zero;
+    delete g_normalize_cache;  g_normalize_cache  = nullptr;
+    delete g_level_pool;       g_level_pool       = nullptr;
+    delete g_level_pool_mutex; g_level_pool_mutex = nullptr;
 }
 }
 void print(lean::level const & l) { std::cout << l << std::endl; }
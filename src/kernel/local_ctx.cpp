@@ -49,27 +49,112 @@ extern "C" object * lean_local_ctx_mk_let_decl(object * lctx, object * name, obj
 extern "C" object * lean_local_ctx_find(object * lctx, object * name);
 extern "C" object * lean_local_ctx_erase(object * lctx, object * name);
 
-local_ctx::local_ctx():object_ref(lean_mk_empty_local_ctx(box(0))) {
+local_ctx::local_ctx():object_ref(lean_mk_empty_local_ctx(box(0))),
+    m_decls(std::make_shared<std::vector<local_decl>>()) {
 }
 
 bool local_ctx::empty() const {
-    return lean_local_ctx_is_empty(to_obj_arg());
+    if (m_overlay && !m_overlay->empty())
+        return false;
+    /* the base object is complete when the overlay is empty */
+    return lean_local_ctx_is_empty(object_ref::to_obj_arg());
+}
+
+void local_ctx::freeze() {
+    if (m_overlay)
+        return;
+    m_next_idx = unbox(lean_local_ctx_num_indices(object_ref::to_obj_arg()));
+    m_overlay  = std::make_shared<std::vector<local_decl>>();
+}
+
+void local_ctx::collapse() const {
+    if (!m_overlay || m_overlay->empty())
+        return;
+    /* Collapsing does not change the logical content of the context, only
+       moves pending declarations into the Lean object, so it is safe to run
+       behind const accessors. Replaying in insertion order reproduces the
+       indices assigned by `mk_local_decl` while frozen. */
+    local_ctx * self = const_cast<local_ctx *>(this);
+    for (local_decl const & d : *m_overlay) {
+        if (optional<expr> v = d.get_value())
+            self->m_obj = lean_local_ctx_mk_let_decl(self->m_obj, d.get_name().to_obj_arg(), d.get_user_name().to_obj_arg(),
+                                                     d.get_type().to_obj_arg(), v->to_obj_arg(), false);
+        else
+            self->m_obj = lean_local_ctx_mk_local_decl(self->m_obj, d.get_name().to_obj_arg(), d.get_user_name().to_obj_arg(),
+                                                       d.get_type().to_obj_arg(), static_cast<uint8>(d.get_info()));
+    }
+    /* stay frozen: later insertions keep going into a (fresh) overlay */
+    self->m_overlay = std::make_shared<std::vector<local_decl>>();
+}
+
+void local_ctx::push_decl(local_decl const & d) {
+    if (!m_decls)
+        return;
+    if (m_decls->size() >= LEAN_LOCAL_CTX_SMALL_SIZE) {
+        /* the context outgrew the fast path; lookups use the Lean object */
+        m_decls = nullptr;
+        return;
+    }
+    if (!m_decls.unique())
+        m_decls = std::make_shared<std::vector<local_decl>>(*m_decls);
+    m_decls->push_back(d);
+}
+
+void local_ctx::push_overlay(local_decl const & d) {
+    if (m_overlay->size() >= LEAN_LOCAL_CTX_SMALL_SIZE) {
+        /* bound the overlay scan; the batch replay amortizes the map updates */
+        collapse();
+    }
+    if (!m_overlay.unique())
+        m_overlay = std::make_shared<std::vector<local_decl>>(*m_overlay);
+    m_overlay->push_back(d);
+    push_decl(d);
 }
 
 local_decl local_ctx::mk_local_decl(name const & n, name const & un, expr const & type, expr const & value) {
-    unsigned idx = unbox(lean_local_ctx_num_indices(to_obj_arg()));
-    m_obj = lean_local_ctx_mk_let_decl(raw(), n.to_obj_arg(), un.to_obj_arg(), type.to_obj_arg(), value.to_obj_arg(), false);
-    return local_decl(idx, n, un, type, value);
+    if (m_overlay) {
+        local_decl d(m_next_idx++, n, un, type, value);
+        push_overlay(d);
+        return d;
+    }
+    unsigned idx = unbox(lean_local_ctx_num_indices(object_ref::to_obj_arg()));
+    m_obj = lean_local_ctx_mk_let_decl(object_ref::raw(), n.to_obj_arg(), un.to_obj_arg(), type.to_obj_arg(), value.to_obj_arg(), false);
+    local_decl d(idx, n, un, type, value);
+    push_decl(d);
+    return d;
 }
 
 local_decl local_ctx::mk_local_decl(name const & n, name const & un, expr const & type, binder_info bi) {
-    unsigned idx = unbox(lean_local_ctx_num_indices(to_obj_arg()));
-    m_obj = lean_local_ctx_mk_local_decl(raw(), n.to_obj_arg(), un.to_obj_arg(), type.to_obj_arg(), static_cast<uint8>(bi));
-    return local_decl(idx, n, un, type, bi);
+    if (m_overlay) {
+        local_decl d(m_next_idx++, n, un, type, bi);
+        push_overlay(d);
+        return d;
+    }
+    unsigned idx = unbox(lean_local_ctx_num_indices(object_ref::to_obj_arg()));
+    m_obj = lean_local_ctx_mk_local_decl(object_ref::raw(), n.to_obj_arg(), un.to_obj_arg(), type.to_obj_arg(), static_cast<uint8>(bi));
+    local_decl d(idx, n, un, type, bi);
+    push_decl(d);
+    return d;
 }
 
 optional<local_decl> local_ctx::find_local_decl(name const & n) const {
-    return to_optional<local_decl>(lean_local_ctx_find(to_obj_arg(), n.to_obj_arg()));
+    if (m_decls) {
+        /* scan from the back: lookups overwhelmingly target the innermost binders */
+        for (auto it = m_decls->rbegin(); it != m_decls->rend(); ++it) {
+            if (it->get_name() == n)
+                return optional<local_decl>(*it);
+        }
+        return optional<local_decl>();
+    }
+    if (m_overlay) {
+        for (auto it = m_overlay->rbegin(); it != m_overlay->rend(); ++it) {
+            if (it->get_name() == n)
+                return optional<local_decl>(*it);
+        }
+        /* not in the overlay; the base object holds the declarations from
+           before `freeze` */
+    }
+    return to_optional<local_decl>(lean_local_ctx_find(object_ref::to_obj_arg(), n.to_obj_arg()));
 }
 
 local_decl local_ctx::get_local_decl(name const & n) const {
@@ -87,6 +172,18 @@ expr local_ctx::get_local(name const & n) const {
 }
 
 void local_ctx::clear(local_decl const & d) {
+    /* erasing goes through the Lean object; flush pending insertions first */
+    collapse();
+    if (m_decls) {
+        if (!m_decls.unique())
+            m_decls = std::make_shared<std::vector<local_decl>>(*m_decls);
+        for (auto it = m_decls->rbegin(); it != m_decls->rend(); ++it) {
+            if (it->get_name() == d.get_name()) {
+                m_decls->erase(std::next(it).base());
+                break;
+            }
+        }
+    }
     m_obj = lean_local_ctx_erase(m_obj, d.get_name().to_obj_arg());
 }
 
@@ -5,6 +5,8 @@ Released under Apache 2.0 license as described in the file LICENSE.
 Author: Leonardo de Moura
 */
 #pragma once
+#include <memory>
+#include <vector>
 #include "util/name_generator.h"
 #include "util/rb_map.h"
 #include "util/name_map.h"
@@ -45,18 +47,57 @@ public:
     expr mk_ref() const;
 };
 
+/* Contexts with at most this many declarations keep a contiguous C++-side copy
+   of their declarations; lookups scan it from the back instead of descending
+   into the persistent map of the underlying Lean object. */
+#define LEAN_LOCAL_CTX_SMALL_SIZE 64
+
 /* Plain local context object used by the kernel type checker. */
 class local_ctx : public object_ref {
+    /* Small-context fast path: declarations in insertion order, shared between
+       copies and cloned on the first write to a shared context (copy-on-write).
+       It is dropped (set to nullptr) when the context outgrows
+       LEAN_LOCAL_CTX_SMALL_SIZE or was created from a raw Lean object; lookups
+       then go through the underlying Lean object as before. */
+    std::shared_ptr<std::vector<local_decl>> m_decls;
+    /* Layered fork support: after `freeze`, insertions go into this small
+       overlay (shared between copies, cloned on first write) instead of the
+       persistent maps of the underlying Lean object, so forking a large
+       context for many parallel branches does not path-copy the maps once per
+       branch and insertion. The overlay is replayed into the Lean object by
+       `collapse`, which runs only when the raw object is actually demanded or
+       the overlay outgrows LEAN_LOCAL_CTX_SMALL_SIZE. `nullptr` when not
+       frozen. Mutable because collapsing does not change the logical content,
+       but is triggered from const accessors such as `raw`. */
+    mutable std::shared_ptr<std::vector<local_decl>> m_overlay;
+    /* Next declaration index while frozen; mirrors `numIndices` of the Lean
+       object plus the pending overlay entries. */
+    mutable unsigned m_next_idx = 0;
+    void push_decl(local_decl const & d);
+    void push_overlay(local_decl const & d);
+    void collapse() const;
 protected:
     template<bool is_lambda> expr mk_binding(unsigned num, expr const * fvars, expr const & b, bool remove_dead_let = false) const;
 public:
     local_ctx();
     explicit local_ctx(obj_arg o):object_ref(o) {}
     local_ctx(b_obj_arg o, bool):object_ref(o, true) {}
-    local_ctx(local_ctx const & other):object_ref(other) {}
-    local_ctx(local_ctx && other):object_ref(other) {}
-    local_ctx & operator=(local_ctx const & other) { object_ref::operator=(other); return *this; }
-    local_ctx & operator=(local_ctx && other) { object_ref::operator=(other); return *this; }
+    local_ctx(local_ctx const & other):object_ref(other), m_decls(other.m_decls), m_overlay(other.m_overlay), m_next_idx(other.m_next_idx) {}
+    local_ctx(local_ctx && other):object_ref(other), m_decls(std::move(other.m_decls)), m_overlay(std::move(other.m_overlay)), m_next_idx(other.m_next_idx) {}
+    local_ctx & operator=(local_ctx const & other) { object_ref::operator=(other); m_decls = other.m_decls; m_overlay = other.m_overlay; m_next_idx = other.m_next_idx; return *this; }
+    local_ctx & operator=(local_ctx && other) { object_ref::operator=(other); m_decls = std::move(other.m_decls); m_overlay = std::move(other.m_overlay); m_next_idx = other.m_next_idx; return *this; }
+
+    /* These shadow `object_ref`: a frozen context must replay its overlay
+       before its raw Lean object is observed. */
+    object * raw() const { collapse(); return object_ref::raw(); }
+    object * to_obj_arg() const { collapse(); return object_ref::to_obj_arg(); }
+
+    /** \brief Mark the current state as an immutable shared base. Call before
+        forking this context for many branches (e.g. parallel goals): later
+        insertions stay in a per-branch overlay instead of rebuilding map paths
+        of the shared base once per branch. No-op when already frozen. */
+    void freeze();
+    bool is_frozen() const { return static_cast<bool>(m_overlay); }
 
     bool empty() const;
 
@@ -19,16 +19,17 @@ struct replace_cache {
         object  *  m_cell;
         unsigned   m_offset;
         expr       m_result;
+        uint32     m_stamp{0};
         entry():m_cell(nullptr) {}
     };
-    unsigned              m_capacity;
-    std::vector<entry>    m_cache;
-    std::vector<unsigned> m_used;
-    replace_cache(unsigned c):m_capacity(c), m_cache(c) {}
+    unsigned           m_capacity;
+    uint32             m_stamp;
+    std::vector<entry> m_cache;
+    replace_cache(unsigned c):m_capacity(c), m_stamp(0), m_cache(c) {}
 
     expr * find(expr const & e, unsigned offset) {
         unsigned i = hash(hash(e), offset) % m_capacity;
-        if (m_cache[i].m_cell == e.raw() && m_cache[i].m_offset == offset)
+        if (m_cache[i].m_stamp == m_stamp && m_cache[i].m_cell == e.raw() && m_cache[i].m_offset == offset)
             return &m_cache[i].m_result;
         else
             return nullptr;
@@ -36,19 +37,23 @@ struct replace_cache {
 
     void insert(expr const & e, unsigned offset, expr const & v) {
         unsigned i = hash(hash(e), offset) % m_capacity;
-        if (m_cache[i].m_cell == nullptr)
-            m_used.push_back(i);
         m_cache[i].m_cell   = e.raw();
         m_cache[i].m_offset = offset;
         m_cache[i].m_result = v;
+        m_cache[i].m_stamp  = m_stamp;
     }
 
+    /* Generation-stamp invalidation: O(1) release instead of walking the used
+       slots; stale results stay pinned until their slot is overwritten (see
+       expr_cache.h for the full rationale). */
     void clear() {
-        for (unsigned i : m_used) {
-            m_cache[i].m_cell   = nullptr;
-            m_cache[i].m_result = expr();
+        m_stamp++;
+        if (m_stamp == 0) {
+            for (entry & e : m_cache) {
+                e.m_cell   = nullptr;
+                e.m_result = expr();
+            }
         }
-        m_used.clear();
     }
 };
 
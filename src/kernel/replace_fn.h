@@ -5,10 +5,8 @@ Released under Apache 2.0 license as described in the file LICENSE.
 Author: Leonardo de Moura
 */
 #pragma once
-#include <tuple>
 #include "runtime/interrupt.h"
 #include "kernel/expr.h"
-#include "kernel/expr_maps.h"
 
 namespace lean {
 /**
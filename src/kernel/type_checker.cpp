@@ -6,10 +6,15 @@ Author: Leonardo de Moura
 */
 #include <utility>
 #include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
 #include "runtime/interrupt.h"
 #include "runtime/sstream.h"
 #include "runtime/flet.h"
+#include "runtime/object.h"
 #include "util/lbool.h"
+#include "util/name_map.h"
 #include "kernel/type_checker.h"
 #include "kernel/expr_maps.h"
 #include "kernel/instantiate.h"
@@ -22,6 +27,45 @@ Author: Leonardo de Moura
 
 namespace lean {
 static name * g_kernel_fresh = nullptr;
+
+/* Opt-in unfold telemetry: when LEAN_TC_UNFOLD_COUNTS is set in the process
+   environment, every definitional unfolding performed by a type checker is counted
+   per constant, and an aggregated report is written to stderr at shutdown. The
+   kernel cannot use the elaborator's trace machinery (it sits below library/), so
+   this follows the same environment-variable pattern as e.g. LEAN_NO_HUGE_PAGES.
+   The counters identify the definitions responsible for pathological is_def_eq
+   calls, which can then be annotated with reducibility hints. */
+static mutex *            g_unfold_counts_mutex = nullptr;
+static name_map<uint64> * g_unfold_counts       = nullptr;
+
+static void count_unfold(name const & n) {
+    lock_guard<mutex> lock(*g_unfold_counts_mutex);
+    if (uint64 const * c = g_unfold_counts->find(n))
+        g_unfold_counts->insert(n, *c + 1);
+    else
+        g_unfold_counts->insert(n, 1);
+}
+
+/* Opt-in inspection of the learned unfold histograms: when LEAN_TC_UNFOLD_STATS
+   is set in the process environment, the per-state outcome histograms that drive
+   `unfold_bias` are merged into a global table when a type-checker state is torn
+   down, and an aggregated report (hits/misses per constant) is written to stderr
+   at shutdown. This makes the learned table available offline, e.g. to decide
+   which constants deserve explicit reducibility hints. */
+static mutex * g_unfold_stats_mutex = nullptr;
+static name_map<pair<uint64, uint64>> * g_unfold_stats = nullptr;
+
+/* Opt-in projection telemetry: when LEAN_TC_PROJ_COUNTS is set in the process
+   environment, projection reductions are classified as `fast` (the projected
+   expression was already a constructor application, modulo metadata), `deep`
+   (a constructor application only appeared after full whnf, e.g. because of
+   unfolding or structure eta), or `stuck` (no constructor application even
+   after whnf). A high `deep` count points at projection chains whose struct
+   arguments are rebuilt by eta instead of being literal constructors. */
+static bool           g_proj_counts = false;
+static atomic<uint64> g_num_proj_fast(0);
+static atomic<uint64> g_num_proj_deep(0);
+static atomic<uint64> g_num_proj_stuck(0);
 static expr * g_dont_care    = nullptr;
 static name * g_bool_true    = nullptr;
 static expr * g_nat_zero     = nullptr;
@@ -33,9 +77,31 @@ static expr * g_nat_mod      = nullptr;
 static expr * g_nat_div      = nullptr;
 static expr * g_nat_beq      = nullptr;
 static expr * g_nat_ble      = nullptr;
-
-type_checker::state::state(environment const & env):
-    m_env(env), m_ngen(*g_kernel_fresh) {}
+static expr * g_nat_land     = nullptr;
+static expr * g_nat_lor      = nullptr;
+static expr * g_nat_xor      = nullptr;
+static expr * g_nat_shiftl   = nullptr;
+static expr * g_nat_shiftr   = nullptr;
+static expr * g_nat_pow      = nullptr;
+static expr * g_nat_gcd      = nullptr;
+static expr * g_nat_log2     = nullptr;
+
+type_checker::state::state(environment const & env, unsigned cache_capacity):
+    m_env(env), m_ngen(*g_kernel_fresh),
+    m_infer_type{infer_cache(cache_capacity), infer_cache(cache_capacity)},
+    m_whnf_core(cache_capacity), m_whnf(cache_capacity), m_failure(cache_capacity) {}
+
+type_checker::state::~state() {
+    if (g_unfold_stats && !m_unfold_stats.empty()) {
+        lock_guard<mutex> lock(*g_unfold_stats_mutex);
+        for (auto const & e : m_unfold_stats) {
+            pair<uint64, uint64> c(e.second.m_hits, e.second.m_misses);
+            if (pair<uint64, uint64> const * p = g_unfold_stats->find(e.first))
+                c = mk_pair(c.first + p->first, c.second + p->second);
+            g_unfold_stats->insert(e.first, c);
+        }
+    }
+}
 
 /** \brief Make sure \c e "is" a sort, and return the corresponding sort.
     If \c e is not a sort, then the whnf procedure is invoked.
@@ -282,9 +348,8 @@ expr type_checker::infer_type_core(expr const & e, bool infer_only) {
     lean_assert(!has_loose_bvars(e));
     check_system("type checker");
 
-    auto it = m_st->m_infer_type[infer_only].find(e);
-    if (it != m_st->m_infer_type[infer_only].end())
-        return it->second;
+    if (expr const * it = m_st->m_infer_type[infer_only].find(e))
+        return *it;
 
     expr r;
     switch (e.kind()) {
@@ -306,7 +371,7 @@ expr type_checker::infer_type_core(expr const & e, bool infer_only) {
     case expr_kind::Let:      r = infer_let(e, infer_only);            break;
     }
 
-    m_st->m_infer_type[infer_only].insert(mk_pair(e, r));
+    m_st->m_infer_type[infer_only].insert(e, r);
     return r;
 }
 
@@ -348,7 +413,8 @@ optional<expr> type_checker::reduce_recursor(expr const & e, bool cheap_rec, boo
     if (optional<expr> r = inductive_reduce_rec(env(), e,
                                                 [&](expr const & e) { return cheap_rec ? whnf_core(e, cheap_rec, cheap_proj) : whnf(e); },
                                                 [&](expr const & e) { return infer(e); },
-                                                [&](expr const & e1, expr const & e2) { return is_def_eq(e1, e2); })) {
+                                                [&](expr const & e1, expr const & e2) { return is_def_eq(e1, e2); },
+                                                [&](expr const & rhs, names const & lps, levels const & ls) { return instantiate_lparams_memo(rhs, lps, ls); })) {
         return r;
     }
     return none_expr();
@@ -364,11 +430,46 @@ expr type_checker::whnf_fvar(expr const & e, bool cheap_rec, bool cheap_proj) {
     return e;
 }
 
+/* Project out of a literal constructor application without entering the general
+   whnf machinery. Structure values are frequently built in place and taken apart
+   again by chains of projections; for them the projected expression is already a
+   constructor application, possibly wrapped in metadata, and whnf-ing it merely
+   re-traverses (and caches) an expression we are about to discard. */
+static optional<expr> reduce_proj_fast(environment const & env, expr const & e, unsigned idx) {
+    buffer<expr> rev_args;
+    expr const * it = &e;
+    while (true) {
+        if (is_mdata(*it)) {
+            it = &mdata_expr(*it);
+        } else if (is_app(*it)) {
+            rev_args.push_back(app_arg(*it));
+            it = &app_fn(*it);
+        } else {
+            break;
+        }
+    }
+    if (!is_constant(*it))
+        return none_expr();
+    optional<constant_info> mk_info = env.find(const_name(*it));
+    if (!mk_info || !mk_info->is_constructor())
+        return none_expr();
+    unsigned nparams = mk_info->to_constructor_val().get_nparams();
+    if (nparams + idx < rev_args.size())
+        return some_expr(rev_args[rev_args.size() - nparams - idx - 1]);
+    else
+        return none_expr();
+}
+
 /* If `cheap == true`, then we don't perform delta-reduction when reducing major premise. */
 optional<expr> type_checker::reduce_proj(expr const & e, bool cheap_rec, bool cheap_proj) {
     if (!proj_idx(e).is_small())
         return none_expr();
     unsigned idx = proj_idx(e).get_small_value();
+    if (optional<expr> r = reduce_proj_fast(env(), proj_expr(e), idx)) {
+        if (g_proj_counts)
+            g_num_proj_fast++;
+        return r;
+    }
     expr c;
     if (cheap_proj)
         c = whnf_core(proj_expr(e), cheap_rec, cheap_proj);
@@ -378,11 +479,19 @@ optional<expr> type_checker::reduce_proj(expr const & e, bool cheap_rec, bool ch
         c = string_lit_to_constructor(c);
     buffer<expr> args;
     expr const & mk = get_app_args(c, args);
-    if (!is_constant(mk))
+    if (!is_constant(mk)) {
+        if (g_proj_counts)
+            g_num_proj_stuck++;
         return none_expr();
+    }
     constant_info mk_info = env().get(const_name(mk));
-    if (!mk_info.is_constructor())
+    if (!mk_info.is_constructor()) {
+        if (g_proj_counts)
+            g_num_proj_stuck++;
         return none_expr();
+    }
+    if (g_proj_counts)
+        g_num_proj_deep++;
     unsigned nparams = mk_info.to_constructor_val().get_nparams();
     if (nparams + idx < args.size())
         return some_expr(args[nparams + idx]);
@@ -403,7 +512,10 @@ static bool is_let_fvar(local_ctx const & lctx, expr const & e) {
     If `cheap == true`, then we don't perform delta-reduction when reducing major premise of recursors and projections.
     We also do not cache results. */
 expr type_checker::whnf_core(expr const & e, bool cheap_rec, bool cheap_proj) {
-    check_system("whnf");
+    /* `whnf_core` is the hottest polling point in the kernel: a long unfolding
+       chain visits it once per step, so batching keeps the per-step cost to a
+       thread-local decrement while still bounding cancellation latency. */
+    check_system_batched("whnf");
 
     // handle easy cases
     switch (e.kind()) {
@@ -424,9 +536,8 @@ expr type_checker::whnf_core(expr const & e, bool cheap_rec, bool cheap_proj) {
     }
 
     // check cache
-    auto it = m_st->m_whnf_core.find(e);
-    if (it != m_st->m_whnf_core.end())
-        return it->second;
+    if (expr const * it = m_st->m_whnf_core.find(e))
+        return *it;
 
     // do the actual work
     expr r;
@@ -476,7 +587,7 @@ expr type_checker::whnf_core(expr const & e, bool cheap_rec, bool cheap_proj) {
     }
 
     if (!cheap_rec && !cheap_proj) {
-        m_st->m_whnf_core.insert(mk_pair(e, r));
+        m_st->m_whnf_core.insert(e, r);
     }
     return r;
 }
@@ -486,18 +597,95 @@ expr type_checker::whnf_core(expr const & e, bool cheap_rec, bool cheap_proj) {
 optional<constant_info> type_checker::is_delta(expr const & e) const {
     expr const & f = get_app_fn(e);
     if (is_constant(f)) {
-        if (optional<constant_info> info = env().find(const_name(f)))
-            if (info->has_value())
-                return info;
+        optional<constant_info> const & info = m_st->m_find_handle.find(env(), const_name(f));
+        if (info && info->has_value())
+            return info;
     }
     return none_constant_info();
 }
 
+/* Number of subterms of `e`, capped at `max`. The cap bounds the cost on huge
+   values (e.g. well-founded recursion unfoldings); fingerprints only need to
+   distinguish small bodies from large ones. */
+static unsigned bounded_expr_size(expr const & e, unsigned max) {
+    buffer<expr> todo;
+    todo.push_back(e);
+    unsigned sz = 0;
+    while (!todo.empty() && sz < max) {
+        expr t = todo.back();
+        todo.pop_back();
+        sz++;
+        switch (t.kind()) {
+        case expr_kind::App:
+            todo.push_back(app_fn(t));
+            todo.push_back(app_arg(t));
+            break;
+        case expr_kind::Lambda: case expr_kind::Pi:
+            todo.push_back(binding_domain(t));
+            todo.push_back(binding_body(t));
+            break;
+        case expr_kind::Let:
+            todo.push_back(let_type(t));
+            todo.push_back(let_value(t));
+            todo.push_back(let_body(t));
+            break;
+        case expr_kind::MData:
+            todo.push_back(mdata_expr(t));
+            break;
+        case expr_kind::Proj:
+            todo.push_back(proj_expr(t));
+            break;
+        default:
+            break;
+        }
+    }
+    return sz;
+}
+
+auto type_checker::get_unfold_fingerprint(constant_info const & d) -> state::unfold_fingerprint const & {
+    auto it = m_st->m_fingerprints.find(d.get_name());
+    if (it != m_st->m_fingerprints.end())
+        return it->second;
+    expr v = d.get_value();
+    while (is_lambda(v))
+        v = binding_body(v);
+    expr const & h = get_app_fn(v);
+    state::unfold_fingerprint fp;
+    fp.m_head = is_constant(h) ? const_name(h) : name();
+    fp.m_size = bounded_expr_size(v, 1u << 10);
+    return m_st->m_fingerprints.insert(mk_pair(d.get_name(), fp)).first->second;
+}
+
+expr type_checker::instantiate_lparams_memo(expr const & v, names const & lps, levels const & ls) {
+    if (is_nil(ls) || !has_param_univ(v))
+        return v;
+    state::instantiation_key k{v, ls};
+    auto it = m_st->m_instantiations.find(k);
+    if (it != m_st->m_instantiations.end())
+        return it->second;
+    /* Miss in the per-state memo: go through the process-wide cache, so the
+       instantiated term is shared with other checker states (see
+       `instantiate_lparams_cached`). */
+    expr r = instantiate_lparams_cached(v, lps, ls);
+    m_st->m_instantiations.insert(mk_pair(k, r));
+    return r;
+}
+
 optional<expr> type_checker::unfold_definition_core(expr const & e) {
     if (is_constant(e)) {
         if (auto d = is_delta(e)) {
-            if (length(const_levels(e)) == d->get_num_lparams())
-                return some_expr(instantiate_value_lparams(*d, const_levels(e)));
+            if (length(const_levels(e)) == d->get_num_lparams()) {
+                /* Each unfolding consumes deterministic budget. Long delta chains in
+                   lazy_delta_reduction can otherwise run for minutes between
+                   allocations, i.e. without moving the heartbeat that maxHeartbeats
+                   is checked against; counting the unfolding itself makes such
+                   is_def_eq calls fail fast with the usual resumable
+                   "(deterministic) timeout" instead of appearing hung. */
+                inc_heartbeat();
+                if (g_unfold_counts)
+                    count_unfold(const_name(e));
+                return some_expr(instantiate_lparams_memo(d->get_value(), d->get_lparams(), const_levels(e)));
+            }
         }
     }
     return none_expr();
@@ -590,6 +778,12 @@ optional<expr> type_checker::reduce_nat(expr const & e) {
             nat v = get_nat_val(arg);
             return some_expr(mk_lit(literal(nat(v+nat(1)))));
         }
+        if (f == *g_nat_log2) {
+            expr arg = whnf(app_arg(e));
+            if (!is_nat_lit_ext(arg)) return none_expr();
+            nat v = get_nat_val(arg);
+            return some_expr(mk_lit(literal(nat(nat_log2(v.raw())))));
+        }
     } else if (nargs == 2) {
         expr const & f = app_fn(app_fn(e));
         if (!is_constant(f)) return none_expr();
@@ -600,6 +794,13 @@ optional<expr> type_checker::reduce_nat(expr const & e) {
         if (f == *g_nat_div) return reduce_bin_nat_op(nat_div, e);
         if (f == *g_nat_beq) return reduce_bin_nat_pred(nat_eq, e);
         if (f == *g_nat_ble) return reduce_bin_nat_pred(nat_le, e);
+        if (f == *g_nat_land) return reduce_bin_nat_op(nat_land, e);
+        if (f == *g_nat_lor)  return reduce_bin_nat_op(nat_lor, e);
+        if (f == *g_nat_xor)  return reduce_bin_nat_op(nat_lxor, e);
+        if (f == *g_nat_shiftl) return reduce_bin_nat_op(nat_shiftl, e);
+        if (f == *g_nat_shiftr) return reduce_bin_nat_op(nat_shiftr, e);
+        if (f == *g_nat_pow) return reduce_bin_nat_op(nat_pow, e);
+        if (f == *g_nat_gcd) return reduce_bin_nat_op(nat_gcd, e);
     }
     return none_expr();
 }
@@ -624,24 +825,23 @@ expr type_checker::whnf(expr const & e) {
     }
 
     // check cache
-    auto it = m_st->m_whnf.find(e);
-    if (it != m_st->m_whnf.end())
-        return it->second;
+    if (expr const * it = m_st->m_whnf.find(e))
+        return *it;
 
     expr t = e;
     while (true) {
         expr t1 = whnf_core(t);
         if (auto v = reduce_native(env(), t1)) {
-            m_st->m_whnf.insert(mk_pair(e, *v));
+            m_st->m_whnf.insert(e, *v);
             return *v;
         } else if (auto v = reduce_nat(t1)) {
-            m_st->m_whnf.insert(mk_pair(e, *v));
+            m_st->m_whnf.insert(e, *v);
             return *v;
         } else if (auto next_t = unfold_definition(t1)) {
             t = *next_t;
         } else {
             auto r = t1;
-            m_st->m_whnf.insert(mk_pair(e, r));
+            m_st->m_whnf.insert(e, r);
             return r;
         }
     }
@@ -731,7 +931,109 @@ lbool type_checker::quick_is_def_eq(expr const & t, expr const & s, bool use_has
 
 /** \brief Return true if arguments of \c t are definitionally equal to arguments of \c s.
     This method is used to implement an optimization in the method \c is_def_eq. */
+/* When enabled, `is_def_eq_args` farms the argument pairs of large applications
+   out to the runtime task manager. Sibling arguments are independent, so each
+   pair is compared by a fresh `type_checker` state sharing the (read-only)
+   environment and local context. The mode is off by default; it is intended for
+   top-level checking of large terms (big structure literals, `Fin`-indexed
+   matrices), and must not be enabled on threads that are themselves task-manager
+   workers, since joining the spawned tasks could then starve the pool. */
+static bool g_def_eq_args_in_parallel = false;
+
+void set_def_eq_args_in_parallel(bool flag) { g_def_eq_args_in_parallel = flag; }
+bool def_eq_args_in_parallel() { return g_def_eq_args_in_parallel; }
+
+/* Do not parallelize applications with fewer argument pairs than this. */
+#define LEAN_PAR_DEF_EQ_MIN_ARGS 8
+
+struct par_def_eq_arg {
+    environment m_env;
+    local_ctx   m_lctx;
+    bool        m_safe_only;
+    expr        m_t;
+    expr        m_s;
+};
+
+static object * par_def_eq_arg_fn(object * p, object * /* unit */) {
+    par_def_eq_arg * a = reinterpret_cast<par_def_eq_arg *>(lean_unbox_usize(p));
+    lean_dec(p);
+    uint8 r;
+    try {
+        type_checker tc(a->m_env, a->m_lctx, a->m_safe_only);
+        r = tc.is_def_eq(a->m_t, a->m_s) ? 1 : 0;
+    } catch (...) {
+        /* Exceptions cannot cross the task boundary; the caller re-checks the
+           arguments sequentially to produce the actual error. */
+        r = 2;
+    }
+    return lean_box(r);
+}
+
+bool type_checker::is_def_eq_args_par(expr t, expr s) {
+    buffer<expr> t_args, s_args;
+    while (is_app(t) && is_app(s)) {
+        t_args.push_back(app_arg(t));
+        s_args.push_back(app_arg(s));
+        t = app_fn(t);
+        s = app_fn(s);
+    }
+    if (is_app(t) || is_app(s))
+        return false;
+    unsigned n = t_args.size();
+    if (n < LEAN_PAR_DEF_EQ_MIN_ARGS) {
+        for (unsigned i = 0; i < n; i++) {
+            if (!is_def_eq(t_args[i], s_args[i]))
+                return false;
+        }
+        return true;
+    }
+    /* Freeze the context before forking it: insertions in the workers then go
+       into small per-branch overlays instead of rebuilding the shared
+       persistent-map paths once per branch. */
+    m_lctx.freeze();
+    /* The workers read the environment, local context and arguments
+       concurrently, so their reference counters must be atomic. */
+    mark_mt(m_st->m_env.raw());
+    mark_mt(m_lctx.raw());
+    std::vector<par_def_eq_arg> payloads;
+    payloads.reserve(n);
+    for (unsigned i = 0; i < n; i++) {
+        mark_mt(t_args[i].raw());
+        mark_mt(s_args[i].raw());
+        payloads.push_back(par_def_eq_arg{m_st->m_env, m_lctx, m_safe_only, t_args[i], s_args[i]});
+    }
+    buffer<object *> tasks;
+    for (par_def_eq_arg & p : payloads) {
+        object * c = alloc_closure(reinterpret_cast<void *>(par_def_eq_arg_fn), 2, 1);
+        lean_closure_set(c, 0, lean_box_usize(reinterpret_cast<size_t>(&p)));
+        tasks.push_back(task_spawn(c));
+    }
+    /* Join all tasks before leaving the frame that owns the payloads. */
+    bool ok       = true;
+    bool redo_seq = false;
+    for (object * task : tasks) {
+        unsigned r = lean_unbox(task_get(task));
+        if (r == 0)
+            ok = false;
+        else if (r == 2)
+            redo_seq = true;
+        lean_dec(task);
+    }
+    if (!ok)
+        return false;
+    if (redo_seq) {
+        /* A worker hit an exception; reproduce it (or a definite answer) here. */
+        for (unsigned i = 0; i < n; i++) {
+            if (!is_def_eq(t_args[i], s_args[i]))
+                return false;
+        }
+    }
+    return true;
+}
+
 bool type_checker::is_def_eq_args(expr t, expr s) {
+    if (g_def_eq_args_in_parallel)
+        return is_def_eq_args_par(t, s);
     while (is_app(t) && is_app(s)) {
         if (!is_def_eq(app_arg(t), app_arg(s)))
             return false;
@@ -811,13 +1113,13 @@ lbool type_checker::is_def_eq_proof_irrel(expr const & t, expr const & s) {
 
 bool type_checker::failed_before(expr const & t, expr const & s) const {
     if (hash(t) < hash(s)) {
-        return m_st->m_failure.find(mk_pair(t, s)) != m_st->m_failure.end();
+        return m_st->m_failure.contains(mk_pair(t, s));
     } else if (hash(t) > hash(s)) {
-        return m_st->m_failure.find(mk_pair(s, t)) != m_st->m_failure.end();
+        return m_st->m_failure.contains(mk_pair(s, t));
     } else {
         return
-            m_st->m_failure.find(mk_pair(t, s)) != m_st->m_failure.end() ||
-            m_st->m_failure.find(mk_pair(s, t)) != m_st->m_failure.end();
+            m_st->m_failure.contains(mk_pair(t, s)) ||
+            m_st->m_failure.contains(mk_pair(s, t));
     }
 }
 
@@ -841,6 +1143,40 @@ optional<expr> type_checker::try_unfold_proj_app(expr const & e) {
     return none_expr();
 }
 
+/* Minimum advantage in the outcome histograms before they override the
+   reducibility-hint comparison in `lazy_delta_reduction_step`. */
+#define LEAN_UNFOLD_BIAS_THRESHOLD 4
+
+/** \brief Return a negative value to prefer unfolding `d_t`, a positive value to
+    prefer unfolding `d_s`, and 0 when the outcome histograms have no clear signal.
+
+    The reducibility-hint heights only compare a single pair of definitions; the
+    histograms accumulate which unfold direction actually let the subsequent quick
+    check decide past queries, so a constant that systematically sits on the wrong
+    side of the height comparison is corrected after a few samples. */
+int type_checker::unfold_bias(constant_info const & d_t, constant_info const & d_s) const {
+    state::unfold_stats_map const & stats = m_st->m_unfold_stats;
+    if (stats.empty())
+        return 0;
+    auto score = [&](name const & n) -> long {
+        auto it = stats.find(n);
+        return it == stats.end() ? 0 : static_cast<long>(it->second.m_hits) - static_cast<long>(it->second.m_misses);
+    };
+    long d = score(d_t.get_name()) - score(d_s.get_name());
+    if (d >= LEAN_UNFOLD_BIAS_THRESHOLD) return -1;
+    if (d <= -LEAN_UNFOLD_BIAS_THRESHOLD) return 1;
+    return 0;
+}
+
+void type_checker::record_unfold_outcome(optional<name> const & t_name, optional<name> const & s_name, bool success) {
+    auto record = [&](name const & n) {
+        state::unfold_outcome & o = m_st->m_unfold_stats[n];
+        if (success) o.m_hits++; else o.m_misses++;
+    };
+    if (t_name) record(*t_name);
+    if (s_name) record(*s_name);
+}
+
 /** \brief Perform one lazy delta-reduction step.
      Return
      - l_true if t_n and s_n are definitionally equal.
@@ -851,6 +1187,8 @@ optional<expr> type_checker::try_unfold_proj_app(expr const & e) {
 auto type_checker::lazy_delta_reduction_step(expr & t_n, expr & s_n) -> reduction_status {
     auto d_t = is_delta(t_n);
     auto d_s = is_delta(s_n);
+    /* constants unfolded in this step, for the outcome histograms */
+    optional<name> uf_t, uf_s;
     if (!d_t && !d_s) {
         return reduction_status::DefUnknown;
     } else if (d_t && !d_s) {
@@ -865,6 +1203,7 @@ auto type_checker::lazy_delta_reduction_step(expr & t_n, expr & s_n) -> reductio
         if (auto s_n_new = try_unfold_proj_app(s_n)) {
             s_n = *s_n_new;
         } else {
+            uf_t = optional<name>(d_t->get_name());
             t_n = whnf_core(*unfold_definition(t_n), false, true);
         }
     } else if (!d_t && d_s) {
@@ -872,13 +1211,20 @@ auto type_checker::lazy_delta_reduction_step(expr & t_n, expr & s_n) -> reductio
         if (auto t_n_new = try_unfold_proj_app(t_n)) {
             t_n = *t_n_new;
         } else {
+            uf_s = optional<name>(d_s->get_name());
             s_n = whnf_core(*unfold_definition(s_n), false, true);
         }
     } else {
-        int c = compare(d_t->get_hints(), d_s->get_hints());
+        /* The outcome histograms take precedence over the height comparison when
+           they show a clear systematic winner; heights remain the fallback. */
+        int c = unfold_bias(*d_t, *d_s);
+        if (c == 0)
+            c = compare(d_t->get_hints(), d_s->get_hints());
         if (c < 0) {
+            uf_t = optional<name>(d_t->get_name());
             t_n = whnf_core(*unfold_definition(t_n), false, true);
         } else if (c > 0) {
+            uf_s = optional<name>(d_s->get_name());
             s_n = whnf_core(*unfold_definition(s_n), false, true);
         } else {
             if (is_app(t_n) && is_app(s_n) && is_eqp(*d_t, *d_s) && d_t->get_hints().is_regular()) {
@@ -895,11 +1241,43 @@ auto type_checker::lazy_delta_reduction_step(expr & t_n, expr & s_n) -> reductio
                     }
                 }
             }
-            t_n = whnf_core(*unfold_definition(t_n), false, true);
-            s_n = whnf_core(*unfold_definition(s_n), false, true);
+            /* The hints tie. If the body of exactly one side is headed by the
+               constant at the head of the other side, unfolding that side alone
+               tends to cancel against the other head at the next quick check,
+               so prefer it over unfolding both. The fingerprints are computed
+               once per declaration, so this decision does not inspect values. */
+            state::unfold_fingerprint const & fp_t = get_unfold_fingerprint(*d_t);
+            state::unfold_fingerprint const & fp_s = get_unfold_fingerprint(*d_s);
+            bool t_exposes_s = fp_t.m_head == const_name(get_app_fn(s_n));
+            bool s_exposes_t = fp_s.m_head == const_name(get_app_fn(t_n));
+            if (t_exposes_s && !s_exposes_t) {
+                uf_t = optional<name>(d_t->get_name());
+                t_n = whnf_core(*unfold_definition(t_n), false, true);
+            } else if (s_exposes_t && !t_exposes_s) {
+                uf_s = optional<name>(d_s->get_name());
+                s_n = whnf_core(*unfold_definition(s_n), false, true);
+            } else if (t_exposes_s && s_exposes_t) {
+                /* Mutual wrappers; unfold the smaller body, it is cheaper to
+                   instantiate and more likely to be the thin alias. */
+                if (fp_t.m_size <= fp_s.m_size) {
+                    uf_t = optional<name>(d_t->get_name());
+                    t_n = whnf_core(*unfold_definition(t_n), false, true);
+                } else {
+                    uf_s = optional<name>(d_s->get_name());
+                    s_n = whnf_core(*unfold_definition(s_n), false, true);
+                }
+            } else {
+                uf_t = optional<name>(d_t->get_name());
+                uf_s = optional<name>(d_s->get_name());
+                t_n = whnf_core(*unfold_definition(t_n), false, true);
+                s_n = whnf_core(*unfold_definition(s_n), false, true);
+            }
         }
     }
-    switch (quick_is_def_eq(t_n, s_n)) {
+    lbool r = quick_is_def_eq(t_n, s_n);
+    if (r != l_undef && (uf_t || uf_s))
+        record_unfold_outcome(uf_t, uf_s, r == l_true);
+    switch (r) {
     case l_true:  return reduction_status::DefEqual;
     case l_false: return reduction_status::DefDiff;
     case l_undef: return reduction_status::Continue;
@@ -1149,6 +1527,22 @@ void initialize_type_checker() {
     mark_persistent(g_nat_beq->raw());
     g_nat_ble      = new expr(mk_constant(name{"Nat", "ble"}));
     mark_persistent(g_nat_ble->raw());
+    g_nat_land     = new expr(mk_constant(name{"Nat", "land"}));
+    mark_persistent(g_nat_land->raw());
+    g_nat_lor      = new expr(mk_constant(name{"Nat", "lor"}));
+    mark_persistent(g_nat_lor->raw());
+    g_nat_xor      = new expr(mk_constant(name{"Nat", "xor"}));
+    mark_persistent(g_nat_xor->raw());
+    g_nat_shiftl   = new expr(mk_constant(name{"Nat", "shiftLeft"}));
+    mark_persistent(g_nat_shiftl->raw());
+    g_nat_shiftr   = new expr(mk_constant(name{"Nat", "shiftRight"}));
+    mark_persistent(g_nat_shiftr->raw());
+    g_nat_pow      = new expr(mk_constant(name{"Nat", "pow"}));
+    mark_persistent(g_nat_pow->raw());
+    g_nat_gcd      = new expr(mk_constant(name{"Nat", "gcd"}));
+    mark_persistent(g_nat_gcd->raw());
+    g_nat_log2     = new expr(mk_constant(name{"Nat", "log2"}));
+    mark_persistent(g_nat_log2->raw());
     g_string_mk    = new expr(mk_constant(name{"String", "mk"}));
     mark_persistent(g_string_mk->raw());
     g_lean_reduce_bool = new expr(mk_constant(name{"Lean", "reduceBool"}));
@@ -1156,9 +1550,55 @@ void initialize_type_checker() {
     g_lean_reduce_nat  = new expr(mk_constant(name{"Lean", "reduceNat"}));
     mark_persistent(g_lean_reduce_nat->raw());
     register_name_generator_prefix(*g_kernel_fresh);
+    if (std::getenv("LEAN_TC_UNFOLD_COUNTS")) {
+        g_unfold_counts_mutex = new mutex();
+        g_unfold_counts       = new name_map<uint64>();
+    }
+    if (std::getenv("LEAN_TC_UNFOLD_STATS")) {
+        g_unfold_stats_mutex = new mutex();
+        g_unfold_stats       = new name_map<pair<uint64, uint64>>();
+    }
+    g_proj_counts = std::getenv("LEAN_TC_PROJ_COUNTS") != nullptr;
 }
 
 void finalize_type_checker() {
+    if (g_unfold_counts) {
+        std::vector<pair<name, uint64>> counts;
+        g_unfold_counts->for_each([&](name const & n, uint64 const & c) {
+            counts.emplace_back(n, c);
+        });
+        std::sort(counts.begin(), counts.end(),
+                  [](pair<name, uint64> const & p1, pair<name, uint64> const & p2) {
+                      return p1.second > p2.second;
+                  });
+        std::cerr << "type checker unfoldings per constant:\n";
+        for (auto const & p : counts)
+            std::cerr << "  " << p.second << " x " << p.first << "\n";
+        delete g_unfold_counts;       g_unfold_counts = nullptr;
+        delete g_unfold_counts_mutex; g_unfold_counts_mutex = nullptr;
+    }
+    if (g_unfold_stats) {
+        std::vector<pair<name, pair<uint64, uint64>>> stats;
+        g_unfold_stats->for_each([&](name const & n, pair<uint64, uint64> const & c) {
+            stats.emplace_back(n, c);
+        });
+        std::sort(stats.begin(), stats.end(),
+                  [](pair<name, pair<uint64, uint64>> const & p1, pair<name, pair<uint64, uint64>> const & p2) {
+                      return p1.second.first + p1.second.second > p2.second.first + p2.second.second;
+                  });
+        std::cerr << "type checker unfold outcome histograms (hits/misses per constant):\n";
+        for (auto const & p : stats)
+            std::cerr << "  " << p.second.first << "/" << p.second.second << " " << p.first << "\n";
+        delete g_unfold_stats;       g_unfold_stats = nullptr;
+        delete g_unfold_stats_mutex; g_unfold_stats_mutex = nullptr;
+    }
+    if (g_proj_counts) {
+        std::cerr << "type checker projection reductions:\n";
+        std::cerr << "  fast (literal constructor):  " << g_num_proj_fast << "\n";
+        std::cerr << "  deep (whnf required):        " << g_num_proj_deep << "\n";
+        std::cerr << "  stuck (no constructor):      " << g_num_proj_stuck << "\n";
+        g_proj_counts = false;
+    }
     delete g_dont_care;
     delete g_kernel_fresh;
     delete g_nat_succ;
@@ -1170,6 +1610,14 @@ void finalize_type_checker() {
     delete g_nat_mod;
     delete g_nat_beq;
     delete g_nat_ble;
+    delete g_nat_land;
+    delete g_nat_lor;
+    delete g_nat_xor;
+    delete g_nat_shiftl;
+    delete g_nat_shiftr;
+    delete g_nat_pow;
+    delete g_nat_gcd;
+    delete g_nat_log2;
     delete g_string_mk;
     delete g_lean_reduce_bool;
     delete g_lean_reduce_nat;
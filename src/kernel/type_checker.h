@@ -11,30 +11,85 @@ Author: Leonardo de Moura
 #include <algorithm>
 #include "util/lbool.h"
 #include "util/name_set.h"
+#include "util/name_hash_map.h"
 #include "util/name_generator.h"
 #include "kernel/environment.h"
 #include "kernel/local_ctx.h"
 #include "kernel/expr_maps.h"
+#include "kernel/expr_sets.h"
 #include "kernel/equiv_manager.h"
 
 namespace lean {
+/* Default bound (in entries per generation) for the whnf/infer caches of a
+   type_checker state. Long-lived states (e.g. in server sessions) rotate their
+   caches at this size instead of growing without bound. */
+#define LEAN_TYPE_CHECKER_CACHE_CAPACITY (1u << 16)
+
 /** \brief Lean Type Checker. It can also be used to infer types, check whether a
     type \c A is convertible to a type \c B, etc. */
 class type_checker {
 public:
     class state {
-        typedef expr_map<expr> infer_cache;
-        typedef std::unordered_set<expr_pair, expr_pair_hash, expr_pair_eq> expr_pair_set;
+        typedef expr_gen_map<expr> infer_cache;
+        /* Memo for universe-instantiated constant values and recursor-rule
+           right-hand sides. The generic value is compared by pointer identity;
+           it is owned by the environment, which the state keeps alive. */
+        struct instantiation_key {
+            expr   m_value;
+            levels m_ls;
+        };
+        struct instantiation_key_hash {
+            unsigned operator()(instantiation_key const & k) const {
+                unsigned h = ::lean::hash(k.m_value);
+                for (level const & l : k.m_ls)
+                    h = ::lean::hash(h, ::lean::hash(l));
+                return h;
+            }
+        };
+        struct instantiation_key_eq {
+            bool operator()(instantiation_key const & k1, instantiation_key const & k2) const {
+                return is_eqp(k1.m_value, k2.m_value) && k1.m_ls == k2.m_ls;
+            }
+        };
+        typedef std::unordered_map<instantiation_key, expr, instantiation_key_hash, instantiation_key_eq> instantiation_cache;
+        /* Unfolding fingerprint of a definition: the head constant of its body
+           (anonymous when the head is not a constant) and a bounded node count.
+           Computed once per declaration and reused across def-eq steps, so the
+           which-side-to-unfold heuristic in `lazy_delta_reduction_step` can
+           decide without re-inspecting values. */
+        struct unfold_fingerprint {
+            name     m_head;
+            unsigned m_size;
+        };
+        typedef name_hash_map<unfold_fingerprint> fingerprint_cache;
+        /* Histogram of delta-step outcomes per unfolded constant: how often
+           unfolding the constant let the following quick check decide the
+           def-eq query. Used to bias the unfold direction when both sides are
+           delta candidates, see `unfold_bias`. */
+        struct unfold_outcome {
+            unsigned m_hits   = 0;
+            unsigned m_misses = 0;
+        };
+        typedef name_hash_map<unfold_outcome> unfold_stats_map;
         environment               m_env;
         name_generator            m_ngen;
         infer_cache               m_infer_type[2];
-        expr_map<expr>            m_whnf_core;
-        expr_map<expr>            m_whnf;
+        expr_gen_map<expr>        m_whnf_core;
+        expr_gen_map<expr>        m_whnf;
+        instantiation_cache       m_instantiations;
+        fingerprint_cache         m_fingerprints;
+        unfold_stats_map          m_unfold_stats;
+        /* Inline cache for `is_delta`: delta chains resolve the same heads
+           over and over. */
+        constant_handle           m_find_handle;
         equiv_manager             m_eqv_manager;
-        expr_pair_set             m_failure;
+        /* Negative cache for def-eq checks; almost all queries miss, so it is
+           fronted by a Bloom filter and bounded generationally. */
+        expr_pair_gen_set         m_failure;
         friend type_checker;
     public:
-        state(environment const & env);
+        state(environment const & env, unsigned cache_capacity = LEAN_TYPE_CHECKER_CACHE_CAPACITY);
+        ~state();
         environment & env() { return m_env; }
         environment const & env() const { return m_env; }
         name_generator & ngen() { return m_ngen; }
@@ -66,6 +121,8 @@ private:
     optional<expr> reduce_proj(expr const & e, bool cheap_rec, bool cheap_proj);
     expr whnf_fvar(expr const & e, bool cheap_rec, bool cheap_proj);
     optional<constant_info> is_delta(expr const & e) const;
+    state::unfold_fingerprint const & get_unfold_fingerprint(constant_info const & d);
+    expr instantiate_lparams_memo(expr const & v, names const & lps, levels const & ls);
     optional<expr> unfold_definition_core(expr const & e);
 
     bool is_def_eq_binding(expr t, expr s);
@@ -74,6 +131,7 @@ private:
     lbool quick_is_def_eq(expr const & t, expr const & s, bool use_hash = false);
     lbool is_def_eq_offset(expr const & t, expr const & s);
     bool is_def_eq_args(expr t, expr s);
+    bool is_def_eq_args_par(expr t, expr s);
     bool try_eta_expansion_core(expr const & t, expr const & s);
     bool try_eta_expansion(expr const & t, expr const & s) {
         return try_eta_expansion_core(t, s) || try_eta_expansion_core(s, t);
@@ -89,6 +147,8 @@ private:
     bool is_def_eq_unit_like(expr const & t, expr const & s);
     bool failed_before(expr const & t, expr const & s) const;
     void cache_failure(expr const & t, expr const & s);
+    int unfold_bias(constant_info const & d_t, constant_info const & d_s) const;
+    void record_unfold_outcome(optional<name> const & t_name, optional<name> const & s_name, bool success);
     reduction_status lazy_delta_reduction_step(expr & t_n, expr & s_n);
     lbool lazy_delta_reduction(expr & t_n, expr & s_n);
     bool is_def_eq_core(expr const & t, expr const & s);
@@ -157,6 +217,12 @@ public:
     optional<expr> unfold_definition(expr const & e);
 };
 
+/** \brief Enable/disable farming argument pairs of large applications in
+    `is_def_eq_args` out to the runtime task manager. Off by default. Must not
+    be enabled on threads that are themselves task-manager workers. */
+void set_def_eq_args_in_parallel(bool flag);
+bool def_eq_args_in_parallel();
+
 void initialize_type_checker();
 void finalize_type_checker();
 }
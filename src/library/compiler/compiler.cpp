@@ -168,6 +168,17 @@ bool is_matcher(environment const & env, comp_decls const & ds) {
     return length(ds) == 1 && is_matcher(env, head(ds).fst());
 }
 
+/* Compile the declarations `cs`.
+
+   Note on parallelism: the pipeline below is deliberately sequential. `compile` is
+   invoked once per elaborated declaration (or mutual block), so the declarations in
+   `cs` are mutually dependent and cannot be compiled independently; several passes
+   (`eager_lambda_lifting`, `specialize`, `extract_closed`, the stage1/stage2 caches)
+   thread the environment through, and lifting `ds` into `task_manager` tasks would
+   require `mark_mt`-marking freshly elaborated terms, making every subsequent RC
+   operation on them atomic. Codegen parallelism across *independent* declarations is
+   obtained at the command/file granularity, where the elaborator already runs
+   `lean_compile_decls` from environment-branching tasks. */
 environment compile(environment const & env, options const & opts, names cs) {
     /* Do not generate code for irrelevant decls */
     cs = filter(cs, [&](name const & c) { return !is_irrelevant_type(env, env.get(c).get_type());});
@@ -221,7 +232,19 @@ environment compile(environment const & env, options const & opts, names cs) {
     environment new_env = env;
     std::tie(new_env, ds) = eager_lambda_lifting(new_env, ds, cfg);
     trace_compiler(name({"compiler", "eager_lambda_lifting"}), ds);
-    ds = apply(max_sharing, ds);
+    {
+        /* use the batch overload: declarations are independent, so it can farm
+           them out to the task manager when parallel mode is enabled */
+        buffer<expr> vals;
+        for (comp_decl const & d : ds)
+            vals.push_back(d.snd());
+        max_sharing(vals);
+        buffer<comp_decl> new_ds;
+        unsigned i = 0;
+        for (comp_decl const & d : ds)
+            new_ds.push_back(comp_decl(d.fst(), vals[i++]));
+        ds = comp_decls(new_ds.begin(), new_ds.end());
+    }
     trace_compiler(name({"compiler", "stage1"}), ds);
     new_env = cache_stage1(new_env, ds);
     if (is_matcher(new_env, ds)) {
@@ -260,6 +283,11 @@ environment compile(environment const & env, options const & opts, names cs) {
         trace_compiler(name({"compiler", "extract_closed"}), ds);
     }
     new_env = cache_new_stage2(new_env, ds);
+    /* Running `cse` before the final `simp` eliminates guards dominated by an identical one:
+       `cse` merges the duplicated pure chains (e.g. `Array.size a` and the `Nat.decLt i sz`
+       of a repeated bounds check), after which the nested `cases` on the merged discriminant
+       is folded by `csimp` (see `m_expr2ctor`), leaving only the unchecked access. */
+    ds = apply(ecse, new_env, ds);
     ds = apply(esimp, new_env, ds);
     trace_compiler(name({"compiler", "simp"}), ds);
     ds = apply(simp_app_args, new_env, ds);
@@ -24,6 +24,17 @@ class cse_fn {
     environment       m_env;
     name_generator    m_ngen;
     bool              m_before_erasure;
+    /* Map from let-value key to the fvar of the first binding with that value.
+
+       Cost note: hashing a key is O(1) regardless of its size -- `expr_hash` reads the
+       hash cached in the expression header (see `hash(expr const &)` in `kernel/expr.cpp`),
+       and the `mk_app` in `mk_key` derives its hash from the two cached child hashes.
+       Structural equality on collision candidates is pre-filtered by those hashes and by
+       the thread-local `eq_cache` (`kernel/expr_eq_fn.cpp`), so it only walks terms that
+       are actually equal. Keys contain no binder context: loose bvars have been replaced
+       by fvars (`instantiate_rev` in `visit_let`) before the key is built, which both
+       makes keys valid across binders and preserves subterm sharing (and hence the
+       cached hashes). */
     expr_map<expr>    m_map;
     std::vector<expr> m_keys;
 
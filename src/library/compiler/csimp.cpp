@@ -17,6 +17,7 @@ Author: Leonardo de Moura
 #include "kernel/kernel_exception.h"
 #include "library/util.h"
 #include "library/constants.h"
+#include "util/option_declarations.h"
 #include "library/class.h"
 #include "library/trace.h"
 #include "library/expr_pair_maps.h"
@@ -27,10 +28,58 @@ Author: Leonardo de Moura
 #include "library/compiler/extract_closed.h"
 #include "library/compiler/reduce_arity.h"
 #include "library/compiler/init_attribute.h"
+#include "runtime/thread.h"
 
 namespace lean {
-csimp_cfg::csimp_cfg(options const &):
+static name * g_compiler_inline           = nullptr;
+static name * g_compiler_inline_threshold = nullptr;
+
+/* Memoized inline-candidate analyses. `is_recursive`, `uses_unsafe_inductive`, and the
+   LCNF size of a candidate's value are recomputed for the same constants at every
+   application visited, across all declarations simplified against the same environment;
+   each query walks whole (transitively inlined) bodies. The results depend only on the
+   environment and the inline threshold, so we keep one cache per thread and reset it
+   when either changes. The environment is held by value to keep it alive. */
+struct csimp_cache {
+    environment        m_env;
+    unsigned           m_inline_threshold;
+    /* keyed by stage1/stage2 name, so the phase is part of the key */
+    name_map<unsigned> m_lcnf_size;
+    name_map<bool>     m_unsafe_inductive;
+    /* keyed by declaration name, indexed by `before_erasure` */
+    name_map<bool>     m_recursive[2];
+    csimp_cache(environment const & env, unsigned inline_threshold):
+        m_env(env), m_inline_threshold(inline_threshold) {}
+};
+LEAN_THREAD_PTR(csimp_cache, g_csimp_cache);
+LEAN_THREAD_VALUE(bool, g_csimp_cache_finalizer_registered, false);
+
+static csimp_cache & get_csimp_cache(environment const & env, unsigned inline_threshold) {
+    if (!g_csimp_cache || !is_eqp(g_csimp_cache->m_env, env) || g_csimp_cache->m_inline_threshold != inline_threshold) {
+        if (!g_csimp_cache_finalizer_registered) {
+            register_thread_finalizer([](void *) { delete g_csimp_cache; g_csimp_cache = nullptr; }, nullptr);
+            g_csimp_cache_finalizer_registered = true;
+        }
+        delete g_csimp_cache;
+        g_csimp_cache = new csimp_cache(env, inline_threshold);
+    }
+    return *g_csimp_cache;
+}
+
+/* Memoized `get_lcnf_size` for the value `v` of the constant `c` (a stage1/stage2 name). */
+static unsigned get_constant_lcnf_size(environment const & env, unsigned inline_threshold, name const & c, expr const & v) {
+    csimp_cache & cache = get_csimp_cache(env, inline_threshold);
+    if (unsigned const * r = cache.m_lcnf_size.find(c))
+        return *r;
+    unsigned r = get_lcnf_size(env, v);
+    cache.m_lcnf_size.insert(c, r);
+    return r;
+}
+
+csimp_cfg::csimp_cfg(options const & opts):
     csimp_cfg() {
+    m_inline           = opts.get_bool(*g_compiler_inline, m_inline);
+    m_inline_threshold = opts.get_unsigned(*g_compiler_inline_threshold, m_inline_threshold);
 }
 
 csimp_cfg::csimp_cfg() {
@@ -1390,7 +1439,10 @@ class csimp_fn {
       `y_i` may depend on other let-declarations, but we only inline if the number
       of let-decl dependencies is less than `m_inline_threshold`.
 
-      Remark: this transformation is only applied before erasure.
+      Remark: after erasure, this transformation complements `struct_cases_on`: destructuring
+      the result of a call (e.g., the pervasive return-pair idiom) has by then been reduced to
+      projections, so extracting the projected fields from a constructor-returning callee
+      eliminates the constructor allocation in the producer as well.
       Remark: this transformation complements eager lambda lifting,
       and has been designed to optimize code such as:
       ```
@@ -1418,7 +1470,6 @@ class csimp_fn {
       See additional comments at `eager_lambda_lifting.cpp` */
     optional<expr> try_inline_proj_app(expr const & e, bool is_let_val) {
         lean_assert(is_proj(e));
-        if (!m_before_erasure) return none_expr();
         if (!proj_idx(e).is_small()) return none_expr();
         unsigned idx = proj_idx(e).get_small_value();
         expr s = find(proj_expr(e));
@@ -1427,11 +1478,14 @@ class csimp_fn {
         if (!is_constant(s_fn)) return none_expr();
         if (has_init_attribute(env(), const_name(s_fn))) return none_expr();
         if (has_noinline_attribute(env(), const_name(s_fn))) return none_expr();
-        optional<constant_info> info = env().find(mk_cstage1_name(const_name(s_fn)));
+        /* We should not inline closed constants we have extracted. */
+        if (!m_before_erasure && is_extract_closed_aux_fn(const_name(s_fn))) return none_expr();
+        name c = m_before_erasure ? mk_cstage1_name(const_name(s_fn)) : mk_cstage2_name(const_name(s_fn));
+        optional<constant_info> info = env().find(c);
         if (!info || !info->is_definition()) return none_expr();
         if (s_args.size()  < get_num_nested_lambdas(info->get_value())) return none_expr();
         if (!inline_proj_app_candidate(info->get_value())) return none_expr();
-        expr s_val = instantiate_value_lparams(*info, const_levels(s_fn));
+        expr s_val = m_before_erasure ? instantiate_value_lparams(*info, const_levels(s_fn)) : info->get_value();
         s_val = apply_beta(s_val, s_args.size(), s_args.data());
         buffer<expr> fvars;
         while (is_let(s_val)) {
@@ -1643,7 +1697,7 @@ class csimp_fn {
                 return optional<constant_info>();
             } else if (has_inline_attribute(m_env, f)) {
                 return info;
-            } else if (get_lcnf_size(m_env, info->get_value()) <= m_cfg.m_inline_threshold) {
+            } else if (get_constant_lcnf_size(m_env, m_cfg.m_inline_threshold, c, info->get_value()) <= m_cfg.m_inline_threshold) {
                 return info;
             } else {
                 return optional<constant_info>();
@@ -1671,17 +1725,27 @@ class csimp_fn {
 
     /* We don't inline recursive functions. */
     bool is_recursive(name const & c) {
-        return is_recursive_fn(env(), m_cfg, m_before_erasure)(c);
+        name_map<bool> & cached = get_csimp_cache(env(), m_cfg.m_inline_threshold).m_recursive[m_before_erasure ? 0 : 1];
+        if (bool const * r = cached.find(c))
+            return *r;
+        bool r = is_recursive_fn(env(), m_cfg, m_before_erasure)(c);
+        cached.insert(c, r);
+        return r;
     }
 
     bool uses_unsafe_inductive(name const & c) {
+        name_map<bool> & cached = get_csimp_cache(env(), m_cfg.m_inline_threshold).m_unsafe_inductive;
+        if (bool const * r = cached.find(c))
+            return *r;
         constant_info info = env().get(c);
-        return static_cast<bool>(::lean::find(info.get_value(), [&](expr const & e, unsigned) {
+        bool r = static_cast<bool>(::lean::find(info.get_value(), [&](expr const & e, unsigned) {
                     if (!is_constant(e) || !is_cases_on_recursor(env(), const_name(e))) return false;
                     name const & I = const_name(e).get_prefix();
                     constant_info I_cinfo = env().get(I);
                     return I_cinfo.is_unsafe();
                 }));
+        cached.insert(c, r);
+        return r;
     }
 
     bool is_stuck_at_cases(expr e) {
@@ -1743,7 +1807,7 @@ class csimp_fn {
             bool inline_attr           = has_inline_attribute(env(), const_name(fn));
             bool inline_if_reduce_attr = has_inline_if_reduce_attribute(env(), const_name(fn));
             if (!inline_attr && !inline_if_reduce_attr &&
-                (get_lcnf_size(env(), info->get_value()) > m_cfg.m_inline_threshold ||
+                (get_constant_lcnf_size(env(), m_cfg.m_inline_threshold, c, info->get_value()) > m_cfg.m_inline_threshold ||
                  is_constant(e))) { /* We only inline constants if they are marked with the `[inline]` or `[inline_if_reduce]` attrs */
                 return none_expr();
             }
@@ -1769,7 +1833,7 @@ class csimp_fn {
             if (!info || !info->is_definition()) return none_expr();
             unsigned arity = get_num_nested_lambdas(info->get_value());
             if (get_app_num_args(e) < arity || arity == 0) return none_expr();
-            if (get_lcnf_size(env(), info->get_value()) > m_cfg.m_inline_threshold) return none_expr();
+            if (get_constant_lcnf_size(env(), m_cfg.m_inline_threshold, c, info->get_value()) > m_cfg.m_inline_threshold) return none_expr();
             if (is_recursive(const_name(fn))) return none_expr();
             if (uses_unsafe_inductive(c)) return none_expr();
             return some_expr(beta_reduce(info->get_value(), e, is_let_val));
@@ -2124,4 +2188,21 @@ expr csimp_core(environment const & env, local_ctx const & lctx, expr const & e0
         e = new_e;
     }
 }
+
+void initialize_csimp() {
+    g_compiler_inline = new name{"compiler", "inline"};
+    mark_persistent(g_compiler_inline->raw());
+    register_bool_option(*g_compiler_inline, true,
+                         "(compiler) enable/disable inlining of definitions tagged with the `[inline]` attribute");
+    g_compiler_inline_threshold = new name{"compiler", "inline_threshold"};
+    mark_persistent(g_compiler_inline_threshold->raw());
+    register_unsigned_option(*g_compiler_inline_threshold, 1,
+                             "(compiler) inline functions whose normalized size is at most this threshold, even without an `[inline]` attribute. "
+                             "Raising it (e.g., via `set_option` in a hot module) trades code size for fewer calls");
+}
+
+void finalize_csimp() {
+    delete g_compiler_inline_threshold;
+    delete g_compiler_inline;
+}
 }
@@ -0,0 +1,19 @@
+/*
+Copyright (c) 2023 Microsoft Corporation. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#include "library/compiler/field_order_attribute.h"
+
+namespace lean {
+extern "C" object * lean_get_field_order(object * env, object * n);
+
+static optional<array_ref<name>> get_field_order(environment const & env, name const & n) {
+    return to_optional<array_ref<name>>(lean_get_field_order(env.to_obj_arg(), n.to_obj_arg()));
+}
+
+optional<array_ref<name>> get_field_order(environment const & env, name const & ctor_name, name const & induct_name) {
+    if (optional<array_ref<name>> r = get_field_order(env, ctor_name))
+        return r;
+    return get_field_order(env, induct_name);
+}
+}
@@ -0,0 +1,14 @@
+/*
+Copyright (c) 2023 Microsoft Corporation. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#pragma once
+#include "runtime/array_ref.h"
+#include "kernel/environment.h"
+
+namespace lean {
+/* Return the field priority list given with the `@[field_order]` attribute for the
+   constructor `ctor_name` or, if the constructor itself was not annotated, for its
+   inductive type `induct_name`. */
+optional<array_ref<name>> get_field_order(environment const & env, name const & ctor_name, name const & induct_name);
+}
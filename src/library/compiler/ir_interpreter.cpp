@@ -26,7 +26,10 @@ functions, which have a (relatively) homogeneous ABI that we can use without run
 `call/lookup_symbol` below.
 
 */
+#include <algorithm>
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #ifdef LEAN_WINDOWS
 #include <windows.h>
@@ -40,6 +43,8 @@ functions, which have a (relatively) homogeneous ABI that we can use without run
 #include "runtime/io.h"
 #include "runtime/option_ref.h"
 #include "runtime/array_ref.h"
+#include "runtime/sigprof.h"
+#include "runtime/load_dynlib.h"
 #include "library/time_task.h"
 #include "library/trace.h"
 #include "library/compiler/ir.h"
@@ -51,6 +56,20 @@ functions, which have a (relatively) homogeneous ABI that we can use without run
 #define LEAN_DEFAULT_INTERPRETER_PREFER_NATIVE true
 #endif
 
+/* Use computed-goto direct threading in `eval_body` where the compiler supports it: each
+   instruction handler jumps straight to the handler of its continuation instead of going
+   back through the shared switch, which removes one branch per interpreted instruction
+   and lets the CPU predict each instruction pair separately. Disabled in debug builds so
+   the per-step trace at the top of the dispatch loop keeps firing. */
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(LEAN_DEBUG)
+#define LEAN_IR_DIRECT_THREADING
+#endif
+
+/* `Case` dispatch over at least this many alternatives goes through a per-site jump
+   table instead of a linear scan of the alternative list; below it, the scan is cheaper
+   than the cache lookup. */
+#define LEAN_IR_CASE_DISPATCH_MIN_ALTS 8
+
 namespace lean {
 namespace ir {
 // C++ wrappers of Lean data types
@@ -191,6 +210,8 @@ static string_ref * g_mangle_prefix = nullptr;
 static string_ref * g_boxed_suffix = nullptr;
 static string_ref * g_boxed_mangled_suffix = nullptr;
 static name * g_interpreter_prefer_native = nullptr;
+static unsigned g_interpreter_prefer_native_idx = 0;
+static name * g_interpreter_hot = nullptr;
 
 // constants (lacking native declarations) initialized by `lean_run_init`
 static name_map<object *> * g_init_globals;
@@ -296,6 +317,10 @@ void print_value(tout const & ios, value const & v, type t) {
 }
 
 void * lookup_symbol_in_cur_exe(char const * sym) {
+    /* bundled dylibs pack many modules into one library; probe their handles
+       directly before falling back to the scan over every loaded object */
+    if (void * addr = lookup_symbol_in_dynlib_bundles(sym))
+        return addr;
 #ifdef LEAN_WINDOWS
     HMODULE hmods[128];  // 128 modules should be enough for everyone
     DWORD bytes_needed;
@@ -314,6 +339,13 @@ void * lookup_symbol_in_cur_exe(char const * sym) {
 
 class interpreter;
 LEAN_THREAD_PTR(interpreter, g_interpreter);
+/* Idle interpreter retained from the most recent top-level `with_interpreter` call on this
+   thread. Separate top-level calls against the same environment (e.g. the many interpreted
+   delaborators, macros, and tactics executed while elaborating a single command) previously
+   each built a fresh interpreter and re-resolved every declaration and symbol from scratch;
+   keeping the last instance around lets them share the warmed-up caches instead. */
+LEAN_THREAD_PTR(interpreter, g_cached_interpreter);
+LEAN_THREAD_VALUE(bool, g_cached_interpreter_finalizer_registered, false);
 
 class interpreter {
     // stack of IR variable slots
@@ -329,8 +361,11 @@ class interpreter {
         frame(name const & mFn, size_t mArgBp, size_t mJpBp) : m_fn(mFn), m_arg_bp(mArgBp), m_jp_bp(mJpBp) {}
     };
     std::vector<frame> m_call_stack;
-    environment const & m_env;
-    options const & m_opts;
+    /* Held by value so that an interpreter stashed in `g_cached_interpreter` keeps the
+       environment (and thus all IR objects its caches point into) alive after the caller's
+       reference has gone out of scope. */
+    environment m_env;
+    options m_opts;
     // if `false`, use IR code where possible
     bool m_prefer_native;
     struct constant_cache_entry {
@@ -348,6 +383,49 @@ class interpreter {
     };
     // caches symbol lookup successes _and_ failures
     name_map<symbol_cache_entry> m_symbol_cache;
+    /* Per-call-site inline caches: maps the address of an `FAp`/`PAp` IR expression to its
+       resolved symbol entry, so re-executing a call site skips the name-based lookup in
+       `m_symbol_cache`. The IR objects are owned by `m_env`, which the interpreter keeps
+       alive for its own lifetime, so the addresses are stable keys. */
+    std::unordered_map<void const *, symbol_cache_entry> m_callsite_cache;
+    /* Per-case-site jump tables: maps the address of a `Case` IR body to a table indexed
+       by constructor tag, so dispatch over large inductives is O(1) instead of a linear
+       scan of the alternative list. Built lazily on first execution of each site; the
+       same key-stability argument as for `m_callsite_cache` applies. */
+    struct case_dispatch_entry {
+        std::vector<fn_body const *> m_conts; // indexed by constructor tag; null -> use default
+        fn_body const * m_default = nullptr;
+    };
+    std::unordered_map<void const *, case_dispatch_entry> m_case_cache;
+    /* Per-declaration frame shape: the number of variable slots (parameters, `let`
+       bindings, and join-point parameters) and join-point slots a frame for the
+       declaration can ever use. Computed by a single pass over the IR body on first
+       call and cached by body address (same key-stability argument as for
+       `m_callsite_cache`), so frames can be sized once on entry instead of `var`
+       growing the stack slot by slot while executing the body. */
+    struct frame_shape {
+        size_t m_num_vars;
+        size_t m_num_jps;
+    };
+    std::unordered_map<void const *, frame_shape> m_frame_shape_cache;
+    /* When the `interpreter.hot` trace class is active, counts interpreted executions per
+       declaration so the hottest ones -- the candidates for precompilation to native
+       code -- can be reported when the interpreter is torn down. */
+    bool m_profile{false};
+    std::unordered_map<void const *, std::pair<name, uint64>> m_exec_counts;
+    /* Interned declaration names for the sampling profiler's shadow stack
+       (see runtime/sigprof.h); keyed by declaration address, populated only
+       while the profiler is enabled. */
+    std::unordered_map<void const *, char const *> m_sigprof_names;
+
+    char const * get_sigprof_name(decl const & d) {
+        auto it = m_sigprof_names.find(d.raw());
+        if (it != m_sigprof_names.end())
+            return it->second;
+        char const * s = sigprof_intern(decl_fun_id(d).to_string());
+        m_sigprof_names.emplace(d.raw(), s);
+        return s;
+    }
 
     /** \brief Get current stack frame */
     inline frame & get_frame() {
@@ -358,26 +436,49 @@ class interpreter {
     inline value & var(var_id const & v) {
         // variables are 1-indexed
         size_t i = get_frame().m_arg_bp + v.get_small_value() - 1;
-        // we don't know the frame size (unless we do an additional IR pass), so we extend it dynamically
-        if (i >= m_arg_stack.size()) {
-            m_arg_stack.resize(i + 1);
-        }
+        // the frame was sized to the declaration's full shape on entry (see `get_frame_shape`)
+        lean_assert(i < m_arg_stack.size());
         return m_arg_stack[i];
     }
 
 public:
     template<class T>
     static inline T with_interpreter(environment const & env, options const & opts, name const & fn, std::function<T(interpreter &)> const & f) {
+        /* An exception unwinding interpreter frames skips their `pop_frame`
+           calls; re-balance the profiler's shadow stack on the way out. */
+        flet<size_t> restore_sigprof_depth(sigprof_depth(), sigprof_depth());
         if (g_interpreter && is_eqp(g_interpreter->m_env, env) && is_eqp(g_interpreter->m_opts, opts)) {
             return f(*g_interpreter);
         } else {
             // We changed threads or the closure was stored and called in a different context.
-            time_task t("interpretation", opts, fn);
-            scope_trace_env scope_trace(env, opts);
+            /* The cached-instance checks below compare options by pointer; intern them
+               so an equal-but-reallocated set (e.g. rebuilt per server request) still
+               matches the instance whose caches were warmed up with it. */
+            options iopts = opts.intern();
+            time_task t("interpretation", iopts, fn);
+            scope_trace_env scope_trace(env, iopts);
+            if (g_cached_interpreter && is_eqp(g_cached_interpreter->m_env, env) && is_eqp(g_cached_interpreter->m_opts, iopts)) {
+                // reuse the warmed-up caches from the previous top-level call on this thread
+                flet<interpreter *> fl(g_interpreter, g_cached_interpreter);
+                return f(*g_cached_interpreter);
+            }
             // the caches contain data from the Environment, so we cannot reuse them when changing it
-            interpreter interp(env, opts);
-            flet<interpreter *> fl(g_interpreter, &interp);
-            return f(interp);
+            std::unique_ptr<interpreter> interp(new interpreter(env, iopts));
+            flet<interpreter *> fl(g_interpreter, interp.get());
+            T r = f(*interp);
+            if (!interp->m_profile) {
+                /* Retain the instance for the next call against the same environment. When
+                   profiling, tear it down immediately instead so that the hot-declaration
+                   report is emitted per call (and while the trace scope above is still
+                   active). */
+                if (!g_cached_interpreter_finalizer_registered) {
+                    register_thread_finalizer([](void *) { delete g_cached_interpreter; g_cached_interpreter = nullptr; }, nullptr);
+                    g_cached_interpreter_finalizer_registered = true;
+                }
+                delete g_cached_interpreter;
+                g_cached_interpreter = interp.release();
+            }
+            return r;
         }
     }
 
@@ -478,14 +579,14 @@ private:
             }
             case expr_kind::FAp: { // satured ("full") application of top-level function
                 if (expr_fap_args(e).size()) {
-                    return call(expr_fap_fun(e), expr_fap_args(e));
+                    return call(lookup_symbol_at(e, expr_fap_fun(e)), expr_fap_args(e));
                 } else {
                     // nullary function ("constant")
                     return load(expr_fap_fun(e), t);
                 }
             }
             case expr_kind::PAp: { // unsatured (partial) application of top-level function
-                symbol_cache_entry sym = lookup_symbol(expr_pap_fun(e));
+                symbol_cache_entry const & sym = lookup_symbol_at(e, expr_pap_fun(e));
                 if (sym.m_addr) {
                     // point closure directly at native symbol
                     object * cls = alloc_closure(sym.m_addr, decl_params(sym.m_decl).size(), expr_pap_args(e).size());
@@ -507,7 +608,8 @@ private:
                 for (size_t i = 0; i < expr_ap_args(e).size(); i++) {
                     args[i] = eval_arg(expr_ap_args(e)[i]).m_obj;
                 }
-                object * r = apply_n(var(expr_ap_fun(e)).m_obj, expr_ap_args(e).size(), args);
+                // the argument count is statically known here, so skip the arity dispatch when possible
+                object * r = closure_direct_call_n(var(expr_ap_fun(e)).m_obj, expr_ap_args(e).size(), args);
                 return r;
             }
             case expr_kind::Box: // box unboxed value
@@ -569,32 +671,85 @@ private:
 
         // make reference reassignable...
         std::reference_wrapper<fn_body const> b(b0);
+        // body of the function currently executing in this frame; reassigned when a tail
+        // call replaces the frame in place (see the `VDecl` case)
+        std::reference_wrapper<fn_body const> entry(b0);
+#ifdef LEAN_IR_DIRECT_THREADING
+        // table order must match `fn_body_kind`
+        static void * const dispatch[] = {
+            &&lbl_vdecl, &&lbl_jdecl, &&lbl_set, &&lbl_set_tag, &&lbl_uset, &&lbl_sset, &&lbl_inc,
+            &&lbl_dec, &&lbl_del, &&lbl_mdata, &&lbl_case, &&lbl_ret, &&lbl_jmp, &&lbl_unreachable
+        };
+#define LEAN_IR_LABEL(l) l:
+#define LEAN_IR_DISPATCH() goto *dispatch[static_cast<unsigned>(fn_body_tag(b))]
+        LEAN_IR_DISPATCH();
+#else
+#define LEAN_IR_LABEL(l)
+#define LEAN_IR_DISPATCH() break
+#endif
         while (true) {
             DEBUG_CODE(lean_trace(name({"interpreter", "step"}),
                                   tout() << std::string(m_call_stack.size(), ' ') << format_fn_body_head(b) << "\n";);)
             switch (fn_body_tag(b)) {
-                case fn_body_kind::VDecl: { // variable declaration
+                case fn_body_kind::VDecl: LEAN_IR_LABEL(lbl_vdecl) { // variable declaration
                     expr const & e = fn_body_vdecl_expr(b);
                     fn_body const & cont = fn_body_vdecl_cont(b);
-                    // tail recursion?
-                    if (expr_tag(e) == expr_kind::FAp && expr_fap_fun(e) == get_frame().m_fn &&
+                    // tail call?
+                    if (expr_tag(e) == expr_kind::FAp &&
                         fn_body_tag(cont) == fn_body_kind::Ret && !arg_is_irrelevant(fn_body_ret_arg(cont)) &&
                         arg_var_id(fn_body_ret_arg(cont)) == fn_body_vdecl_var(b)) {
-                        // tail recursion! copy argument values to parameter slots and reset `b`
-                        array_ref<arg> const & args = expr_fap_args(e);
-                        // argument and parameter slots may overlap, so first copy arguments to end of stack
-                        size_t old_size = m_arg_stack.size();
-                        for (const auto & arg : args) {
-                            m_arg_stack.push_back(eval_arg(arg));
+                        if (expr_fap_fun(e) == get_frame().m_fn) {
+                            // tail recursion! copy argument values to parameter slots and reset `b`
+                            array_ref<arg> const & args = expr_fap_args(e);
+                            // argument and parameter slots may overlap, so first copy arguments to end of stack
+                            size_t old_size = m_arg_stack.size();
+                            for (const auto & arg : args) {
+                                m_arg_stack.push_back(eval_arg(arg));
+                            }
+                            // now copy to parameter slots; drop the temporary copies but keep the
+                            // frame at its full shape
+                            for (size_t i = 0; i < args.size(); i++) {
+                                m_arg_stack[get_frame().m_arg_bp + i] = m_arg_stack[old_size + i];
+                            }
+                            m_arg_stack.resize(old_size);
+                            b = entry;
+                            check_system();
+                            LEAN_IR_DISPATCH();
                         }
-                        // now copy to parameter slots
-                        for (size_t i = 0; i < args.size(); i++) {
-                            m_arg_stack[get_frame().m_arg_bp + i] = m_arg_stack[old_size + i];
+                        symbol_cache_entry const & sym = lookup_symbol_at(e, expr_fap_fun(e));
+                        if (!sym.m_addr && decl_tag(sym.m_decl) != decl_kind::Extern) {
+                            // tail call of another interpreted function: replace the current frame in
+                            // place instead of recursing via `call`, so the C++ stack depth does not
+                            // scale with the depth of mutual tail recursion
+                            if (m_profile) {
+                                auto & c = m_exec_counts[sym.m_decl.raw()];
+                                if (c.second++ == 0) {
+                                    c.first = decl_fun_id(sym.m_decl);
+                                }
+                            }
+                            array_ref<arg> const & args = expr_fap_args(e);
+                            lean_assert(decl_params(sym.m_decl).size() == args.size());
+                            size_t old_size = m_arg_stack.size();
+                            for (const auto & arg : args) {
+                                m_arg_stack.push_back(eval_arg(arg));
+                            }
+                            for (size_t i = 0; i < args.size(); i++) {
+                                m_arg_stack[get_frame().m_arg_bp + i] = m_arg_stack[old_size + i];
+                            }
+                            // resize the replaced frame to the callee's shape; its join points are
+                            // dead, but the body reference stays valid because the callsite cache
+                            // retains the callee declaration
+                            frame_shape const & shape = get_frame_shape(sym.m_decl);
+                            m_arg_stack.resize(get_frame().m_arg_bp + shape.m_num_vars);
+                            m_jp_stack.resize(get_frame().m_jp_bp + shape.m_num_jps);
+                            get_frame().m_fn = decl_fun_id(sym.m_decl);
+                            if (LEAN_UNLIKELY(sigprof_enabled()))
+                                sigprof_replace_frame(get_sigprof_name(sym.m_decl));
+                            entry = decl_fun_body(sym.m_decl);
+                            b = entry;
+                            check_system();
+                            LEAN_IR_DISPATCH();
                         }
-                        m_arg_stack.resize(get_frame().m_arg_bp + args.size());
-                        b = b0;
-                        check_system();
-                        break;
                     }
                     value v = eval_expr(fn_body_vdecl_expr(b), fn_body_vdecl_type(b));
                     // NOTE: `var` must be called *after* `eval_expr` because the stack may get resized and invalidate
@@ -606,39 +761,37 @@ private:
                                           print_value(tout(), var(fn_body_vdecl_var(b)), fn_body_vdecl_type(b));
                                           tout() << "\n";);)
                     b = fn_body_vdecl_cont(b);
-                    break;
+                    LEAN_IR_DISPATCH();
                 }
-                case fn_body_kind::JDecl: { // join-point declaration; store in stack slot just like variables
+                case fn_body_kind::JDecl: LEAN_IR_LABEL(lbl_jdecl) { // join-point declaration; store in stack slot just like variables
                     size_t i = get_frame().m_jp_bp + fn_body_jdecl_id(b).get_small_value();
-                    if (i >= m_jp_stack.size()) {
-                        m_jp_stack.resize(i + 1);
-                    }
+                    lean_assert(i < m_jp_stack.size());
                     m_jp_stack[i] = &b.get();
                     b = fn_body_jdecl_cont(b);
-                    break;
+                    LEAN_IR_DISPATCH();
                 }
-                case fn_body_kind::Set: { // set boxed field of unique reference
+                case fn_body_kind::Set: LEAN_IR_LABEL(lbl_set) { // set boxed field of unique reference
                     object * o = var(fn_body_set_var(b)).m_obj;
                     lean_assert(is_exclusive(o));
                     cnstr_set(o, fn_body_set_idx(b).get_small_value(), eval_arg(fn_body_set_arg(b)).m_obj);
                     b = fn_body_set_cont(b);
-                    break;
+                    LEAN_IR_DISPATCH();
                 }
-                case fn_body_kind::SetTag: { // set constructor tag of unique reference
+                case fn_body_kind::SetTag: LEAN_IR_LABEL(lbl_set_tag) { // set constructor tag of unique reference
                     object * o = var(fn_body_set_tag_var(b)).m_obj;
                     lean_assert(is_exclusive(o));
                     cnstr_set_tag(o, fn_body_set_tag_cidx(b).get_small_value());
                     b = fn_body_set_tag_cont(b);
-                    break;
+                    LEAN_IR_DISPATCH();
                 }
-                case fn_body_kind::USet: { // set USize field of unique reference
+                case fn_body_kind::USet: LEAN_IR_LABEL(lbl_uset) { // set USize field of unique reference
                     object * o = var(fn_body_uset_target(b)).m_obj;
                     lean_assert(is_exclusive(o));
                     cnstr_set_usize(o, fn_body_uset_idx(b).get_small_value(), var(fn_body_uset_source(b)).m_num);
                     b = fn_body_uset_cont(b);
-                    break;
+                    LEAN_IR_DISPATCH();
                 }
-                case fn_body_kind::SSet: { // set other unboxed field of unique reference
+                case fn_body_kind::SSet: LEAN_IR_LABEL(lbl_sset) { // set other unboxed field of unique reference
                     object * o = var(fn_body_sset_target(b)).m_obj;
                     size_t offset = fn_body_sset_idx(b).get_small_value() * sizeof(void *) +
                                     fn_body_sset_offset(b).get_small_value();
@@ -657,28 +810,28 @@ private:
                             throw exception(sstream() << "invalid instruction");
                     }
                     b = fn_body_sset_cont(b);
-                    break;
+                    LEAN_IR_DISPATCH();
                 }
-                case fn_body_kind::Inc: // increment reference counter
+                case fn_body_kind::Inc: LEAN_IR_LABEL(lbl_inc) // increment reference counter
                     inc(var(fn_body_inc_var(b)).m_obj, fn_body_inc_val(b).get_small_value());
                     b = fn_body_inc_cont(b);
-                    break;
-                case fn_body_kind::Dec: { // decrement reference counter
+                    LEAN_IR_DISPATCH();
+                case fn_body_kind::Dec: LEAN_IR_LABEL(lbl_dec) { // decrement reference counter
                     size_t n = fn_body_dec_val(b).get_small_value();
                     for (size_t i = 0; i < n; i++) {
                         dec(var(fn_body_dec_var(b)).m_obj);
                     }
                     b = fn_body_dec_cont(b);
-                    break;
+                    LEAN_IR_DISPATCH();
                 }
-                case fn_body_kind::Del: // delete object of unique reference
+                case fn_body_kind::Del: LEAN_IR_LABEL(lbl_del) // delete object of unique reference
                     lean_free_object(var(fn_body_del_var(b)).m_obj);
                     b = fn_body_del_cont(b);
-                    break;
-                case fn_body_kind::MData: // metadata; no-op
+                    LEAN_IR_DISPATCH();
+                case fn_body_kind::MData: LEAN_IR_LABEL(lbl_mdata) // metadata; no-op
                     b = fn_body_mdata_cont(b);
-                    break;
-                case fn_body_kind::Case: { // branch according to constructor tag
+                    LEAN_IR_DISPATCH();
+                case fn_body_kind::Case: LEAN_IR_LABEL(lbl_case) { // branch according to constructor tag
                     array_ref<alt_core> const & alts = fn_body_case_alts(b);
                     unsigned tag;
                     value v = var(fn_body_case_var(b));
@@ -687,6 +840,15 @@ private:
                     } else {
                         tag = lean_obj_tag(v.m_obj);
                     }
+                    if (alts.size() >= LEAN_IR_CASE_DISPATCH_MIN_ALTS) {
+                        // large inductive: dispatch through the per-site jump table
+                        case_dispatch_entry const & ent = lookup_case_dispatch(b);
+                        fn_body const * cont = tag < ent.m_conts.size() ? ent.m_conts[tag] : nullptr;
+                        if (!cont) cont = ent.m_default;
+                        if (!cont) throw exception("incomplete case");
+                        b = *cont;
+                        goto done;
+                    }
                     for (alt_core const & a : alts) {
                         switch (alt_core_tag(a)) {
                             case alt_core_kind::Ctor:
@@ -701,23 +863,98 @@ private:
                         }
                     }
                     throw exception("incomplete case");
-                    done: break;
+                    done: LEAN_IR_DISPATCH();
                 }
-                case fn_body_kind::Ret:
+                case fn_body_kind::Ret: LEAN_IR_LABEL(lbl_ret)
                     return eval_arg(fn_body_ret_arg(b));
-                case fn_body_kind::Jmp: { // jump to join-point
+                case fn_body_kind::Jmp: LEAN_IR_LABEL(lbl_jmp) { // jump to join-point
                     fn_body const & jp = *m_jp_stack[get_frame().m_jp_bp + fn_body_jmp_jp(b).get_small_value()];
                     lean_assert(fn_body_jdecl_params(jp).size() == fn_body_jmp_args(b).size());
                     for (size_t i = 0; i < fn_body_jdecl_params(jp).size(); i++) {
                         var(param_var(fn_body_jdecl_params(jp)[i])) = eval_arg(fn_body_jmp_args(b)[i]);
                     }
                     b = fn_body_jdecl_body(jp);
-                    break;
+                    LEAN_IR_DISPATCH();
                 }
-                case fn_body_kind::Unreachable:
+                case fn_body_kind::Unreachable: LEAN_IR_LABEL(lbl_unreachable)
                     throw exception("unreachable code");
             }
         }
+#undef LEAN_IR_LABEL
+#undef LEAN_IR_DISPATCH
+    }
+
+    /* Compute the frame shape of declaration `d` (see `m_frame_shape_cache`): one pass
+       over the body taking the maximum over all bound variable ids and join-point ids.
+       Slot reuse across disjoint live ranges would additionally require renumbering the
+       variable ids, which we cannot do on the shared IR objects owned by `m_env`. */
+    frame_shape const & get_frame_shape(decl const & d) {
+        auto it = m_frame_shape_cache.find(decl_fun_body(d).raw());
+        if (it != m_frame_shape_cache.end())
+            return it->second;
+        // parameters occupy the first slots of the frame
+        frame_shape shape { decl_params(d).size(), 0 };
+        std::vector<fn_body const *> todo;
+        todo.push_back(&decl_fun_body(d));
+        while (!todo.empty()) {
+            fn_body const & b = *todo.back();
+            todo.pop_back();
+            switch (fn_body_tag(b)) {
+                case fn_body_kind::VDecl:
+                    shape.m_num_vars = std::max(shape.m_num_vars, static_cast<size_t>(fn_body_vdecl_var(b).get_small_value()));
+                    todo.push_back(&fn_body_vdecl_cont(b));
+                    break;
+                case fn_body_kind::JDecl:
+                    shape.m_num_jps = std::max(shape.m_num_jps, static_cast<size_t>(fn_body_jdecl_id(b).get_small_value()) + 1);
+                    for (param const & p : fn_body_jdecl_params(b)) {
+                        shape.m_num_vars = std::max(shape.m_num_vars, static_cast<size_t>(param_var(p).get_small_value()));
+                    }
+                    todo.push_back(&fn_body_jdecl_body(b));
+                    todo.push_back(&fn_body_jdecl_cont(b));
+                    break;
+                case fn_body_kind::Set:
+                    todo.push_back(&fn_body_set_cont(b));
+                    break;
+                case fn_body_kind::SetTag:
+                    todo.push_back(&fn_body_set_tag_cont(b));
+                    break;
+                case fn_body_kind::USet:
+                    todo.push_back(&fn_body_uset_cont(b));
+                    break;
+                case fn_body_kind::SSet:
+                    todo.push_back(&fn_body_sset_cont(b));
+                    break;
+                case fn_body_kind::Inc:
+                    todo.push_back(&fn_body_inc_cont(b));
+                    break;
+                case fn_body_kind::Dec:
+                    todo.push_back(&fn_body_dec_cont(b));
+                    break;
+                case fn_body_kind::Del:
+                    todo.push_back(&fn_body_del_cont(b));
+                    break;
+                case fn_body_kind::MData:
+                    todo.push_back(&fn_body_mdata_cont(b));
+                    break;
+                case fn_body_kind::Case:
+                    for (alt_core const & a : fn_body_case_alts(b)) {
+                        switch (alt_core_tag(a)) {
+                            case alt_core_kind::Ctor:
+                                todo.push_back(&alt_core_ctor_cont(a));
+                                break;
+                            case alt_core_kind::Default:
+                                todo.push_back(&alt_core_default_cont(a));
+                                break;
+                        }
+                    }
+                    break;
+                case fn_body_kind::Ret:
+                case fn_body_kind::Jmp:
+                case fn_body_kind::Unreachable:
+                    break;
+            }
+        }
+        return m_frame_shape_cache.emplace(decl_fun_body(d).raw(), shape).first->second;
     }
 
     // specify argument base pointer explicitly because we've usually already pushed some function arguments
@@ -732,12 +969,26 @@ private:
                        tout() << "\n";);
         });
         m_call_stack.emplace_back(decl_fun_id(d), arg_bp, m_jp_stack.size());
+        if (LEAN_UNLIKELY(sigprof_enabled()))
+            sigprof_push_frame(get_sigprof_name(d));
+    }
+
+    /* Like `push_frame`, but for frames whose body we are about to interpret: size the
+       variable and join-point stacks to the callee's full frame shape up front so `var`
+       and `JDecl` never have to grow them mid-body. */
+    void push_interpreted_frame(decl const & d, size_t arg_bp) {
+        push_frame(d, arg_bp);
+        frame_shape const & shape = get_frame_shape(d);
+        m_arg_stack.resize(arg_bp + shape.m_num_vars);
+        m_jp_stack.resize(get_frame().m_jp_bp + shape.m_num_jps);
     }
 
     void pop_frame(value DEBUG_CODE(r), type DEBUG_CODE(t)) {
         m_arg_stack.resize(get_frame().m_arg_bp);
         m_jp_stack.resize(get_frame().m_jp_bp);
         m_call_stack.pop_back();
+        if (LEAN_UNLIKELY(sigprof_enabled()))
+            sigprof_pop_frame();
         DEBUG_CODE({
             lean_trace(name({"interpreter", "call"}),
                        tout() << std::string(m_call_stack.size(), ' ')
@@ -816,7 +1067,7 @@ private:
             // We don't know whether `[init]` decls can be re-executed, so let's not.
             throw exception(sstream() << "cannot evaluate `[init]` declaration '" << fn << "' in the same module");
         }
-        push_frame(e.m_decl, m_arg_stack.size());
+        push_interpreted_frame(e.m_decl, m_arg_stack.size());
         value r = eval_body(decl_fun_body(e.m_decl));
         pop_frame(r, decl_type(e.m_decl));
         if (!type_is_scalar(t)) {
@@ -826,10 +1077,45 @@ private:
         return r;
     }
 
-    value call(name const & fn, array_ref<arg> const & args) {
+    /* Resolve the jump table of case site `b`, building it on first use (see
+       `m_case_cache`). Constructor tags are contiguous indices, so the table is dense
+       by construction; missing tags fall through to the default alternative. */
+    case_dispatch_entry const & lookup_case_dispatch(fn_body const & b) {
+        auto it = m_case_cache.find(b.raw());
+        if (it != m_case_cache.end())
+            return it->second;
+        array_ref<alt_core> const & alts = fn_body_case_alts(b);
+        case_dispatch_entry ent;
+        size_t max_tag = 0;
+        for (alt_core const & a : alts) {
+            if (alt_core_tag(a) == alt_core_kind::Ctor)
+                max_tag = std::max(max_tag, ctor_info_tag(alt_core_ctor_info(a)).get_small_value());
+        }
+        ent.m_conts.resize(max_tag + 1, nullptr);
+        for (alt_core const & a : alts) {
+            switch (alt_core_tag(a)) {
+                case alt_core_kind::Ctor:
+                    ent.m_conts[ctor_info_tag(alt_core_ctor_info(a)).get_small_value()] = &alt_core_ctor_cont(a);
+                    break;
+                case alt_core_kind::Default:
+                    ent.m_default = &alt_core_default_cont(a);
+                    break;
+            }
+        }
+        return m_case_cache.emplace(b.raw(), std::move(ent)).first->second;
+    }
+
+    /* Resolve the callee of call site `e` through its inline cache. */
+    symbol_cache_entry const & lookup_symbol_at(expr const & e, name const & fn) {
+        auto it = m_callsite_cache.find(e.raw());
+        if (it != m_callsite_cache.end())
+            return it->second;
+        return m_callsite_cache.emplace(e.raw(), lookup_symbol(fn)).first->second;
+    }
+
+    value call(symbol_cache_entry const & e, array_ref<arg> const & args) {
         size_t old_size = m_arg_stack.size();
         value r;
-        symbol_cache_entry e = lookup_symbol(fn);
         if (e.m_addr) {
             object ** args2 = static_cast<object **>(LEAN_ALLOCA(args.size() * sizeof(object *))); // NOLINT
             for (size_t i = 0; i < args.size(); i++) {
@@ -856,16 +1142,23 @@ private:
             }
         } else {
             if (decl_tag(e.m_decl) == decl_kind::Extern) {
+                name const & fn = decl_fun_id(e.m_decl);
                 string_ref mangled = name_mangle(fn, *g_mangle_prefix);
                 string_ref boxed_mangled(string_append(mangled.to_obj_arg(), g_boxed_mangled_suffix->raw()));
                 throw exception(sstream() << "could not find native implementation of external declaration '" << fn
                                           << "' (symbols '" << boxed_mangled.data() << "' or '" << mangled.data() << "')");
             }
+            if (m_profile) {
+                auto & c = m_exec_counts[e.m_decl.raw()];
+                if (c.second++ == 0) {
+                    c.first = decl_fun_id(e.m_decl);
+                }
+            }
             // evaluate args in old stack frame
             for (const auto & arg : args) {
                 m_arg_stack.push_back(eval_arg(arg));
             }
-            push_frame(e.m_decl, old_size);
+            push_interpreted_frame(e.m_decl, old_size);
             r = eval_body(decl_fun_body(e.m_decl));
         }
         pop_frame(r, decl_type(e.m_decl));
@@ -879,7 +1172,7 @@ private:
         for (size_t i = 0; i < decl_params(d).size(); i++) {
             m_arg_stack.push_back(args[3 + i]);
         }
-        push_frame(d, old_size);
+        push_interpreted_frame(d, old_size);
         object * r = eval_body(decl_fun_body(d)).m_obj;
         pop_frame(r, type::TObject);
         return r;
@@ -889,6 +1182,17 @@ private:
     static object * stub_m_aux(object ** args) {
         environment env(args[0]);
         options opts(args[1]);
+        /* Fast path for native->interpreter callbacks: a native HOF such as
+           `Array.forIn` applied to an interpreted closure crosses this boundary
+           once per element. When the interpreter that created the closure is
+           already active on this thread -- the overwhelmingly common case --
+           dispatch into it directly, so an interpreted loop body costs the same
+           as an ordinary interpreted call instead of a full `with_interpreter`
+           re-entry (std::function allocation, name construction, cache checks)
+           per element. */
+        if (g_interpreter && is_eqp(g_interpreter->m_env, env) && is_eqp(g_interpreter->m_opts, opts)) {
+            return g_interpreter->stub_m(args);
+        }
         return with_interpreter<object *>(env, opts, decl_fun_id(TO_REF(decl, args[2])), [&](interpreter & interp) {
             return interp.stub_m(args);
         });
@@ -936,10 +1240,25 @@ private:
     }
 public:
     explicit interpreter(environment const & env, options const & opts) : m_env(env), m_opts(opts) {
-        m_prefer_native = opts.get_bool(*g_interpreter_prefer_native, LEAN_DEFAULT_INTERPRETER_PREFER_NATIVE);
+        m_prefer_native = option_values(opts).get_bool(g_interpreter_prefer_native_idx, LEAN_DEFAULT_INTERPRETER_PREFER_NATIVE);
+        m_profile       = lean_is_trace_enabled(*g_interpreter_hot);
     }
 
     ~interpreter() {
+        if (m_profile && !m_exec_counts.empty()) {
+            std::vector<std::pair<name, uint64>> hot;
+            for (auto const & e : m_exec_counts) {
+                hot.push_back(e.second);
+            }
+            std::sort(hot.begin(), hot.end(), [](std::pair<name, uint64> const & e1, std::pair<name, uint64> const & e2) {
+                return e1.second > e2.second;
+            });
+            lean_trace(*g_interpreter_hot, {
+                for (size_t i = 0; i < hot.size() && i < 16; i++) {
+                    tout() << hot[i].second << " x " << hot[i].first << "\n";
+                }
+            });
+        }
         for_each(m_constant_cache, [](name const &, constant_cache_entry const & e) {
             if (!e.m_is_scalar) {
                 dec(e.m_val.m_obj);
@@ -973,7 +1292,7 @@ public:
             }
         }
         if (n > 0) {
-            r = apply_n(r, n, args);
+            r = closure_direct_call_n(r, n, args);
         }
         return r;
     }
@@ -1102,8 +1421,10 @@ void initialize_ir_interpreter() {
     ir::g_boxed_mangled_suffix = new string_ref("___boxed");
     mark_persistent(ir::g_boxed_mangled_suffix->raw());
     ir::g_interpreter_prefer_native = new name({"interpreter", "prefer_native"});
+    ir::g_interpreter_hot = new name({"interpreter", "hot"});
+    register_trace_class({"interpreter", "hot"});
     ir::g_init_globals = new name_map<object *>();
-    register_bool_option(*ir::g_interpreter_prefer_native, LEAN_DEFAULT_INTERPRETER_PREFER_NATIVE, "(interpreter) whether to use precompiled code where available");
+    ir::g_interpreter_prefer_native_idx = register_bool_option(*ir::g_interpreter_prefer_native, LEAN_DEFAULT_INTERPRETER_PREFER_NATIVE, "(interpreter) whether to use precompiled code where available");
     DEBUG_CODE({
         register_trace_class({"interpreter"});
         register_trace_class({"interpreter", "call"});
@@ -1113,6 +1434,7 @@ void initialize_ir_interpreter() {
 
 void finalize_ir_interpreter() {
     delete ir::g_init_globals;
+    delete ir::g_interpreter_hot;
     delete ir::g_interpreter_prefer_native;
     delete ir::g_boxed_mangled_suffix;
     delete ir::g_boxed_suffix;
@@ -24,6 +24,7 @@ Author: Leonardo de Moura
 #include "library/compiler/cse.h"
 #include "library/compiler/elim_dead_let.h"
 #include "library/compiler/extern_attribute.h"
+#include "library/compiler/field_order_attribute.h"
 #include "library/compiler/borrowed_annotation.h"
 #include "library/compiler/ir.h"
 
@@ -268,7 +269,9 @@ static void get_cnstr_info_core(type_checker::state & st, name const & n, buffer
     unsigned max_scalar_size = 0;
     to_telescope(env, lctx, st.ngen(), type, telescope);
     lean_assert(telescope.size() >= nparams);
+    buffer<name> fnames;
     for (unsigned i = nparams; i < telescope.size(); i++) {
+        fnames.push_back(lctx.get_local_decl(telescope[i]).get_user_name());
         expr ftype = lctx.get_type(telescope[i]);
         if (is_irrelevant_type(st, lctx, ftype)) {
             result.push_back(field_info::mk_irrelevant());
@@ -292,15 +295,41 @@ static void get_cnstr_info_core(type_checker::state & st, name const & n, buffer
         }
     }
 
-    unsigned next_idx = next_object;
     /* Remark:
        - usize fields are stored after object fields.
        - regular scalar fields are stored after object and usize fields,
-         and are sorted by size. */
+         and are sorted by size.
+       The relative order of the kinds is fixed (the runtime scans the leading pointer
+       fields), but within each kind the fields listed in `@[field_order]` are laid out
+       first, in the given order, so frequently accessed fields get the low offsets. */
+    buffer<unsigned> perm;
+    for (unsigned i = 0; i < result.size(); i++)
+        perm.push_back(i);
+    if (optional<array_ref<name>> forder = get_field_order(env, n, I_name)) {
+        buffer<unsigned> rank;
+        for (name const & fname : fnames) {
+            unsigned r = forder->size();
+            for (unsigned j = 0; j < forder->size(); j++) {
+                if ((*forder)[j] == fname) { r = j; break; }
+            }
+            rank.push_back(r);
+        }
+        std::stable_sort(perm.data(), perm.data() + perm.size(),
+                         [&](unsigned i1, unsigned i2) { return rank[i1] < rank[i2]; });
+    }
+    /* Fix object idxs */
+    unsigned next_idx = 0;
+    for (unsigned i : perm) {
+        if (result[i].m_kind == field_info::Object) {
+            result[i].m_idx = next_idx;
+            next_idx++;
+        }
+    }
+    lean_assert(next_idx == next_object);
     /* Fix USize idxs */
-    for (field_info & info : result) {
-        if (info.m_kind == field_info::USize) {
-            info.m_idx = next_idx;
+    for (unsigned i : perm) {
+        if (result[i].m_kind == field_info::USize) {
+            result[i].m_idx = next_idx;
             next_idx++;
         }
     }
@@ -308,11 +337,11 @@ static void get_cnstr_info_core(type_checker::state & st, name const & n, buffer
     unsigned offset = 0;
     /* Fix regular scalar offsets and idxs */
     for (unsigned sz = max_scalar_size; sz > 0; sz--) {
-        for (field_info & info : result) {
-            if (info.m_kind == field_info::Scalar && info.m_size == sz) {
-                info.m_idx    = idx;
-                info.m_offset = offset;
-                offset += info.m_size;
+        for (unsigned i : perm) {
+            if (result[i].m_kind == field_info::Scalar && result[i].m_size == sz) {
+                result[i].m_idx    = idx;
+                result[i].m_offset = offset;
+                offset += result[i].m_size;
             }
         }
     }
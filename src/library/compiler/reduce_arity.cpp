@@ -4,8 +4,10 @@ Released under Apache 2.0 license as described in the file LICENSE.
 Author: Leonardo de Moura
 */
 #include "kernel/instantiate.h"
+#include "util/name_map.h"
 #include "library/util.h"
 #include "library/compiler/util.h"
+#include "library/compiler/elim_dead_let.h"
 #include "library/compiler/export_attribute.h"
 
 namespace lean {
@@ -29,7 +31,9 @@ bool arity_was_reduced(comp_decl const & cdecl) {
     return is_reduce_arity_aux_fn(n) && n.get_prefix() == cdecl.fst();
 }
 
-comp_decls reduce_arity(environment const & env, comp_decl const & cdecl) {
+/* Reduce the arity of `cdecl`, and set `num_dropped` to the number of removed leading parameters. */
+static comp_decls reduce_arity(environment const & env, comp_decl const & cdecl, unsigned & num_dropped) {
+    num_dropped = 0;
     if (has_export_name(env, cdecl.fst()) || cdecl.fst() == "main") {
         /* We do not modify the arity of entry points (i.e., functions with attribute [export]) */
         return comp_decls(cdecl);
@@ -81,6 +85,7 @@ comp_decls reduce_arity(environment const & env, comp_decl const & cdecl) {
         */
         return comp_decls(cdecl);
     }
+    num_dropped   = fvars.size() - new_fvars.size();
     name red_fn   = mk_reduce_arity_aux_fn(cdecl.fst());
     expr red_code = lctx.mk_lambda(new_fvars, code);
     comp_decl red_decl(red_fn, red_code);
@@ -92,11 +97,84 @@ comp_decls reduce_arity(environment const & env, comp_decl const & cdecl) {
     return comp_decls(red_decl, comp_decls(new_decl));
 }
 
+/* Rewrite calls `f a_1 ... a_m` to `f._rarg a_{d+1} ... a_m` for every `f` in `dropped`,
+   where `d` is the number of leading parameters removed from `f`. This is the reduction
+   we otherwise rely on inlining for, but inlining does not see call sites between
+   declarations of the same batch (e.g. between the specialized copies produced by
+   `specialize.cpp`, which forward whole dictionaries to each other). */
+class rewrite_reduced_calls_fn {
+    name_map<unsigned> const & m_dropped;
+
+    expr visit(expr const & e) {
+        switch (e.kind()) {
+        case expr_kind::Lambda:
+            return update_binding(e, binding_domain(e), visit(binding_body(e)));
+        case expr_kind::Let:
+            return update_let(e, let_type(e), visit(let_value(e)), visit(let_body(e)));
+        case expr_kind::MData:
+            return update_mdata(e, visit(mdata_expr(e)));
+        case expr_kind::Proj:
+            return update_proj(e, visit(proj_expr(e)));
+        case expr_kind::App: {
+            buffer<expr> args;
+            expr fn = get_app_args(e, args);
+            for (expr & arg : args)
+                arg = visit(arg);
+            if (is_constant(fn)) {
+                if (unsigned const * d = m_dropped.find(const_name(fn))) {
+                    if (args.size() >= *d) {
+                        expr red_fn = mk_constant(mk_reduce_arity_aux_fn(const_name(fn)));
+                        return mk_app(red_fn, args.size() - *d, args.data() + *d);
+                    }
+                }
+            } else {
+                fn = visit(fn);
+            }
+            return mk_app(fn, args);
+        }
+        default:
+            return e;
+        }
+    }
+
+public:
+    rewrite_reduced_calls_fn(name_map<unsigned> const & dropped):m_dropped(dropped) {}
+
+    expr operator()(expr const & e) { return visit(e); }
+};
+
 comp_decls reduce_arity(environment const & env, comp_decls const & ds) {
-    comp_decls r;
-    for (comp_decl const & d : ds) {
-        r = append(r, reduce_arity(env, d));
+    comp_decls r = ds;
+    /* Iterate to a fixpoint: after we rewrite the call sites of a reduced function, arguments
+       that were only forwarded to the removed parameters become dead in the callers, so the
+       next round can remove them as well. Each productive round strictly decreases the total
+       number of parameters, so the iteration terminates. */
+    while (true) {
+        name_map<unsigned> dropped;
+        comp_decls new_r;
+        for (comp_decl const & d : r) {
+            if (arity_was_reduced(d)) {
+                /* `d` is already a thin wrapper around its `_rarg` function. */
+                new_r = append(new_r, comp_decls(d));
+                continue;
+            }
+            unsigned num_dropped = 0;
+            comp_decls split = reduce_arity(env, d, num_dropped);
+            if (num_dropped > 0)
+                dropped.insert(d.fst(), num_dropped);
+            new_r = append(new_r, split);
+        }
+        if (dropped.empty())
+            return new_r;
+        comp_decls rewritten;
+        for (comp_decl const & d : new_r) {
+            expr code = rewrite_reduced_calls_fn(dropped)(d.snd());
+            /* Remove the `let`s that only fed dropped arguments, so the next round sees the
+               parameters they mention as dead. */
+            code = elim_dead_let(code);
+            rewritten = append(rewritten, comp_decls(comp_decl(d.fst(), code)));
+        }
+        r = rewritten;
     }
-    return r;
 }
 }
@@ -252,6 +252,12 @@ environment update_spec_info(environment const & env, comp_decls const & ds) {
     return new_env;
 }
 
+/* The specialization cache lives in the persistent environment extension `specExtension`
+   (see `Lean.Compiler.Specialize`). Its entries are exported to the .olean file, so a
+   specialization cached while compiling one module is found here by every module that
+   (transitively) imports it, and the cached `_spec_` declaration is resolved like any
+   other imported symbol. Thus identical specializations are generated at most once per
+   import chain, not once per module. */
 extern "C" object* lean_cache_specialization(object* env, object* e, object* fn);
 extern "C" object* lean_get_cached_specialization(object* env, object* e);
 
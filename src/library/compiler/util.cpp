@@ -45,8 +45,25 @@ optional<unsigned> is_enum_type(environment const & env, name const & I) {
         return optional<unsigned>();
     }
     for (name const & c : cs) {
-        if (is_pi(env.get(c).get_type()))
-            return optional<unsigned>();
+        if (is_pi(env.get(c).get_type())) {
+            /* A constructor whose fields are all erased carries no information beyond its
+               tag, so it does not prevent the unboxed enum representation. This is the
+               `decidable` situation generalized: proof-carrying constructors plus constant
+               alternatives. Constructors with a *relevant* field do prevent it: the
+               compiler does not monomorphize, so values of the type flow into polymorphic
+               code expecting the uniform boxed representation, and a niche-filling scalar
+               encoding of the payload would need coercions at every such boundary. */
+            constant_info c_info = env.get(c);
+            unsigned nparams     = c_info.to_constructor_val().get_nparams();
+            type_checker::state st(env);
+            local_ctx lctx;
+            buffer<expr> telescope;
+            to_telescope(env, lctx, st.ngen(), c_info.get_type(), telescope);
+            for (unsigned i = nparams; i < telescope.size(); i++) {
+                if (!is_irrelevant_type(st, lctx, lctx.get_type(telescope[i])))
+                    return optional<unsigned>();
+            }
+        }
         if (n == std::numeric_limits<unsigned>::max())
             return optional<unsigned>();
         n++;
@@ -8,12 +8,25 @@ Author: Leonardo de Moura
 #include "library/expr_lt.h"
 
 namespace lean {
+/* The scalar word of the `Expr` header packs the hash together with the approximate
+   depth, the loose bvar range, and the has-fvar/has-mvar/has-param flags (see
+   `Expr.Data` in `Lean/Expr.lean`); `hash` reads only its low 32 bits. Comparing the
+   whole word settles almost every comparison of structurally distinct expressions
+   without descending: a full collision requires matching depth, range, and flags in
+   addition to the hash. Deep structural comparison remains the tie breaker, so the
+   relation is still a total order. */
+static uint64 expr_data_word(expr const & e) {
+    object * o = e.raw();
+    return lean_ctor_get_uint64(o, lean_ctor_num_objs(o)*sizeof(object*));
+}
+
 bool is_lt(expr const & a, expr const & b, bool use_hash, local_ctx const * lctx) {
     if (is_eqp(a, b))                    return false;
     if (a.kind() != b.kind())            return a.kind() < b.kind();
     if (use_hash) {
-        if (hash(a) < hash(b))           return true;
-        if (hash(a) > hash(b))           return false;
+        uint64 da = expr_data_word(a);
+        uint64 db = expr_data_word(b);
+        if (da != db)                    return da < db;
     }
     if (a == b)                          return false;
     switch (a.kind()) {
@@ -9,6 +9,8 @@ Author: Leonardo de Moura
 #include <functional>
 #include "runtime/interrupt.h"
 #include "runtime/buffer.h"
+#include "runtime/object.h"
+#include "runtime/thread.h"
 #include "library/max_sharing.h"
 
 namespace lean {
@@ -116,4 +118,56 @@ bool max_sharing_fn::already_processed(expr const & a) const { return m_ptr->alr
 expr max_sharing(expr const & a) {
     return max_sharing_fn::imp()(a);
 }
+
+static bool g_max_sharing_in_parallel = false;
+
+void set_max_sharing_in_parallel(bool flag) { g_max_sharing_in_parallel = flag; }
+
+/* Do not parallelize batches with fewer expressions than this. */
+#define LEAN_PAR_MAX_SHARING_MIN_EXPRS 2
+
+static object * par_max_sharing_fn(object * p, object * /* unit */) {
+    expr const & e = *reinterpret_cast<expr const *>(lean_unbox_usize(p));
+    lean_dec(p);
+    try {
+        return max_sharing(e).steal();
+    } catch (...) {
+        /* Exceptions cannot cross the task boundary; the caller redoes the
+           element sequentially to produce the actual error. */
+        return lean_box(0);
+    }
+}
+
+void max_sharing(buffer<expr> & es) {
+    unsigned n = es.size();
+    if (g_max_sharing_in_parallel && n >= LEAN_PAR_MAX_SHARING_MIN_EXPRS && hardware_concurrency() > 1) {
+        /* The workers read the expressions concurrently, so their reference
+           counters must be atomic. */
+        for (expr const & e : es)
+            mark_mt(e.raw());
+        buffer<object *> tasks;
+        for (expr const & e : es) {
+            object * c = alloc_closure(par_max_sharing_fn, 1);
+            lean_closure_set(c, 0, lean_box_usize(reinterpret_cast<size_t>(&e)));
+            tasks.push_back(task_spawn(c));
+        }
+        /* Join in order; each element got a fresh cache, so the batch is
+           canonical independently of scheduling. */
+        for (unsigned i = 0; i < n; i++) {
+            object * v = task_get(tasks[i]);
+            if (lean_is_scalar(v)) {
+                /* the worker hit an exception; reproduce it here */
+                lean_dec(tasks[i]);
+                es[i] = max_sharing(es[i]);
+            } else {
+                expr r(v, true);
+                lean_dec(tasks[i]);
+                es[i] = r;
+            }
+        }
+        return;
+    }
+    for (unsigned i = 0; i < n; i++)
+        es[i] = max_sharing(es[i]);
+}
 }
@@ -6,6 +6,7 @@ Author: Leonardo de Moura
 */
 #pragma once
 #include <memory>
+#include "runtime/buffer.h"
 #include "kernel/expr.h"
 
 namespace lean {
@@ -35,4 +36,19 @@ public:
    it uses maximally shared sub-expressions.
 */
 expr max_sharing(expr const & a);
+
+/**
+   \brief Apply \c max_sharing to every element of \c es in place. The elements
+   are independent -- each gets a fresh cache, exactly as with separate
+   \c max_sharing calls -- so when parallel mode is enabled they are farmed out
+   to the runtime task manager; the result is deterministic and identical to
+   the sequential one either way.
+*/
+void max_sharing(buffer<expr> & es);
+
+/* When enabled, the buffer overload of `max_sharing` processes its elements in
+   parallel. Off by default; as with `set_def_eq_args_in_parallel`, it must not
+   be enabled on threads that are themselves task-manager workers, since joining
+   the spawned tasks could starve the pool. */
+void set_max_sharing_in_parallel(bool flag);
 }
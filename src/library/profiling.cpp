@@ -19,11 +19,16 @@ namespace lean {
 
 static name * g_profiler           = nullptr;
 static name * g_profiler_threshold = nullptr;
+static name * g_profiler_output    = nullptr;
 
 bool get_profiler(options const & opts) {
     return opts.get_bool(*g_profiler, LEAN_DEFAULT_PROFILER);
 }
 
+char const * get_profiler_output(options const & opts) {
+    return opts.get_string(*g_profiler_output, "");
+}
+
 second_duration get_profiling_threshold(options const & opts) {
     return second_duration(static_cast<double>(opts.get_unsigned(*g_profiler_threshold, LEAN_DEFAULT_PROFILER_THRESHOLD))/1000.0);
 }
@@ -36,11 +41,16 @@ void initialize_profiling() {
     register_bool_option(*g_profiler, LEAN_DEFAULT_PROFILER, "(profiler) profile tactics and vm_eval command");
     register_unsigned_option(*g_profiler_threshold, LEAN_DEFAULT_PROFILER_THRESHOLD,
                              "(profiler) threshold in milliseconds, profiling times under threshold will not be reported");
+    g_profiler_output    = new name{"profiler", "output"};
+    mark_persistent(g_profiler_output->raw());
+    register_string_option(*g_profiler_output, "",
+                           "(profiler) write a Chrome trace-event JSON profile of all measured tasks to the given file");
 }
 
 void finalize_profiling() {
     delete g_profiler;
     delete g_profiler_threshold;
+    delete g_profiler_output;
 }
 
 }
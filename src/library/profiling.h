@@ -14,6 +14,8 @@ using second_duration = std::chrono::duration<double>;
 
 bool get_profiler(options const &);
 second_duration get_profiling_threshold(options const &);
+/* Output file for the Chrome trace-event profile; empty when disabled. */
+char const * get_profiler_output(options const &);
 
 void initialize_profiling();
 void finalize_profiling();
@@ -6,6 +6,10 @@ Author: Sebastian Ullrich
 */
 #include <string>
 #include <map>
+#include <fstream>
+#include <vector>
+#include "runtime/alloc.h"
+#include "runtime/memory.h"
 #include "library/time_task.h"
 #include "library/trace.h"
 
@@ -15,6 +19,64 @@ static std::map<std::string, second_duration> * g_cum_times;
 static mutex * g_cum_times_mutex;
 LEAN_THREAD_PTR(time_task, g_current_time_task);
 
+/* Chrome trace-event recording, enabled by the `profiler.output` option.
+   One complete event is appended per finished task; the viewer reconstructs
+   the hierarchy from the (thread, timestamp, duration) triples. Heartbeats
+   count small-object allocations on the task's thread (always available, in
+   contrast to the RUNTIME_STATS-only g_num_alloc), and the RSS figure is the
+   process peak at task completion. */
+struct trace_event {
+    std::string m_name;
+    size_t      m_tid;
+    double      m_ts_us;
+    double      m_dur_us;
+    uint64      m_heartbeats;
+    size_t      m_peak_rss;
+};
+static std::vector<trace_event> * g_trace_events = nullptr;
+static std::string * g_trace_output = nullptr;
+static std::chrono::steady_clock::time_point g_trace_epoch;
+static atomic<size_t> g_next_trace_tid(1);
+LEAN_THREAD_VALUE(size_t, g_trace_tid, 0);
+
+static size_t get_trace_tid() {
+    if (g_trace_tid == 0)
+        g_trace_tid = atomic_fetch_add_explicit(&g_next_trace_tid, size_t(1), memory_order_relaxed);
+    return g_trace_tid;
+}
+
+static void append_json_string(std::ostream & out, std::string const & s) {
+    out << '"';
+    for (char c : s) {
+        if (c == '"' || c == '\\')
+            out << '\\' << c;
+        else if (c == '\n')
+            out << "\\n";
+        else
+            out << c;
+    }
+    out << '"';
+}
+
+void export_profiling_trace() {
+    lock_guard<mutex> _(*g_cum_times_mutex);
+    if (!g_trace_events)
+        return;
+    std::ofstream out(*g_trace_output);
+    out << "{\"traceEvents\": [";
+    bool first = true;
+    for (trace_event const & e : *g_trace_events) {
+        out << (first ? "\n" : ",\n") << "  {\"name\": ";
+        append_json_string(out, e.m_name);
+        out << ", \"ph\": \"X\", \"pid\": 1, \"tid\": " << e.m_tid
+            << ", \"ts\": " << (uint64)e.m_ts_us << ", \"dur\": " << (uint64)e.m_dur_us
+            << ", \"args\": {\"heartbeats\": " << e.m_heartbeats
+            << ", \"peakRssBytes\": " << e.m_peak_rss << "}}";
+        first = false;
+    }
+    out << "\n]}\n";
+}
+
 void report_profiling_time(std::string const & category, second_duration time) {
     lock_guard<mutex> _(*g_cum_times_mutex);
     (*g_cum_times)[category] += time;
@@ -34,6 +96,10 @@ void initialize_time_task() {
 }
 
 void finalize_time_task() {
+    delete g_trace_events;
+    g_trace_events = nullptr;
+    delete g_trace_output;
+    g_trace_output = nullptr;
     delete g_cum_times;
     delete g_cum_times_mutex;
 }
@@ -49,6 +115,19 @@ time_task::time_task(std::string const & category, options const & opts, name de
         });
         m_parent_task = g_current_time_task;
         g_current_time_task = this;
+        char const * trace_output = get_profiler_output(opts);
+        if (*trace_output) {
+            m_trace            = true;
+            m_decl             = decl;
+            m_trace_start      = std::chrono::steady_clock::now();
+            m_start_heartbeats = get_num_heartbeats();
+            lock_guard<mutex> _(*g_cum_times_mutex);
+            if (!g_trace_events) {
+                g_trace_events = new std::vector<trace_event>();
+                g_trace_output = new std::string(trace_output);
+                g_trace_epoch  = m_trace_start;
+            }
+        }
     }
 }
 
@@ -59,6 +138,23 @@ time_task::~time_task() {
         if (m_parent_task && m_parent_task->m_timeit)
             // report exclusive times
             m_parent_task->m_timeit->exclude_duration(m_timeit->get_elapsed_inclusive());
+        if (m_trace) {
+            auto now = std::chrono::steady_clock::now();
+            trace_event e;
+            e.m_name = m_category;
+            if (m_decl) {
+                std::ostringstream strm;
+                strm << m_category << " of " << m_decl;
+                e.m_name = strm.str();
+            }
+            e.m_tid        = get_trace_tid();
+            e.m_ts_us      = std::chrono::duration<double, std::micro>(m_trace_start - g_trace_epoch).count();
+            e.m_dur_us     = std::chrono::duration<double, std::micro>(now - m_trace_start).count();
+            e.m_heartbeats = get_num_heartbeats() - m_start_heartbeats;
+            e.m_peak_rss   = get_peak_rss();
+            lock_guard<mutex> _(*g_cum_times_mutex);
+            g_trace_events->push_back(e);
+        }
     }
 }
 
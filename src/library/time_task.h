@@ -13,12 +13,21 @@ Author: Sebastian Ullrich
 namespace lean {
 void report_profiling_time(std::string const & category, second_duration time);
 void display_cumulative_profiling_times(std::ostream & out);
+/* Write the Chrome trace-event profile to the file given by `profiler.output`,
+   if that option was set on any measured task. Nesting does not need to be
+   recorded explicitly: complete ("ph":"X") events on the same thread nest by
+   their timestamps in the trace viewer. */
+void export_profiling_trace();
 
 /** Measure time of some task and report it for the final cumulative profile. */
 class time_task {
     std::string     m_category;
     optional<xtimeit> m_timeit;
     time_task *     m_parent_task;
+    name            m_decl;
+    bool            m_trace = false;
+    std::chrono::steady_clock::time_point m_trace_start;
+    uint64          m_start_heartbeats = 0;
 public:
     time_task(std::string const & category, options const & opts, name decl = name());
     ~time_task();
@@ -6,6 +6,10 @@ Author: Leonardo de Moura
 */
 #include <vector>
 #include <string>
+#include <memory>
+#include <fstream>
+#include <cstdlib>
+#include "runtime/thread.h"
 #include "util/io.h"
 #include "util/option_declarations.h"
 #include "kernel/environment.h"
@@ -130,7 +134,77 @@ static void io_eprint(obj_arg s) {
     lean_dec(r);
 }
 
+/* Buffered trace output, enabled by the LEAN_TRACE_OUTPUT environment variable.
+
+   By default every trace message is written to stderr immediately, which
+   serializes all elaboration threads on the stderr stream when tracing classes
+   are enabled in a multi-threaded run. When LEAN_TRACE_OUTPUT names a file,
+   each thread instead appends its finished messages to a private buffer, and a
+   background thread drains all buffers to the file every few milliseconds. The
+   per-message cost on the emitting thread is then a lock only the flusher ever
+   contends for and a string move; the thread never blocks on I/O or on other
+   tracing threads. Messages from different threads are interleaved in the file
+   at message granularity. */
+#if defined(LEAN_MULTI_THREAD)
+struct trace_buffer {
+    mutex                    m_mutex; /* only contended by the flush thread */
+    std::vector<std::string> m_msgs;
+};
+/* The registry owns the buffers; each tracing thread keeps a borrowed pointer
+   to its own. Buffers outlive their threads so late messages are still
+   flushed, and are freed together with the registry. */
+static mutex * g_trace_buffers_mutex = nullptr;
+static std::vector<std::unique_ptr<trace_buffer>> * g_trace_buffers = nullptr;
+static std::string * g_trace_output  = nullptr;
+static lthread *     g_trace_flusher = nullptr;
+static atomic<bool>  g_trace_flusher_stop(false);
+LEAN_THREAD_PTR(trace_buffer, g_trace_buffer);
+
+static trace_buffer * get_trace_buffer() {
+    if (!g_trace_output)
+        return nullptr;
+    if (!g_trace_buffer) {
+        lock_guard<mutex> lock(*g_trace_buffers_mutex);
+        g_trace_buffers->emplace_back(new trace_buffer());
+        g_trace_buffer = g_trace_buffers->back().get();
+    }
+    return g_trace_buffer;
+}
+
+static void trace_flusher() {
+    std::ofstream out(*g_trace_output);
+    std::vector<std::string> pending;
+    while (true) {
+        bool stop = g_trace_flusher_stop.load();
+        {
+            lock_guard<mutex> lock(*g_trace_buffers_mutex);
+            for (std::unique_ptr<trace_buffer> const & b : *g_trace_buffers) {
+                lock_guard<mutex> buf_lock(b->m_mutex);
+                for (std::string & m : b->m_msgs)
+                    pending.push_back(std::move(m));
+                b->m_msgs.clear();
+            }
+        }
+        for (std::string const & m : pending)
+            out << m;
+        pending.clear();
+        out.flush();
+        if (stop)
+            return;
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+}
+#endif
+
 tout::~tout() {
+#if defined(LEAN_MULTI_THREAD)
+    if (trace_buffer * b = get_trace_buffer()) {
+        std::string msg = m_out.str();
+        lock_guard<mutex> lock(b->m_mutex);
+        b->m_msgs.push_back(std::move(msg));
+        return;
+    }
+#endif
     io_eprint(mk_string(m_out.str()));
 }
 
@@ -144,9 +218,28 @@ void initialize_trace() {
     g_trace_aliases = new name_map<name_set>();
 
     register_trace_class(name{"debug"});
+
+#if defined(LEAN_MULTI_THREAD)
+    if (char const * out = std::getenv("LEAN_TRACE_OUTPUT")) {
+        g_trace_output        = new std::string(out);
+        g_trace_buffers_mutex = new mutex();
+        g_trace_buffers       = new std::vector<std::unique_ptr<trace_buffer>>();
+        g_trace_flusher       = new lthread([]() { trace_flusher(); });
+    }
+#endif
 }
 
 void finalize_trace() {
+#if defined(LEAN_MULTI_THREAD)
+    if (g_trace_flusher) {
+        g_trace_flusher_stop.store(true);
+        g_trace_flusher->join();
+        delete g_trace_flusher;       g_trace_flusher = nullptr;
+        delete g_trace_buffers;       g_trace_buffers = nullptr;
+        delete g_trace_buffers_mutex; g_trace_buffers_mutex = nullptr;
+        delete g_trace_output;        g_trace_output = nullptr;
+    }
+#endif
     delete g_trace_classes;
     delete g_trace_aliases;
 }
@@ -4,11 +4,13 @@ Released under Apache 2.0 license as described in the file LICENSE.
 
 Author: Leonardo de Moura
 */
+#include <cstdlib>
 #include <vector>
 #include <lean/lean.h>
 #include "runtime/thread.h"
 #include "runtime/debug.h"
 #include "runtime/alloc.h"
+#include "runtime/allocprof.h"
 
 #ifdef LEAN_RUNTIME_STATS
 #define LEAN_RUNTIME_STAT_CODE(c) c
@@ -30,7 +32,44 @@ Author: Leonardo de Moura
 LEAN_CASSERT(LEAN_PAGE_SIZE > LEAN_MAX_SMALL_OBJECT_SIZE);
 LEAN_CASSERT(LEAN_SEGMENT_SIZE > LEAN_PAGE_SIZE);
 
+/* Use a lock-free MPSC stack (Treiber stack) for sending deallocated objects back to
+   their owner heap when the platform has lock-free pointer atomics. Otherwise, we use
+   a mutex-protected list. */
+#if defined(LEAN_MULTI_THREAD) && defined(ATOMIC_POINTER_LOCK_FREE) && ATOMIC_POINTER_LOCK_FREE == 2
+#define LEAN_LOCK_FREE_IMPORT
+#endif
+
+/* On Linux, we allocate segments with mmap instead of malloc. mmap always returns fresh
+   pages, so the pages are bound (first-touch NUMA policy) to the node of the worker thread
+   that owns the heap, instead of inheriting the placement of whatever thread touched the
+   memory malloc recycles. */
+#ifdef __linux__
+#define LEAN_MMAP_SEGMENTS
+#include <sys/mman.h>
+#endif
+
+/* On Linux, return the payload of completely free pages to the OS with madvise, so the
+   RSS of long-running processes tracks their live data instead of their high-water mark.
+   A few completely free pages per size class are kept resident ("hot") to absorb
+   allocation bursts without page faults. */
+#ifdef LEAN_MMAP_SEGMENTS
+#define LEAN_RECLAIM_PAGES
+#define LEAN_MAX_HOT_FREE_PAGES    8
+#define LEAN_OS_PAGE_SIZE          4096
+/* Incremental reclaim prefers MADV_FREE (Linux >= 4.5): the kernel takes the
+   pages lazily and only under memory pressure, so reclaiming and then promptly
+   reusing a page costs no page fault. The explicit `lean_heap_trim` uses
+   MADV_DONTNEED so the RSS drop is immediate and observable. */
+#ifdef MADV_FREE
+#define LEAN_RECLAIM_ADVICE MADV_FREE
+#else
+#define LEAN_RECLAIM_ADVICE MADV_DONTNEED
+#endif
+#endif
+
 namespace lean {
+/* See comment in alloc.h. */
+LEAN_EXPORT bool g_heap_check = false;
 namespace allocator {
 #ifdef LEAN_RUNTIME_STATS
 static atomic<uint64> g_num_alloc(0);
@@ -38,6 +77,7 @@ static atomic<uint64> g_num_small_alloc(0);
 static atomic<uint64> g_num_dealloc(0);
 static atomic<uint64> g_num_small_dealloc(0);
 static atomic<uint64> g_num_segments(0);
+static atomic<uint64> g_num_mmap_segments(0);
 static atomic<uint64> g_num_pages(0);
 static atomic<uint64> g_num_exports(0);
 static atomic<uint64> g_num_recycled_pages(0);
@@ -48,6 +88,7 @@ struct alloc_stats {
         std::cerr << "num. dealloc.:       " << g_num_dealloc << "\n";
         std::cerr << "num. small dealloc.: " << g_num_small_dealloc << "\n";
         std::cerr << "num. segments:       " << g_num_segments << "\n";
+        std::cerr << "num. mmap segments:  " << g_num_mmap_segments << "\n";
         std::cerr << "num. pages:          " << g_num_pages << "\n";
         std::cerr << "num. recycled pages: " << g_num_recycled_pages << "\n";
         std::cerr << "num. exports:        " << g_num_exports << "\n";
@@ -68,6 +109,9 @@ struct page_header {
     unsigned         m_num_free;
     unsigned         m_slot_idx;
     bool             m_in_page_free_list;
+    /* The page's payload was returned to the OS; the free list must be rebuilt
+       before the page can service allocations again. */
+    bool             m_reclaimed;
 };
 
 struct page {
@@ -83,6 +127,11 @@ struct page {
     bool in_page_free_list() const { return m_header.m_in_page_free_list; }
     unsigned get_slot_idx() const { return m_header.m_slot_idx; }
     void push_free_obj(void * o);
+    /* Splice the pre-linked list `head` .. `tail` of `num` objects (all living in this
+       page) into the free list. */
+    void push_free_objs(void * head, void * tail, unsigned num);
+    void recycle_if_many_free();
+    void reclaim_if_all_free();
 };
 
 inline char * align_ptr(char * p, size_t a) {
@@ -114,13 +163,21 @@ struct heap {
     heap *    m_next_orphan{nullptr};
     page *    m_curr_page[LEAN_NUM_SLOTS];
     page *    m_page_free_list[LEAN_NUM_SLOTS];
+    unsigned  m_num_free_pages[LEAN_NUM_SLOTS];
     /* Objects that must be sent to other heaps. */
     void *    m_to_export_list{nullptr};
     unsigned  m_to_export_list_size{0};
+#ifdef LEAN_LOCK_FREE_IMPORT
+    /* The following stack contains objects owned by this heap that were deallocated
+       by other heaps. Producers push sub-lists using CAS, and only this heap pops
+       (by exchanging the whole stack). */
+    atomic<void *> m_to_import_list{nullptr};
+#else
     mutex     m_mutex; /* for the following fields */
     /* The following list contains object by this heap that were deallocated
        by other heaps. */
     void *    m_to_import_list{nullptr};
+#endif
     uint64_t  m_heartbeat{0}; /* Counter for implementing "deterministic timeouts". It is currently the number of small allocations */
     void import_objs();
     void export_objs();
@@ -156,8 +213,11 @@ static inline page * get_page_of(void * o) {
     return reinterpret_cast<page*>((reinterpret_cast<size_t>(o)/LEAN_PAGE_SIZE)*LEAN_PAGE_SIZE);
 }
 
-LEAN_THREAD_GLOBAL_PTR(page *, g_curr_pages);
-LEAN_THREAD_PTR(heap, g_heap);
+/* The allocator's hot thread-locals live in the aggregated `runtime_tls`
+   block (see thread.h), so one TLS address computation covers both; the
+   traditional names stay in place at the use sites. */
+#define g_heap       (g_runtime_tls.m_heap)
+#define g_curr_pages (g_runtime_tls.m_curr_pages)
 static heap_manager * g_heap_manager = nullptr;
 
 inline void set_next_obj(void * obj, void * next) {
@@ -198,11 +258,7 @@ static inline page * page_list_pop(page * & head) {
     return r;
 }
 
-void page::push_free_obj(void * o) {
-    lean_assert(get_page_of(o) == this);
-    set_next_obj(o, m_header.m_free_list);
-    m_header.m_free_list = o;
-    m_header.m_num_free++;
+void page::recycle_if_many_free() {
     if (!in_page_free_list() && has_many_free()) {
         heap * h = get_heap();
         unsigned slot_idx = m_header.m_slot_idx;
@@ -211,17 +267,66 @@ void page::push_free_obj(void * o) {
             m_header.m_in_page_free_list = true;
             page_list_remove(h->m_curr_page[slot_idx], this);
             page_list_insert(h->m_page_free_list[slot_idx], this);
+            h->m_num_free_pages[slot_idx]++;
         }
     }
 }
 
+#ifdef LEAN_RECLAIM_PAGES
+/* Release the payload of a completely free page back to the OS. The free-list
+   links live inside the dead objects, so the chain is discarded here and
+   rebuilt lazily when the page is reused. The first LEAN_OS_PAGE_SIZE bytes
+   stay resident because they share an OS page with the header. */
+static void reclaim_page_payload(page * p, int advice) {
+    p->m_header.m_free_list = nullptr;
+    p->m_header.m_reclaimed = true;
+    madvise(reinterpret_cast<char*>(p) + LEAN_OS_PAGE_SIZE, LEAN_PAGE_SIZE - LEAN_OS_PAGE_SIZE, advice);
+}
+#endif
+
+/* If the page sits in the page free list and all of its objects have been returned,
+   release its payload back to the OS (see LEAN_RECLAIM_PAGES). */
+void page::reclaim_if_all_free() {
+#ifdef LEAN_RECLAIM_PAGES
+    if (!in_page_free_list() || m_header.m_reclaimed || m_header.m_num_free != m_header.m_max_free)
+        return;
+    heap * h = get_heap();
+    if (h->m_num_free_pages[m_header.m_slot_idx] <= LEAN_MAX_HOT_FREE_PAGES)
+        return;
+    reclaim_page_payload(this, LEAN_RECLAIM_ADVICE);
+#endif
+}
+
+void page::push_free_obj(void * o) {
+    lean_assert(get_page_of(o) == this);
+    set_next_obj(o, m_header.m_free_list);
+    m_header.m_free_list = o;
+    m_header.m_num_free++;
+    recycle_if_many_free();
+    reclaim_if_all_free();
+}
+
+void page::push_free_objs(void * head, void * tail, unsigned num) {
+    lean_assert(get_page_of(head) == this);
+    lean_assert(get_page_of(tail) == this);
+    set_next_obj(tail, m_header.m_free_list);
+    m_header.m_free_list = head;
+    m_header.m_num_free += num;
+    recycle_if_many_free();
+    reclaim_if_all_free();
+}
+
 void heap::import_objs() {
+#ifdef LEAN_LOCK_FREE_IMPORT
+    void * to_import = m_to_import_list.exchange(nullptr, memory_order_acquire);
+#else
     void * to_import = nullptr;
-    {   // TODO(Leo): avoid mutex using compare and swap
+    {
         lock_guard<mutex> lock(m_mutex);
         to_import = m_to_import_list;
         m_to_import_list = nullptr;
     }
+#endif
     while (to_import) {
         page * p = get_page_of(to_import);
         void * n = get_next_obj(to_import);
@@ -260,34 +365,40 @@ void heap::export_objs() {
     m_to_export_list      = nullptr;
     m_to_export_list_size = 0;
     for (export_entry const & e : to_export) {
+#ifdef LEAN_LOCK_FREE_IMPORT
+        void * curr = e.m_heap->m_to_import_list.load(memory_order_relaxed);
+        do {
+            set_next_obj(e.m_tail, curr);
+        } while (!e.m_heap->m_to_import_list.compare_exchange_weak(curr, e.m_head,
+                     memory_order_release, memory_order_relaxed));
+#else
         unique_lock<mutex> lock(e.m_heap->m_mutex);
         set_next_obj(e.m_tail, e.m_heap->m_to_import_list);
         e.m_heap->m_to_import_list = e.m_head;
+#endif
     }
 }
 
 void heap::alloc_segment() {
     LEAN_RUNTIME_STAT_CODE(g_num_segments++);
-    segment * s = new segment();
+    segment * s;
+#ifdef LEAN_MMAP_SEGMENTS
+    void * mem = mmap(nullptr, sizeof(segment), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) lean_internal_panic_out_of_memory();
+    /* The pages of `s` are first touched by the thread owning this heap when `alloc_page`
+       initializes the free lists, which binds them to this thread's NUMA node. */
+    s = new (mem) segment();
+    LEAN_RUNTIME_STAT_CODE(g_num_mmap_segments++);
+#else
+    s = new segment();
+#endif
     s->m_next   = m_curr_segment;
     m_curr_segment = s;
 }
 
-static page * alloc_page(heap * h, unsigned obj_size) {
-    lean_assert(lean_align(obj_size, LEAN_OBJECT_SIZE_DELTA) == obj_size);
-    segment * s = h->m_curr_segment;
-    LEAN_RUNTIME_STAT_CODE(g_num_pages++);
-    page * p    = new (s->m_next_page_mem) page();
-    s->m_next_page_mem += LEAN_PAGE_SIZE;
-    if (s->is_full()) {
-        /* s is full, we need to allocate a new one. */
-        h->alloc_segment();
-    }
-    unsigned slot_idx        = lean_get_slot_idx(obj_size);
-    p->m_header.m_heap       = h;
-    page_list_insert(h->m_curr_page[slot_idx], p);
-    p->m_header.m_slot_idx   = slot_idx;
-    p->m_header.m_obj_size   = obj_size;
+/* Link every object slot of `p` into a fresh free list. Used when a page is first
+   allocated and when a reclaimed page is reused. */
+static void init_page_free_list(page * p, unsigned obj_size) {
     char * curr_free         = p->m_data;
     set_next_obj(curr_free, nullptr);
     char * end               = p->m_data + (LEAN_PAGE_SIZE - sizeof(page_header));
@@ -314,6 +425,25 @@ static page * alloc_page(heap * h, unsigned obj_size) {
     p->m_header.m_free_list  = curr_free;
     p->m_header.m_max_free   = num_free;
     p->m_header.m_num_free   = num_free;
+    p->m_header.m_reclaimed  = false;
+}
+
+static page * alloc_page(heap * h, unsigned obj_size) {
+    lean_assert(lean_align(obj_size, LEAN_OBJECT_SIZE_DELTA) == obj_size);
+    segment * s = h->m_curr_segment;
+    LEAN_RUNTIME_STAT_CODE(g_num_pages++);
+    page * p    = new (s->m_next_page_mem) page();
+    s->m_next_page_mem += LEAN_PAGE_SIZE;
+    if (s->is_full()) {
+        /* s is full, we need to allocate a new one. */
+        h->alloc_segment();
+    }
+    unsigned slot_idx        = lean_get_slot_idx(obj_size);
+    p->m_header.m_heap       = h;
+    page_list_insert(h->m_curr_page[slot_idx], p);
+    p->m_header.m_slot_idx   = slot_idx;
+    p->m_header.m_obj_size   = obj_size;
+    init_page_free_list(p, obj_size);
     p->m_header.m_in_page_free_list = false;
     return p;
 }
@@ -337,6 +467,7 @@ static void init_heap(bool main) {
         for (unsigned i = 0; i < LEAN_NUM_SLOTS; i++) {
             g_heap->m_curr_page[i] = nullptr;
             g_heap->m_page_free_list[i] = nullptr;
+            g_heap->m_num_free_pages[i] = 0;
         }
         g_heap->alloc_segment();
         unsigned obj_size = LEAN_OBJECT_SIZE_DELTA;
@@ -368,6 +499,9 @@ void * lean_alloc_small_cold(unsigned sz, unsigned slot_idx, page * p) {
     } else {
         p = page_list_pop(g_heap->m_page_free_list[slot_idx]);
         p->m_header.m_in_page_free_list = false;
+        g_heap->m_num_free_pages[slot_idx]--;
+        if (p->m_header.m_reclaimed)
+            init_page_free_list(p, p->m_header.m_obj_size);
         page_list_insert(g_heap->m_curr_page[slot_idx], p);
     }
     void * r = p->m_header.m_free_list;
@@ -381,6 +515,8 @@ void * lean_alloc_small_cold(unsigned sz, unsigned slot_idx, page * p) {
 extern "C" LEAN_EXPORT void * lean_alloc_small(unsigned sz, unsigned slot_idx) {
     page * p = g_heap->m_curr_page[slot_idx];
     g_heap->m_heartbeat++;
+    if (LEAN_UNLIKELY(g_allocprof_interval != 0))
+        allocprof_tick();
     void * r = p->m_header.m_free_list;
     if (LEAN_UNLIKELY(r == nullptr)) {
         return lean_alloc_small_cold(sz, slot_idx, p);
@@ -418,6 +554,49 @@ void * alloc(size_t sz) {
     return lean_alloc_small(sz, slot_idx);
 }
 
+/* LEAN_HEAP_CHECK validation of a small-object deallocation (see comment in alloc.h).
+   Validate that `o` lies on an object boundary of a page whose header is internally
+   consistent. This catches wild frees (the surrounding "page" header does not describe
+   a valid size class), pointers into the middle of an object, and frees into a page
+   that is already completely free (a double free), before the free-list splice that
+   would silently corrupt the page. A free from a foreign heap goes through the same
+   page, so the check covers the export path as well. */
+LEAN_NOINLINE
+static void heap_check_free(void * o) {
+    page * p = get_page_of(o);
+    if (reinterpret_cast<char*>(o) < p->m_data)
+        lean_internal_panic("heap check: freed pointer points into a page header");
+    unsigned obj_size = p->m_header.m_obj_size;
+    if (obj_size == 0 || obj_size > LEAN_MAX_SMALL_OBJECT_SIZE ||
+        obj_size % LEAN_OBJECT_SIZE_DELTA != 0 ||
+        p->m_header.m_slot_idx != lean_get_slot_idx(obj_size) ||
+        p->get_heap() == nullptr)
+        lean_internal_panic("heap check: freed pointer does not belong to a small allocator page");
+    size_t off = static_cast<size_t>(reinterpret_cast<char*>(o) - p->m_data);
+    if (off % obj_size != 0 || off + obj_size > LEAN_PAGE_SIZE - sizeof(page_header))
+        lean_internal_panic("heap check: freed pointer is not on an object boundary");
+    if (p->m_header.m_num_free >= p->m_header.m_max_free)
+        lean_internal_panic("heap check: object freed twice (its page is already completely free)");
+}
+
+/* LEAN_HEAP_CHECK validation of a freed object. In addition to the page checks, the
+   header is still intact at this point (deletion reads the tag and fields before
+   releasing the memory), so we can validate it: the tag must not be the reserved one,
+   and closure headers must satisfy the invariants the apply machinery relies on.
+   Closures get no canary word: their layout is ABI shared with all compiled code. */
+LEAN_NOINLINE
+static void heap_check_free_obj(void * mem) {
+    heap_check_free(mem);
+    lean_object * o = reinterpret_cast<lean_object*>(mem);
+    if (lean_ptr_tag(o) == LeanReserved)
+        lean_internal_panic("heap check: freed object has a corrupt header (reserved tag)");
+    if (lean_ptr_tag(o) == LeanClosure) {
+        lean_closure_object * c = lean_to_closure(o);
+        if (c->m_fun == nullptr || c->m_arity == 0 || c->m_num_fixed >= c->m_arity)
+            lean_internal_panic("heap check: freed closure has a corrupt header");
+    }
+}
+
 LEAN_NOINLINE
 static void dealloc_small_core_cold(void * o) {
     set_next_obj(o, g_heap->m_to_export_list);
@@ -449,19 +628,139 @@ void dealloc(void * o, size_t sz) {
     if (LEAN_UNLIKELY(sz > LEAN_MAX_SMALL_OBJECT_SIZE)) {
         return free(o);
     }
+    if (LEAN_UNLIKELY(g_heap_check))
+        heap_check_free(o);
     dealloc_small_core(o);
 }
 
 extern "C" LEAN_EXPORT void lean_free_small(void * o) {
+    if (LEAN_UNLIKELY(g_heap_check))
+        heap_check_free_obj(o);
     dealloc_small_core(o);
 }
 
+extern "C" LEAN_EXPORT void lean_free_small_batch(void ** os, unsigned num) {
+    if (LEAN_UNLIKELY(g_heap == nullptr)) {
+        init_heap(false);
+    }
+    unsigned i = 0;
+    while (i < num) {
+        void * o = os[i];
+        LEAN_RUNTIME_STAT_CODE(g_num_small_dealloc++);
+        if (LEAN_UNLIKELY(g_heap_check))
+            heap_check_free_obj(o);
+        page * p = get_page_of(o);
+        i++;
+        if (LEAN_UNLIKELY(p->get_heap() != g_heap)) {
+            dealloc_small_core_cold(o);
+            continue;
+        }
+        /* Dying objects were typically allocated together, so consecutive batch entries
+           tend to share a page: link the whole run locally and splice it in one step. */
+        void * head = o;
+        void * tail = o;
+        unsigned n  = 1;
+        while (i < num && get_page_of(os[i]) == p) {
+            LEAN_RUNTIME_STAT_CODE(g_num_small_dealloc++);
+            if (LEAN_UNLIKELY(g_heap_check))
+                heap_check_free_obj(os[i]);
+            set_next_obj(os[i], head);
+            head = os[i];
+            n++;
+            i++;
+        }
+        p->push_free_objs(head, tail, n);
+    }
+}
+
 extern "C" LEAN_EXPORT unsigned lean_small_mem_size(void * o) {
     page * p = get_page_of(o);
     return p->m_header.m_obj_size;
 }
 
+static unsigned count_pages(page * p) {
+    unsigned n = 0;
+    for (; p; p = p->get_next())
+        n++;
+    return n;
+}
+
+/* allocatorStats : BaseIO AllocStats
+
+   Snapshot of the allocator's statistics, for monitoring long-running
+   processes while they run rather than post-mortem. The global counters are
+   only maintained when the runtime is compiled with LEAN_RUNTIME_STATS and
+   read as zero otherwise. The per-size-class page counts are computed by
+   walking the calling thread's heap, which is touched by no other thread, so
+   taking a snapshot requires no locks and does not perturb other heaps. */
+extern "C" LEAN_EXPORT lean_obj_res lean_allocator_stats(lean_obj_arg /* w */) {
+    lean_object * live_pages = lean_alloc_array(LEAN_NUM_SLOTS, LEAN_NUM_SLOTS);
+    lean_object * free_pages = lean_alloc_array(LEAN_NUM_SLOTS, LEAN_NUM_SLOTS);
+    for (unsigned i = 0; i < LEAN_NUM_SLOTS; i++) {
+        unsigned num_live = g_heap ? count_pages(g_heap->m_curr_page[i]) : 0;
+        unsigned num_free = g_heap ? count_pages(g_heap->m_page_free_list[i]) : 0;
+        lean_array_set_core(live_pages, i, lean_usize_to_nat(num_live));
+        lean_array_set_core(free_pages, i, lean_usize_to_nat(num_free));
+    }
+#ifdef LEAN_RUNTIME_STATS
+    uint64_t num_alloc          = g_num_alloc;
+    uint64_t num_small_alloc    = g_num_small_alloc;
+    uint64_t num_dealloc        = g_num_dealloc;
+    uint64_t num_small_dealloc  = g_num_small_dealloc;
+    uint64_t num_segments       = g_num_segments;
+    uint64_t num_pages          = g_num_pages;
+    uint64_t num_recycled_pages = g_num_recycled_pages;
+    uint64_t num_exports        = g_num_exports;
+#else
+    uint64_t num_alloc          = 0;
+    uint64_t num_small_alloc    = 0;
+    uint64_t num_dealloc        = 0;
+    uint64_t num_small_dealloc  = 0;
+    uint64_t num_segments       = 0;
+    uint64_t num_pages          = 0;
+    uint64_t num_recycled_pages = 0;
+    uint64_t num_exports        = 0;
+#endif
+    lean_object * r = lean_alloc_ctor(0, 10, 0);
+    lean_ctor_set(r, 0, lean_uint64_to_nat(num_alloc));
+    lean_ctor_set(r, 1, lean_uint64_to_nat(num_small_alloc));
+    lean_ctor_set(r, 2, lean_uint64_to_nat(num_dealloc));
+    lean_ctor_set(r, 3, lean_uint64_to_nat(num_small_dealloc));
+    lean_ctor_set(r, 4, lean_uint64_to_nat(num_segments));
+    lean_ctor_set(r, 5, lean_uint64_to_nat(num_pages));
+    lean_ctor_set(r, 6, lean_uint64_to_nat(num_recycled_pages));
+    lean_ctor_set(r, 7, lean_uint64_to_nat(num_exports));
+    lean_ctor_set(r, 8, live_pages);
+    lean_ctor_set(r, 9, free_pages);
+    return lean_io_result_mk_ok(r);
+}
+
+/* heapTrim : BaseIO Unit
+
+   Returns the payload of every completely free page of the calling thread's
+   heap to the OS with MADV_DONTNEED, ignoring the LEAN_MAX_HOT_FREE_PAGES
+   hysteresis that incremental reclaim applies. Intended to shed memory after a
+   large batch of work completes (e.g. at the end of a build in a long-running
+   server), when the hot free pages will not be needed again soon. Only the
+   calling thread's heap is trimmed: heaps are touched by no other thread, so
+   the walk needs no locks; long-running workers should call this themselves. */
+extern "C" LEAN_EXPORT lean_obj_res lean_heap_trim(lean_obj_arg /* w */) {
+#ifdef LEAN_RECLAIM_PAGES
+    if (g_heap) {
+        for (unsigned i = 0; i < LEAN_NUM_SLOTS; i++) {
+            for (page * p = g_heap->m_page_free_list[i]; p; p = p->get_next()) {
+                if (!p->m_header.m_reclaimed && p->m_header.m_num_free == p->m_header.m_max_free)
+                    reclaim_page_payload(p, MADV_DONTNEED);
+            }
+        }
+    }
+#endif
+    return lean_io_result_mk_ok(lean_box(0));
+}
+
 void initialize_alloc() {
+    if (std::getenv("LEAN_HEAP_CHECK"))
+        g_heap_check = true;
     g_heap_manager = new heap_manager();
     init_heap(true);
 }
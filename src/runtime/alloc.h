@@ -9,6 +9,19 @@ Author: Leonardo de Moura
 #include <stdint.h>
 
 namespace lean {
+/* Always-on heap integrity checking, enabled by setting the environment variable
+   LEAN_HEAP_CHECK. Release builds compile out `lean_assert`, so heap corruption
+   observed in production normally requires reproducing the failure under a much
+   slower debug runtime. This mode keeps the release code paths but validates, on
+   every small-object deallocation, that the freed pointer lies on an object
+   boundary of a consistent allocator page, that the object header has not been
+   trashed (closure headers in particular), and, on the cold reference-counting
+   paths, that the counter still has a legal value. Violations panic immediately
+   at the faulting call instead of corrupting a free list that fails much later.
+   The cost is a handful of loads and predictable branches per deallocation when
+   enabled, and a single global test when not. */
+extern bool g_heap_check;
+
 void init_thread_heap();
 void * alloc(size_t sz);
 void dealloc(void * o, size_t sz);
@@ -4,8 +4,146 @@ Released under Apache 2.0 license as described in the file LICENSE.
 
 Author: Leonardo de Moura
 */
+#include <cstdlib>
+#include <cstring>
+#include <csignal>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <vector>
 #include "runtime/allocprof.h"
+#include "runtime/thread.h"
+#include "runtime/io.h"
+#if !defined(LEAN_WINDOWS) && !defined(LEAN_EMSCRIPTEN)
+#include <dlfcn.h>
+#define LEAN_ALLOCPROF_BACKTRACE
+#endif
 namespace lean {
+LEAN_EXPORT uint64 g_allocprof_interval = 0;
+LEAN_THREAD_VALUE(uint64, g_allocprof_countdown, 0);
+
+#define LEAN_ALLOCPROF_MAX_FRAMES 32
+#define LEAN_ALLOCPROF_DEFAULT_INTERVAL 8192
+
+/* Samples aggregated by stack (leaf frame first). The mutex is only taken
+   once per sample, i.e. once per g_allocprof_interval allocations. */
+static mutex * g_allocprof_mutex = nullptr;
+typedef std::map<std::vector<void *>, uint64> allocprof_samples;
+static allocprof_samples * g_allocprof_samples = nullptr;
+static volatile sig_atomic_t g_allocprof_dump_requested = 0;
+
+/* Walk the frame-pointer chain. We deliberately do not use unwind tables:
+   this runs inside the allocator and must be cheap and signal-safety-grade
+   simple. The sanity checks bound the walk when a frame pointer is reused as
+   a general-purpose register (-fomit-frame-pointer code). */
+static unsigned allocprof_backtrace(void ** frames, unsigned max_frames) {
+    unsigned n = 0;
+#ifdef LEAN_ALLOCPROF_BACKTRACE
+    void ** fp = reinterpret_cast<void **>(__builtin_frame_address(0));
+    while (n < max_frames && fp != nullptr) {
+        void ** next = reinterpret_cast<void **>(fp[0]);
+        void * ret   = fp[1];
+        if (ret == nullptr)
+            break;
+        frames[n++] = ret;
+        /* the next frame must be strictly above us, reasonably close, and aligned */
+        if (next <= fp ||
+            reinterpret_cast<char *>(next) - reinterpret_cast<char *>(fp) > 1024 * 1024 ||
+            (reinterpret_cast<uintptr_t>(next) & (sizeof(void *) - 1)) != 0)
+            break;
+        fp = next;
+    }
+#endif
+    return n;
+}
+
+static void allocprof_dump_core(std::ostream & out) {
+    lock_guard<mutex> lock(*g_allocprof_mutex);
+    for (auto const & entry : *g_allocprof_samples) {
+        std::vector<void *> const & stack = entry.first;
+        /* collapsed-stack format is root first */
+        for (auto it = stack.rbegin(); it != stack.rend(); ++it) {
+            if (it != stack.rbegin())
+                out << ";";
+#ifdef LEAN_ALLOCPROF_BACKTRACE
+            Dl_info info;
+            if (dladdr(*it, &info) && info.dli_sname) {
+                out << info.dli_sname;
+                continue;
+            }
+#endif
+            out << *it;
+        }
+        out << " " << entry.second << "\n";
+    }
+}
+
+static void allocprof_dump() {
+    if (char const * fname = std::getenv("LEAN_ALLOC_PROF_OUT")) {
+        std::ofstream out(fname);
+        allocprof_dump_core(out);
+    } else {
+        allocprof_dump_core(std::cerr);
+    }
+}
+
+extern "C" LEAN_EXPORT obj_res lean_allocprof_dump(obj_arg /* w */) {
+    if (g_allocprof_interval != 0)
+        allocprof_dump();
+    return io_result_mk_ok(box(0));
+}
+
+#ifdef LEAN_ALLOCPROF_BACKTRACE
+static void allocprof_signal_handler(int) {
+    /* dumping is not async-signal-safe; just request it, the next sample hit dumps */
+    g_allocprof_dump_requested = 1;
+}
+#endif
+
+void allocprof_tick() {
+    if (g_allocprof_countdown > 1) {
+        g_allocprof_countdown--;
+        return;
+    }
+    g_allocprof_countdown = g_allocprof_interval;
+    void * frames[LEAN_ALLOCPROF_MAX_FRAMES];
+    unsigned n = allocprof_backtrace(frames, LEAN_ALLOCPROF_MAX_FRAMES);
+    if (n > 0) {
+        /* note: the std::map operates on the system allocator; it must not
+           reenter the Lean heap here */
+        lock_guard<mutex> lock(*g_allocprof_mutex);
+        (*g_allocprof_samples)[std::vector<void *>(frames, frames + n)]++;
+    }
+    if (g_allocprof_dump_requested) {
+        g_allocprof_dump_requested = 0;
+        allocprof_dump();
+    }
+}
+
+void initialize_allocprof() {
+    char const * interval = std::getenv("LEAN_ALLOC_PROF");
+    if (interval == nullptr)
+        return;
+    uint64 v = std::strtoull(interval, nullptr, 10);
+    g_allocprof_mutex   = new mutex();
+    g_allocprof_samples = new allocprof_samples();
+    g_allocprof_interval = v > 1 ? v : LEAN_ALLOCPROF_DEFAULT_INTERVAL;
+#ifdef LEAN_ALLOCPROF_BACKTRACE
+    std::signal(SIGUSR2, allocprof_signal_handler);
+#endif
+}
+
+void finalize_allocprof() {
+    if (g_allocprof_interval == 0)
+        return;
+    allocprof_dump();
+    g_allocprof_interval = 0;
+    delete g_allocprof_samples;
+    g_allocprof_samples = nullptr;
+    delete g_allocprof_mutex;
+    g_allocprof_mutex = nullptr;
+}
+
 allocprof::allocprof(std::ostream & out, char const * msg):
     m_out(out), m_msg(msg) {
 #ifdef LEAN_RUNTIME_STATS
@@ -8,6 +8,31 @@ Author: Leonardo de Moura
 #include <string>
 #include "runtime/object.h"
 namespace lean {
+/* Sampling allocation profiler.
+
+   When enabled (environment variable LEAN_ALLOC_PROF=<sample interval>, or
+   just LEAN_ALLOC_PROF=1 for the default interval), every Nth small-object
+   allocation captures a compact frame-pointer backtrace. Samples are
+   aggregated by stack and dumped in collapsed-stack format (one
+   `frame;frame;... count` line per stack, flamegraph.pl-compatible) to the
+   file named by LEAN_ALLOC_PROF_OUT (stderr by default) at process exit, on
+   SIGUSR2, or via the exported `lean_allocprof_dump` IO entry point.
+
+   At the default interval the cost is one global load and branch per
+   allocation, so it is cheap enough to keep enabled on servers. Backtraces
+   rely on frame pointers; compile with -fno-omit-frame-pointer (as the
+   RelWithDebInfo configuration already does) for useful stacks. */
+
+/* Sample interval; 0 when the profiler is disabled. Read on the allocation
+   fast path in lean_alloc_small. */
+extern uint64 g_allocprof_interval;
+/* Called from the allocator when g_allocprof_interval != 0; decrements the
+   thread's countdown and records a sample when it expires. Must not allocate
+   from the Lean heap. */
+void allocprof_tick();
+void initialize_allocprof();
+void finalize_allocprof();
+
 /* Low tech runtime allocation profiler.
    We need to compile Lean using RUNTIME_STATS=ON to use it. */
 class allocprof {
@@ -7,16 +7,42 @@ Author: Leonardo de Moura
 // DO NOT EDIT, this is an automatically generated file
 // Generated using script: ../../gen/apply.lean
 #include "runtime/apply.h"
+#include "runtime/stackinfo.h"
 namespace lean {
 #define obj lean_object
 #define fx(i) lean_closure_arg_cptr(f)[i]
 
+/* Closures can fix up to 2^16-1 arguments, so the stack-allocated args buffer used for
+   the boxed calling convention can grow to 512KiB; make sure there is room before
+   building a huge frame. */
+#define CHECK_APPLY_STACK() if (LEAN_UNLIKELY(arity > 1024)) check_stack("apply")
+
 static obj* fix_args(obj* f, unsigned n, obj*const* as) {
     unsigned arity = lean_closure_arity(f);
     unsigned fixed = lean_closure_num_fixed(f);
     unsigned new_fixed = fixed + n;
     lean_assert(new_fixed < arity);
-    obj * r = lean_alloc_closure(lean_closure_fun(f), arity, new_fixed);
+    if (lean_is_exclusive(f) &&
+        sizeof(lean_closure_object) + sizeof(obj*)*new_fixed <= lean_small_object_size(f)) {
+        /* `f` was allocated with spare argument capacity (see below); extend it in place. */
+        obj ** target = lean_closure_arg_cptr(f) + fixed;
+        for (unsigned i = 0; i < n; i++, as++, target++) {
+            *target = *as;
+        }
+        lean_to_closure(f)->m_num_fixed = new_fixed;
+        return f;
+    }
+    /* Reserve room for `arity - 1` arguments: a closure built here is usually applied
+       again, and the extra capacity lets the next `fix_args` on the (by then exclusive)
+       result fill arguments in place instead of allocating a fresh closure per step. */
+    unsigned capacity = arity - 1;
+    if (sizeof(lean_closure_object) + sizeof(obj*)*capacity > LEAN_MAX_SMALL_OBJECT_SIZE)
+        capacity = new_fixed;
+    obj * r = lean_alloc_small_object(sizeof(lean_closure_object) + sizeof(obj*)*capacity);
+    lean_set_st_header(r, LeanClosure, 0);
+    lean_to_closure(r)->m_fun       = lean_closure_fun(f);
+    lean_to_closure(r)->m_arity     = arity;
+    lean_to_closure(r)->m_num_fixed = new_fixed;
     obj ** source = lean_closure_arg_cptr(f);
     obj ** target = lean_closure_arg_cptr(r);
     if (!lean_is_exclusive(f)) {
@@ -99,10 +125,10 @@ default: return reinterpret_cast<fnn>(f)(as);
 static obj* curry(obj* f, unsigned n, obj** as) { return curry(lean_closure_fun(f), n, as); }
 extern "C" obj* lean_apply_n(obj*, unsigned, obj**);
 extern "C" LEAN_EXPORT obj* lean_apply_1(obj* f, obj* a1) {
-if (lean_is_scalar(f)) { lean_dec(a1); return f; } // f is an erased proof
+if (LEAN_UNLIKELY(lean_is_scalar(f))) { lean_dec(a1); return f; } // f is an erased proof
 unsigned arity = lean_closure_arity(f);
 unsigned fixed = lean_closure_num_fixed(f);
-if (arity == fixed + 1) {
+if (LEAN_LIKELY(arity == fixed + 1)) {
   if (is_exclusive(f)) {
     switch (arity) {
     case 1: { obj* r = FN1(f)(a1); lean_free_small_object(f); return r; }
@@ -143,6 +169,7 @@ if (arity == fixed + 1) {
   default:
     lean_assert(arity > 16);
     obj * as[1] = { a1 };
+    CHECK_APPLY_STACK();
     obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
     for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
     for (unsigned i = 0; i < 1; i++) args[fixed+i] = as[i];
@@ -158,10 +185,10 @@ if (arity == fixed + 1) {
 }
 }
 extern "C" LEAN_EXPORT obj* lean_apply_2(obj* f, obj* a1, obj* a2) {
-if (lean_is_scalar(f)) { lean_dec(a1); lean_dec(a2); return f; } // f is an erased proof
+if (LEAN_UNLIKELY(lean_is_scalar(f))) { lean_dec(a1); lean_dec(a2); return f; } // f is an erased proof
 unsigned arity = lean_closure_arity(f);
 unsigned fixed = lean_closure_num_fixed(f);
-if (arity == fixed + 2) {
+if (LEAN_LIKELY(arity == fixed + 2)) {
   if (is_exclusive(f)) {
     switch (arity) {
     case 2: { obj* r = FN2(f)(a1, a2); lean_free_small_object(f); return r; }
@@ -200,6 +227,7 @@ if (arity == fixed + 2) {
   default:
     lean_assert(arity > 16);
     obj * as[2] = { a1, a2 };
+    CHECK_APPLY_STACK();
     obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
     for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
     for (unsigned i = 0; i < 2; i++) args[fixed+i] = as[i];
@@ -209,6 +237,7 @@ if (arity == fixed + 2) {
   }
 } else if (arity < fixed + 2) {
   obj * as[2] = { a1, a2 };
+  CHECK_APPLY_STACK();
   obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
   for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
   for (unsigned i = 0; i < arity-fixed; i++) args[fixed+i] = as[i];
@@ -220,10 +249,10 @@ if (arity == fixed + 2) {
 }
 }
 extern "C" LEAN_EXPORT obj* lean_apply_3(obj* f, obj* a1, obj* a2, obj* a3) {
-if (lean_is_scalar(f)) { lean_dec(a1); lean_dec(a2); lean_dec(a3); return f; } // f is an erased proof
+if (LEAN_UNLIKELY(lean_is_scalar(f))) { lean_dec(a1); lean_dec(a2); lean_dec(a3); return f; } // f is an erased proof
 unsigned arity = lean_closure_arity(f);
 unsigned fixed = lean_closure_num_fixed(f);
-if (arity == fixed + 3) {
+if (LEAN_LIKELY(arity == fixed + 3)) {
   if (is_exclusive(f)) {
     switch (arity) {
     case 3: { obj* r = FN3(f)(a1, a2, a3); lean_free_small_object(f); return r; }
@@ -260,6 +289,7 @@ if (arity == fixed + 3) {
   default:
     lean_assert(arity > 16);
     obj * as[3] = { a1, a2, a3 };
+    CHECK_APPLY_STACK();
     obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
     for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
     for (unsigned i = 0; i < 3; i++) args[fixed+i] = as[i];
@@ -269,6 +299,7 @@ if (arity == fixed + 3) {
   }
 } else if (arity < fixed + 3) {
   obj * as[3] = { a1, a2, a3 };
+  CHECK_APPLY_STACK();
   obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
   for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
   for (unsigned i = 0; i < arity-fixed; i++) args[fixed+i] = as[i];
@@ -280,10 +311,10 @@ if (arity == fixed + 3) {
 }
 }
 extern "C" LEAN_EXPORT obj* lean_apply_4(obj* f, obj* a1, obj* a2, obj* a3, obj* a4) {
-if (lean_is_scalar(f)) { lean_dec(a1); lean_dec(a2); lean_dec(a3); lean_dec(a4); return f; } // f is an erased proof
+if (LEAN_UNLIKELY(lean_is_scalar(f))) { lean_dec(a1); lean_dec(a2); lean_dec(a3); lean_dec(a4); return f; } // f is an erased proof
 unsigned arity = lean_closure_arity(f);
 unsigned fixed = lean_closure_num_fixed(f);
-if (arity == fixed + 4) {
+if (LEAN_LIKELY(arity == fixed + 4)) {
   if (is_exclusive(f)) {
     switch (arity) {
     case 4: { obj* r = FN4(f)(a1, a2, a3, a4); lean_free_small_object(f); return r; }
@@ -318,6 +349,7 @@ if (arity == fixed + 4) {
   default:
     lean_assert(arity > 16);
     obj * as[4] = { a1, a2, a3, a4 };
+    CHECK_APPLY_STACK();
     obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
     for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
     for (unsigned i = 0; i < 4; i++) args[fixed+i] = as[i];
@@ -327,6 +359,7 @@ if (arity == fixed + 4) {
   }
 } else if (arity < fixed + 4) {
   obj * as[4] = { a1, a2, a3, a4 };
+  CHECK_APPLY_STACK();
   obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
   for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
   for (unsigned i = 0; i < arity-fixed; i++) args[fixed+i] = as[i];
@@ -338,10 +371,10 @@ if (arity == fixed + 4) {
 }
 }
 extern "C" LEAN_EXPORT obj* lean_apply_5(obj* f, obj* a1, obj* a2, obj* a3, obj* a4, obj* a5) {
-if (lean_is_scalar(f)) { lean_dec(a1); lean_dec(a2); lean_dec(a3); lean_dec(a4); lean_dec(a5); return f; } // f is an erased proof
+if (LEAN_UNLIKELY(lean_is_scalar(f))) { lean_dec(a1); lean_dec(a2); lean_dec(a3); lean_dec(a4); lean_dec(a5); return f; } // f is an erased proof
 unsigned arity = lean_closure_arity(f);
 unsigned fixed = lean_closure_num_fixed(f);
-if (arity == fixed + 5) {
+if (LEAN_LIKELY(arity == fixed + 5)) {
   if (is_exclusive(f)) {
     switch (arity) {
     case 5: { obj* r = FN5(f)(a1, a2, a3, a4, a5); lean_free_small_object(f); return r; }
@@ -374,6 +407,7 @@ if (arity == fixed + 5) {
   default:
     lean_assert(arity > 16);
     obj * as[5] = { a1, a2, a3, a4, a5 };
+    CHECK_APPLY_STACK();
     obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
     for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
     for (unsigned i = 0; i < 5; i++) args[fixed+i] = as[i];
@@ -383,6 +417,7 @@ if (arity == fixed + 5) {
   }
 } else if (arity < fixed + 5) {
   obj * as[5] = { a1, a2, a3, a4, a5 };
+  CHECK_APPLY_STACK();
   obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
   for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
   for (unsigned i = 0; i < arity-fixed; i++) args[fixed+i] = as[i];
@@ -394,10 +429,10 @@ if (arity == fixed + 5) {
 }
 }
 extern "C" LEAN_EXPORT obj* lean_apply_6(obj* f, obj* a1, obj* a2, obj* a3, obj* a4, obj* a5, obj* a6) {
-if (lean_is_scalar(f)) { lean_dec(a1); lean_dec(a2); lean_dec(a3); lean_dec(a4); lean_dec(a5); lean_dec(a6); return f; } // f is an erased proof
+if (LEAN_UNLIKELY(lean_is_scalar(f))) { lean_dec(a1); lean_dec(a2); lean_dec(a3); lean_dec(a4); lean_dec(a5); lean_dec(a6); return f; } // f is an erased proof
 unsigned arity = lean_closure_arity(f);
 unsigned fixed = lean_closure_num_fixed(f);
-if (arity == fixed + 6) {
+if (LEAN_LIKELY(arity == fixed + 6)) {
   if (is_exclusive(f)) {
     switch (arity) {
     case 6: { obj* r = FN6(f)(a1, a2, a3, a4, a5, a6); lean_free_small_object(f); return r; }
@@ -428,6 +463,7 @@ if (arity == fixed + 6) {
   default:
     lean_assert(arity > 16);
     obj * as[6] = { a1, a2, a3, a4, a5, a6 };
+    CHECK_APPLY_STACK();
     obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
     for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
     for (unsigned i = 0; i < 6; i++) args[fixed+i] = as[i];
@@ -437,6 +473,7 @@ if (arity == fixed + 6) {
   }
 } else if (arity < fixed + 6) {
   obj * as[6] = { a1, a2, a3, a4, a5, a6 };
+  CHECK_APPLY_STACK();
   obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
   for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
   for (unsigned i = 0; i < arity-fixed; i++) args[fixed+i] = as[i];
@@ -448,10 +485,10 @@ if (arity == fixed + 6) {
 }
 }
 extern "C" LEAN_EXPORT obj* lean_apply_7(obj* f, obj* a1, obj* a2, obj* a3, obj* a4, obj* a5, obj* a6, obj* a7) {
-if (lean_is_scalar(f)) { lean_dec(a1); lean_dec(a2); lean_dec(a3); lean_dec(a4); lean_dec(a5); lean_dec(a6); lean_dec(a7); return f; } // f is an erased proof
+if (LEAN_UNLIKELY(lean_is_scalar(f))) { lean_dec(a1); lean_dec(a2); lean_dec(a3); lean_dec(a4); lean_dec(a5); lean_dec(a6); lean_dec(a7); return f; } // f is an erased proof
 unsigned arity = lean_closure_arity(f);
 unsigned fixed = lean_closure_num_fixed(f);
-if (arity == fixed + 7) {
+if (LEAN_LIKELY(arity == fixed + 7)) {
   if (is_exclusive(f)) {
     switch (arity) {
     case 7: { obj* r = FN7(f)(a1, a2, a3, a4, a5, a6, a7); lean_free_small_object(f); return r; }
@@ -480,6 +517,7 @@ if (arity == fixed + 7) {
   default:
     lean_assert(arity > 16);
     obj * as[7] = { a1, a2, a3, a4, a5, a6, a7 };
+    CHECK_APPLY_STACK();
     obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
     for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
     for (unsigned i = 0; i < 7; i++) args[fixed+i] = as[i];
@@ -489,6 +527,7 @@ if (arity == fixed + 7) {
   }
 } else if (arity < fixed + 7) {
   obj * as[7] = { a1, a2, a3, a4, a5, a6, a7 };
+  CHECK_APPLY_STACK();
   obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
   for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
   for (unsigned i = 0; i < arity-fixed; i++) args[fixed+i] = as[i];
@@ -500,10 +539,10 @@ if (arity == fixed + 7) {
 }
 }
 extern "C" LEAN_EXPORT obj* lean_apply_8(obj* f, obj* a1, obj* a2, obj* a3, obj* a4, obj* a5, obj* a6, obj* a7, obj* a8) {
-if (lean_is_scalar(f)) { lean_dec(a1); lean_dec(a2); lean_dec(a3); lean_dec(a4); lean_dec(a5); lean_dec(a6); lean_dec(a7); lean_dec(a8); return f; } // f is an erased proof
+if (LEAN_UNLIKELY(lean_is_scalar(f))) { lean_dec(a1); lean_dec(a2); lean_dec(a3); lean_dec(a4); lean_dec(a5); lean_dec(a6); lean_dec(a7); lean_dec(a8); return f; } // f is an erased proof
 unsigned arity = lean_closure_arity(f);
 unsigned fixed = lean_closure_num_fixed(f);
-if (arity == fixed + 8) {
+if (LEAN_LIKELY(arity == fixed + 8)) {
   if (is_exclusive(f)) {
     switch (arity) {
     case 8: { obj* r = FN8(f)(a1, a2, a3, a4, a5, a6, a7, a8); lean_free_small_object(f); return r; }
@@ -530,6 +569,7 @@ if (arity == fixed + 8) {
   default:
     lean_assert(arity > 16);
     obj * as[8] = { a1, a2, a3, a4, a5, a6, a7, a8 };
+    CHECK_APPLY_STACK();
     obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
     for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
     for (unsigned i = 0; i < 8; i++) args[fixed+i] = as[i];
@@ -539,6 +579,7 @@ if (arity == fixed + 8) {
   }
 } else if (arity < fixed + 8) {
   obj * as[8] = { a1, a2, a3, a4, a5, a6, a7, a8 };
+  CHECK_APPLY_STACK();
   obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
   for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
   for (unsigned i = 0; i < arity-fixed; i++) args[fixed+i] = as[i];
@@ -550,10 +591,10 @@ if (arity == fixed + 8) {
 }
 }
 extern "C" LEAN_EXPORT obj* lean_apply_9(obj* f, obj* a1, obj* a2, obj* a3, obj* a4, obj* a5, obj* a6, obj* a7, obj* a8, obj* a9) {
-if (lean_is_scalar(f)) { lean_dec(a1); lean_dec(a2); lean_dec(a3); lean_dec(a4); lean_dec(a5); lean_dec(a6); lean_dec(a7); lean_dec(a8); lean_dec(a9); return f; } // f is an erased proof
+if (LEAN_UNLIKELY(lean_is_scalar(f))) { lean_dec(a1); lean_dec(a2); lean_dec(a3); lean_dec(a4); lean_dec(a5); lean_dec(a6); lean_dec(a7); lean_dec(a8); lean_dec(a9); return f; } // f is an erased proof
 unsigned arity = lean_closure_arity(f);
 unsigned fixed = lean_closure_num_fixed(f);
-if (arity == fixed + 9) {
+if (LEAN_LIKELY(arity == fixed + 9)) {
   if (is_exclusive(f)) {
     switch (arity) {
     case 9: { obj* r = FN9(f)(a1, a2, a3, a4, a5, a6, a7, a8, a9); lean_free_small_object(f); return r; }
@@ -578,6 +619,7 @@ if (arity == fixed + 9) {
   default:
     lean_assert(arity > 16);
     obj * as[9] = { a1, a2, a3, a4, a5, a6, a7, a8, a9 };
+    CHECK_APPLY_STACK();
     obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
     for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
     for (unsigned i = 0; i < 9; i++) args[fixed+i] = as[i];
@@ -587,6 +629,7 @@ if (arity == fixed + 9) {
   }
 } else if (arity < fixed + 9) {
   obj * as[9] = { a1, a2, a3, a4, a5, a6, a7, a8, a9 };
+  CHECK_APPLY_STACK();
   obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
   for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
   for (unsigned i = 0; i < arity-fixed; i++) args[fixed+i] = as[i];
@@ -598,10 +641,10 @@ if (arity == fixed + 9) {
 }
 }
 extern "C" LEAN_EXPORT obj* lean_apply_10(obj* f, obj* a1, obj* a2, obj* a3, obj* a4, obj* a5, obj* a6, obj* a7, obj* a8, obj* a9, obj* a10) {
-if (lean_is_scalar(f)) { lean_dec(a1); lean_dec(a2); lean_dec(a3); lean_dec(a4); lean_dec(a5); lean_dec(a6); lean_dec(a7); lean_dec(a8); lean_dec(a9); lean_dec(a10); return f; } // f is an erased proof
+if (LEAN_UNLIKELY(lean_is_scalar(f))) { lean_dec(a1); lean_dec(a2); lean_dec(a3); lean_dec(a4); lean_dec(a5); lean_dec(a6); lean_dec(a7); lean_dec(a8); lean_dec(a9); lean_dec(a10); return f; } // f is an erased proof
 unsigned arity = lean_closure_arity(f);
 unsigned fixed = lean_closure_num_fixed(f);
-if (arity == fixed + 10) {
+if (LEAN_LIKELY(arity == fixed + 10)) {
   if (is_exclusive(f)) {
     switch (arity) {
     case 10: { obj* r = FN10(f)(a1, a2, a3, a4, a5, a6, a7, a8, a9, a10); lean_free_small_object(f); return r; }
@@ -624,6 +667,7 @@ if (arity == fixed + 10) {
   default:
     lean_assert(arity > 16);
     obj * as[10] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10 };
+    CHECK_APPLY_STACK();
     obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
     for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
     for (unsigned i = 0; i < 10; i++) args[fixed+i] = as[i];
@@ -633,6 +677,7 @@ if (arity == fixed + 10) {
   }
 } else if (arity < fixed + 10) {
   obj * as[10] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10 };
+  CHECK_APPLY_STACK();
   obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
   for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
   for (unsigned i = 0; i < arity-fixed; i++) args[fixed+i] = as[i];
@@ -644,10 +689,10 @@ if (arity == fixed + 10) {
 }
 }
 extern "C" LEAN_EXPORT obj* lean_apply_11(obj* f, obj* a1, obj* a2, obj* a3, obj* a4, obj* a5, obj* a6, obj* a7, obj* a8, obj* a9, obj* a10, obj* a11) {
-if (lean_is_scalar(f)) { lean_dec(a1); lean_dec(a2); lean_dec(a3); lean_dec(a4); lean_dec(a5); lean_dec(a6); lean_dec(a7); lean_dec(a8); lean_dec(a9); lean_dec(a10); lean_dec(a11); return f; } // f is an erased proof
+if (LEAN_UNLIKELY(lean_is_scalar(f))) { lean_dec(a1); lean_dec(a2); lean_dec(a3); lean_dec(a4); lean_dec(a5); lean_dec(a6); lean_dec(a7); lean_dec(a8); lean_dec(a9); lean_dec(a10); lean_dec(a11); return f; } // f is an erased proof
 unsigned arity = lean_closure_arity(f);
 unsigned fixed = lean_closure_num_fixed(f);
-if (arity == fixed + 11) {
+if (LEAN_LIKELY(arity == fixed + 11)) {
   if (is_exclusive(f)) {
     switch (arity) {
     case 11: { obj* r = FN11(f)(a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11); lean_free_small_object(f); return r; }
@@ -668,6 +713,7 @@ if (arity == fixed + 11) {
   default:
     lean_assert(arity > 16);
     obj * as[11] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11 };
+    CHECK_APPLY_STACK();
     obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
     for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
     for (unsigned i = 0; i < 11; i++) args[fixed+i] = as[i];
@@ -677,6 +723,7 @@ if (arity == fixed + 11) {
   }
 } else if (arity < fixed + 11) {
   obj * as[11] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11 };
+  CHECK_APPLY_STACK();
   obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
   for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
   for (unsigned i = 0; i < arity-fixed; i++) args[fixed+i] = as[i];
@@ -688,10 +735,10 @@ if (arity == fixed + 11) {
 }
 }
 extern "C" LEAN_EXPORT obj* lean_apply_12(obj* f, obj* a1, obj* a2, obj* a3, obj* a4, obj* a5, obj* a6, obj* a7, obj* a8, obj* a9, obj* a10, obj* a11, obj* a12) {
-if (lean_is_scalar(f)) { lean_dec(a1); lean_dec(a2); lean_dec(a3); lean_dec(a4); lean_dec(a5); lean_dec(a6); lean_dec(a7); lean_dec(a8); lean_dec(a9); lean_dec(a10); lean_dec(a11); lean_dec(a12); return f; } // f is an erased proof
+if (LEAN_UNLIKELY(lean_is_scalar(f))) { lean_dec(a1); lean_dec(a2); lean_dec(a3); lean_dec(a4); lean_dec(a5); lean_dec(a6); lean_dec(a7); lean_dec(a8); lean_dec(a9); lean_dec(a10); lean_dec(a11); lean_dec(a12); return f; } // f is an erased proof
 unsigned arity = lean_closure_arity(f);
 unsigned fixed = lean_closure_num_fixed(f);
-if (arity == fixed + 12) {
+if (LEAN_LIKELY(arity == fixed + 12)) {
   if (is_exclusive(f)) {
     switch (arity) {
     case 12: { obj* r = FN12(f)(a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12); lean_free_small_object(f); return r; }
@@ -710,6 +757,7 @@ if (arity == fixed + 12) {
   default:
     lean_assert(arity > 16);
     obj * as[12] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12 };
+    CHECK_APPLY_STACK();
     obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
     for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
     for (unsigned i = 0; i < 12; i++) args[fixed+i] = as[i];
@@ -719,6 +767,7 @@ if (arity == fixed + 12) {
   }
 } else if (arity < fixed + 12) {
   obj * as[12] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12 };
+  CHECK_APPLY_STACK();
   obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
   for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
   for (unsigned i = 0; i < arity-fixed; i++) args[fixed+i] = as[i];
@@ -730,10 +779,10 @@ if (arity == fixed + 12) {
 }
 }
 extern "C" LEAN_EXPORT obj* lean_apply_13(obj* f, obj* a1, obj* a2, obj* a3, obj* a4, obj* a5, obj* a6, obj* a7, obj* a8, obj* a9, obj* a10, obj* a11, obj* a12, obj* a13) {
-if (lean_is_scalar(f)) { lean_dec(a1); lean_dec(a2); lean_dec(a3); lean_dec(a4); lean_dec(a5); lean_dec(a6); lean_dec(a7); lean_dec(a8); lean_dec(a9); lean_dec(a10); lean_dec(a11); lean_dec(a12); lean_dec(a13); return f; } // f is an erased proof
+if (LEAN_UNLIKELY(lean_is_scalar(f))) { lean_dec(a1); lean_dec(a2); lean_dec(a3); lean_dec(a4); lean_dec(a5); lean_dec(a6); lean_dec(a7); lean_dec(a8); lean_dec(a9); lean_dec(a10); lean_dec(a11); lean_dec(a12); lean_dec(a13); return f; } // f is an erased proof
 unsigned arity = lean_closure_arity(f);
 unsigned fixed = lean_closure_num_fixed(f);
-if (arity == fixed + 13) {
+if (LEAN_LIKELY(arity == fixed + 13)) {
   if (is_exclusive(f)) {
     switch (arity) {
     case 13: { obj* r = FN13(f)(a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13); lean_free_small_object(f); return r; }
@@ -750,6 +799,7 @@ if (arity == fixed + 13) {
   default:
     lean_assert(arity > 16);
     obj * as[13] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13 };
+    CHECK_APPLY_STACK();
     obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
     for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
     for (unsigned i = 0; i < 13; i++) args[fixed+i] = as[i];
@@ -759,6 +809,7 @@ if (arity == fixed + 13) {
   }
 } else if (arity < fixed + 13) {
   obj * as[13] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13 };
+  CHECK_APPLY_STACK();
   obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
   for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
   for (unsigned i = 0; i < arity-fixed; i++) args[fixed+i] = as[i];
@@ -770,10 +821,10 @@ if (arity == fixed + 13) {
 }
 }
 extern "C" LEAN_EXPORT obj* lean_apply_14(obj* f, obj* a1, obj* a2, obj* a3, obj* a4, obj* a5, obj* a6, obj* a7, obj* a8, obj* a9, obj* a10, obj* a11, obj* a12, obj* a13, obj* a14) {
-if (lean_is_scalar(f)) { lean_dec(a1); lean_dec(a2); lean_dec(a3); lean_dec(a4); lean_dec(a5); lean_dec(a6); lean_dec(a7); lean_dec(a8); lean_dec(a9); lean_dec(a10); lean_dec(a11); lean_dec(a12); lean_dec(a13); lean_dec(a14); return f; } // f is an erased proof
+if (LEAN_UNLIKELY(lean_is_scalar(f))) { lean_dec(a1); lean_dec(a2); lean_dec(a3); lean_dec(a4); lean_dec(a5); lean_dec(a6); lean_dec(a7); lean_dec(a8); lean_dec(a9); lean_dec(a10); lean_dec(a11); lean_dec(a12); lean_dec(a13); lean_dec(a14); return f; } // f is an erased proof
 unsigned arity = lean_closure_arity(f);
 unsigned fixed = lean_closure_num_fixed(f);
-if (arity == fixed + 14) {
+if (LEAN_LIKELY(arity == fixed + 14)) {
   if (is_exclusive(f)) {
     switch (arity) {
     case 14: { obj* r = FN14(f)(a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14); lean_free_small_object(f); return r; }
@@ -788,6 +839,7 @@ if (arity == fixed + 14) {
   default:
     lean_assert(arity > 16);
     obj * as[14] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14 };
+    CHECK_APPLY_STACK();
     obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
     for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
     for (unsigned i = 0; i < 14; i++) args[fixed+i] = as[i];
@@ -797,6 +849,7 @@ if (arity == fixed + 14) {
   }
 } else if (arity < fixed + 14) {
   obj * as[14] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14 };
+  CHECK_APPLY_STACK();
   obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
   for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
   for (unsigned i = 0; i < arity-fixed; i++) args[fixed+i] = as[i];
@@ -808,10 +861,10 @@ if (arity == fixed + 14) {
 }
 }
 extern "C" LEAN_EXPORT obj* lean_apply_15(obj* f, obj* a1, obj* a2, obj* a3, obj* a4, obj* a5, obj* a6, obj* a7, obj* a8, obj* a9, obj* a10, obj* a11, obj* a12, obj* a13, obj* a14, obj* a15) {
-if (lean_is_scalar(f)) { lean_dec(a1); lean_dec(a2); lean_dec(a3); lean_dec(a4); lean_dec(a5); lean_dec(a6); lean_dec(a7); lean_dec(a8); lean_dec(a9); lean_dec(a10); lean_dec(a11); lean_dec(a12); lean_dec(a13); lean_dec(a14); lean_dec(a15); return f; } // f is an erased proof
+if (LEAN_UNLIKELY(lean_is_scalar(f))) { lean_dec(a1); lean_dec(a2); lean_dec(a3); lean_dec(a4); lean_dec(a5); lean_dec(a6); lean_dec(a7); lean_dec(a8); lean_dec(a9); lean_dec(a10); lean_dec(a11); lean_dec(a12); lean_dec(a13); lean_dec(a14); lean_dec(a15); return f; } // f is an erased proof
 unsigned arity = lean_closure_arity(f);
 unsigned fixed = lean_closure_num_fixed(f);
-if (arity == fixed + 15) {
+if (LEAN_LIKELY(arity == fixed + 15)) {
   if (is_exclusive(f)) {
     switch (arity) {
     case 15: { obj* r = FN15(f)(a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15); lean_free_small_object(f); return r; }
@@ -824,6 +877,7 @@ if (arity == fixed + 15) {
   default:
     lean_assert(arity > 16);
     obj * as[15] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15 };
+    CHECK_APPLY_STACK();
     obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
     for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
     for (unsigned i = 0; i < 15; i++) args[fixed+i] = as[i];
@@ -833,6 +887,7 @@ if (arity == fixed + 15) {
   }
 } else if (arity < fixed + 15) {
   obj * as[15] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15 };
+  CHECK_APPLY_STACK();
   obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
   for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
   for (unsigned i = 0; i < arity-fixed; i++) args[fixed+i] = as[i];
@@ -844,10 +899,10 @@ if (arity == fixed + 15) {
 }
 }
 extern "C" LEAN_EXPORT obj* lean_apply_16(obj* f, obj* a1, obj* a2, obj* a3, obj* a4, obj* a5, obj* a6, obj* a7, obj* a8, obj* a9, obj* a10, obj* a11, obj* a12, obj* a13, obj* a14, obj* a15, obj* a16) {
-if (lean_is_scalar(f)) { lean_dec(a1); lean_dec(a2); lean_dec(a3); lean_dec(a4); lean_dec(a5); lean_dec(a6); lean_dec(a7); lean_dec(a8); lean_dec(a9); lean_dec(a10); lean_dec(a11); lean_dec(a12); lean_dec(a13); lean_dec(a14); lean_dec(a15); lean_dec(a16); return f; } // f is an erased proof
+if (LEAN_UNLIKELY(lean_is_scalar(f))) { lean_dec(a1); lean_dec(a2); lean_dec(a3); lean_dec(a4); lean_dec(a5); lean_dec(a6); lean_dec(a7); lean_dec(a8); lean_dec(a9); lean_dec(a10); lean_dec(a11); lean_dec(a12); lean_dec(a13); lean_dec(a14); lean_dec(a15); lean_dec(a16); return f; } // f is an erased proof
 unsigned arity = lean_closure_arity(f);
 unsigned fixed = lean_closure_num_fixed(f);
-if (arity == fixed + 16) {
+if (LEAN_LIKELY(arity == fixed + 16)) {
   if (is_exclusive(f)) {
     switch (arity) {
     case 16: { obj* r = FN16(f)(a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16); lean_free_small_object(f); return r; }
@@ -858,6 +913,7 @@ if (arity == fixed + 16) {
   default:
     lean_assert(arity > 16);
     obj * as[16] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16 };
+    CHECK_APPLY_STACK();
     obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
     for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
     for (unsigned i = 0; i < 16; i++) args[fixed+i] = as[i];
@@ -867,6 +923,7 @@ if (arity == fixed + 16) {
   }
 } else if (arity < fixed + 16) {
   obj * as[16] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16 };
+  CHECK_APPLY_STACK();
   obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
   for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
   for (unsigned i = 0; i < arity-fixed; i++) args[fixed+i] = as[i];
@@ -877,12 +934,445 @@ if (arity == fixed + 16) {
   return fix_args(f, {a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16});
 }
 }
+extern "C" LEAN_EXPORT obj* lean_apply_17(obj* f, obj* a1, obj* a2, obj* a3, obj* a4, obj* a5, obj* a6, obj* a7, obj* a8, obj* a9, obj* a10, obj* a11, obj* a12, obj* a13, obj* a14, obj* a15, obj* a16, obj* a17) {
+if (LEAN_UNLIKELY(lean_is_scalar(f))) { lean_dec(a1); lean_dec(a2); lean_dec(a3); lean_dec(a4); lean_dec(a5); lean_dec(a6); lean_dec(a7); lean_dec(a8); lean_dec(a9); lean_dec(a10); lean_dec(a11); lean_dec(a12); lean_dec(a13); lean_dec(a14); lean_dec(a15); lean_dec(a16); lean_dec(a17); return f; } // f is an erased proof
+unsigned arity = lean_closure_arity(f);
+unsigned fixed = lean_closure_num_fixed(f);
+if (LEAN_LIKELY(arity == fixed + 17)) {
+  lean_assert(arity > 16);
+  obj * as[17] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17 };
+  CHECK_APPLY_STACK();
+  obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
+  for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
+  for (unsigned i = 0; i < 17; i++) args[fixed+i] = as[i];
+  obj * r = FNN(f)(args);
+  lean_dec_ref(f);
+  return r;
+} else if (arity < fixed + 17) {
+  obj * as[17] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17 };
+  CHECK_APPLY_STACK();
+  obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
+  for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
+  for (unsigned i = 0; i < arity-fixed; i++) args[fixed+i] = as[i];
+  obj * new_f = curry(f, arity, args);
+  lean_dec_ref(f);
+  return lean_apply_n(new_f, 17+fixed-arity, &as[arity-fixed]);
+} else {
+  return fix_args(f, { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17 });
+}
+}
+extern "C" LEAN_EXPORT obj* lean_apply_18(obj* f, obj* a1, obj* a2, obj* a3, obj* a4, obj* a5, obj* a6, obj* a7, obj* a8, obj* a9, obj* a10, obj* a11, obj* a12, obj* a13, obj* a14, obj* a15, obj* a16, obj* a17, obj* a18) {
+if (LEAN_UNLIKELY(lean_is_scalar(f))) { lean_dec(a1); lean_dec(a2); lean_dec(a3); lean_dec(a4); lean_dec(a5); lean_dec(a6); lean_dec(a7); lean_dec(a8); lean_dec(a9); lean_dec(a10); lean_dec(a11); lean_dec(a12); lean_dec(a13); lean_dec(a14); lean_dec(a15); lean_dec(a16); lean_dec(a17); lean_dec(a18); return f; } // f is an erased proof
+unsigned arity = lean_closure_arity(f);
+unsigned fixed = lean_closure_num_fixed(f);
+if (LEAN_LIKELY(arity == fixed + 18)) {
+  lean_assert(arity > 16);
+  obj * as[18] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18 };
+  CHECK_APPLY_STACK();
+  obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
+  for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
+  for (unsigned i = 0; i < 18; i++) args[fixed+i] = as[i];
+  obj * r = FNN(f)(args);
+  lean_dec_ref(f);
+  return r;
+} else if (arity < fixed + 18) {
+  obj * as[18] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18 };
+  CHECK_APPLY_STACK();
+  obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
+  for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
+  for (unsigned i = 0; i < arity-fixed; i++) args[fixed+i] = as[i];
+  obj * new_f = curry(f, arity, args);
+  lean_dec_ref(f);
+  return lean_apply_n(new_f, 18+fixed-arity, &as[arity-fixed]);
+} else {
+  return fix_args(f, { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18 });
+}
+}
+extern "C" LEAN_EXPORT obj* lean_apply_19(obj* f, obj* a1, obj* a2, obj* a3, obj* a4, obj* a5, obj* a6, obj* a7, obj* a8, obj* a9, obj* a10, obj* a11, obj* a12, obj* a13, obj* a14, obj* a15, obj* a16, obj* a17, obj* a18, obj* a19) {
+if (LEAN_UNLIKELY(lean_is_scalar(f))) { lean_dec(a1); lean_dec(a2); lean_dec(a3); lean_dec(a4); lean_dec(a5); lean_dec(a6); lean_dec(a7); lean_dec(a8); lean_dec(a9); lean_dec(a10); lean_dec(a11); lean_dec(a12); lean_dec(a13); lean_dec(a14); lean_dec(a15); lean_dec(a16); lean_dec(a17); lean_dec(a18); lean_dec(a19); return f; } // f is an erased proof
+unsigned arity = lean_closure_arity(f);
+unsigned fixed = lean_closure_num_fixed(f);
+if (LEAN_LIKELY(arity == fixed + 19)) {
+  lean_assert(arity > 16);
+  obj * as[19] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18, a19 };
+  CHECK_APPLY_STACK();
+  obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
+  for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
+  for (unsigned i = 0; i < 19; i++) args[fixed+i] = as[i];
+  obj * r = FNN(f)(args);
+  lean_dec_ref(f);
+  return r;
+} else if (arity < fixed + 19) {
+  obj * as[19] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18, a19 };
+  CHECK_APPLY_STACK();
+  obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
+  for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
+  for (unsigned i = 0; i < arity-fixed; i++) args[fixed+i] = as[i];
+  obj * new_f = curry(f, arity, args);
+  lean_dec_ref(f);
+  return lean_apply_n(new_f, 19+fixed-arity, &as[arity-fixed]);
+} else {
+  return fix_args(f, { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18, a19 });
+}
+}
+extern "C" LEAN_EXPORT obj* lean_apply_20(obj* f, obj* a1, obj* a2, obj* a3, obj* a4, obj* a5, obj* a6, obj* a7, obj* a8, obj* a9, obj* a10, obj* a11, obj* a12, obj* a13, obj* a14, obj* a15, obj* a16, obj* a17, obj* a18, obj* a19, obj* a20) {
+if (LEAN_UNLIKELY(lean_is_scalar(f))) { lean_dec(a1); lean_dec(a2); lean_dec(a3); lean_dec(a4); lean_dec(a5); lean_dec(a6); lean_dec(a7); lean_dec(a8); lean_dec(a9); lean_dec(a10); lean_dec(a11); lean_dec(a12); lean_dec(a13); lean_dec(a14); lean_dec(a15); lean_dec(a16); lean_dec(a17); lean_dec(a18); lean_dec(a19); lean_dec(a20); return f; } // f is an erased proof
+unsigned arity = lean_closure_arity(f);
+unsigned fixed = lean_closure_num_fixed(f);
+if (LEAN_LIKELY(arity == fixed + 20)) {
+  lean_assert(arity > 16);
+  obj * as[20] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18, a19, a20 };
+  CHECK_APPLY_STACK();
+  obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
+  for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
+  for (unsigned i = 0; i < 20; i++) args[fixed+i] = as[i];
+  obj * r = FNN(f)(args);
+  lean_dec_ref(f);
+  return r;
+} else if (arity < fixed + 20) {
+  obj * as[20] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18, a19, a20 };
+  CHECK_APPLY_STACK();
+  obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
+  for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
+  for (unsigned i = 0; i < arity-fixed; i++) args[fixed+i] = as[i];
+  obj * new_f = curry(f, arity, args);
+  lean_dec_ref(f);
+  return lean_apply_n(new_f, 20+fixed-arity, &as[arity-fixed]);
+} else {
+  return fix_args(f, { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18, a19, a20 });
+}
+}
+extern "C" LEAN_EXPORT obj* lean_apply_21(obj* f, obj* a1, obj* a2, obj* a3, obj* a4, obj* a5, obj* a6, obj* a7, obj* a8, obj* a9, obj* a10, obj* a11, obj* a12, obj* a13, obj* a14, obj* a15, obj* a16, obj* a17, obj* a18, obj* a19, obj* a20, obj* a21) {
+if (LEAN_UNLIKELY(lean_is_scalar(f))) { lean_dec(a1); lean_dec(a2); lean_dec(a3); lean_dec(a4); lean_dec(a5); lean_dec(a6); lean_dec(a7); lean_dec(a8); lean_dec(a9); lean_dec(a10); lean_dec(a11); lean_dec(a12); lean_dec(a13); lean_dec(a14); lean_dec(a15); lean_dec(a16); lean_dec(a17); lean_dec(a18); lean_dec(a19); lean_dec(a20); lean_dec(a21); return f; } // f is an erased proof
+unsigned arity = lean_closure_arity(f);
+unsigned fixed = lean_closure_num_fixed(f);
+if (LEAN_LIKELY(arity == fixed + 21)) {
+  lean_assert(arity > 16);
+  obj * as[21] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18, a19, a20, a21 };
+  CHECK_APPLY_STACK();
+  obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
+  for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
+  for (unsigned i = 0; i < 21; i++) args[fixed+i] = as[i];
+  obj * r = FNN(f)(args);
+  lean_dec_ref(f);
+  return r;
+} else if (arity < fixed + 21) {
+  obj * as[21] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18, a19, a20, a21 };
+  CHECK_APPLY_STACK();
+  obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
+  for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
+  for (unsigned i = 0; i < arity-fixed; i++) args[fixed+i] = as[i];
+  obj * new_f = curry(f, arity, args);
+  lean_dec_ref(f);
+  return lean_apply_n(new_f, 21+fixed-arity, &as[arity-fixed]);
+} else {
+  return fix_args(f, { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18, a19, a20, a21 });
+}
+}
+extern "C" LEAN_EXPORT obj* lean_apply_22(obj* f, obj* a1, obj* a2, obj* a3, obj* a4, obj* a5, obj* a6, obj* a7, obj* a8, obj* a9, obj* a10, obj* a11, obj* a12, obj* a13, obj* a14, obj* a15, obj* a16, obj* a17, obj* a18, obj* a19, obj* a20, obj* a21, obj* a22) {
+if (LEAN_UNLIKELY(lean_is_scalar(f))) { lean_dec(a1); lean_dec(a2); lean_dec(a3); lean_dec(a4); lean_dec(a5); lean_dec(a6); lean_dec(a7); lean_dec(a8); lean_dec(a9); lean_dec(a10); lean_dec(a11); lean_dec(a12); lean_dec(a13); lean_dec(a14); lean_dec(a15); lean_dec(a16); lean_dec(a17); lean_dec(a18); lean_dec(a19); lean_dec(a20); lean_dec(a21); lean_dec(a22); return f; } // f is an erased proof
+unsigned arity = lean_closure_arity(f);
+unsigned fixed = lean_closure_num_fixed(f);
+if (LEAN_LIKELY(arity == fixed + 22)) {
+  lean_assert(arity > 16);
+  obj * as[22] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18, a19, a20, a21, a22 };
+  CHECK_APPLY_STACK();
+  obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
+  for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
+  for (unsigned i = 0; i < 22; i++) args[fixed+i] = as[i];
+  obj * r = FNN(f)(args);
+  lean_dec_ref(f);
+  return r;
+} else if (arity < fixed + 22) {
+  obj * as[22] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18, a19, a20, a21, a22 };
+  CHECK_APPLY_STACK();
+  obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
+  for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
+  for (unsigned i = 0; i < arity-fixed; i++) args[fixed+i] = as[i];
+  obj * new_f = curry(f, arity, args);
+  lean_dec_ref(f);
+  return lean_apply_n(new_f, 22+fixed-arity, &as[arity-fixed]);
+} else {
+  return fix_args(f, { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18, a19, a20, a21, a22 });
+}
+}
+extern "C" LEAN_EXPORT obj* lean_apply_23(obj* f, obj* a1, obj* a2, obj* a3, obj* a4, obj* a5, obj* a6, obj* a7, obj* a8, obj* a9, obj* a10, obj* a11, obj* a12, obj* a13, obj* a14, obj* a15, obj* a16, obj* a17, obj* a18, obj* a19, obj* a20, obj* a21, obj* a22, obj* a23) {
+if (LEAN_UNLIKELY(lean_is_scalar(f))) { lean_dec(a1); lean_dec(a2); lean_dec(a3); lean_dec(a4); lean_dec(a5); lean_dec(a6); lean_dec(a7); lean_dec(a8); lean_dec(a9); lean_dec(a10); lean_dec(a11); lean_dec(a12); lean_dec(a13); lean_dec(a14); lean_dec(a15); lean_dec(a16); lean_dec(a17); lean_dec(a18); lean_dec(a19); lean_dec(a20); lean_dec(a21); lean_dec(a22); lean_dec(a23); return f; } // f is an erased proof
+unsigned arity = lean_closure_arity(f);
+unsigned fixed = lean_closure_num_fixed(f);
+if (LEAN_LIKELY(arity == fixed + 23)) {
+  lean_assert(arity > 16);
+  obj * as[23] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18, a19, a20, a21, a22, a23 };
+  CHECK_APPLY_STACK();
+  obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
+  for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
+  for (unsigned i = 0; i < 23; i++) args[fixed+i] = as[i];
+  obj * r = FNN(f)(args);
+  lean_dec_ref(f);
+  return r;
+} else if (arity < fixed + 23) {
+  obj * as[23] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18, a19, a20, a21, a22, a23 };
+  CHECK_APPLY_STACK();
+  obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
+  for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
+  for (unsigned i = 0; i < arity-fixed; i++) args[fixed+i] = as[i];
+  obj * new_f = curry(f, arity, args);
+  lean_dec_ref(f);
+  return lean_apply_n(new_f, 23+fixed-arity, &as[arity-fixed]);
+} else {
+  return fix_args(f, { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18, a19, a20, a21, a22, a23 });
+}
+}
+extern "C" LEAN_EXPORT obj* lean_apply_24(obj* f, obj* a1, obj* a2, obj* a3, obj* a4, obj* a5, obj* a6, obj* a7, obj* a8, obj* a9, obj* a10, obj* a11, obj* a12, obj* a13, obj* a14, obj* a15, obj* a16, obj* a17, obj* a18, obj* a19, obj* a20, obj* a21, obj* a22, obj* a23, obj* a24) {
+if (LEAN_UNLIKELY(lean_is_scalar(f))) { lean_dec(a1); lean_dec(a2); lean_dec(a3); lean_dec(a4); lean_dec(a5); lean_dec(a6); lean_dec(a7); lean_dec(a8); lean_dec(a9); lean_dec(a10); lean_dec(a11); lean_dec(a12); lean_dec(a13); lean_dec(a14); lean_dec(a15); lean_dec(a16); lean_dec(a17); lean_dec(a18); lean_dec(a19); lean_dec(a20); lean_dec(a21); lean_dec(a22); lean_dec(a23); lean_dec(a24); return f; } // f is an erased proof
+unsigned arity = lean_closure_arity(f);
+unsigned fixed = lean_closure_num_fixed(f);
+if (LEAN_LIKELY(arity == fixed + 24)) {
+  lean_assert(arity > 16);
+  obj * as[24] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18, a19, a20, a21, a22, a23, a24 };
+  CHECK_APPLY_STACK();
+  obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
+  for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
+  for (unsigned i = 0; i < 24; i++) args[fixed+i] = as[i];
+  obj * r = FNN(f)(args);
+  lean_dec_ref(f);
+  return r;
+} else if (arity < fixed + 24) {
+  obj * as[24] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18, a19, a20, a21, a22, a23, a24 };
+  CHECK_APPLY_STACK();
+  obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
+  for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
+  for (unsigned i = 0; i < arity-fixed; i++) args[fixed+i] = as[i];
+  obj * new_f = curry(f, arity, args);
+  lean_dec_ref(f);
+  return lean_apply_n(new_f, 24+fixed-arity, &as[arity-fixed]);
+} else {
+  return fix_args(f, { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18, a19, a20, a21, a22, a23, a24 });
+}
+}
+extern "C" LEAN_EXPORT obj* lean_apply_25(obj* f, obj* a1, obj* a2, obj* a3, obj* a4, obj* a5, obj* a6, obj* a7, obj* a8, obj* a9, obj* a10, obj* a11, obj* a12, obj* a13, obj* a14, obj* a15, obj* a16, obj* a17, obj* a18, obj* a19, obj* a20, obj* a21, obj* a22, obj* a23, obj* a24, obj* a25) {
+if (LEAN_UNLIKELY(lean_is_scalar(f))) { lean_dec(a1); lean_dec(a2); lean_dec(a3); lean_dec(a4); lean_dec(a5); lean_dec(a6); lean_dec(a7); lean_dec(a8); lean_dec(a9); lean_dec(a10); lean_dec(a11); lean_dec(a12); lean_dec(a13); lean_dec(a14); lean_dec(a15); lean_dec(a16); lean_dec(a17); lean_dec(a18); lean_dec(a19); lean_dec(a20); lean_dec(a21); lean_dec(a22); lean_dec(a23); lean_dec(a24); lean_dec(a25); return f; } // f is an erased proof
+unsigned arity = lean_closure_arity(f);
+unsigned fixed = lean_closure_num_fixed(f);
+if (LEAN_LIKELY(arity == fixed + 25)) {
+  lean_assert(arity > 16);
+  obj * as[25] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18, a19, a20, a21, a22, a23, a24, a25 };
+  CHECK_APPLY_STACK();
+  obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
+  for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
+  for (unsigned i = 0; i < 25; i++) args[fixed+i] = as[i];
+  obj * r = FNN(f)(args);
+  lean_dec_ref(f);
+  return r;
+} else if (arity < fixed + 25) {
+  obj * as[25] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18, a19, a20, a21, a22, a23, a24, a25 };
+  CHECK_APPLY_STACK();
+  obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
+  for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
+  for (unsigned i = 0; i < arity-fixed; i++) args[fixed+i] = as[i];
+  obj * new_f = curry(f, arity, args);
+  lean_dec_ref(f);
+  return lean_apply_n(new_f, 25+fixed-arity, &as[arity-fixed]);
+} else {
+  return fix_args(f, { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18, a19, a20, a21, a22, a23, a24, a25 });
+}
+}
+extern "C" LEAN_EXPORT obj* lean_apply_26(obj* f, obj* a1, obj* a2, obj* a3, obj* a4, obj* a5, obj* a6, obj* a7, obj* a8, obj* a9, obj* a10, obj* a11, obj* a12, obj* a13, obj* a14, obj* a15, obj* a16, obj* a17, obj* a18, obj* a19, obj* a20, obj* a21, obj* a22, obj* a23, obj* a24, obj* a25, obj* a26) {
+if (LEAN_UNLIKELY(lean_is_scalar(f))) { lean_dec(a1); lean_dec(a2); lean_dec(a3); lean_dec(a4); lean_dec(a5); lean_dec(a6); lean_dec(a7); lean_dec(a8); lean_dec(a9); lean_dec(a10); lean_dec(a11); lean_dec(a12); lean_dec(a13); lean_dec(a14); lean_dec(a15); lean_dec(a16); lean_dec(a17); lean_dec(a18); lean_dec(a19); lean_dec(a20); lean_dec(a21); lean_dec(a22); lean_dec(a23); lean_dec(a24); lean_dec(a25); lean_dec(a26); return f; } // f is an erased proof
+unsigned arity = lean_closure_arity(f);
+unsigned fixed = lean_closure_num_fixed(f);
+if (LEAN_LIKELY(arity == fixed + 26)) {
+  lean_assert(arity > 16);
+  obj * as[26] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18, a19, a20, a21, a22, a23, a24, a25, a26 };
+  CHECK_APPLY_STACK();
+  obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
+  for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
+  for (unsigned i = 0; i < 26; i++) args[fixed+i] = as[i];
+  obj * r = FNN(f)(args);
+  lean_dec_ref(f);
+  return r;
+} else if (arity < fixed + 26) {
+  obj * as[26] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18, a19, a20, a21, a22, a23, a24, a25, a26 };
+  CHECK_APPLY_STACK();
+  obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
+  for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
+  for (unsigned i = 0; i < arity-fixed; i++) args[fixed+i] = as[i];
+  obj * new_f = curry(f, arity, args);
+  lean_dec_ref(f);
+  return lean_apply_n(new_f, 26+fixed-arity, &as[arity-fixed]);
+} else {
+  return fix_args(f, { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18, a19, a20, a21, a22, a23, a24, a25, a26 });
+}
+}
+extern "C" LEAN_EXPORT obj* lean_apply_27(obj* f, obj* a1, obj* a2, obj* a3, obj* a4, obj* a5, obj* a6, obj* a7, obj* a8, obj* a9, obj* a10, obj* a11, obj* a12, obj* a13, obj* a14, obj* a15, obj* a16, obj* a17, obj* a18, obj* a19, obj* a20, obj* a21, obj* a22, obj* a23, obj* a24, obj* a25, obj* a26, obj* a27) {
+if (LEAN_UNLIKELY(lean_is_scalar(f))) { lean_dec(a1); lean_dec(a2); lean_dec(a3); lean_dec(a4); lean_dec(a5); lean_dec(a6); lean_dec(a7); lean_dec(a8); lean_dec(a9); lean_dec(a10); lean_dec(a11); lean_dec(a12); lean_dec(a13); lean_dec(a14); lean_dec(a15); lean_dec(a16); lean_dec(a17); lean_dec(a18); lean_dec(a19); lean_dec(a20); lean_dec(a21); lean_dec(a22); lean_dec(a23); lean_dec(a24); lean_dec(a25); lean_dec(a26); lean_dec(a27); return f; } // f is an erased proof
+unsigned arity = lean_closure_arity(f);
+unsigned fixed = lean_closure_num_fixed(f);
+if (LEAN_LIKELY(arity == fixed + 27)) {
+  lean_assert(arity > 16);
+  obj * as[27] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18, a19, a20, a21, a22, a23, a24, a25, a26, a27 };
+  CHECK_APPLY_STACK();
+  obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
+  for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
+  for (unsigned i = 0; i < 27; i++) args[fixed+i] = as[i];
+  obj * r = FNN(f)(args);
+  lean_dec_ref(f);
+  return r;
+} else if (arity < fixed + 27) {
+  obj * as[27] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18, a19, a20, a21, a22, a23, a24, a25, a26, a27 };
+  CHECK_APPLY_STACK();
+  obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
+  for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
+  for (unsigned i = 0; i < arity-fixed; i++) args[fixed+i] = as[i];
+  obj * new_f = curry(f, arity, args);
+  lean_dec_ref(f);
+  return lean_apply_n(new_f, 27+fixed-arity, &as[arity-fixed]);
+} else {
+  return fix_args(f, { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18, a19, a20, a21, a22, a23, a24, a25, a26, a27 });
+}
+}
+extern "C" LEAN_EXPORT obj* lean_apply_28(obj* f, obj* a1, obj* a2, obj* a3, obj* a4, obj* a5, obj* a6, obj* a7, obj* a8, obj* a9, obj* a10, obj* a11, obj* a12, obj* a13, obj* a14, obj* a15, obj* a16, obj* a17, obj* a18, obj* a19, obj* a20, obj* a21, obj* a22, obj* a23, obj* a24, obj* a25, obj* a26, obj* a27, obj* a28) {
+if (LEAN_UNLIKELY(lean_is_scalar(f))) { lean_dec(a1); lean_dec(a2); lean_dec(a3); lean_dec(a4); lean_dec(a5); lean_dec(a6); lean_dec(a7); lean_dec(a8); lean_dec(a9); lean_dec(a10); lean_dec(a11); lean_dec(a12); lean_dec(a13); lean_dec(a14); lean_dec(a15); lean_dec(a16); lean_dec(a17); lean_dec(a18); lean_dec(a19); lean_dec(a20); lean_dec(a21); lean_dec(a22); lean_dec(a23); lean_dec(a24); lean_dec(a25); lean_dec(a26); lean_dec(a27); lean_dec(a28); return f; } // f is an erased proof
+unsigned arity = lean_closure_arity(f);
+unsigned fixed = lean_closure_num_fixed(f);
+if (LEAN_LIKELY(arity == fixed + 28)) {
+  lean_assert(arity > 16);
+  obj * as[28] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18, a19, a20, a21, a22, a23, a24, a25, a26, a27, a28 };
+  CHECK_APPLY_STACK();
+  obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
+  for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
+  for (unsigned i = 0; i < 28; i++) args[fixed+i] = as[i];
+  obj * r = FNN(f)(args);
+  lean_dec_ref(f);
+  return r;
+} else if (arity < fixed + 28) {
+  obj * as[28] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18, a19, a20, a21, a22, a23, a24, a25, a26, a27, a28 };
+  CHECK_APPLY_STACK();
+  obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
+  for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
+  for (unsigned i = 0; i < arity-fixed; i++) args[fixed+i] = as[i];
+  obj * new_f = curry(f, arity, args);
+  lean_dec_ref(f);
+  return lean_apply_n(new_f, 28+fixed-arity, &as[arity-fixed]);
+} else {
+  return fix_args(f, { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18, a19, a20, a21, a22, a23, a24, a25, a26, a27, a28 });
+}
+}
+extern "C" LEAN_EXPORT obj* lean_apply_29(obj* f, obj* a1, obj* a2, obj* a3, obj* a4, obj* a5, obj* a6, obj* a7, obj* a8, obj* a9, obj* a10, obj* a11, obj* a12, obj* a13, obj* a14, obj* a15, obj* a16, obj* a17, obj* a18, obj* a19, obj* a20, obj* a21, obj* a22, obj* a23, obj* a24, obj* a25, obj* a26, obj* a27, obj* a28, obj* a29) {
+if (LEAN_UNLIKELY(lean_is_scalar(f))) { lean_dec(a1); lean_dec(a2); lean_dec(a3); lean_dec(a4); lean_dec(a5); lean_dec(a6); lean_dec(a7); lean_dec(a8); lean_dec(a9); lean_dec(a10); lean_dec(a11); lean_dec(a12); lean_dec(a13); lean_dec(a14); lean_dec(a15); lean_dec(a16); lean_dec(a17); lean_dec(a18); lean_dec(a19); lean_dec(a20); lean_dec(a21); lean_dec(a22); lean_dec(a23); lean_dec(a24); lean_dec(a25); lean_dec(a26); lean_dec(a27); lean_dec(a28); lean_dec(a29); return f; } // f is an erased proof
+unsigned arity = lean_closure_arity(f);
+unsigned fixed = lean_closure_num_fixed(f);
+if (LEAN_LIKELY(arity == fixed + 29)) {
+  lean_assert(arity > 16);
+  obj * as[29] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18, a19, a20, a21, a22, a23, a24, a25, a26, a27, a28, a29 };
+  CHECK_APPLY_STACK();
+  obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
+  for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
+  for (unsigned i = 0; i < 29; i++) args[fixed+i] = as[i];
+  obj * r = FNN(f)(args);
+  lean_dec_ref(f);
+  return r;
+} else if (arity < fixed + 29) {
+  obj * as[29] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18, a19, a20, a21, a22, a23, a24, a25, a26, a27, a28, a29 };
+  CHECK_APPLY_STACK();
+  obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
+  for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
+  for (unsigned i = 0; i < arity-fixed; i++) args[fixed+i] = as[i];
+  obj * new_f = curry(f, arity, args);
+  lean_dec_ref(f);
+  return lean_apply_n(new_f, 29+fixed-arity, &as[arity-fixed]);
+} else {
+  return fix_args(f, { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18, a19, a20, a21, a22, a23, a24, a25, a26, a27, a28, a29 });
+}
+}
+extern "C" LEAN_EXPORT obj* lean_apply_30(obj* f, obj* a1, obj* a2, obj* a3, obj* a4, obj* a5, obj* a6, obj* a7, obj* a8, obj* a9, obj* a10, obj* a11, obj* a12, obj* a13, obj* a14, obj* a15, obj* a16, obj* a17, obj* a18, obj* a19, obj* a20, obj* a21, obj* a22, obj* a23, obj* a24, obj* a25, obj* a26, obj* a27, obj* a28, obj* a29, obj* a30) {
+if (LEAN_UNLIKELY(lean_is_scalar(f))) { lean_dec(a1); lean_dec(a2); lean_dec(a3); lean_dec(a4); lean_dec(a5); lean_dec(a6); lean_dec(a7); lean_dec(a8); lean_dec(a9); lean_dec(a10); lean_dec(a11); lean_dec(a12); lean_dec(a13); lean_dec(a14); lean_dec(a15); lean_dec(a16); lean_dec(a17); lean_dec(a18); lean_dec(a19); lean_dec(a20); lean_dec(a21); lean_dec(a22); lean_dec(a23); lean_dec(a24); lean_dec(a25); lean_dec(a26); lean_dec(a27); lean_dec(a28); lean_dec(a29); lean_dec(a30); return f; } // f is an erased proof
+unsigned arity = lean_closure_arity(f);
+unsigned fixed = lean_closure_num_fixed(f);
+if (LEAN_LIKELY(arity == fixed + 30)) {
+  lean_assert(arity > 16);
+  obj * as[30] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18, a19, a20, a21, a22, a23, a24, a25, a26, a27, a28, a29, a30 };
+  CHECK_APPLY_STACK();
+  obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
+  for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
+  for (unsigned i = 0; i < 30; i++) args[fixed+i] = as[i];
+  obj * r = FNN(f)(args);
+  lean_dec_ref(f);
+  return r;
+} else if (arity < fixed + 30) {
+  obj * as[30] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18, a19, a20, a21, a22, a23, a24, a25, a26, a27, a28, a29, a30 };
+  CHECK_APPLY_STACK();
+  obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
+  for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
+  for (unsigned i = 0; i < arity-fixed; i++) args[fixed+i] = as[i];
+  obj * new_f = curry(f, arity, args);
+  lean_dec_ref(f);
+  return lean_apply_n(new_f, 30+fixed-arity, &as[arity-fixed]);
+} else {
+  return fix_args(f, { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18, a19, a20, a21, a22, a23, a24, a25, a26, a27, a28, a29, a30 });
+}
+}
+extern "C" LEAN_EXPORT obj* lean_apply_31(obj* f, obj* a1, obj* a2, obj* a3, obj* a4, obj* a5, obj* a6, obj* a7, obj* a8, obj* a9, obj* a10, obj* a11, obj* a12, obj* a13, obj* a14, obj* a15, obj* a16, obj* a17, obj* a18, obj* a19, obj* a20, obj* a21, obj* a22, obj* a23, obj* a24, obj* a25, obj* a26, obj* a27, obj* a28, obj* a29, obj* a30, obj* a31) {
+if (LEAN_UNLIKELY(lean_is_scalar(f))) { lean_dec(a1); lean_dec(a2); lean_dec(a3); lean_dec(a4); lean_dec(a5); lean_dec(a6); lean_dec(a7); lean_dec(a8); lean_dec(a9); lean_dec(a10); lean_dec(a11); lean_dec(a12); lean_dec(a13); lean_dec(a14); lean_dec(a15); lean_dec(a16); lean_dec(a17); lean_dec(a18); lean_dec(a19); lean_dec(a20); lean_dec(a21); lean_dec(a22); lean_dec(a23); lean_dec(a24); lean_dec(a25); lean_dec(a26); lean_dec(a27); lean_dec(a28); lean_dec(a29); lean_dec(a30); lean_dec(a31); return f; } // f is an erased proof
+unsigned arity = lean_closure_arity(f);
+unsigned fixed = lean_closure_num_fixed(f);
+if (LEAN_LIKELY(arity == fixed + 31)) {
+  lean_assert(arity > 16);
+  obj * as[31] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18, a19, a20, a21, a22, a23, a24, a25, a26, a27, a28, a29, a30, a31 };
+  CHECK_APPLY_STACK();
+  obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
+  for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
+  for (unsigned i = 0; i < 31; i++) args[fixed+i] = as[i];
+  obj * r = FNN(f)(args);
+  lean_dec_ref(f);
+  return r;
+} else if (arity < fixed + 31) {
+  obj * as[31] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18, a19, a20, a21, a22, a23, a24, a25, a26, a27, a28, a29, a30, a31 };
+  CHECK_APPLY_STACK();
+  obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
+  for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
+  for (unsigned i = 0; i < arity-fixed; i++) args[fixed+i] = as[i];
+  obj * new_f = curry(f, arity, args);
+  lean_dec_ref(f);
+  return lean_apply_n(new_f, 31+fixed-arity, &as[arity-fixed]);
+} else {
+  return fix_args(f, { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18, a19, a20, a21, a22, a23, a24, a25, a26, a27, a28, a29, a30, a31 });
+}
+}
+extern "C" LEAN_EXPORT obj* lean_apply_32(obj* f, obj* a1, obj* a2, obj* a3, obj* a4, obj* a5, obj* a6, obj* a7, obj* a8, obj* a9, obj* a10, obj* a11, obj* a12, obj* a13, obj* a14, obj* a15, obj* a16, obj* a17, obj* a18, obj* a19, obj* a20, obj* a21, obj* a22, obj* a23, obj* a24, obj* a25, obj* a26, obj* a27, obj* a28, obj* a29, obj* a30, obj* a31, obj* a32) {
+if (LEAN_UNLIKELY(lean_is_scalar(f))) { lean_dec(a1); lean_dec(a2); lean_dec(a3); lean_dec(a4); lean_dec(a5); lean_dec(a6); lean_dec(a7); lean_dec(a8); lean_dec(a9); lean_dec(a10); lean_dec(a11); lean_dec(a12); lean_dec(a13); lean_dec(a14); lean_dec(a15); lean_dec(a16); lean_dec(a17); lean_dec(a18); lean_dec(a19); lean_dec(a20); lean_dec(a21); lean_dec(a22); lean_dec(a23); lean_dec(a24); lean_dec(a25); lean_dec(a26); lean_dec(a27); lean_dec(a28); lean_dec(a29); lean_dec(a30); lean_dec(a31); lean_dec(a32); return f; } // f is an erased proof
+unsigned arity = lean_closure_arity(f);
+unsigned fixed = lean_closure_num_fixed(f);
+if (LEAN_LIKELY(arity == fixed + 32)) {
+  lean_assert(arity > 16);
+  obj * as[32] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18, a19, a20, a21, a22, a23, a24, a25, a26, a27, a28, a29, a30, a31, a32 };
+  CHECK_APPLY_STACK();
+  obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
+  for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
+  for (unsigned i = 0; i < 32; i++) args[fixed+i] = as[i];
+  obj * r = FNN(f)(args);
+  lean_dec_ref(f);
+  return r;
+} else if (arity < fixed + 32) {
+  obj * as[32] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18, a19, a20, a21, a22, a23, a24, a25, a26, a27, a28, a29, a30, a31, a32 };
+  CHECK_APPLY_STACK();
+  obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
+  for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
+  for (unsigned i = 0; i < arity-fixed; i++) args[fixed+i] = as[i];
+  obj * new_f = curry(f, arity, args);
+  lean_dec_ref(f);
+  return lean_apply_n(new_f, 32+fixed-arity, &as[arity-fixed]);
+} else {
+  return fix_args(f, { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18, a19, a20, a21, a22, a23, a24, a25, a26, a27, a28, a29, a30, a31, a32 });
+}
+}
 extern "C" LEAN_EXPORT obj* lean_apply_m(obj* f, unsigned n, obj** as) {
 lean_assert(n > 16);
-if (lean_is_scalar(f)) { for (unsigned i = 0; i < n; i++) { lean_dec(as[i]); } return f; } // f is an erased proof
+if (LEAN_UNLIKELY(lean_is_scalar(f))) { for (unsigned i = 0; i < n; i++) { lean_dec(as[i]); } return f; } // f is an erased proof
 unsigned arity = lean_closure_arity(f);
 unsigned fixed = lean_closure_num_fixed(f);
-if (arity == fixed + n) {
+if (LEAN_LIKELY(arity == fixed + n)) {
+  CHECK_APPLY_STACK();
   obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
   for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
   for (unsigned i = 0; i < n; i++) args[fixed+i] = as[i];
@@ -890,6 +1380,7 @@ if (arity == fixed + n) {
   lean_dec_ref(f);
   return r;
 } else if (arity < fixed + n) {
+  CHECK_APPLY_STACK();
   obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
   for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
   for (unsigned i = 0; i < arity-fixed; i++) args[fixed+i] = as[i];
@@ -919,7 +1410,42 @@ case 13: return lean_apply_13(f, as[0], as[1], as[2], as[3], as[4], as[5], as[6]
 case 14: return lean_apply_14(f, as[0], as[1], as[2], as[3], as[4], as[5], as[6], as[7], as[8], as[9], as[10], as[11], as[12], as[13]);
 case 15: return lean_apply_15(f, as[0], as[1], as[2], as[3], as[4], as[5], as[6], as[7], as[8], as[9], as[10], as[11], as[12], as[13], as[14]);
 case 16: return lean_apply_16(f, as[0], as[1], as[2], as[3], as[4], as[5], as[6], as[7], as[8], as[9], as[10], as[11], as[12], as[13], as[14], as[15]);
+case 17: return lean_apply_17(f, as[0], as[1], as[2], as[3], as[4], as[5], as[6], as[7], as[8], as[9], as[10], as[11], as[12], as[13], as[14], as[15], as[16]);
+case 18: return lean_apply_18(f, as[0], as[1], as[2], as[3], as[4], as[5], as[6], as[7], as[8], as[9], as[10], as[11], as[12], as[13], as[14], as[15], as[16], as[17]);
+case 19: return lean_apply_19(f, as[0], as[1], as[2], as[3], as[4], as[5], as[6], as[7], as[8], as[9], as[10], as[11], as[12], as[13], as[14], as[15], as[16], as[17], as[18]);
+case 20: return lean_apply_20(f, as[0], as[1], as[2], as[3], as[4], as[5], as[6], as[7], as[8], as[9], as[10], as[11], as[12], as[13], as[14], as[15], as[16], as[17], as[18], as[19]);
+case 21: return lean_apply_21(f, as[0], as[1], as[2], as[3], as[4], as[5], as[6], as[7], as[8], as[9], as[10], as[11], as[12], as[13], as[14], as[15], as[16], as[17], as[18], as[19], as[20]);
+case 22: return lean_apply_22(f, as[0], as[1], as[2], as[3], as[4], as[5], as[6], as[7], as[8], as[9], as[10], as[11], as[12], as[13], as[14], as[15], as[16], as[17], as[18], as[19], as[20], as[21]);
+case 23: return lean_apply_23(f, as[0], as[1], as[2], as[3], as[4], as[5], as[6], as[7], as[8], as[9], as[10], as[11], as[12], as[13], as[14], as[15], as[16], as[17], as[18], as[19], as[20], as[21], as[22]);
+case 24: return lean_apply_24(f, as[0], as[1], as[2], as[3], as[4], as[5], as[6], as[7], as[8], as[9], as[10], as[11], as[12], as[13], as[14], as[15], as[16], as[17], as[18], as[19], as[20], as[21], as[22], as[23]);
+case 25: return lean_apply_25(f, as[0], as[1], as[2], as[3], as[4], as[5], as[6], as[7], as[8], as[9], as[10], as[11], as[12], as[13], as[14], as[15], as[16], as[17], as[18], as[19], as[20], as[21], as[22], as[23], as[24]);
+case 26: return lean_apply_26(f, as[0], as[1], as[2], as[3], as[4], as[5], as[6], as[7], as[8], as[9], as[10], as[11], as[12], as[13], as[14], as[15], as[16], as[17], as[18], as[19], as[20], as[21], as[22], as[23], as[24], as[25]);
+case 27: return lean_apply_27(f, as[0], as[1], as[2], as[3], as[4], as[5], as[6], as[7], as[8], as[9], as[10], as[11], as[12], as[13], as[14], as[15], as[16], as[17], as[18], as[19], as[20], as[21], as[22], as[23], as[24], as[25], as[26]);
+case 28: return lean_apply_28(f, as[0], as[1], as[2], as[3], as[4], as[5], as[6], as[7], as[8], as[9], as[10], as[11], as[12], as[13], as[14], as[15], as[16], as[17], as[18], as[19], as[20], as[21], as[22], as[23], as[24], as[25], as[26], as[27]);
+case 29: return lean_apply_29(f, as[0], as[1], as[2], as[3], as[4], as[5], as[6], as[7], as[8], as[9], as[10], as[11], as[12], as[13], as[14], as[15], as[16], as[17], as[18], as[19], as[20], as[21], as[22], as[23], as[24], as[25], as[26], as[27], as[28]);
+case 30: return lean_apply_30(f, as[0], as[1], as[2], as[3], as[4], as[5], as[6], as[7], as[8], as[9], as[10], as[11], as[12], as[13], as[14], as[15], as[16], as[17], as[18], as[19], as[20], as[21], as[22], as[23], as[24], as[25], as[26], as[27], as[28], as[29]);
+case 31: return lean_apply_31(f, as[0], as[1], as[2], as[3], as[4], as[5], as[6], as[7], as[8], as[9], as[10], as[11], as[12], as[13], as[14], as[15], as[16], as[17], as[18], as[19], as[20], as[21], as[22], as[23], as[24], as[25], as[26], as[27], as[28], as[29], as[30]);
+case 32: return lean_apply_32(f, as[0], as[1], as[2], as[3], as[4], as[5], as[6], as[7], as[8], as[9], as[10], as[11], as[12], as[13], as[14], as[15], as[16], as[17], as[18], as[19], as[20], as[21], as[22], as[23], as[24], as[25], as[26], as[27], as[28], as[29], as[30], as[31]);
 default: return lean_apply_m(f, n, as);
 }
 }
+/* Direct call for applications whose argument count is statically known (e.g. the IR
+   interpreter's `Ap` evaluation). When the application exactly saturates a closure with
+   no fixed arguments, the native function pointer is invoked through `curry` right away,
+   skipping the per-call arity dispatch and fixed-argument bookkeeping of `lean_apply_n`;
+   any other shape falls back to the general path. */
+extern "C" LEAN_EXPORT obj* lean_closure_direct_call_n(obj* f, unsigned n, obj** as) {
+if (LEAN_LIKELY(!lean_is_scalar(f) && lean_closure_num_fixed(f) == 0 && lean_closure_arity(f) == n)) {
+  if (lean_is_exclusive(f)) {
+    void * fn = lean_closure_fun(f);
+    lean_free_small_object(f);
+    return curry(fn, n, as);
+  } else {
+    obj * r = curry(f, n, as);
+    lean_dec_ref(f);
+    return r;
+  }
+}
+return lean_apply_n(f, n, as);
+}
 }
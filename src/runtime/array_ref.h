@@ -20,7 +20,14 @@ template<typename C> object * to_array(C const & elems) {
     return a;
 }
 
-/* Wrapper for manipulating Lean Arrays in C++ */
+/* Wrapper for manipulating Lean Arrays in C++.
+
+   Read-only traversal is borrowed: `operator[]` and the iterator hand out
+   `T const &` views directly into the array cells (reinterpreting the stored
+   `object *`), so neither performs any reference-count operation. Copying the
+   element into a `T` is what bumps the count; take `T const &` in consumer
+   loops (as e.g. the IR interpreter does for `fn_body` argument arrays) to
+   keep traversal RC-free. */
 template<typename T>
 class array_ref : public object_ref {
 public:
@@ -0,0 +1,188 @@
+/*
+Copyright (c) 2023 Microsoft Corporation. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#include <chrono>
+#include <cstdio>
+#include <lean/lean.h>
+#include "runtime/init_module.h"
+
+/* Micro-benchmark harness for the runtime primitives (`leanruntime-bench`).
+
+   Each benchmark is a plain loop over the C API of libleanrt: allocator size
+   classes, closure application at every direct-call arity, array push/pop,
+   string building and task spawn/join. The harness runs each loop three times
+   after a warmup round and reports the best ns/op as one JSON object per
+   benchmark, so runs can be tracked across commits and toolchains:
+
+       $ make leanruntime-bench && ./runtime/leanruntime-bench
+
+   The harness is deliberately self-contained (steady_clock + best-of-three)
+   instead of depending on an external benchmark framework; the runtime links
+   against nothing but libc, libstdc++ and GMP, and its benchmark driver should
+   not change that. */
+
+namespace {
+
+template<unsigned NumFields> void bench_alloc_ctor(size_t iters) {
+    for (size_t i = 0; i < iters; i++) {
+        lean_object * o = lean_alloc_ctor(0, NumFields, 0);
+        for (unsigned j = 0; j < NumFields; j++)
+            lean_ctor_set(o, j, lean_box(j));
+        lean_dec(o);
+    }
+}
+
+/* One callback per direct-call arity of the application dispatch in apply.cpp.
+   All arguments are boxed scalars, so there is nothing to release. */
+static lean_object * fn1(lean_object *) { return lean_box(0); }
+static lean_object * fn2(lean_object *, lean_object *) { return lean_box(0); }
+static lean_object * fn3(lean_object *, lean_object *, lean_object *) { return lean_box(0); }
+static lean_object * fn4(lean_object *, lean_object *, lean_object *, lean_object *) { return lean_box(0); }
+static lean_object * fn5(lean_object *, lean_object *, lean_object *, lean_object *, lean_object *) { return lean_box(0); }
+static lean_object * fn6(lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *) { return lean_box(0); }
+static lean_object * fn7(lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *) { return lean_box(0); }
+static lean_object * fn8(lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *) { return lean_box(0); }
+static lean_object * fn9(lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *) { return lean_box(0); }
+static lean_object * fn10(lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *) { return lean_box(0); }
+static lean_object * fn11(lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *) { return lean_box(0); }
+static lean_object * fn12(lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *) { return lean_box(0); }
+static lean_object * fn13(lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *) { return lean_box(0); }
+static lean_object * fn14(lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *) { return lean_box(0); }
+static lean_object * fn15(lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *) { return lean_box(0); }
+static lean_object * fn16(lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *, lean_object *) { return lean_box(0); }
+
+void * const g_apply_fns[17] = {
+    nullptr,
+    (void*)fn1,  (void*)fn2,  (void*)fn3,  (void*)fn4,
+    (void*)fn5,  (void*)fn6,  (void*)fn7,  (void*)fn8,
+    (void*)fn9,  (void*)fn10, (void*)fn11, (void*)fn12,
+    (void*)fn13, (void*)fn14, (void*)fn15, (void*)fn16
+};
+
+template<unsigned Arity> void bench_apply(size_t iters) {
+    lean_object * f = lean_alloc_closure(g_apply_fns[Arity], Arity, 0);
+    for (size_t i = 0; i < iters; i++) {
+        lean_object * args[Arity];
+        for (unsigned j = 0; j < Arity; j++)
+            args[j] = lean_box(j);
+        lean_inc(f);
+        lean_dec(lean_apply_n(f, Arity, args));
+    }
+    lean_dec(f);
+}
+
+void bench_array_push_pop(size_t iters) {
+    size_t const block = 256;
+    for (size_t i = 0; i < iters; i += block) {
+        lean_object * a = lean_mk_empty_array();
+        for (size_t j = 0; j < block; j++)
+            a = lean_array_push(a, lean_box(j));
+        for (size_t j = 0; j < block; j++)
+            a = lean_array_pop(a);
+        lean_dec(a);
+    }
+}
+
+void bench_string_append(size_t iters) {
+    size_t const block = 1024; /* restart so the string stays cache-sized */
+    lean_object * frag = lean_mk_string("0123456789abcdef");
+    lean_object * s    = lean_mk_string("");
+    for (size_t i = 0; i < iters; i++) {
+        if (i % block == 0) {
+            lean_dec(s);
+            s = lean_mk_string("");
+        }
+        s = lean_string_append(s, frag);
+    }
+    lean_dec(s);
+    lean_dec(frag);
+}
+
+void bench_string_push(size_t iters) {
+    size_t const block = 4096;
+    lean_object * s = lean_mk_string("");
+    for (size_t i = 0; i < iters; i++) {
+        if (i % block == 0) {
+            lean_dec(s);
+            s = lean_mk_string("");
+        }
+        s = lean_string_push(s, 'x');
+    }
+    lean_dec(s);
+}
+
+void bench_task_spawn_join(size_t iters) {
+    for (size_t i = 0; i < iters; i++) {
+        lean_object * c = lean_alloc_closure(g_apply_fns[1], 1, 0);
+        lean_object * t = lean_task_spawn_core(c, 0, false);
+        lean_dec(lean_task_get_own(t));
+    }
+}
+
+struct bench_entry {
+    char const * m_name;
+    void       (*m_op)(size_t);
+    size_t       m_iters;
+};
+
+bench_entry const g_benchmarks[] = {
+    {"alloc_ctor_1",    bench_alloc_ctor<1>,  1 << 22},
+    {"alloc_ctor_2",    bench_alloc_ctor<2>,  1 << 22},
+    {"alloc_ctor_4",    bench_alloc_ctor<4>,  1 << 22},
+    {"alloc_ctor_6",    bench_alloc_ctor<6>,  1 << 22},
+    {"alloc_ctor_8",    bench_alloc_ctor<8>,  1 << 21},
+    {"apply_arity_1",   bench_apply<1>,       1 << 21},
+    {"apply_arity_2",   bench_apply<2>,       1 << 21},
+    {"apply_arity_3",   bench_apply<3>,       1 << 21},
+    {"apply_arity_4",   bench_apply<4>,       1 << 21},
+    {"apply_arity_5",   bench_apply<5>,       1 << 21},
+    {"apply_arity_6",   bench_apply<6>,       1 << 21},
+    {"apply_arity_7",   bench_apply<7>,       1 << 21},
+    {"apply_arity_8",   bench_apply<8>,       1 << 21},
+    {"apply_arity_9",   bench_apply<9>,       1 << 20},
+    {"apply_arity_10",  bench_apply<10>,      1 << 20},
+    {"apply_arity_11",  bench_apply<11>,      1 << 20},
+    {"apply_arity_12",  bench_apply<12>,      1 << 20},
+    {"apply_arity_13",  bench_apply<13>,      1 << 20},
+    {"apply_arity_14",  bench_apply<14>,      1 << 20},
+    {"apply_arity_15",  bench_apply<15>,      1 << 20},
+    {"apply_arity_16",  bench_apply<16>,      1 << 20},
+    {"array_push_pop",  bench_array_push_pop, 1 << 21},
+    {"string_append",   bench_string_append,  1 << 20},
+    {"string_push",     bench_string_push,    1 << 21},
+    {"task_spawn_join", bench_task_spawn_join, 1 << 14},
+};
+
+double measure_ns_per_op(bench_entry const & b) {
+    b.m_op(b.m_iters / 16 + 1); /* warmup */
+    double best = -1.0;
+    for (int round = 0; round < 3; round++) {
+        auto t0 = std::chrono::steady_clock::now();
+        b.m_op(b.m_iters);
+        auto t1 = std::chrono::steady_clock::now();
+        double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / double(b.m_iters);
+        if (best < 0.0 || ns < best)
+            best = ns;
+    }
+    return best;
+}
+}
+
+int main() {
+    lean::initialize_runtime_module();
+    lean_init_task_manager();
+    lean_io_mark_end_initialization();
+    printf("[");
+    bool first = true;
+    for (bench_entry const & b : g_benchmarks) {
+        double ns = measure_ns_per_op(b);
+        printf("%s\n  {\"name\": \"%s\", \"iterations\": %zu, \"ns_per_op\": %.2f}",
+               first ? "" : ",", b.m_name, b.m_iters, ns);
+        fflush(stdout);
+        first = false;
+    }
+    printf("\n]\n");
+    lean_finalize_task_manager();
+    return 0;
+}
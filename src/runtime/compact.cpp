@@ -8,9 +8,11 @@ Author: Leonardo de Moura
 #include <algorithm>
 #include <string>
 #include <vector>
+#include <memory>
 #include <cstring>
 #include <lean/lean.h>
 #include "runtime/hash.h"
+#include "runtime/thread.h"
 #include "runtime/compact.h"
 
 #ifndef LEAN_WINDOWS
@@ -19,6 +21,18 @@ Author: Leonardo de Moura
 
 #define LEAN_COMPACTOR_INIT_SZ 1024*1024
 #define LEAN_MAX_SHARING_TABLE_INITIAL_SIZE 1024*1024
+/* Minimum work per thread when fixing up a relocated region concurrently. */
+#define LEAN_REGION_FIXUP_CHUNK_SZ (8*1024*1024)
+
+/* On 64-bit POSIX systems we back the compactor buffer by a large `PROT_NONE` virtual
+   memory reservation and commit pages on demand, so growing the buffer never copies the
+   data already compacted, and the resulting region is page-aligned. */
+#if !defined(LEAN_WINDOWS) && UINTPTR_MAX == UINT64_MAX
+#define LEAN_COMPACTOR_MMAP
+/* Virtual address space reserved per compactor. Only the pages actually used are ever
+   committed. */
+#define LEAN_COMPACTOR_RESERVE_SZ (static_cast<size_t>(1) << 36) // 64 Gb
+#endif
 
 // uncomment to track the number of each kind of object in an .olean file
 // #define LEAN_TAG_COUNTERS
@@ -59,12 +73,33 @@ struct object_compactor::max_sharing_table {
 object_compactor::object_compactor(void * base_addr):
     m_max_sharing_table(new max_sharing_table(this)),
     m_base_addr(base_addr),
-    m_begin(malloc(LEAN_COMPACTOR_INIT_SZ)),
-    m_end(m_begin),
-    m_capacity(static_cast<char*>(m_begin) + LEAN_COMPACTOR_INIT_SZ) {
+    m_begin(nullptr),
+    m_reserve_end(nullptr) {
+    /* Compacting a big environment inserts millions of objects; pre-sizing the object
+       table avoids a long series of rehashes that dominate the single-threaded walk. */
+    m_obj_table.reserve(LEAN_MAX_SHARING_TABLE_INITIAL_SIZE);
+#ifdef LEAN_COMPACTOR_MMAP
+    void * mem = mmap(nullptr, LEAN_COMPACTOR_RESERVE_SZ, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mem != MAP_FAILED && mprotect(mem, LEAN_COMPACTOR_INIT_SZ, PROT_READ | PROT_WRITE) == 0) {
+        m_begin       = mem;
+        m_reserve_end = static_cast<char*>(mem) + LEAN_COMPACTOR_RESERVE_SZ;
+    } else if (mem != MAP_FAILED) {
+        munmap(mem, LEAN_COMPACTOR_RESERVE_SZ);
+    }
+#endif
+    if (m_begin == nullptr)
+        m_begin = malloc(LEAN_COMPACTOR_INIT_SZ);
+    m_end      = m_begin;
+    m_capacity = static_cast<char*>(m_begin) + LEAN_COMPACTOR_INIT_SZ;
 }
 
 object_compactor::~object_compactor() {
+#ifdef LEAN_COMPACTOR_MMAP
+    if (m_reserve_end) {
+        munmap(m_begin, LEAN_COMPACTOR_RESERVE_SZ);
+        return;
+    }
+#endif
     free(m_begin);
 }
 
@@ -81,10 +116,27 @@ void * object_compactor::alloc(size_t sz) {
         sz = sz + sizeof(void*) - rem;
     while (static_cast<char*>(m_end) + sz > m_capacity) {
         size_t new_capacity = capacity()*2;
+#ifdef LEAN_COMPACTOR_MMAP
+        if (m_reserve_end && static_cast<char*>(m_begin) + new_capacity <= m_reserve_end) {
+            /* Commit more pages of the reservation; the data already compacted stays in place. */
+            if (mprotect(m_begin, new_capacity, PROT_READ | PROT_WRITE) != 0)
+                lean_internal_panic_out_of_memory();
+            m_capacity = static_cast<char*>(m_begin) + new_capacity;
+            continue;
+        }
+#endif
         void * new_begin = malloc(new_capacity);
+        if (new_begin == nullptr) lean_internal_panic_out_of_memory();
         memcpy(new_begin, m_begin, size());
         m_end      = static_cast<char*>(new_begin) + size();
         m_capacity = static_cast<char*>(new_begin) + new_capacity;
+#ifdef LEAN_COMPACTOR_MMAP
+        if (m_reserve_end) {
+            /* Reservation exhausted; fall back to the malloc buffer from now on. */
+            munmap(m_begin, LEAN_COMPACTOR_RESERVE_SZ);
+            m_reserve_end = nullptr;
+        } else
+#endif
         free(m_begin);
         m_begin    = new_begin;
     }
@@ -320,10 +372,14 @@ tag_counter_manager g_tag_counter_manager;
 
 #endif
 
-void object_compactor::operator()(object * o) {
+void object_compactor::ensure_root_slot() {
+    // allocate space for the root address at offset 0, see end of `operator()`
+    if (size() == 0)
+        alloc(sizeof(object_offset));
+}
+
+void object_compactor::process(object * o) {
     lean_assert(m_todo.empty());
-    // allocate for root address, see end of function
-    alloc(sizeof(object_offset));
     if (!lean_is_scalar(o)) {
         m_todo.push_back(o);
         while (!m_todo.empty()) {
@@ -354,6 +410,16 @@ void object_compactor::operator()(object * o) {
         }
         m_tmp.clear();
     }
+}
+
+void object_compactor::place_subgraph(object * o) {
+    ensure_root_slot();
+    process(o);
+}
+
+void object_compactor::operator()(object * o) {
+    ensure_root_slot();
+    process(o);
     *static_cast<object_offset *>(m_begin) = to_offset(o);
 }
 
@@ -382,16 +448,16 @@ inline object * compacted_region::fix_object_ptr(object * o) {
     return reinterpret_cast<object*>(static_cast<char*>(m_begin) + (reinterpret_cast<size_t>(o) - reinterpret_cast<size_t>(m_base_addr)));
 }
 
-inline void compacted_region::move(size_t d) {
-    lean_assert(m_next < m_end);
+inline size_t compacted_region::obj_stride(size_t d) {
     size_t rem = d % sizeof(void*);
     if (rem != 0)
         d = d + sizeof(void*) - rem;
-    m_next = static_cast<char*>(m_next) + d;
+    return d;
 }
 
-inline void compacted_region::move(object * o) {
-    return move(lean_object_byte_size(o));
+inline void compacted_region::move(size_t d) {
+    lean_assert(m_next < m_end);
+    m_next = static_cast<char*>(m_next) + obj_stride(d);
 }
 
 inline void compacted_region::fix_constructor(object * o) {
@@ -402,7 +468,6 @@ inline void compacted_region::fix_constructor(object * o) {
         *it = fix_object_ptr(*it);
     }
     lean_assert(lean_object_byte_size(o) < 4192);
-    move(o);
 }
 
 inline void compacted_region::fix_array(object * o) {
@@ -411,50 +476,44 @@ inline void compacted_region::fix_array(object * o) {
     for (; it != end; it++) {
         *it = fix_object_ptr(*it);
     }
-    move(o);
 }
 
 inline void compacted_region::fix_thunk(object * o) {
     lean_to_thunk(o)->m_value = fix_object_ptr(lean_to_thunk(o)->m_value);
-    move(sizeof(lean_thunk_object));
 }
 
 inline void compacted_region::fix_ref(object * o) {
     lean_to_ref(o)->m_value = fix_object_ptr(lean_to_ref(o)->m_value);
-    move(sizeof(lean_ref_object));
 }
 
 inline void compacted_region::fix_task(object * o) {
     lean_to_task(o)->m_value = fix_object_ptr(lean_to_task(o)->m_value);
-    move(sizeof(lean_task_object));
+}
+
+inline void compacted_region::fix_string(object * o) {
+    /* Strings in a loaded region are immortal, so publish short ones as canonical
+       interned literals: later `lean_mk_string_literal` calls from module initializers
+       then alias the region object instead of allocating a fresh copy. */
+    intern_immortal_string(o);
 }
 
 void compacted_region::fix_mpz(object * o) {
 #ifdef LEAN_USE_GMP
     __mpz_struct & m = to_mpz(o)->m_value.m_val[0];
     m._mp_d = reinterpret_cast<mp_limb_t *>(static_cast<char *>(m_begin) + reinterpret_cast<size_t>(m._mp_d) - reinterpret_cast<size_t>(m_base_addr));
-    move(sizeof(mpz_object) + sizeof(mp_limb_t) * mpz_size(to_mpz(o)->m_value.m_val));
 #else
     to_mpz(o)->m_value.m_digits = reinterpret_cast<mpn_digit*>(reinterpret_cast<char*>(o) + sizeof(mpz_object));
-    move(sizeof(mpz_object) + sizeof(mpn_digit) * to_mpz(o)->m_value.m_size);
 #endif
 }
 
-object * compacted_region::read() {
-    if (m_next == m_end)
-        return nullptr; /* all objects have been read */
-
-    object * root = fix_object_ptr(*static_cast<object_offset *>(m_next));
-    move(sizeof(object_offset));
-    if (m_begin == m_base_addr) {
-        // no relocations needed
-        m_end = m_next;
-        return root;
-    }
-    lean_assert(!m_is_mmap);
-
-    while (m_next < m_end) {
-        object * curr = reinterpret_cast<object*>(m_next);
+/* Rewrites the pointers of all objects in `[begin, end)`. Both bounds must be object
+   boundaries; disjoint parts of the region can be processed concurrently, see
+   `fixup_region`. */
+void compacted_region::fix_objects(void * begin, void * end) {
+    char * it = static_cast<char*>(begin);
+    while (it < static_cast<char*>(end)) {
+        object * curr = reinterpret_cast<object*>(it);
+        size_t sz = lean_object_byte_size(curr);
         uint8 tag = lean_ptr_tag(curr);
         if (tag <= LeanMaxCtorTag) {
             fix_constructor(curr);
@@ -462,8 +521,8 @@ object * compacted_region::read() {
             switch (tag) {
             case LeanClosure:         lean_unreachable();
             case LeanArray:           fix_array(curr); break;
-            case LeanScalarArray:     move(lean_sarray_byte_size(curr)); break;
-            case LeanString:          move(lean_string_byte_size(curr)); break;
+            case LeanScalarArray:     break;
+            case LeanString:          fix_string(curr); break;
             case LeanMPZ:             fix_mpz(curr); break;
             case LeanThunk:           fix_thunk(curr); break;
             case LeanRef:             fix_ref(curr); break;
@@ -472,7 +531,60 @@ object * compacted_region::read() {
             default:                  lean_unreachable();
             }
         }
+        it += obj_stride(sz);
+    }
+}
+
+/* Rewrites the pointers of all remaining objects in the region. The region is a sequence
+   of self-delimited objects, so for large regions we pre-scan the object boundaries into
+   chunks and rewrite the chunks concurrently: the boundary scan only reads the object
+   headers, while the rewrite touches every pointer field. */
+void compacted_region::fixup_region() {
+    size_t remaining = static_cast<char*>(m_end) - static_cast<char*>(m_next);
+    unsigned nw = hardware_concurrency();
+    if (nw > 1 && remaining >= 2 * LEAN_REGION_FIXUP_CHUNK_SZ) {
+        std::vector<char *> cuts;
+        char * it = static_cast<char*>(m_next);
+        char * next_cut = it + LEAN_REGION_FIXUP_CHUNK_SZ;
+        cuts.push_back(it);
+        while (it < static_cast<char*>(m_end)) {
+            if (it >= next_cut) {
+                cuts.push_back(it);
+                next_cut = it + LEAN_REGION_FIXUP_CHUNK_SZ;
+            }
+            it += obj_stride(lean_object_byte_size(reinterpret_cast<object*>(it)));
+        }
+        cuts.push_back(static_cast<char*>(m_end));
+        if (nw > cuts.size() - 1)
+            nw = static_cast<unsigned>(cuts.size() - 1);
+        std::vector<std::unique_ptr<lthread>> threads;
+        for (unsigned i = 0; i < nw; i++) {
+            threads.push_back(std::unique_ptr<lthread>(new lthread([this, &cuts, i, nw]() {
+                for (size_t j = i; j + 1 < cuts.size(); j += nw)
+                    fix_objects(cuts[j], cuts[j + 1]);
+            })));
+        }
+        for (auto & t : threads)
+            t->join();
+    } else {
+        fix_objects(m_next, m_end);
     }
+    m_next = m_end;
+}
+
+object * compacted_region::read() {
+    if (m_next == m_end)
+        return nullptr; /* all objects have been read */
+
+    object * root = fix_object_ptr(*static_cast<object_offset *>(m_next));
+    move(sizeof(object_offset));
+    if (m_begin == m_base_addr) {
+        // no relocations needed
+        m_end = m_next;
+        return root;
+    }
+    lean_assert(!m_is_mmap);
+    fixup_region();
     return root;
 }
 
@@ -24,10 +24,25 @@ class object_compactor {
     // On-disk base address used for `mmap`ing compacted regions without relocations
     // References within the compacted region are rewritten by subtracting `m_begin` and adding `m_base_addr`
     // In the simplest case `base_addr == nullptr`, we get region-relative pointers
+    //
+    // A position-independent variant (references stay region-relative on disk and are
+    // decoded on access) has been considered and rejected: compacted objects are live
+    // heap objects, handed out directly to generated code and the runtime, so an
+    // offset-based reference would have to be decoded by every object accessor in
+    // `lean.h` for every object, resident or compacted. The scheme here gets the same
+    // zero-fixup, zero-dirty-page load whenever the region can be mapped at
+    // `m_base_addr`, which is the common case since the address is derived
+    // deterministically from the module name; ASLR randomizes the other mappings, not
+    // this hint. Fixup is the fallback for address collisions, not the normal path.
     void * m_base_addr;
     void * m_begin;
     void * m_end;
     void * m_capacity;
+    // End of the reserved (but not necessarily committed) virtual-memory range when the
+    // buffer is a `PROT_NONE` mmap reservation committed on demand, nullptr when the
+    // buffer is malloc-based. Growing a reservation just commits more pages, so it never
+    // copies, and the resulting region is page-aligned.
+    void * m_reserve_end;
     size_t capacity() const { return static_cast<char*>(m_capacity) - static_cast<char*>(m_begin); }
     void save(object * o, object * new_o);
     void save_max_sharing(object * o, object * new_o, size_t new_o_sz);
@@ -43,6 +58,8 @@ class object_compactor {
     bool insert_task(object * o);
     bool insert_ref(object * o);
     void insert_mpz(object * o);
+    void ensure_root_slot();
+    void process(object * o);
 public:
     object_compactor(void * base_addr = nullptr);
     object_compactor(object_compactor const &) = delete;
@@ -51,6 +68,13 @@ public:
     object_compactor operator=(object_compactor const &) = delete;
     object_compactor operator=(object_compactor &&) = delete;
     void operator()(object * o);
+    /* Compact the objects reachable from `o` without recording a region root. This is a
+       layout control: objects keep the offset of the call that first placed them, so a
+       sequence of `place_subgraph` calls before the final `operator()` segregates the
+       region into an eagerly-accessed head and a rarely-accessed tail. When the region
+       is later `mmap`ed, the tail pages are demand-paged and stay non-resident until an
+       object on them is first dereferenced (see `lean_save_module_data`). */
+    void place_subgraph(object * o);
     size_t size() const { return static_cast<char*>(m_end) - static_cast<char*>(m_begin); }
     void const * data() const { return m_begin; }
 };
@@ -64,7 +88,7 @@ class compacted_region {
     void * m_next;
     void * m_end;
     void move(size_t d);
-    void move(object * o);
+    static size_t obj_stride(size_t d);
     object * fix_object_ptr(object * o);
     void fix_constructor(object * o);
     void fix_array(object * o);
@@ -72,6 +96,9 @@ class compacted_region {
     void fix_ref(object * o);
     void fix_task(object * o);
     void fix_mpz(object * o);
+    void fix_string(object * o);
+    void fix_objects(void * begin, void * end);
+    void fixup_region();
 public:
     /* Creates a compacted object region using the given region in memory.
        This object takes ownership of the region. */
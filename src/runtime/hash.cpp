@@ -22,6 +22,21 @@ void mix(unsigned & a, unsigned & b, unsigned & c) {
 
 // Bob Jenkin's hash function.
 // http://burtleburtle.net/bob/hash/doobs.html
+//
+// Two things to know before replacing this with a faster hash (xxh3, wyhash, ...):
+//
+// * It is word-at-a-time already: the main loop consumes 12 bytes (three 32-bit
+//   words) per `mix`; only the <= 11-byte tail is processed per byte. For the short
+//   strings that dominate (`Name` components), the tail switch *is* the hash, and a
+//   wide hash's setup costs about as much.
+//
+// * The output is part of the .olean format. `Name` and `Expr` values cache their
+//   hashes in the object itself and are compacted to disk with them; a runtime
+//   computing different hashes for freshly created names would disagree with the
+//   cached hashes of equal imported names, silently breaking every hash container
+//   they meet in. There is no format-version field to gate a change on, and the
+//   stage0 compiler writes .oleans with the old function during bootstrap. Changing
+//   this function is a coordinated format break, not a local optimization.
 unsigned hash_str(size_t length, unsigned char const * str, unsigned init_value) {
     unsigned a, b, c;
     size_t len;
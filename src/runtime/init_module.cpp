@@ -5,6 +5,7 @@ Released under Apache 2.0 license as described in the file LICENSE.
 Author: Leonardo de Moura
 */
 #include "runtime/alloc.h"
+#include "runtime/platform.h"
 #include "runtime/debug.h"
 #include "runtime/thread.h"
 #include "runtime/object.h"
@@ -12,16 +13,26 @@ Author: Leonardo de Moura
 #include "runtime/stack_overflow.h"
 #include "runtime/process.h"
 #include "runtime/mutex.h"
+#include "runtime/allocprof.h"
+#include "runtime/rcprof.h"
+#include "runtime/sigprof.h"
+#include "runtime/load_dynlib.h"
 
 namespace lean {
 extern "C" LEAN_EXPORT void lean_initialize_runtime_module() {
+    /* first: later initializers resolve CPU-dispatched function pointers */
+    initialize_platform();
     initialize_alloc();
+    initialize_allocprof();
+    initialize_rcprof();
+    initialize_sigprof();
     initialize_debug();
     initialize_object();
     initialize_io();
     initialize_thread();
     initialize_mutex();
     initialize_process();
+    initialize_load_dynlib();
     initialize_stack_overflow();
 }
 void initialize_runtime_module() {
@@ -29,12 +40,17 @@ void initialize_runtime_module() {
 }
 void finalize_runtime_module() {
     finalize_stack_overflow();
+    finalize_load_dynlib();
     finalize_process();
     finalize_mutex();
     finalize_thread();
     finalize_io();
     finalize_object();
     finalize_debug();
+    finalize_sigprof();
+    finalize_rcprof();
+    finalize_allocprof();
     finalize_alloc();
+    finalize_platform();
 }
 }
@@ -12,7 +12,8 @@ Author: Leonardo de Moura
 
 namespace lean {
 LEAN_THREAD_VALUE(size_t, g_max_heartbeat, 0);
-LEAN_THREAD_VALUE(size_t, g_heartbeat, 0);
+/* Hot counter, kept in the aggregated `runtime_tls` block; see thread.h. */
+#define g_heartbeat (g_runtime_tls.m_heartbeat)
 
 void inc_heartbeat() { g_heartbeat++; }
 
@@ -54,6 +55,20 @@ void check_system(char const * component_name) {
     check_heartbeat();
 }
 
+LEAN_THREAD_VALUE(unsigned, g_check_system_countdown, 0);
+
+void check_system_batched(char const * component_name) {
+    if (g_check_system_countdown > 0) {
+        g_check_system_countdown--;
+        return;
+    }
+    g_check_system_countdown = LEAN_CHECK_SYSTEM_BATCH - 1;
+    /* Credit the skipped increments so heartbeat counts keep the same average
+       rate as calling `check_system` on every iteration. */
+    g_heartbeat += LEAN_CHECK_SYSTEM_BATCH - 1;
+    check_system(component_name);
+}
+
 void sleep_for(unsigned ms, unsigned step_ms) {
     if (step_ms == 0)
         step_ms = 1;
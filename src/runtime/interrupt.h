@@ -56,6 +56,17 @@ void check_interrupted();
 */
 void check_system(char const * component_name);
 
+#define LEAN_CHECK_SYSTEM_BATCH 128
+
+/**
+   \brief Batched version of \c check_system for hot loops: the full check runs
+   only once every LEAN_CHECK_SYSTEM_BATCH calls, driven by a thread-local
+   countdown, so the amortized cost per call is a decrement and a branch.
+   Cancellation latency is bounded by the batch size times the cost of one
+   iteration of the polling loop.
+*/
+void check_system_batched(char const * component_name);
+
 constexpr unsigned g_small_sleep = 10;
 
 /**
@@ -13,6 +13,7 @@ Authors: Leonardo de Moura, Sebastian Ullrich
 #elif defined(__APPLE__)
 #include <mach-o/dyld.h>
 #include <unistd.h>
+#include <sys/mman.h>
 #else
 #if defined(LEAN_EMSCRIPTEN)
 #include <emscripten.h>
@@ -42,6 +43,7 @@ Authors: Leonardo de Moura, Sebastian Ullrich
 #include "runtime/utf8.h"
 #include "runtime/object.h"
 #include "runtime/thread.h"
+#include "runtime/stackinfo.h"
 #include "runtime/allocprof.h"
 
 #ifdef _MSC_VER
@@ -72,6 +74,11 @@ static bool g_initializing = true;
 extern "C" LEAN_EXPORT void lean_io_mark_end_initialization() {
     g_initializing = false;
 }
+static object * g_io_unit_ok = nullptr;
+extern "C" LEAN_EXPORT obj_res lean_io_unit_result_ok() {
+    // persistent, so the caller's reference needs no `inc` and its `dec` is a no-op
+    return g_io_unit_ok;
+}
 extern "C" LEAN_EXPORT obj_res lean_io_initializing(obj_arg) {
     return io_result_mk_ok(box(g_initializing));
 }
@@ -309,6 +316,47 @@ extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_write(b_obj_arg h, b_obj_arg
     }
 }
 
+/* Handle.writeBatch : (@& Handle) → (@& Array ByteArray) → IO Unit
+
+   The stream lock is taken once for the whole batch, so streaming many small
+   fragments does not pay a libc lock/unlock (and possibly a flush) per
+   fragment the way per-fragment `Handle.write` calls do. */
+extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_write_batch(b_obj_arg h, b_obj_arg bufs, obj_arg /* w */) {
+    FILE * fp = io_get_handle(h);
+    size_t n  = lean_array_size(bufs);
+    bool ok   = true;
+#if !defined(LEAN_WINDOWS)
+    flockfile(fp);
+    for (size_t i = 0; i < n && ok; i++) {
+        object * buf = lean_array_get_core(bufs, i);
+        usize sz     = lean_sarray_size(buf);
+        ok = fwrite_unlocked(lean_sarray_cptr(buf), 1, sz, fp) == sz;
+    }
+    funlockfile(fp);
+#else
+    for (size_t i = 0; i < n && ok; i++) {
+        object * buf = lean_array_get_core(bufs, i);
+        usize sz     = lean_sarray_size(buf);
+        ok = std::fwrite(lean_sarray_cptr(buf), 1, sz, fp) == sz;
+    }
+#endif
+    if (ok) {
+        return io_result_mk_ok(box(0));
+    } else {
+        return io_result_mk_error(decode_io_error(errno, nullptr));
+    }
+}
+
+/* Handle.setBufferSize : (@& Handle) → USize → IO Unit */
+extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_set_buffer_size(b_obj_arg h, usize sz, obj_arg /* w */) {
+    FILE * fp = io_get_handle(h);
+    if (std::setvbuf(fp, nullptr, sz == 0 ? _IONBF : _IOFBF, sz) == 0) {
+        return io_result_mk_ok(box(0));
+    } else {
+        return io_result_mk_error(decode_io_error(errno, nullptr));
+    }
+}
+
 static object * g_io_error_getline = nullptr;
 
 /*
@@ -354,6 +402,170 @@ extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_put_str(b_obj_arg h, b_obj_ar
     }
 }
 
+/* Read the whole file at `fname` into a fresh ByteArray stored in `out`.
+   On failure, store an `IO.Error` object in `out` instead and return false. */
+static bool read_bin_file_core(b_obj_arg fname, object * & out) {
+#if !defined(LEAN_WINDOWS)
+    int fd = open(lean_string_cstr(fname), O_RDONLY);
+    if (fd == -1) {
+        out = decode_io_error(errno, fname);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        int errnum = errno;
+        close(fd);
+        out = decode_io_error(errnum, fname);
+        return false;
+    }
+    if (S_ISREG(st.st_mode) && st.st_size > 0) {
+        size_t sz  = static_cast<size_t>(st.st_size);
+        void * map = mmap(nullptr, sz, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            out = lean_alloc_sarray(1, sz, sz);
+            memcpy(lean_sarray_cptr(out), map, sz);
+            munmap(map, sz);
+            close(fd);
+            return true;
+        }
+    }
+    close(fd);
+#endif
+    FILE * fp = fopen(lean_string_cstr(fname), "rb");
+    if (!fp) {
+        out = decode_io_error(errno, fname);
+        return false;
+    }
+    std::string buf;
+    char tmp[4096]; // NOLINT
+    while (true) {
+        size_t n = std::fread(tmp, 1, sizeof(tmp), fp);
+        buf.append(tmp, n);
+        if (n < sizeof(tmp)) {
+            if (std::feof(fp))
+                break;
+            int errnum = errno;
+            fclose(fp);
+            out = decode_io_error(errnum, fname);
+            return false;
+        }
+    }
+    fclose(fp);
+    out = lean_alloc_sarray(1, buf.size(), buf.size());
+    memcpy(lean_sarray_cptr(out), buf.data(), buf.size());
+    return true;
+}
+
+/* readBinFileMmap (fname : @& FilePath) : IO ByteArray
+
+   Read a whole binary file in one step. On POSIX systems the file is mapped
+   with `mmap`, so the read shares the OS page cache with other processes and
+   the bytes are copied exactly once, into the exactly-sized result array.
+   `ByteArray`s store their bytes inline in the `lean_sarray_object`, so the
+   mapping itself cannot be handed to Lean code; it is released after the
+   copy. Empty and non-regular files, and systems without `mmap`, fall back
+   to a buffered read. */
+extern "C" LEAN_EXPORT obj_res lean_io_read_bin_file_mmap(b_obj_arg fname, obj_arg /* w */) {
+    object * r;
+    if (read_bin_file_core(fname, r))
+        return io_result_mk_ok(r);
+    else
+        return io_result_mk_error(r);
+}
+
+/* Asynchronous file IO.
+
+   Blocking file reads are executed on a small pool of dedicated IO worker
+   threads that complete into promises, so a blocked read parks one of these
+   cheap waiters instead of a `task_manager` worker. The pool is grown lazily
+   and capped; queued requests are served FIFO. */
+#define LEAN_ASYNC_IO_MAX_WORKERS 4
+
+extern "C" obj_res lean_io_promise_new(obj_arg);
+extern "C" obj_res lean_io_promise_resolve(obj_arg value, b_obj_arg promise, obj_arg);
+
+struct async_io_request {
+    object *           m_fname;   /* owned, String */
+    object *           m_promise; /* owned, promise to resolve */
+    async_io_request * m_next{nullptr};
+};
+
+static mutex              * g_async_io_mutex      = nullptr;
+static condition_variable * g_async_io_cv         = nullptr;
+static async_io_request   * g_async_io_queue_head = nullptr;
+static async_io_request   * g_async_io_queue_tail = nullptr;
+static unsigned             g_async_io_workers    = 0;
+static unsigned             g_async_io_idle       = 0;
+
+static void async_io_worker() {
+    save_stack_info(false);
+    unique_lock<mutex> lock(*g_async_io_mutex);
+    while (true) {
+        while (!g_async_io_queue_head) {
+            g_async_io_idle++;
+            g_async_io_cv->wait(lock);
+            g_async_io_idle--;
+        }
+        async_io_request * req = g_async_io_queue_head;
+        g_async_io_queue_head  = req->m_next;
+        if (!g_async_io_queue_head)
+            g_async_io_queue_tail = nullptr;
+        lock.unlock();
+        object * r;
+        bool ok = read_bin_file_core(req->m_fname, r);
+        object * e = lean_alloc_ctor(ok ? 1 : 0, 1, 0); /* Except.ok / Except.error */
+        lean_ctor_set(e, 0, r);
+        dec_ref(lean_io_promise_resolve(e, req->m_promise, lean_box(0)));
+        dec(req->m_fname);
+        dec_ref(req->m_promise);
+        delete req;
+        lock.lock();
+    }
+}
+
+static void enqueue_async_io(async_io_request * req) {
+    unique_lock<mutex> lock(*g_async_io_mutex);
+    if (g_async_io_queue_tail)
+        g_async_io_queue_tail->m_next = req;
+    else
+        g_async_io_queue_head = req;
+    g_async_io_queue_tail = req;
+    if (g_async_io_idle == 0 && g_async_io_workers < LEAN_ASYNC_IO_MAX_WORKERS) {
+        g_async_io_workers++;
+        lthread([]() { async_io_worker(); });
+        /* the `lthread` is implicitly freed, which frees up its control
+           resources but does not terminate the thread */
+    } else {
+        g_async_io_cv->notify_one();
+    }
+}
+
+/* readBinFileAsync (fname : @& FilePath) : IO (Task (Except IO.Error ByteArray)) */
+extern "C" LEAN_EXPORT obj_res lean_io_read_bin_file_async(b_obj_arg fname, obj_arg /* w */) {
+#if defined(LEAN_MULTI_THREAD)
+    object * pres    = lean_io_promise_new(lean_box(0));
+    object * promise = lean_io_result_get_value(pres);
+    inc(promise);
+    dec_ref(pres);
+    inc(fname);
+    mark_mt(fname);
+    mark_mt(promise);
+    async_io_request * req = new async_io_request;
+    req->m_fname   = fname;
+    req->m_promise = promise;
+    inc(promise);
+    enqueue_async_io(req);
+    return io_result_mk_ok(promise);
+#else
+    /* without threads, read synchronously and return a finished task */
+    object * r;
+    bool ok    = read_bin_file_core(fname, r);
+    object * e = lean_alloc_ctor(ok ? 1 : 0, 1, 0);
+    lean_ctor_set(e, 0, r);
+    return io_result_mk_ok(lean_task_pure(e));
+#endif
+}
+
 /* monoMsNow : BaseIO Nat */
 extern "C" LEAN_EXPORT obj_res lean_io_mono_ms_now(obj_arg /* w */) {
     static_assert(sizeof(std::chrono::milliseconds::rep) <= sizeof(uint64));
@@ -462,6 +674,18 @@ extern "C" LEAN_EXPORT obj_res lean_io_get_num_heartbeats(obj_arg /* w */) {
     return io_result_mk_ok(lean_uint64_to_nat(get_num_heartbeats()));
 }
 
+/* Runtime.markMultiThreaded (a : α) : BaseIO α */
+extern "C" LEAN_EXPORT obj_res lean_runtime_mark_multi_threaded(obj_arg a, obj_arg /* w */) {
+    mark_mt(a);
+    return io_result_mk_ok(a);
+}
+
+/* Runtime.markPersistent (a : α) : BaseIO α */
+extern "C" LEAN_EXPORT obj_res lean_runtime_mark_persistent(obj_arg a, obj_arg /* w */) {
+    mark_persistent(a);
+    return io_result_mk_ok(a);
+}
+
 extern "C" LEAN_EXPORT obj_res lean_io_getenv(b_obj_arg env_var, obj_arg) {
 #if defined(LEAN_EMSCRIPTEN)
     // HACK(WN): getenv doesn't seem to work in Emscripten even though it should
@@ -795,6 +1019,44 @@ extern "C" LEAN_EXPORT obj_res lean_st_ref_set(b_obj_arg ref, obj_arg a, obj_arg
     }
 }
 
+/*
+  RCU-style read-mostly refs. `lean_st_ref_publish` marks the new value as persistent
+  before storing it, and `lean_st_ref_get_snapshot` returns a persistent value with a
+  single load. Persistent objects are reference-count free, so the read path avoids the
+  RMW `exchange` pair of `lean_st_ref_get`, which serializes all reader threads on the
+  ref's cache line. The cost is paid on the (assumed rare) write side: a superseded
+  snapshot is never reclaimed, like any other persistent object.
+*/
+extern "C" LEAN_EXPORT obj_res lean_st_ref_publish(b_obj_arg ref, obj_arg a, obj_arg) {
+    mark_persistent(a);
+    if (ref_maybe_mt(ref)) {
+        atomic<object *> * val_addr = mt_ref_val_addr(ref);
+        object * old_a = val_addr->exchange(a);
+        if (old_a != nullptr)
+            dec(old_a); /* no-op if `old_a` was also published */
+        return io_result_mk_ok(box(0));
+    } else {
+        if (lean_to_ref(ref)->m_value != nullptr)
+            dec(lean_to_ref(ref)->m_value);
+        lean_to_ref(ref)->m_value = a;
+        return io_result_mk_ok(box(0));
+    }
+}
+
+extern "C" LEAN_EXPORT obj_res lean_st_ref_get_snapshot(b_obj_arg ref, obj_arg w) {
+    if (ref_maybe_mt(ref)) {
+        object * val = mt_ref_val_addr(ref)->load();
+        if (val != nullptr && lean_is_persistent(val)) {
+            /* `inc` would be a no-op, and a published value is never deallocated,
+               so returning the bare pointer is safe even if a writer races us. */
+            return io_result_mk_ok(val);
+        }
+        /* The current value was not published (or the ref is being `take`n);
+           fall back to the RC-safe read. */
+    }
+    return lean_st_ref_get(ref, w);
+}
+
 extern "C" LEAN_EXPORT obj_res lean_st_ref_swap(b_obj_arg ref, obj_arg a, obj_arg) {
     if (ref_maybe_mt(ref)) {
         /* See io_ref_write */
@@ -885,6 +1147,10 @@ extern "C" LEAN_EXPORT obj_res lean_io_exit(uint8_t code, obj_arg /* w */) {
 }
 
 void initialize_io() {
+    g_async_io_mutex = new mutex();
+    g_async_io_cv    = new condition_variable();
+    g_io_unit_ok = lean_io_result_mk_ok(box(0));
+    mark_persistent(g_io_unit_ok);
     g_io_error_nullptr_read = lean_mk_io_user_error(mk_string("null reference read"));
     mark_persistent(g_io_error_nullptr_read);
     g_io_error_getline = lean_mk_io_user_error(mk_string("getLine failed"));
@@ -4,10 +4,14 @@ Released under Apache 2.0 license as described in the file LICENSE.
 
 Author: Leonardo de Moura, Mac Malone
 */
+#include <cstring>
+#include <unordered_map>
+#include <vector>
 #include "runtime/io.h"
 #include "runtime/object.h"
 #include "runtime/sstream.h"
 #include "runtime/exception.h"
+#include "runtime/thread.h"
 #include "runtime/load_dynlib.h"
 
 #ifdef LEAN_WINDOWS
@@ -15,23 +19,126 @@ Author: Leonardo de Moura, Mac Malone
 #else
 #include <dlfcn.h>
 #endif
+#ifdef __linux__
+#include <link.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 namespace lean {
-void load_dynlib(std::string path) {
+/* Loaded libraries keyed by the path they were requested under, so loading
+   the same library again (plugin-heavy setups name the same dependencies many
+   times) is a table hit instead of another trip through the loader. Bundle
+   handles are additionally kept in `g_dynlib_bundles` for direct symbol
+   probes; see `lookup_symbol_in_dynlib_bundles`. */
+static mutex * g_dynlib_mutex = nullptr;
+static std::unordered_map<std::string, void *> * g_loaded_dynlibs = nullptr;
+static std::vector<void *> * g_dynlib_bundles = nullptr;
+
+#ifdef __linux__
+struct huge_text_ctx {
+    char const * m_path;
+};
+
+static int advise_huge_text_cb(struct dl_phdr_info * info, size_t, void * data) {
+    huge_text_ctx const * ctx = static_cast<huge_text_ctx const *>(data);
+    char const * name = info->dlpi_name;
+    if (name == nullptr || *name == '\0')
+        return 0;
+    /* the loader may report a resolved path; accept an exact or `/`-anchored suffix match */
+    size_t nlen = strlen(name), plen = strlen(ctx->m_path);
+    if (strcmp(name, ctx->m_path) != 0 &&
+        !(nlen > plen && strcmp(name + nlen - plen, ctx->m_path) == 0 && name[nlen - plen - 1] == '/'))
+        return 0;
+    uintptr_t page_size = sysconf(_SC_PAGESIZE);
+    for (int i = 0; i < info->dlpi_phnum; i++) {
+        ElfW(Phdr) const & ph = info->dlpi_phdr[i];
+        if (ph.p_type != PT_LOAD || !(ph.p_flags & PF_X))
+            continue;
+        uintptr_t begin = (info->dlpi_addr + ph.p_vaddr) & ~(page_size - 1);
+        uintptr_t end   = (info->dlpi_addr + ph.p_vaddr + ph.p_memsz + page_size - 1) & ~(page_size - 1);
+        /* Best effort: `MADV_COLLAPSE` (Linux >= 6.1) backs the text with huge
+           pages right away; otherwise `MADV_HUGEPAGE` leaves it to khugepaged.
+           Either may fail (old kernel, THP disabled), which is fine. */
+#ifdef MADV_COLLAPSE
+        if (madvise(reinterpret_cast<void *>(begin), end - begin, MADV_COLLAPSE) == 0)
+            continue;
+#endif
+#ifdef MADV_HUGEPAGE
+        madvise(reinterpret_cast<void *>(begin), end - begin, MADV_HUGEPAGE);
+#endif
+    }
+    return 1; /* found the library, stop iterating */
+}
+#endif
+
+/* If `LEAN_DYNLIB_HUGEPAGES` is set, ask the kernel to back the executable
+   segments of the library just loaded from `path` with huge pages, reducing
+   iTLB pressure when precompiled code spans many libraries. */
+static void advise_huge_text(char const * path) {
+#ifdef __linux__
+    if (std::getenv("LEAN_DYNLIB_HUGEPAGES") == nullptr)
+        return;
+    huge_text_ctx ctx = { path };
+    dl_iterate_phdr(advise_huge_text_cb, &ctx);
+#else
+    (void) path;
+#endif
+}
+
+static void * load_dynlib_core(std::string const & path) {
 #ifdef LEAN_WINDOWS
     HMODULE h = LoadLibrary(path.c_str());
     if (!h) {
         throw exception(sstream() << "error loading library " << path << ": " << GetLastError());
     }
+    return reinterpret_cast<void *>(h);
 #else
     void *handle = dlopen(path.c_str(), RTLD_LAZY | RTLD_GLOBAL);
     if (!handle) {
         throw exception(sstream() << "error loading library, " << dlerror());
     }
+    advise_huge_text(path.c_str());
+    return handle;
 #endif
     // NOTE: we never unload libraries
 }
 
+void load_dynlib(std::string path) {
+    lock_guard<mutex> lock(*g_dynlib_mutex);
+    if (g_loaded_dynlibs->find(path) != g_loaded_dynlibs->end())
+        return;
+    (*g_loaded_dynlibs)[path] = load_dynlib_core(path);
+}
+
+void load_dynlib_bundle(std::string path) {
+    lock_guard<mutex> lock(*g_dynlib_mutex);
+    auto it = g_loaded_dynlibs->find(path);
+    if (it == g_loaded_dynlibs->end())
+        it = g_loaded_dynlibs->emplace(path, load_dynlib_core(path)).first;
+    for (void * h : *g_dynlib_bundles) {
+        if (h == it->second)
+            return;
+    }
+    g_dynlib_bundles->push_back(it->second);
+}
+
+void * lookup_symbol_in_dynlib_bundles(char const * sym) {
+    if (g_dynlib_bundles == nullptr)
+        return nullptr;
+    lock_guard<mutex> lock(*g_dynlib_mutex);
+    for (void * h : *g_dynlib_bundles) {
+#ifdef LEAN_WINDOWS
+        if (void * addr = reinterpret_cast<void *>(GetProcAddress(reinterpret_cast<HMODULE>(h), sym)))
+            return addr;
+#else
+        if (void * addr = dlsym(h, sym))
+            return addr;
+#endif
+    }
+    return nullptr;
+}
+
 /* loadDynlib : System.FilePath -> IO Unit */
 extern "C" LEAN_EXPORT obj_res lean_load_dynlib(b_obj_arg path, obj_arg) {
     try {
@@ -41,4 +148,29 @@ extern "C" LEAN_EXPORT obj_res lean_load_dynlib(b_obj_arg path, obj_arg) {
         return io_result_mk_error(ex.what());
     }
 }
+
+/* Load a library bundling the code of many precompiled modules: one
+   `dlopen` (and one pass of loader relocation work) instead of one per
+   module, and module-initializer lookups probe the bundle handle directly
+   instead of scanning every loaded object. */
+extern "C" LEAN_EXPORT obj_res lean_load_dynlib_bundle(b_obj_arg path, obj_arg) {
+    try {
+        load_dynlib_bundle(string_cstr(path));
+        return io_result_mk_ok(box(0));
+    } catch (exception & ex) {
+        return io_result_mk_error(ex.what());
+    }
+}
+
+void initialize_load_dynlib() {
+    g_dynlib_mutex   = new mutex();
+    g_loaded_dynlibs = new std::unordered_map<std::string, void *>();
+    g_dynlib_bundles = new std::vector<void *>();
+}
+
+void finalize_load_dynlib() {
+    delete g_dynlib_bundles; g_dynlib_bundles = nullptr;
+    delete g_loaded_dynlibs; g_loaded_dynlibs = nullptr;
+    delete g_dynlib_mutex;   g_dynlib_mutex   = nullptr;
+}
 }
@@ -9,4 +9,12 @@ Author: Mac Malone
 
 namespace lean {
 void load_dynlib(std::string path);
+/** \brief Load a shared library that bundles many precompiled modules and
+    remember its handle so symbol lookups can probe it directly. */
+void load_dynlib_bundle(std::string path);
+/** \brief Resolve \c sym against the libraries loaded via
+    \c load_dynlib_bundle, in load order. Returns \c nullptr if not found. */
+void * lookup_symbol_in_dynlib_bundles(char const * sym);
+void initialize_load_dynlib();
+void finalize_load_dynlib();
 }
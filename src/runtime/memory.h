@@ -14,4 +14,6 @@ void set_max_memory(size_t max);
 void set_max_memory_megabyte(unsigned max);
 void check_memory(char const * component_name);
 size_t get_allocated_memory();
+/** \brief Peak resident set size of the process, in bytes */
+size_t get_peak_rss();
 }
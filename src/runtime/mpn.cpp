@@ -86,11 +86,10 @@ void mpn_sub(mpn_digit const * a, size_t const lnga,
     }
 }
 
-void mpn_mul(mpn_digit const * a, size_t const lnga,
-             mpn_digit const * b, size_t const lngb,
-             mpn_digit * c) {
+static void mpn_mul_basecase(mpn_digit const * a, size_t const lnga,
+                             mpn_digit const * b, size_t const lngb,
+                             mpn_digit * c) {
     // Essentially Knuth's Algorithm M.
-    // Perhaps implement a more efficient version, see e.g., Knuth, Section 4.3.3.
     size_t i;
     mpn_digit k;
 
@@ -122,6 +121,44 @@ void mpn_mul(mpn_digit const * a, size_t const lnga,
     }
 }
 
+/* Add a into c (in place), propagating the carry through the rest of c.
+   \pre the sum fits in lngc digits. */
+static void mpn_add_in_place(mpn_digit * c, size_t const lngc,
+                             mpn_digit const * a, size_t const lnga) {
+    lean_assert(lnga <= lngc);
+    mpn_digit k = 0;
+    mpn_digit r;
+    bool c1, c2;
+    size_t i = 0;
+    for (; i < lnga; i++) {
+        r = c[i] + a[i]; c1 = r < c[i];
+        c[i] = r + k;    c2 = c[i] < r;
+        k = c1 | c2;
+    }
+    for (; k != 0 && i < lngc; i++) {
+        c[i]++;
+        k = c[i] == 0;
+    }
+    lean_assert(k == 0);
+}
+
+/* Switch from the schoolbook O(n^2) product to Karatsuba above this many
+   digits per operand (32 digits = 1024 bits). */
+#define LEAN_KARATSUBA_THRESHOLD 32
+
+static void mpn_mul_karatsuba(mpn_digit const * a, size_t const lnga,
+                              mpn_digit const * b, size_t const lngb,
+                              mpn_digit * c);
+
+void mpn_mul(mpn_digit const * a, size_t const lnga,
+             mpn_digit const * b, size_t const lngb,
+             mpn_digit * c) {
+    if (lnga >= LEAN_KARATSUBA_THRESHOLD && lngb >= LEAN_KARATSUBA_THRESHOLD)
+        mpn_mul_karatsuba(a, lnga, b, lngb, c);
+    else
+        mpn_mul_basecase(a, lnga, b, lngb, c);
+}
+
 #define MASK_FIRST (~((mpn_digit)(-1) >> 1))
 #define FIRST_BITS(N, X) ((X) >> (DIGIT_BITS-(N)))
 #define LAST_BITS(N, X) (((X) << (DIGIT_BITS-(N))) >> (DIGIT_BITS-(N)))
@@ -148,6 +185,61 @@ public:
     }
 };
 
+/* Karatsuba multiplication: split both operands at m digits,
+
+       a = a1*B^m + a0,  b = b1*B^m + b0,
+
+   and compute the three half-size products
+
+       z0 = a0*b0,  z2 = a1*b1,  z1 = (a0+a1)*(b0+b1) - z0 - z2,
+
+   so that a*b = z2*B^2m + z1*B^m + z0. The recursion goes through mpn_mul,
+   which falls back to the schoolbook product below the threshold.
+   \pre c does not alias a or b (as for mpn_mul_basecase). */
+static void mpn_mul_karatsuba(mpn_digit const * a, size_t const lnga,
+                              mpn_digit const * b, size_t const lngb,
+                              mpn_digit * c) {
+    size_t m = (lnga < lngb ? lnga : lngb) / 2;
+    lean_assert(m > 0 && m < lnga && m < lngb);
+    size_t l1a = lnga - m;
+    size_t l1b = lngb - m;
+
+    mpn_buffer z0(2*m, 0);
+    mpn_mul(a, m, b, m, z0.data());
+    mpn_buffer z2(l1a + l1b, 0);
+    mpn_mul(a + m, l1a, b + m, l1b, z2.data());
+
+    mpn_buffer sa(max(m, l1a) + 1, 0);
+    mpn_buffer sb(max(m, l1b) + 1, 0);
+    size_t lsa, lsb;
+    mpn_add(a, m, a + m, l1a, sa.data(), max(m, l1a) + 1, &lsa);
+    mpn_add(b, m, b + m, l1b, sb.data(), max(m, l1b) + 1, &lsb);
+
+    mpn_buffer z1(lsa + lsb, 0);
+    mpn_mul(sa.data(), lsa, sb.data(), lsb, z1.data());
+    /* subtract with the significant lengths: z0 <= sa*sb and z2 <= sa*sb, but
+       their buffers may be longer than z1's once leading zeros are counted */
+    size_t lz0 = 2*m;
+    while (lz0 > 0 && z0[lz0-1] == 0) lz0--;
+    size_t lz2 = l1a + l1b;
+    while (lz2 > 0 && z2[lz2-1] == 0) lz2--;
+    lean_assert(lz0 <= lsa + lsb && lz2 <= lsa + lsb);
+    mpn_digit borrow;
+    mpn_sub(z1.data(), lsa + lsb, z0.data(), lz0, z1.data(), &borrow);
+    lean_assert(borrow == 0);
+    mpn_sub(z1.data(), lsa + lsb, z2.data(), lz2, z1.data(), &borrow);
+    lean_assert(borrow == 0);
+
+    for (size_t i = 0; i < 2*m; i++)
+        c[i] = z0[i];
+    for (size_t i = 0; i < l1a + l1b; i++)
+        c[2*m + i] = z2[i];
+    size_t lz1 = lsa + lsb;
+    while (lz1 > 0 && z1[lz1-1] == 0)
+        lz1--;
+    mpn_add_in_place(c + m, lnga + lngb - m, z1.data(), lz1);
+}
+
 static size_t div_normalize(mpn_digit const * numer, size_t const lnum,
                             mpn_digit const * denom, size_t const lden,
                             mpn_buffer & n_numer,
@@ -335,14 +427,27 @@ char * mpn_to_string(mpn_digit const * a, size_t const lng, char * buf, size_t c
 
         size_t j = 0;
         mpn_digit rem;
-        mpn_digit ten = 10;
+        /* Extract nine decimal digits per big-number division: the division is
+           the expensive part, so dividing by 10^9 (the largest power of ten
+           that fits in an mpn_digit) instead of 10 cuts the number of passes
+           over the number by 9x. */
+        mpn_digit base = 1000000000u;
         while (!temp.empty() && (temp.size() > 1 || temp[0] != 0)) {
-            size_t d = div_normalize(&temp[0], temp.size(), &ten, 1, t_numer, t_denom);
+            size_t d = div_normalize(&temp[0], temp.size(), &base, 1, t_numer, t_denom);
             div_1(t_numer, t_denom[0], &temp[0]);
             div_unnormalize(t_numer, t_denom, d, &rem);
-            buf[j++] = '0' + rem;
             while (!temp.empty() && temp.back() == 0)
                 temp.pop_back();
+            bool last = temp.empty() || (temp.size() == 1 && temp[0] == 0);
+            /* least-significant digit first; the buffer is reversed below.
+               Chunks below the most significant one are zero-padded to nine
+               digits. */
+            for (unsigned k = 0; k < 9; k++) {
+                buf[j++] = '0' + rem % 10;
+                rem /= 10;
+                if (last && rem == 0)
+                    break;
+            }
         }
         buf[j] = 0;
 
@@ -5,12 +5,16 @@ Released under Apache 2.0 license as described in the file LICENSE.
 Author: Leonardo de Moura
 */
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <algorithm>
 #include <vector>
 #include <deque>
 #include <cmath>
+#include <chrono>
 #include <lean/lean.h>
 #include "runtime/object.h"
+#include "runtime/rcprof.h"
 #include "runtime/thread.h"
 #include "runtime/utf8.h"
 #include "runtime/alloc.h"
@@ -23,9 +27,14 @@ Author: Leonardo de Moura
 
 #ifdef __GLIBC__
 #include <execinfo.h>
+#include <dlfcn.h>
 #include <unistd.h>
 #endif
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 // HACK: for unknown reasons, std::isnan(x) fails on msys64 because math.h
 // is imported and isnan(x) looks like a macro. On the other hand, isnan(x)
 // fails on linux because <cmath> doesn't define it (as expected).
@@ -43,6 +52,13 @@ Author: Leonardo de Moura
 // see `Task.Priority.max`
 #define LEAN_MAX_PRIO 8
 
+/* Weak cell, see the `lean_weak_ref_*` API in lean.h. Defined at file scope
+   because the public API names the incomplete global `struct lean_weak_ref`. */
+struct lean_weak_ref {
+    lean_object *   m_target; /* nullptr once the target has died */
+    lean_weak_ref * m_next;   /* next cell observing the same target */
+};
+
 namespace lean {
 
 static void abort_on_panic() {
@@ -53,8 +69,60 @@ static void abort_on_panic() {
 #endif
 }
 
+static void print_async_backtrace(); // see task section below
+
+#ifdef __GLIBC__
+/* Print captured return addresses one frame per line, each with the containing
+   module and the module-relative offset. The symbol name (when the dynamic
+   symbol table has one) is a convenience; the module+offset pair is the part
+   that stays meaningful after ASLR and stripping, so a production panic log
+   can be symbolized offline with `addr2line -e <module> <offset>`. */
+static void print_backtrace_frames(void * const * bt, int nptrs) {
+    for (int i = 0; i < nptrs; i++) {
+        std::cerr << "#" << i << " " << bt[i];
+        Dl_info info;
+        if (dladdr(bt[i], &info) && info.dli_fname != nullptr) {
+            size_t off = static_cast<char *>(bt[i]) - static_cast<char *>(info.dli_fbase);
+            std::cerr << " " << info.dli_fname << "+0x" << std::hex << off << std::dec;
+            if (info.dli_sname != nullptr)
+                std::cerr << " (" << info.dli_sname << ")";
+        }
+        std::cerr << "\n";
+    }
+}
+#endif
+
+static void print_backtrace() {
+#ifdef __GLIBC__
+    void * bt_buf[100];
+    int nptrs = backtrace(bt_buf, sizeof(bt_buf) / sizeof(void *));
+    print_backtrace_frames(bt_buf, nptrs);
+    if (nptrs == sizeof(bt_buf)) {
+        std::cerr << "...\n";
+    }
+#else
+    std::cerr << "(stack trace unavailable)\n";
+#endif
+}
+
+/* Failure-path reporting shared by `lean_internal_panic` and `lean_panic_fn`:
+   the worker's own stack, followed by the spawn backtraces of the enclosing
+   task chain when LEAN_TASK_BACKTRACE capture is enabled. Disabled with
+   LEAN_BACKTRACE=0. Capture and printing only ever run on the failure path. */
+static void print_panic_backtrace() {
+#ifdef __GLIBC__
+    char * bt_env = getenv("LEAN_BACKTRACE");
+    if (!bt_env || strcmp(bt_env, "0") != 0) {
+        std::cerr << "backtrace:\n";
+        print_backtrace();
+        print_async_backtrace();
+    }
+#endif
+}
+
 extern "C" LEAN_EXPORT void lean_internal_panic(char const * msg) {
     std::cerr << "INTERNAL PANIC: " << msg << "\n";
+    print_panic_backtrace();
     abort_on_panic();
     std::exit(1);
 }
@@ -82,30 +150,11 @@ extern "C" LEAN_EXPORT void lean_set_panic_messages(bool flag) {
     g_panic_messages = flag;
 }
 
-static void print_backtrace() {
-#ifdef __GLIBC__
-    void * bt_buf[100];
-    int nptrs = backtrace(bt_buf, sizeof(bt_buf) / sizeof(void *));
-    backtrace_symbols_fd(bt_buf, nptrs, STDERR_FILENO);
-    if (nptrs == sizeof(bt_buf)) {
-        std::cerr << "...\n";
-    }
-#else
-    std::cerr << "(stack trace unavailable)\n";
-#endif
-}
-
 extern "C" LEAN_EXPORT object * lean_panic_fn(object * default_val, object * msg) {
     // TODO(Leo, Kha): add thread local buffer for interpreter.
     if (g_panic_messages) {
         std::cerr << lean_string_cstr(msg) << "\n";
-#ifdef __GLIBC__
-        char * bt_env = getenv("LEAN_BACKTRACE");
-        if (!bt_env || strcmp(bt_env, "0") != 0) {
-            std::cerr << "backtrace:\n";
-            print_backtrace();
-        }
-#endif
+        print_panic_backtrace();
     }
 
     abort_on_panic();
@@ -121,33 +170,74 @@ extern "C" LEAN_EXPORT object * lean_sorry(uint8) {
     lean_unreachable();
 }
 
+/* LEAN_HEAP_CHECK sanity check on the cold RC paths (see comment in alloc.h). The inline
+   fast path dispatches here only when the counter is not positive, and the caller holds a
+   reference, so a positive counter (on an `inc`) or a counter above one (on a `dec`) means
+   the header has been overwritten since the dispatch -- typically a use after free: the
+   first word of a dead object stores its free-list link. */
+static void heap_check_rc(lean_object * o, int max_valid) {
+    if (o->m_rc > max_valid)
+        lean_internal_panic("heap check: invalid reference counter on the multi-threaded RC path (use after free?)");
+}
+
 extern "C" LEAN_EXPORT void lean_inc_ref_cold(lean_object * o) {
+    if (LEAN_UNLIKELY(g_rcprof_interval != 0))
+        rcprof_tick(o, LEAN_RCPROF_CALL_SITE());
+    if (LEAN_UNLIKELY(g_heap_check))
+        heap_check_rc(o, 0);
     std::atomic_fetch_sub_explicit(lean_get_rc_mt_addr(o), 1, std::memory_order_relaxed);
 }
 
 extern "C" LEAN_EXPORT void lean_inc_ref_n_cold(lean_object * o, unsigned n) {
+    if (LEAN_UNLIKELY(g_rcprof_interval != 0))
+        rcprof_tick(o, LEAN_RCPROF_CALL_SITE());
+    if (LEAN_UNLIKELY(g_heap_check))
+        heap_check_rc(o, 0);
     std::atomic_fetch_sub_explicit(lean_get_rc_mt_addr(o), (int)n, std::memory_order_relaxed);
 }
 
+/* Byte sizes of the non-constructor object kinds whose size is determined by the tag
+   alone, indexed by `tag - LeanClosure`. A zero entry means the size must be read from
+   the object (closures and the array/string kinds) or, for constructors, is not
+   recoverable from the header at all (the trailing scalar area has no size field). For
+   the fixed-size kinds the table replaces `lean_small_object_size`, which dereferences
+   the allocator page header -- usually a cache miss in the graph-walk-heavy compaction
+   and sharing phases. The struct sizes are multiples of LEAN_OBJECT_SIZE_DELTA, so the
+   values coincide with the small-object slot sizes returned before. */
+static size_t const g_fixed_obj_byte_size[16] = {
+    0,                             // LeanClosure
+    0,                             // LeanArray
+    0,                             // LeanStructArray
+    0,                             // LeanScalarArray
+    0,                             // LeanString
+    sizeof(mpz_object),            // LeanMPZ
+    sizeof(lean_thunk_object),     // LeanThunk
+    sizeof(lean_task_object),      // LeanTask
+    sizeof(lean_ref_object),       // LeanRef
+    sizeof(lean_external_object),  // LeanExternal
+    0,                             // LeanReserved
+    0, 0, 0, 0, 0
+};
+
 extern "C" LEAN_EXPORT size_t lean_object_byte_size(lean_object * o) {
-    if (o->m_cs_sz == 0) {
+    uint8 tag = lean_ptr_tag(o);
+    switch (tag) {
+    case LeanArray:       return lean_array_byte_size(o);
+    case LeanScalarArray: return lean_sarray_byte_size(o);
+    case LeanString:      return lean_string_byte_size(o);
+    default:
+        if (o->m_cs_sz != 0) {
+            /* See comment at `lean_set_non_heap_header`, for small objects we store the object size in the RC field. */
+            return o->m_cs_sz;
+        }
         /* Recall that multi-threaded, single-threaded and persistent objects are stored in the heap.
            Persistent objects are multi-threaded and/or single-threaded that have been "promoted" to
            a persistent status. */
-        switch (lean_ptr_tag(o)) {
-        case LeanArray:       return lean_array_byte_size(o);
-        case LeanScalarArray: return lean_sarray_byte_size(o);
-        case LeanString:      return lean_string_byte_size(o);
-        default:              return lean_small_object_size(o);
-        }
-    } else {
-        /* See comment at `lean_set_non_heap_header`, for small objects we store the object size in the RC field. */
-        switch (lean_ptr_tag(o)) {
-        case LeanArray:       return lean_array_byte_size(o);
-        case LeanScalarArray: return lean_sarray_byte_size(o);
-        case LeanString:      return lean_string_byte_size(o);
-        default:              return o->m_cs_sz;
+        if (tag > LeanMaxCtorTag) {
+            if (size_t sz = g_fixed_obj_byte_size[tag - LeanClosure])
+                return sz;
         }
+        return lean_small_object_size(o);
     }
 }
 
@@ -159,12 +249,160 @@ static inline void lean_dealloc(lean_object * o, size_t sz) {
 #endif
 }
 
+static void dealloc_mpz(object * o);
+
+// =======================================
+// Weak references and finalizer queue
+
+/* Weak references are a pure side table: creating one does not touch the
+   target, and the deletion walk only consults the table after checking
+   `g_num_weak_tracked`, so programs that never create a weak reference or
+   register a finalizer pay a single predictable branch per dying object.
+   All table accesses are serialized by `m_mutex`; registration and death are
+   rare next to `lean_weak_ref_get`, which holds the lock only for a lookup
+   and an RC increment. */
+struct weak_target_info {
+    lean_weak_ref *                                     m_cells{nullptr};
+    std::vector<std::pair<lean_finalizer_proc, void *>> m_finalizers;
+};
+
+struct weak_ref_state {
+    mutex                                               m_mutex;
+    std::unordered_map<lean_object *, weak_target_info> m_tracked;
+    std::vector<std::pair<lean_finalizer_proc, void *>> m_pending;
+};
+
+static weak_ref_state * g_weak_refs = nullptr;
+/* Lock-free gates: number of entries in `m_tracked` resp. `m_pending`.
+   Read without the lock on the deletion path and at task-step boundaries. */
+static atomic<unsigned> g_num_weak_tracked(0);
+static atomic<unsigned> g_num_pending_finalizers(0);
+
+static weak_target_info & get_weak_target_info(lean_object * o) {
+    auto it = g_weak_refs->m_tracked.find(o);
+    if (it == g_weak_refs->m_tracked.end()) {
+        it = g_weak_refs->m_tracked.emplace(o, weak_target_info()).first;
+        g_num_weak_tracked++;
+    }
+    return it->second;
+}
+
+/* Invoked from the deletion walk when `o`'s reference count has been
+   committed to zero. Nulls every cell observing `o` and moves its finalizers
+   to the pending queue. Returns true iff a `lean_weak_ref_get` revived `o`
+   after the commit but before we acquired the lock (only possible for
+   single-threaded objects freed lazily, see LEAN_LAZY_RC); the caller must
+   then leave the object alone. Multi-threaded targets cannot be revived:
+   their committed count is 0 and `lean_inc` ignores such objects, and
+   `lean_weak_ref_get` reports them dead (see below). */
+static bool invalidate_weak_target(lean_object * o) {
+    unique_lock<mutex> lock(g_weak_refs->m_mutex);
+    auto it = g_weak_refs->m_tracked.find(o);
+    if (it == g_weak_refs->m_tracked.end())
+        return false;
+    if (lean_is_st(o) && o->m_rc > 1)
+        return true;
+    for (lean_weak_ref * w = it->second.m_cells; w != nullptr;) {
+        lean_weak_ref * n = w->m_next;
+        w->m_target = nullptr;
+        w->m_next   = nullptr;
+        w = n;
+    }
+    for (auto const & f : it->second.m_finalizers) {
+        g_weak_refs->m_pending.push_back(f);
+        g_num_pending_finalizers++;
+    }
+    g_weak_refs->m_tracked.erase(it);
+    g_num_weak_tracked--;
+    return false;
+}
+
+extern "C" LEAN_EXPORT lean_weak_ref * lean_weak_ref_create(b_lean_obj_arg o) {
+    lean_weak_ref * w = new lean_weak_ref{o, nullptr};
+    if (lean_is_scalar(o) || !lean_has_rc(o)) {
+        /* scalars and persistent objects are immortal; no tracking needed */
+        return w;
+    }
+    unique_lock<mutex> lock(g_weak_refs->m_mutex);
+    weak_target_info & info = get_weak_target_info(o);
+    w->m_next    = info.m_cells;
+    info.m_cells = w;
+    return w;
+}
+
+extern "C" LEAN_EXPORT lean_obj_res lean_weak_ref_get(lean_weak_ref * w) {
+    unique_lock<mutex> lock(g_weak_refs->m_mutex);
+    lean_object * o = w->m_target;
+    if (o == nullptr)
+        return nullptr;
+    if (lean_is_scalar(o))
+        return o;
+    if (!lean_has_rc(o) && g_weak_refs->m_tracked.find(o) != g_weak_refs->m_tracked.end()) {
+        /* A tracked object without a reference count is a multi-threaded
+           target whose final decrement has been committed; the deletion walk
+           will null this cell as soon as it reaches the table. This branch
+           also covers objects marked persistent after the weak reference was
+           created; they are conservatively reported dead (see lean.h). */
+        return nullptr;
+    }
+    /* For a lazily freed single-threaded target this increment revives the
+       object: `invalidate_weak_target` sees m_rc > 1 and aborts the free. */
+    lean_inc(o);
+    return o;
+}
+
+extern "C" LEAN_EXPORT void lean_weak_ref_free(lean_weak_ref * w) {
+    if (lean_object * o = w->m_target) {
+        if (!lean_is_scalar(o)) {
+            unique_lock<mutex> lock(g_weak_refs->m_mutex);
+            auto it = g_weak_refs->m_tracked.find(o);
+            if (it != g_weak_refs->m_tracked.end()) {
+                lean_weak_ref ** prev = &it->second.m_cells;
+                while (*prev != nullptr && *prev != w)
+                    prev = &(*prev)->m_next;
+                if (*prev != nullptr)
+                    *prev = w->m_next;
+                if (it->second.m_cells == nullptr && it->second.m_finalizers.empty()) {
+                    g_weak_refs->m_tracked.erase(it);
+                    g_num_weak_tracked--;
+                }
+            }
+        }
+    }
+    delete w;
+}
+
+extern "C" LEAN_EXPORT void lean_register_finalizer(b_lean_obj_arg o, lean_finalizer_proc fn, void * arg) {
+    if (lean_is_scalar(o) || !lean_has_rc(o)) {
+        /* immortal target: the finalizer would never run */
+        return;
+    }
+    unique_lock<mutex> lock(g_weak_refs->m_mutex);
+    get_weak_target_info(o).m_finalizers.emplace_back(fn, arg);
+}
+
+extern "C" LEAN_EXPORT void lean_run_pending_finalizers() {
+    if (g_num_pending_finalizers.load() == 0)
+        return;
+    std::vector<std::pair<lean_finalizer_proc, void *>> fs;
+    {
+        unique_lock<mutex> lock(g_weak_refs->m_mutex);
+        fs.swap(g_weak_refs->m_pending);
+        g_num_pending_finalizers = 0;
+    }
+    /* run the callbacks outside the lock; they may create weak references */
+    for (auto const & f : fs)
+        f.first(f.second);
+}
+
 extern "C" LEAN_EXPORT void lean_free_object(lean_object * o) {
+    if (LEAN_UNLIKELY(g_num_weak_tracked.load() != 0) && invalidate_weak_target(o))
+        return;
     switch (lean_ptr_tag(o)) {
     case LeanArray:       return lean_dealloc(o, lean_array_byte_size(o));
     case LeanScalarArray: return lean_dealloc(o, lean_sarray_byte_size(o));
     case LeanString:      return lean_dealloc(o, lean_string_byte_size(o));
-    case LeanMPZ:         to_mpz(o)->m_value.~mpz(); return lean_free_small_object(o);
+    case LeanMPZ:         return dealloc_mpz(o);
     default:              return lean_free_small_object(o);
     }
 }
@@ -221,15 +459,106 @@ static inline void dec(lean_object * o, lean_object* & todo) {
 
 #ifdef LEAN_LAZY_RC
 LEAN_THREAD_PTR(object, g_to_free);
+/* Maximum number of pending objects destroyed per allocation. Destruction of a big
+   object graph is amortized over subsequent allocations, but each slice must free
+   more than one object so reclamation keeps up with code that allocates little while
+   dropping large structures. */
+#define LEAN_LAZY_RC_SLICE 8
 #endif
 
-static void lean_del_core(object * o, object * & todo);
+#ifdef LEAN_SMALL_ALLOCATOR
+#define LEAN_DEL_BATCH_SIZE 64
+/* Buffer of dead small objects released with a single `lean_free_small_batch` call.
+   Batching amortizes the page lookup and free-list bookkeeping when big object graphs
+   (e.g. multi-million element arrays) are destroyed. */
+struct del_batch {
+    unsigned m_num = 0;
+    void *   m_objs[LEAN_DEL_BATCH_SIZE];
+    void push(lean_object * o) {
+        if (m_num == LEAN_DEL_BATCH_SIZE)
+            flush();
+        m_objs[m_num++] = o;
+    }
+    void flush() {
+        if (m_num > 0) {
+            lean_free_small_batch(m_objs, m_num);
+            m_num = 0;
+        }
+    }
+    ~del_batch() { flush(); }
+};
+#else
+struct del_batch {
+    void push(lean_object * o) { lean_free_small_object(o); }
+    void flush() {}
+};
+#endif
+
+/* Recycling pool for `thunk_object`/`task_object` headers. They are the two hottest
+   small-object allocation sites in async-heavy code, are typically freed shortly after
+   being forced, and have the same size, so a single per-thread inline free list serves
+   both and bypasses the small allocator's size-class dispatch (cf. the mpz pool). */
+#define LEAN_THUNK_TASK_POOL_SIZE 256
+LEAN_THREAD_PTR(lean_object, g_thunk_task_pool);
+LEAN_THREAD_VALUE(unsigned, g_thunk_task_pool_num, 0);
+LEAN_THREAD_VALUE(bool, g_thunk_task_pool_finalizer_registered, false);
+
+static_assert(sizeof(lean_thunk_object) == sizeof(lean_task_object),
+              "thunk and task objects must have the same size to share the recycling pool");
+
+static inline lean_object * thunk_task_pool_next(lean_object * o) {
+    return *reinterpret_cast<lean_object **>(o);
+}
+
+static inline void set_thunk_task_pool_next(lean_object * o, lean_object * n) {
+    *reinterpret_cast<lean_object **>(o) = n;
+}
+
+static void finalize_thunk_task_pool(void *) {
+    while (lean_object * o = g_thunk_task_pool) {
+        g_thunk_task_pool = thunk_task_pool_next(o);
+        lean_free_small_object(o);
+    }
+    g_thunk_task_pool_num = 0;
+}
+
+extern "C" LEAN_EXPORT lean_object * lean_alloc_thunk_task_object() {
+    if (lean_object * o = g_thunk_task_pool) {
+        g_thunk_task_pool = thunk_task_pool_next(o);
+        g_thunk_task_pool_num--;
+        /* `lean_alloc_small` bumps the heartbeat; keep the count identical on the
+           pool fast path so heartbeat-based budgets are unaffected by reuse. */
+        lean_inc_heartbeat();
+        return o;
+    }
+    if (!g_thunk_task_pool_finalizer_registered) {
+        g_thunk_task_pool_finalizer_registered = true;
+        register_thread_finalizer(finalize_thunk_task_pool, nullptr);
+    }
+    return lean_alloc_small_object(sizeof(lean_thunk_object));
+}
+
+static void free_thunk_task_object(lean_object * o) {
+    if (g_thunk_task_pool_num < LEAN_THUNK_TASK_POOL_SIZE) {
+        set_thunk_task_pool_next(o, g_thunk_task_pool);
+        g_thunk_task_pool = o;
+        g_thunk_task_pool_num++;
+    } else {
+        lean_free_small_object(o);
+    }
+}
+
+static void lean_del_core(object * o, object * & todo, del_batch & batch);
 
 extern "C" LEAN_EXPORT lean_object * lean_alloc_object(size_t sz) {
 #ifdef LEAN_LAZY_RC
      if (g_to_free) {
-         object * o = pop_back(g_to_free);
-         lean_del_core(o, g_to_free);
+         del_batch batch;
+         unsigned budget = LEAN_LAZY_RC_SLICE;
+         do {
+             object * o = pop_back(g_to_free);
+             lean_del_core(o, g_to_free, batch);
+         } while (g_to_free && --budget > 0);
      }
 #endif
 #ifdef LEAN_SMALL_ALLOCATOR
@@ -243,20 +572,22 @@ extern "C" LEAN_EXPORT lean_object * lean_alloc_object(size_t sz) {
 
 static void deactivate_task(lean_task_object * t);
 
-static void lean_del_core(object * o, object * & todo) {
+static void lean_del_core(object * o, object * & todo, del_batch & batch) {
+    if (LEAN_UNLIKELY(g_num_weak_tracked.load() != 0) && invalidate_weak_target(o))
+        return;
     uint8 tag = lean_ptr_tag(o);
     if (tag <= LeanMaxCtorTag) {
         object ** it  = lean_ctor_obj_cptr(o);
         object ** end = it + lean_ctor_num_objs(o);
         for (; it != end; ++it) dec(*it, todo);
-        lean_free_small_object(o);
+        batch.push(o);
     } else {
         switch (tag) {
         case LeanClosure: {
             object ** it  = lean_closure_arg_cptr(o);
             object ** end = it + lean_closure_num_fixed(o);
             for (; it != end; ++it) dec(*it, todo);
-            lean_free_small_object(o);
+            batch.push(o);
             break;
         }
         case LeanArray: {
@@ -273,24 +604,23 @@ static void lean_del_core(object * o, object * & todo) {
             lean_dealloc(o, lean_string_byte_size(o));
             break;
         case LeanMPZ:
-            to_mpz(o)->m_value.~mpz();
-            lean_free_small_object(o);
+            dealloc_mpz(o);
             break;
         case LeanThunk:
             if (object * c = lean_to_thunk(o)->m_closure) dec(c, todo);
             if (object * v = lean_to_thunk(o)->m_value) dec(v, todo);
-            lean_free_small_object(o);
+            free_thunk_task_object(o);
             break;
         case LeanRef:
             if (object * v = lean_to_ref(o)->m_value) dec(v, todo);
-            lean_free_small_object(o);
+            batch.push(o);
             break;
         case LeanTask:
             deactivate_task(lean_to_task(o));
             break;
         case LeanExternal:
             lean_to_external(o)->m_class->m_finalize(lean_to_external(o)->m_data);
-            lean_free_small_object(o);
+            batch.push(o);
             break;
         default:
             lean_unreachable();
@@ -299,13 +629,18 @@ static void lean_del_core(object * o, object * & todo) {
 }
 
 extern "C" LEAN_EXPORT void lean_dec_ref_cold(lean_object * o) {
+    if (LEAN_UNLIKELY(g_rcprof_interval != 0))
+        rcprof_tick(o, LEAN_RCPROF_CALL_SITE());
+    if (LEAN_UNLIKELY(g_heap_check))
+        heap_check_rc(o, 1);
     if (o->m_rc == 1 || std::atomic_fetch_add_explicit(lean_get_rc_mt_addr(o), 1, std::memory_order_acq_rel) == -1) {
 #ifdef LEAN_LAZY_RC
         push_back(g_to_free, o);
 #else
         object * todo = nullptr;
+        del_batch batch;
         while (true) {
-            lean_del_core(o, todo);
+            lean_del_core(o, todo, batch);
             if (todo == nullptr)
                 return;
             o = pop_back(todo);
@@ -546,10 +881,174 @@ extern "C" LEAN_EXPORT void lean_mark_mt(object * o) {
     }
 }
 
+// =======================================
+// Heap census
+
+#define LEAN_CENSUS_NUM_BUCKETS 33
+
+/* Census of the object graph reachable from a set of roots: object counts and
+   bytes by tag, and power-of-two size histograms for arrays, scalar arrays and
+   strings. Unlike the tag counters in the compactor (see LEAN_TAG_COUNTERS in
+   compact.cpp), the walk is non-destructive and enabled in every build, so a
+   long-running server can answer "what is in this heap" from a live root
+   (e.g. its environment) instead of from a core dump. Traversal mirrors
+   `lean_mark_mt`, except that an unfinished task is not waited for: only an
+   already available task value is visited. */
+struct heap_census {
+    std::unordered_set<object *> m_visited;
+    buffer<object *>             m_todo;
+    size_t                       m_count[256];
+    size_t                       m_bytes[256];
+    size_t                       m_array_sizes[LEAN_CENSUS_NUM_BUCKETS];
+    size_t                       m_sarray_sizes[LEAN_CENSUS_NUM_BUCKETS];
+    size_t                       m_string_sizes[LEAN_CENSUS_NUM_BUCKETS];
+
+    heap_census() {
+        memset(m_count, 0, sizeof(m_count));
+        memset(m_bytes, 0, sizeof(m_bytes));
+        memset(m_array_sizes, 0, sizeof(m_array_sizes));
+        memset(m_sarray_sizes, 0, sizeof(m_sarray_sizes));
+        memset(m_string_sizes, 0, sizeof(m_string_sizes));
+    }
+
+    void push(object * o) {
+        if (!lean_is_scalar(o))
+            m_todo.push_back(o);
+    }
+
+    /* Bucket 0 counts size 0; bucket i > 0 counts sizes in [2^(i-1), 2^i). */
+    static void add_size(size_t * histogram, size_t sz) {
+        unsigned bucket = 0;
+        while (sz != 0 && bucket < LEAN_CENSUS_NUM_BUCKETS - 1) {
+            bucket++;
+            sz >>= 1;
+        }
+        histogram[bucket]++;
+    }
+
+    void walk();
+};
+
+LEAN_THREAD_PTR(heap_census, g_census);
+
+static obj_res census_fn(obj_arg o) {
+    g_census->push(o);
+    lean_dec(o);
+    return lean_box(0);
+}
+
+void heap_census::walk() {
+    while (!m_todo.empty()) {
+        object * o = m_todo.back();
+        m_todo.pop_back();
+        if (!m_visited.insert(o).second)
+            continue;
+        uint8_t tag = lean_ptr_tag(o);
+        m_count[tag]++;
+        m_bytes[tag] += lean_object_byte_size(o);
+        if (tag <= LeanMaxCtorTag) {
+            object ** it  = lean_ctor_obj_cptr(o);
+            object ** end = it + lean_ctor_num_objs(o);
+            for (; it != end; ++it) push(*it);
+        } else {
+            switch (tag) {
+            case LeanScalarArray:
+                add_size(m_sarray_sizes, lean_sarray_size(o));
+                break;
+            case LeanString:
+                add_size(m_string_sizes, lean_string_size(o));
+                break;
+            case LeanMPZ:
+                break;
+            case LeanExternal: {
+                object * fn = lean_alloc_closure((void*)census_fn, 1, 0);
+                lean_to_external(o)->m_class->m_foreach(lean_to_external(o)->m_data, fn);
+                lean_dec(fn);
+                break;
+            }
+            case LeanTask:
+                /* Do not force the task: a census must not block on (or help run)
+                   pending work. */
+                if (object * v = lean_to_task(o)->m_value) push(v);
+                break;
+            case LeanClosure: {
+                object ** it  = lean_closure_arg_cptr(o);
+                object ** end = it + lean_closure_num_fixed(o);
+                for (; it != end; ++it) push(*it);
+                break;
+            }
+            case LeanArray: {
+                add_size(m_array_sizes, lean_array_size(o));
+                object ** it  = lean_array_cptr(o);
+                object ** end = it + lean_array_size(o);
+                for (; it != end; ++it) push(*it);
+                break;
+            }
+            case LeanThunk:
+                if (object * c = lean_to_thunk(o)->m_closure) push(c);
+                if (object * v = lean_to_thunk(o)->m_value) push(v);
+                break;
+            case LeanRef:
+                if (object * v = lean_to_ref(o)->m_value) push(v);
+                break;
+            default:
+                lean_unreachable();
+                break;
+            }
+        }
+    }
+}
+
+static object * census_histogram(size_t const * v, size_t n) {
+    object * a = lean_alloc_array(n, n);
+    for (size_t i = 0; i < n; i++)
+        lean_array_set_core(a, i, lean_usize_to_nat(v[i]));
+    return a;
+}
+
+/* Runtime.heapCensus : α → BaseIO Runtime.HeapCensus */
+extern "C" LEAN_EXPORT obj_res lean_runtime_heap_census(b_obj_arg a, obj_arg /* w */) {
+    heap_census census;
+    flet<heap_census *> set_census(g_census, &census);
+    census.push(a);
+    census.walk();
+    object * r = lean_alloc_ctor(0, 5, 0);
+    lean_ctor_set(r, 0, census_histogram(census.m_count, 256));
+    lean_ctor_set(r, 1, census_histogram(census.m_bytes, 256));
+    lean_ctor_set(r, 2, census_histogram(census.m_array_sizes, LEAN_CENSUS_NUM_BUCKETS));
+    lean_ctor_set(r, 3, census_histogram(census.m_sarray_sizes, LEAN_CENSUS_NUM_BUCKETS));
+    lean_ctor_set(r, 4, census_histogram(census.m_string_sizes, LEAN_CENSUS_NUM_BUCKETS));
+    return lean_io_result_mk_ok(r);
+}
+
 // =======================================
 // Tasks
 
-LEAN_THREAD_PTR(lean_task_object, g_current_task_object);
+/* Kept in the aggregated `runtime_tls` block together with the step-start
+   heartbeat snapshot below; see thread.h. */
+#define g_current_task_object (g_runtime_tls.m_current_task)
+
+/* Cooperative timeslice for standard tasks, in heartbeats (the allocation-driven
+   counter behind `IO.getNumHeartbeats`). Configured via
+   `LEAN_TASK_TIMESLICE=<thousands of heartbeats>`; 0 (the default) disables
+   accounting. Workers run each task step to completion, so a task cannot be
+   suspended mid-step; instead a task that has consumed more than the budget is
+   *demoted*: its later steps skip the high-priority lane and the inline
+   continuation fast path and queue behind all waiting work. On a shared server
+   this bounds the latency of small tasks: a heavy multi-step task stops
+   overtaking them after at most one timeslice. Over-budget status is detected
+   at the existing poll points (`IO.checkCanceled`) and at step boundaries. */
+static uint64 g_task_timeslice = 0;
+/* Default per-task allocation budget in heartbeats (one heartbeat per small
+   allocation), configured via `LEAN_TASK_ALLOC_BUDGET=<thousands>`; 0 (the
+   default) means unlimited. A task over its budget is cancelled cooperatively,
+   exactly as by `IO.cancel`, so one runaway elaboration aborts at its next
+   poll point instead of OOM-killing a shared server. Each task (and each
+   subtask, which inherits the cap) is bounded individually; see
+   `IO.setTaskMaxAllocs` for per-task control. */
+static size_t g_task_alloc_budget = 0;
+/* Heartbeat count at the start of the step currently running on this worker. */
+#define g_task_step_start_heartbeats (g_runtime_tls.m_task_step_start_heartbeats)
 
 static lean_task_imp * alloc_task_imp(obj_arg c, unsigned prio, bool keep_alive) {
     lean_task_imp * imp = (lean_task_imp*)lean_alloc_small_object(sizeof(lean_task_imp));
@@ -560,53 +1059,282 @@ static lean_task_imp * alloc_task_imp(obj_arg c, unsigned prio, bool keep_alive)
     imp->m_canceled    = false;
     imp->m_keep_alive  = keep_alive;
     imp->m_deleted     = false;
+    imp->m_demoted     = false;
+    imp->m_elapsed     = 0;
+    imp->m_max_allocs  = g_task_alloc_budget;
+    imp->m_spawn_bt      = nullptr;
+    imp->m_spawn_bt_size = 0;
+#ifdef __GLIBC__
+    /* Spawn backtraces cost one `backtrace` call and a small allocation per task,
+       so they are opt-in; panics then report where the failing task (and its
+       ancestors, see `print_async_backtrace`) was spawned. */
+    static bool capture_bt = std::getenv("LEAN_TASK_BACKTRACE") != nullptr;
+    if (capture_bt) {
+        void * bt[32];
+        int nptrs = backtrace(bt, sizeof(bt) / sizeof(void *));
+        if (nptrs > 0) {
+            imp->m_spawn_bt = static_cast<void **>(malloc(nptrs * sizeof(void *)));
+            memcpy(imp->m_spawn_bt, bt, nptrs * sizeof(void *));
+            imp->m_spawn_bt_size = nptrs;
+        }
+    }
+#endif
+    imp->m_parent       = nullptr;
+    imp->m_head_child   = nullptr;
+    imp->m_next_sibling = nullptr;
+    imp->m_prev_sibling = nullptr;
     return imp;
 }
 
 static void free_task_imp(lean_task_imp * imp) {
+    if (imp->m_spawn_bt)
+        free(imp->m_spawn_bt);
     lean_free_small_object((lean_object*)imp);
 }
 
 static void free_task(lean_task_object * t) {
     if (t->m_imp) free_task_imp(t->m_imp);
-    lean_free_small_object((lean_object*)t);
+    free_thunk_task_object((lean_object*)t);
 }
 
 struct scoped_current_task_object : flet<lean_task_object *> {
     scoped_current_task_object(lean_task_object * t):flet(g_current_task_object, t) {}
 };
 
+/* Report the spawn backtraces of the task running on this thread and of its
+   ancestors in the cancellation tree (see `print_panic_backtrace`). Best
+   effort by design: the process is already failing, so the chain is read
+   without the task-manager mutex and the walk stops at the first link that
+   looks torn down. */
+static void print_async_backtrace() {
+#ifdef __GLIBC__
+    lean_task_object * t = g_current_task_object;
+    while (t != nullptr) {
+        lean_task_imp * imp = t->m_imp;
+        if (imp == nullptr || imp->m_deleted)
+            break;
+        if (imp->m_spawn_bt != nullptr) {
+            std::cerr << "task spawned at:\n";
+            print_backtrace_frames(imp->m_spawn_bt, imp->m_spawn_bt_size);
+        }
+        t = imp->m_parent;
+    }
+#endif
+}
+
+/* Per-worker ready queue. Each standard worker owns one; other workers steal from its
+   back when they run out of local work. Guarded by its own mutex, so enqueues and
+   dequeues on different workers never contend with each other (or with the task-manager
+   mutex, which keeps protecting task lifecycle state: dependencies, resolution,
+   cancellation). */
+struct worker_info {
+    mutex                          m_mutex;
+    std::deque<lean_task_object *> m_queue;
+    /* Continuation to run next on this worker, bypassing the queues. When a task
+       finishes, its first runnable dependent is executed inline on the same worker
+       (unless local work is pending), so a chain of `Task.bind`s does not ping-pong
+       between workers and keeps the captured data of the bound closures in cache. */
+    lean_task_object *             m_inline_next{nullptr};
+    /* Worker reserved for the high-priority lane: it never picks up priority-0 work,
+       so an interactive task is served promptly even when every other worker is busy
+       with long-running background tasks. See `task_manager::m_high_queue`. */
+    bool                           m_high_only{false};
+};
+
+LEAN_THREAD_PTR(worker_info, g_worker_info);
+
+/* Spin-round bounds for idle workers: rounds grow exponentially from
+   LEAN_WORKER_SPIN_INIT to LEAN_WORKER_SPIN_MAX counter probes before the worker
+   parks on the condition variable. The total budget (~16K probes) is a few
+   microseconds, well under one futex wake round-trip. */
+#define LEAN_WORKER_SPIN_INIT 32
+#define LEAN_WORKER_SPIN_MAX  8192
+
+/* Concurrency-controller epoch length and lower bound on active general workers,
+   see `task_manager::autotune_step`. */
+#define LEAN_AUTOTUNE_EPOCH_MS    100
+#define LEAN_AUTOTUNE_MIN_WORKERS 2
+
 class task_manager {
     mutex                                         m_mutex;
-    unsigned                                      m_num_std_workers{0};
-    unsigned                                      m_idle_std_workers{0};
+    atomic<unsigned>                              m_num_std_workers{0};
+    atomic<unsigned>                              m_idle_std_workers{0};
     unsigned                                      m_max_std_workers{0};
     unsigned                                      m_num_dedicated_workers{0};
-    std::deque<lean_task_object *>                m_queues[LEAN_MAX_PRIO+1];
-    unsigned                                      m_queues_size{0};
-    unsigned                                      m_max_prio{0};
+    /* Dedicated (priority > LEAN_MAX_PRIO) tasks waiting for a dedicated worker, and
+       the number of dedicated workers parked on `m_dedicated_cv`. Dedicated workers
+       are pooled: after finishing a task they park with their (lazily initialized)
+       thread heap warm instead of exiting, so servers spawning dedicated tasks at
+       high frequency only pay thread creation while the pool grows. All three are
+       protected by `m_mutex`. */
+    std::deque<lean_task_object *>                m_dedicated_ready;
+    unsigned                                      m_idle_dedicated_workers{0};
+    condition_variable                            m_dedicated_cv;
+    std::vector<std::unique_ptr<worker_info>>     m_workers;
+    /* Shared lane for tasks with standard priority > 0. Every worker drains it before
+       its own queue, so prioritized tasks overtake all queued background work instead
+       of merely jumping to the front of one worker's queue (from which other workers
+       steal at the *back*). FIFO within the lane. */
+    mutex                                         m_high_mutex;
+    std::deque<lean_task_object *>                m_high_queue;
+    atomic<unsigned>                              m_num_high_ready{0};
+    /* Number of workers serving priority-0 tasks; the remaining (reserved) workers only
+       serve the high-priority lane. */
+    unsigned                                      m_num_general{0};
+    atomic<unsigned>                              m_num_ready{0};
+    /* Number of workers spinning on the ready counters before parking on
+       `m_queue_cv`. Enqueues subtract them from the wakeups they issue, since a
+       spinner picks up new work without a futex round-trip. */
+    atomic<unsigned>                              m_spinning_workers{0};
+    atomic<unsigned>                              m_next_worker{0};
     condition_variable                            m_queue_cv;
     condition_variable                            m_task_finished_cv;
     condition_variable                            m_worker_finished_cv;
     bool                                          m_shutting_down{false};
+    /* Feedback-driven concurrency control (opt-in via LEAN_TASK_AUTOTUNE).
+       Allocation-heavy workloads saturate memory bandwidth well below the core
+       count on large machines, after which additional workers only add allocator
+       and RC contention. When enabled, the scheduler measures task throughput
+       per epoch and hill-climbs `m_active_general`, a soft cap on the number of
+       workers serving the general queues; workers above the cap park on
+       `m_throttle_cv` (a separate condition variable, so enqueue wakeups on
+       `m_queue_cv` only ever reach workers that will take the work) until the
+       cap rises again. The high-priority lane and dedicated workers are never
+       throttled. The epoch state below the cap is protected by `m_mutex`. */
+    bool                                          m_autotune{false};
+    atomic<unsigned>                              m_active_general{0};
+    condition_variable                            m_throttle_cv;
+    uint64                                        m_tasks_completed{0};
+    uint64                                        m_epoch_base{0};
+    std::chrono::steady_clock::time_point         m_epoch_start;
+    double                                        m_prev_throughput{0.0};
+    int                                           m_climb_dir{-1};
+
+    /* Push `t` into a ready queue: the current worker's own queue for locality, or
+       round-robin when enqueuing from a non-worker thread. Priorities are approximate:
+       prioritized tasks go to the front of the chosen queue. */
+    void push_ready(lean_task_object * t) {
+        if (t->m_imp->m_prio > 0 && !t->m_imp->m_demoted) {
+            {
+                lock_guard<mutex> lock(m_high_mutex);
+                m_high_queue.push_back(t);
+            }
+            m_num_high_ready++;
+            m_num_ready++;
+            return;
+        }
+        worker_info * wi = g_worker_info;
+        if (wi == nullptr || wi->m_high_only)
+            /* `m_active_general` equals `m_num_general` unless the concurrency
+               controller has lowered the cap; routing new work to unthrottled
+               workers keeps it from idling in queues of parked workers (anything
+               already there is stolen). */
+            wi = m_workers[m_next_worker++ % m_active_general.load()].get();
+        {
+            lock_guard<mutex> lock(wi->m_mutex);
+            wi->m_queue.push_back(t);
+        }
+        m_num_ready++;
+    }
 
-    lean_task_object * dequeue() {
-        lean_assert(m_queues_size != 0);
-        std::deque<lean_task_object *> & q = m_queues[m_max_prio];
-        lean_assert(!q.empty());
-        lean_task_object * result      = q.front();
-        q.pop_front();
-        m_queues_size--;
-        if (q.empty()) {
-            while (m_max_prio > 0) {
-                --m_max_prio;
-                if (!m_queues[m_max_prio].empty())
-                    break;
+    /* Take a task from the worker's own queue (front, FIFO), or steal from the back of
+       another worker's queue. Returns nullptr if every queue is empty. */
+    lean_task_object * pop_or_steal(unsigned idx) {
+        {
+            lock_guard<mutex> lock(m_high_mutex);
+            if (!m_high_queue.empty()) {
+                lean_task_object * t = m_high_queue.front();
+                m_high_queue.pop_front();
+                m_num_high_ready--;
+                m_num_ready--;
+                return t;
             }
         }
-        return result;
+        if (m_workers[idx]->m_high_only)
+            return nullptr;
+        unsigned n = m_workers.size();
+        {
+            worker_info & own = *m_workers[idx];
+            lock_guard<mutex> lock(own.m_mutex);
+            if (!own.m_queue.empty()) {
+                lean_task_object * t = own.m_queue.front();
+                own.m_queue.pop_front();
+                m_num_ready--;
+                return t;
+            }
+        }
+        for (unsigned i = 1; i < n; i++) {
+            worker_info & victim = *m_workers[(idx + i) % n];
+            lock_guard<mutex> lock(victim.m_mutex);
+            if (!victim.m_queue.empty()) {
+                lean_task_object * t = victim.m_queue.back();
+                victim.m_queue.pop_back();
+                m_num_ready--;
+                return t;
+            }
+        }
+        return nullptr;
+    }
+
+    /* Wake at most `n` parked workers for `n` newly enqueued tasks. Spinning workers
+       are subtracted first: they observe the ready counters directly and need no
+       wakeup. Callers must have made the tasks visible in the ready counters before
+       calling (see the pairing argument at the wait site). */
+    void notify_workers(size_t n) {
+        size_t spinning = m_spinning_workers.load();
+        if (n <= spinning)
+            return;
+        n -= spinning;
+        /* The reserved high-lane worker shares the condition variable and may swallow
+           one wakeup meant for a general worker; keep one notify of slack. */
+        if (m_num_general < m_max_std_workers)
+            n++;
+        if (n >= m_idle_std_workers.load()) {
+            m_queue_cv.notify_all();
+        } else {
+            for (size_t i = 0; i < n; i++)
+                m_queue_cv.notify_one();
+        }
     }
 
+    /* Requires `m_mutex`. One step of the hill-climbing concurrency controller,
+       called from the worker loop after task completions: once per epoch
+       (LEAN_AUTOTUNE_EPOCH_MS of wall time), compare task throughput against the
+       previous epoch, keep moving the active-worker cap in the current direction
+       while throughput holds, and reverse after a regression. On a
+       bandwidth-bound workload the cap settles into an oscillation of ±1 around
+       the saturation point instead of running every core. */
+    void autotune_step() {
+        auto now  = std::chrono::steady_clock::now();
+        double ms = std::chrono::duration_cast<std::chrono::microseconds>(now - m_epoch_start).count() / 1000.0;
+        if (ms < LEAN_AUTOTUNE_EPOCH_MS)
+            return;
+        double throughput = static_cast<double>(m_tasks_completed - m_epoch_base) / ms;
+        /* Require a clear regression before reversing, so measurement noise does
+           not turn the climb into a random walk. */
+        if (m_prev_throughput > 0.0 && throughput < 0.95 * m_prev_throughput)
+            m_climb_dir = -m_climb_dir;
+        unsigned lo  = std::min<unsigned>(LEAN_AUTOTUNE_MIN_WORKERS, m_num_general);
+        unsigned cur = m_active_general.load();
+        if (m_climb_dir < 0) {
+            if (cur > lo)
+                m_active_general.store(cur - 1);
+            else
+                m_climb_dir = 1;
+        } else {
+            if (cur < m_num_general) {
+                m_active_general.store(cur + 1);
+                m_throttle_cv.notify_all();
+            } else {
+                m_climb_dir = -1;
+            }
+        }
+        m_prev_throughput = throughput;
+        m_epoch_base      = m_tasks_completed;
+        m_epoch_start     = now;
+    }
+
+    /* Requires `m_mutex` to be held (it serializes worker spawning). */
     void enqueue_core(lean_task_object * t) {
         lean_assert(t->m_imp);
         unsigned prio = t->m_imp->m_prio;
@@ -614,17 +1342,86 @@ class task_manager {
             spawn_dedicated_worker(t);
             return;
         }
-        if (prio > m_max_prio)
-            m_max_prio = prio;
-        m_queues[prio].push_back(t);
-        m_queues_size++;
-        if (!m_idle_std_workers && m_num_std_workers < m_max_std_workers)
+        push_ready(t);
+        if (m_idle_std_workers.load() == 0 && m_num_std_workers.load() < m_max_std_workers)
             spawn_worker();
         else
-            m_queue_cv.notify_one();
+            notify_workers(1);
+    }
+
+    /* Requires `m_mutex`. Detach `t` from the cancellation tree: unlink it from its
+       parent's child list and orphan its own children. Must be called before `m_imp`
+       is freed or the task is marked deleted, so sibling lists only ever contain tasks
+       with a live `m_imp`. */
+    void detach_scope(lean_task_object * t) {
+        lean_task_imp * imp = t->m_imp;
+        lean_assert(imp);
+        if (lean_task_object * p = imp->m_parent) {
+            lean_assert(p->m_imp);
+            if (imp->m_prev_sibling)
+                imp->m_prev_sibling->m_imp->m_next_sibling = imp->m_next_sibling;
+            else
+                p->m_imp->m_head_child = imp->m_next_sibling;
+            if (imp->m_next_sibling)
+                imp->m_next_sibling->m_imp->m_prev_sibling = imp->m_prev_sibling;
+            imp->m_parent       = nullptr;
+            imp->m_prev_sibling = nullptr;
+            imp->m_next_sibling = nullptr;
+        }
+        lean_task_object * c = imp->m_head_child;
+        imp->m_head_child = nullptr;
+        while (c) {
+            lean_task_object * next = c->m_imp->m_next_sibling;
+            c->m_imp->m_parent       = nullptr;
+            c->m_imp->m_prev_sibling = nullptr;
+            c->m_imp->m_next_sibling = nullptr;
+            c = next;
+        }
+    }
+
+    /* Requires `m_mutex`. Record the task currently running on this thread (if any) as
+       the parent of `child` in the cancellation tree. Must run before `child` is
+       published to the scheduler, so `child->m_imp` cannot be freed concurrently. */
+    void record_parent_core(lean_task_object * child) {
+        lean_task_object * parent = g_current_task_object;
+        if (parent == nullptr || parent->m_imp == nullptr || parent->m_imp->m_deleted)
+            return;
+        lean_assert(child->m_imp);
+        child->m_imp->m_parent       = parent;
+        child->m_imp->m_next_sibling = parent->m_imp->m_head_child;
+        if (parent->m_imp->m_head_child)
+            parent->m_imp->m_head_child->m_imp->m_prev_sibling = child;
+        parent->m_imp->m_head_child  = child;
+        /* A subtree cancelled mid-flight must not leak newly spawned descendants. */
+        if (parent->m_imp->m_canceled)
+            child->m_imp->m_canceled = true;
+        /* Subtasks inherit the parent's allocation budget as their own cap, so a
+           bounded task cannot escape its limit by spawning helpers. */
+        if (parent->m_imp->m_max_allocs != 0)
+            child->m_imp->m_max_allocs = parent->m_imp->m_max_allocs;
+    }
+
+    /* Requires `m_mutex`. Cancel `t` and every descendant recorded in the
+       cancellation tree. */
+    void cancel_core(lean_task_object * t) {
+        if (t->m_imp == nullptr)
+            return;
+        /* Iterative with an explicit worklist: spawn trees can be as deep as
+           user-level recursion, and this runs while holding `m_mutex`, so the
+           C++ stack must not be a limit. */
+        std::vector<lean_task_object *> todo;
+        todo.push_back(t);
+        while (!todo.empty()) {
+            lean_task_object * cur = todo.back();
+            todo.pop_back();
+            cur->m_imp->m_canceled = true;
+            for (lean_task_object * c = cur->m_imp->m_head_child; c != nullptr; c = c->m_imp->m_next_sibling)
+                todo.push_back(c);
+        }
     }
 
     void deactivate_task_core(unique_lock<mutex> & lock, lean_task_object * t) {
+        detach_scope(t);
         object * c              = t->m_imp->m_closure;
         lean_task_object * it   = t->m_imp->m_head_dep;
         t->m_imp->m_closure     = nullptr;
@@ -643,39 +1440,114 @@ class task_manager {
     }
 
     void spawn_worker() {
-        m_num_std_workers++;
-        lthread([this]() {
+        unsigned idx = m_num_std_workers++;
+        lthread([this, idx]() {
             save_stack_info(false);
+            g_worker_info = m_workers[idx].get();
             unique_lock<mutex> lock(m_mutex);
             m_idle_std_workers++;
             while (true) {
-                if (m_queues_size == 0) {
+                if (m_autotune && !g_worker_info->m_high_only && idx >= m_active_general.load()) {
+                    if (m_shutting_down)
+                        break;
+                    /* Parked by the concurrency controller; leftover tasks in this
+                       worker's queue are picked up by the others via stealing. */
+                    m_throttle_cv.wait(lock);
+                    continue;
+                }
+                lock.unlock();
+                lean_task_object * t = pop_or_steal(idx);
+                lock.lock();
+                if (t == nullptr) {
                     if (m_shutting_down) {
                         break;
                     }
-                    m_queue_cv.wait(lock);
+                    /* A reserved worker only watches the high lane; it must not pick up
+                       (or spin for) background tasks it will never take. */
+                    bool high_only = g_worker_info->m_high_only;
+                    atomic<unsigned> & ready = high_only ? m_num_high_ready : m_num_ready;
+                    if (ready.load() == 0) {
+                        /* At fine task granularity the futex wake latency dominates, so
+                           spin on the ready counter with exponentially growing rounds
+                           before parking. The spin runs without the manager mutex; the
+                           recheck under the lock below pairs with the counter increment
+                           in `push_ready`, so an enqueue that elected to skip the wakeup
+                           because it saw this spinner can never be missed. */
+                        lock.unlock();
+                        m_spinning_workers++;
+                        bool found = false;
+                        for (unsigned spins = LEAN_WORKER_SPIN_INIT; spins <= LEAN_WORKER_SPIN_MAX; spins *= 2) {
+                            for (unsigned i = 0; i < spins; i++) {
+                                if (ready.load() != 0) {
+                                    found = true;
+                                    break;
+                                }
+                            }
+                            if (found)
+                                break;
+                            this_thread::yield();
+                        }
+                        m_spinning_workers--;
+                        lock.lock();
+                        if (!found && !m_shutting_down && ready.load() == 0)
+                            m_queue_cv.wait(lock);
+                    }
                     continue;
                 }
-
-                lean_task_object * t = dequeue();
                 m_idle_std_workers--;
                 run_task(lock, t);
-                m_idle_std_workers++;
                 reset_heartbeat();
+                if (m_autotune)
+                    m_tasks_completed++;
+                /* Run continuations scheduled inline by `handle_finished`. */
+                while (lean_task_object * next = g_worker_info->m_inline_next) {
+                    g_worker_info->m_inline_next = nullptr;
+                    run_task(lock, next);
+                    reset_heartbeat();
+                    if (m_autotune)
+                        m_tasks_completed++;
+                }
+                if (m_autotune)
+                    autotune_step();
+                m_idle_std_workers++;
             }
             m_idle_std_workers--;
             m_num_std_workers--;
+            g_worker_info = nullptr;
             m_worker_finished_cv.notify_all();
         });
         // `lthread` will be implicitly freed, which frees up its control resources but does not terminate the thread
     }
 
+    /* Upper bound on parked dedicated workers; a worker that finds the pool full on
+       completion exits instead of parking, so a burst of dedicated tasks does not pin
+       threads (and their heaps) forever. */
+    #define LEAN_MAX_PARKED_DEDICATED_WORKERS 8
+
     void spawn_dedicated_worker(lean_task_object * t) {
+        m_dedicated_ready.push_back(t);
+        if (m_idle_dedicated_workers > 0) {
+            /* Reuse a parked worker; its thread heap is already initialized. */
+            m_dedicated_cv.notify_one();
+            return;
+        }
         m_num_dedicated_workers++;
-        lthread([this, t]() {
+        lthread([this]() {
             save_stack_info(false);
             unique_lock<mutex> lock(m_mutex);
-            run_task(lock, t);
+            while (true) {
+                if (m_dedicated_ready.empty()) {
+                    if (m_shutting_down || m_idle_dedicated_workers >= LEAN_MAX_PARKED_DEDICATED_WORKERS)
+                        break;
+                    m_idle_dedicated_workers++;
+                    m_dedicated_cv.wait(lock, [&]() { return !m_dedicated_ready.empty() || m_shutting_down; });
+                    m_idle_dedicated_workers--;
+                    continue;
+                }
+                lean_task_object * next = m_dedicated_ready.front();
+                m_dedicated_ready.pop_front();
+                run_task(lock, next);
+            }
             m_num_dedicated_workers--;
             m_worker_finished_cv.notify_all();
         });
@@ -689,6 +1561,7 @@ class task_manager {
             return;
         }
         reset_heartbeat();
+        g_task_step_start_heartbeats = get_num_heartbeats();
         object * v = nullptr;
         {
             scoped_current_task_object scope_cur_task(t);
@@ -700,9 +1573,23 @@ class task_manager {
             if (v != nullptr && t->m_imp->m_keep_alive) {
                 lean_dec_ref((lean_object*)t);
             }
+            /* task-step boundary: a safe point for finalizers queued by the
+               deletion walk (see lean_register_finalizer in lean.h) */
+            if (LEAN_UNLIKELY(g_num_pending_finalizers.load() != 0))
+                lean_run_pending_finalizers();
             lock.lock();
         }
         lean_assert(t->m_imp);
+        if ((g_task_timeslice != 0 || t->m_imp->m_max_allocs != 0) && v == nullptr && !t->m_imp->m_deleted) {
+            /* The step finished but the task runs again later (nested `bind` task):
+               charge the step against its timeslice and allocation budget before it
+               is rescheduled. */
+            t->m_imp->m_elapsed += get_num_heartbeats() - g_task_step_start_heartbeats;
+            if (g_task_timeslice != 0 && t->m_imp->m_elapsed > g_task_timeslice)
+                t->m_imp->m_demoted = true;
+            if (t->m_imp->m_max_allocs != 0 && t->m_imp->m_elapsed > t->m_imp->m_max_allocs)
+                cancel_core(t); /* m_mutex is held */
+        }
         if (t->m_imp->m_deleted) {
             lock.unlock();
             if (v) lean_dec(v);
@@ -720,6 +1607,7 @@ class task_manager {
     }
 
     void resolve_core(lean_task_object * t, object * v) {
+        detach_scope(t);
         handle_finished(t);
         mark_mt(v);
         t->m_value = v;
@@ -730,6 +1618,29 @@ class task_manager {
         m_task_finished_cv.notify_all();
     }
 
+    /* Schedule `t` to run directly after the current task on this worker. Only done on a
+       standard worker whose own queue is empty, so queued work is never starved by a long
+       chain of continuations. */
+    bool try_schedule_inline(lean_task_object * t) {
+        worker_info * wi = g_worker_info;
+        if (wi == nullptr || wi->m_inline_next != nullptr)
+            return false;
+        if (t->m_imp->m_prio > LEAN_MAX_PRIO)
+            return false;
+        /* A task over its timeslice must queue behind waiting work. */
+        if (t->m_imp->m_demoted)
+            return false;
+        if (wi->m_high_only && t->m_imp->m_prio == 0)
+            return false;
+        {
+            lock_guard<mutex> lock(wi->m_mutex);
+            if (!wi->m_queue.empty())
+                return false;
+        }
+        wi->m_inline_next = t;
+        return true;
+    }
+
     void handle_finished(lean_task_object * t) {
         lean_task_object * it = t->m_imp->m_head_dep;
         t->m_imp->m_head_dep = nullptr;
@@ -740,6 +1651,8 @@ class task_manager {
             it->m_imp->m_next_dep = nullptr;
             if (it->m_imp->m_deleted) {
                 free_task(it);
+            } else if (try_schedule_inline(it)) {
+                /* runs next on this worker, see worker loop */
             } else {
                 enqueue_core(it);
             }
@@ -761,19 +1674,95 @@ class task_manager {
 public:
     task_manager(unsigned max_std_workers):
         m_max_std_workers(max_std_workers) {
+        /* Queues are created eagerly so that tasks can be distributed over all slots even
+           before the corresponding (lazily spawned) workers exist; running workers steal
+           the tasks of not-yet-started ones. */
+        for (unsigned i = 0; i < max_std_workers; i++)
+            m_workers.push_back(std::unique_ptr<worker_info>(new worker_info()));
+        /* On pools of language-server size, reserve the last worker for the
+           high-priority lane; it idles when there is no prioritized work, which is
+           cheaper than interactive requests waiting behind a full pool of background
+           elaboration. Small pools keep all workers general; the drain-first rule on
+           the lane still gives prioritized tasks the next free worker. */
+        unsigned reserved = max_std_workers >= 4 ? 1 : 0;
+        m_num_general = max_std_workers - reserved;
+        for (unsigned i = m_num_general; i < max_std_workers; i++)
+            m_workers[i]->m_high_only = true;
+        m_active_general = m_num_general;
+        /* The controller needs headroom on both sides of the cap to probe;
+           pools at the minimum are left alone. */
+        if (std::getenv("LEAN_TASK_AUTOTUNE") != nullptr && m_num_general > LEAN_AUTOTUNE_MIN_WORKERS) {
+            m_autotune    = true;
+            m_epoch_start = std::chrono::steady_clock::now();
+        }
     }
 
     ~task_manager() {
         unique_lock<mutex> lock(m_mutex);
         m_shutting_down = true;
         m_queue_cv.notify_all();
+        m_throttle_cv.notify_all();
+        m_dedicated_cv.notify_all();
         // wait for all workers to finish
         m_worker_finished_cv.wait(lock, [&]() { return m_num_std_workers + m_num_dedicated_workers == 0; });
     }
 
     void enqueue(lean_task_object * t) {
+        unsigned prio = t->m_imp->m_prio;
+        if (prio > LEAN_MAX_PRIO || (m_idle_std_workers.load() == 0 && m_num_std_workers.load() < m_max_std_workers)) {
+            /* Dedicated tasks and worker spawning are serialized by the manager mutex. */
+            unique_lock<mutex> lock(m_mutex);
+            enqueue_core(t);
+            return;
+        }
+        push_ready(t);
+        if (m_idle_std_workers.load() > 0) {
+            /* Briefly acquiring the mutex pairs with the sleep predicate: a worker that
+               found no work is either before its predicate re-check (and will see the
+               task counted in m_num_ready) or already waiting (and will get the notify),
+               so the wakeup cannot be lost. */
+            { unique_lock<mutex> lock(m_mutex); }
+            notify_workers(1);
+        }
+    }
+
+    /* Enqueue `n` ready tasks (all with the same standard priority) with a single
+       scheduler entry: the tasks are spread over the worker queues in contiguous chunks,
+       workers are spawned up to the number of tasks, and sleeping workers are notified
+       once, instead of one lock/notify round-trip per task. */
+    void enqueue_batch(lean_task_object ** ts, size_t n) {
+        if (n == 0)
+            return;
         unique_lock<mutex> lock(m_mutex);
-        enqueue_core(t);
+        if (ts[0]->m_imp->m_prio > 0) {
+            {
+                lock_guard<mutex> ql(m_high_mutex);
+                for (size_t i = 0; i < n; i++)
+                    m_high_queue.push_back(ts[i]);
+            }
+            m_num_high_ready += n;
+            m_num_ready += n;
+            size_t target = std::min<size_t>(m_max_std_workers, m_num_std_workers.load() + n);
+            while (m_num_std_workers.load() < target)
+                spawn_worker();
+            m_queue_cv.notify_all();
+            return;
+        }
+        size_t num_queues = m_active_general.load();
+        unsigned start = m_next_worker++;
+        size_t i = 0;
+        for (size_t q = 0; q < num_queues && i < n; q++) {
+            size_t cnt = (n - i + num_queues - q - 1) / (num_queues - q);
+            worker_info & wi = *m_workers[(start + q) % num_queues];
+            lock_guard<mutex> ql(wi.m_mutex);
+            for (size_t j = 0; j < cnt; j++, i++)
+                wi.m_queue.push_back(ts[i]);
+        }
+        m_num_ready += n;
+        size_t target = std::min<size_t>(m_max_std_workers, m_num_std_workers.load() + n);
+        while (m_num_std_workers.load() < target)
+            spawn_worker();
+        notify_workers(n);
     }
 
     void resolve(lean_task_object * t, object * v) {
@@ -837,8 +1826,22 @@ public:
 
     void cancel(lean_task_object * t) {
         unique_lock<mutex> lock(m_mutex);
-        if (t->m_imp)
-            t->m_imp->m_canceled = true;
+        cancel_core(t);
+    }
+
+    void record_parent(lean_task_object * child) {
+        if (g_current_task_object == nullptr)
+            return;
+        unique_lock<mutex> lock(m_mutex);
+        record_parent_core(child);
+    }
+
+    void record_parent_batch(lean_task_object ** ts, size_t n) {
+        if (g_current_task_object == nullptr)
+            return;
+        unique_lock<mutex> lock(m_mutex);
+        for (size_t i = 0; i < n; i++)
+            record_parent_core(ts[i]);
     }
 
     bool shutting_down() const {
@@ -877,6 +1880,19 @@ extern "C" LEAN_EXPORT void lean_finalize_task_manager() {
     }
 }
 
+/* Replace the task manager in a child created by fork(2). The old manager's
+   worker threads do not exist in the child, and its queue mutex may have been
+   held by one of them at fork time, so it must be abandoned (leaked), not
+   destroyed. Only safe right after fork, before the child spawns any task. */
+extern "C" LEAN_EXPORT void lean_reinit_task_manager_after_fork(unsigned num_workers) {
+#if defined(LEAN_MULTI_THREAD)
+    g_task_manager = nullptr;
+    if (num_workers > 0) {
+        g_task_manager = new task_manager(num_workers);
+    }
+#endif
+}
+
 scoped_task_manager::scoped_task_manager(unsigned num_workers) {
     lean_assert(g_task_manager == nullptr);
 #if defined(LEAN_MULTI_THREAD)
@@ -912,7 +1928,7 @@ static inline void lean_set_task_header(lean_object * o) {
 
 static lean_task_object * alloc_task(obj_arg c, unsigned prio, bool keep_alive) {
     lean_mark_mt(c);
-    lean_task_object * o = (lean_task_object*)lean_alloc_small_object(sizeof(lean_task_object));
+    lean_task_object * o = (lean_task_object*)lean_alloc_thunk_task_object();
     lean_set_task_header((lean_object*)o);
     o->m_value = nullptr;
     o->m_imp   = alloc_task_imp(c, prio, keep_alive);
@@ -922,7 +1938,7 @@ static lean_task_object * alloc_task(obj_arg c, unsigned prio, bool keep_alive)
 }
 
 static lean_task_object * alloc_task(obj_arg v) {
-    lean_task_object * o = (lean_task_object*)lean_alloc_small_object(sizeof(lean_task_object));
+    lean_task_object * o = (lean_task_object*)lean_alloc_thunk_task_object();
     lean_set_st_header((lean_object*)o, LeanTask, 0);
     o->m_value = v;
     o->m_imp   = nullptr;
@@ -935,13 +1951,42 @@ extern "C" LEAN_EXPORT obj_res lean_task_spawn_core(obj_arg c, unsigned prio, bo
         return lean_task_pure(apply_1(c, box(0)));
     } else {
         lean_task_object * new_task = alloc_task(c, prio, keep_alive);
+        g_task_manager->record_parent(new_task);
         g_task_manager->enqueue(new_task);
         return (lean_object*)new_task;
     }
-}
-
-extern "C" LEAN_EXPORT obj_res lean_task_pure(obj_arg a) {
-    return (lean_object*)alloc_task(a);
+}
+
+extern "C" LEAN_EXPORT obj_res lean_task_pure(obj_arg a) {
+    return (lean_object*)alloc_task(a);
+}
+
+extern "C" LEAN_EXPORT obj_res lean_task_spawn_batch_core(obj_arg cs, unsigned prio, bool keep_alive) {
+    size_t n = lean_array_size(cs);
+    if (!lean_is_exclusive(cs)) {
+        obj_res fresh = lean_alloc_array(n, n);
+        object ** src = lean_array_cptr(cs);
+        object ** dst = lean_array_cptr(fresh);
+        for (size_t i = 0; i < n; i++) {
+            lean_inc(src[i]);
+            dst[i] = src[i];
+        }
+        lean_dec_ref(cs);
+        cs = fresh;
+    }
+    object ** it = lean_array_cptr(cs);
+    if (!g_task_manager || prio > LEAN_MAX_PRIO) {
+        /* No task manager (evaluate eagerly) or dedicated priority (one thread per
+           task); batching buys nothing, spawn individually. */
+        for (size_t i = 0; i < n; i++)
+            it[i] = lean_task_spawn_core(it[i], prio, keep_alive);
+        return cs;
+    }
+    for (size_t i = 0; i < n; i++)
+        it[i] = (object*)alloc_task(it[i], prio, keep_alive);
+    g_task_manager->record_parent_batch(reinterpret_cast<lean_task_object **>(it), n);
+    g_task_manager->enqueue_batch(reinterpret_cast<lean_task_object **>(it), n);
+    return cs;
 }
 
 static obj_res task_map_fn(obj_arg f, obj_arg t, obj_arg) {
@@ -957,6 +2002,7 @@ extern "C" LEAN_EXPORT obj_res lean_task_map_core(obj_arg f, obj_arg t, unsigned
         return lean_task_pure(apply_1(f, lean_task_get_own(t)));
     } else {
         lean_task_object * new_task = alloc_task(mk_closure_3_2(task_map_fn, f, t), prio, keep_alive);
+        g_task_manager->record_parent(new_task);
         g_task_manager->add_dep(lean_to_task(t), new_task);
         return (lean_object*)new_task;
     }
@@ -999,6 +2045,7 @@ extern "C" LEAN_EXPORT obj_res lean_task_bind_core(obj_arg x, obj_arg f, unsigne
         return apply_1(f, lean_task_get_own(x));
     } else {
         lean_task_object * new_task = alloc_task(mk_closure_3_2(task_bind_fn1, x, f), prio, keep_alive);
+        g_task_manager->record_parent(new_task);
         g_task_manager->add_dep(lean_to_task(x), new_task);
         return (lean_object*)new_task;
     }
@@ -1007,11 +2054,31 @@ extern "C" LEAN_EXPORT obj_res lean_task_bind_core(obj_arg x, obj_arg f, unsigne
 extern "C" LEAN_EXPORT bool lean_io_check_canceled_core() {
     if (lean_task_object * t = g_current_task_object) {
         lean_assert(t->m_imp); // task is being executed
+        /* Only the worker running the task writes `m_demoted` (here and at step
+           boundaries in `run_task`); the scheduler reads it only while the task is
+           queued, so no synchronization is needed, like for `m_canceled` above
+           (which is only ever flipped to true). */
+        if (g_task_timeslice != 0 || t->m_imp->m_max_allocs != 0) {
+            size_t consumed = t->m_imp->m_elapsed + (get_num_heartbeats() - g_task_step_start_heartbeats);
+            if (g_task_timeslice != 0 && !t->m_imp->m_demoted && consumed > g_task_timeslice)
+                t->m_imp->m_demoted = true;
+            if (t->m_imp->m_max_allocs != 0 && consumed > t->m_imp->m_max_allocs)
+                t->m_imp->m_canceled = true;
+        }
         return t->m_imp->m_canceled || g_task_manager->shutting_down();
     }
     return false;
 }
 
+/* IO.setTaskMaxAllocs : Nat → BaseIO Unit */
+extern "C" LEAN_EXPORT obj_res lean_io_set_task_max_allocs(b_obj_arg max, obj_arg /* w */) {
+    if (lean_task_object * t = g_current_task_object) {
+        lean_assert(t->m_imp); // task is being executed
+        t->m_imp->m_max_allocs = lean_is_scalar(max) ? lean_unbox(max) : std::numeric_limits<size_t>::max();
+    }
+    return io_result_mk_ok(box(0));
+}
+
 extern "C" LEAN_EXPORT void lean_io_cancel_core(b_obj_arg t) {
     if (lean_to_task(t)->m_value)
         return;
@@ -1031,7 +2098,7 @@ extern "C" LEAN_EXPORT obj_res lean_io_promise_new(obj_arg) {
     bool keep_alive = false;
     unsigned prio = 0;
     object * closure = nullptr;
-    lean_task_object * o = (lean_task_object*)lean_alloc_small_object(sizeof(lean_task_object));
+    lean_task_object * o = (lean_task_object*)lean_alloc_thunk_task_object();
     lean_set_task_header((lean_object*)o);
     o->m_value = nullptr;
     o->m_imp   = alloc_task_imp(closure, prio, keep_alive);
@@ -1043,16 +2110,140 @@ extern "C" LEAN_EXPORT obj_res lean_io_promise_resolve(obj_arg value, b_obj_arg
     return io_result_mk_ok(box(0));
 }
 
+// =======================================
+// FFI pin scopes
+
+/* Scoped pinning for C extensions. Instead of inc/dec'ing a Lean value around every
+   store or callback, an extension opens a scope, transfers one RC token per object to
+   the scope with `lean_pin`, and releases all of them with a single
+   `lean_pin_scope_end`. Scopes are per-thread and nest like a stack; a pinned object
+   is guaranteed to stay alive until the enclosing scope ends, so inside the scope it
+   can be passed around as a borrowed reference with no RC traffic at all. */
+struct pin_scopes {
+    std::vector<lean_object *> m_pinned;
+    std::vector<size_t>        m_starts;
+};
+
+MK_THREAD_LOCAL_GET_DEF(pin_scopes, get_pin_scopes)
+
+extern "C" LEAN_EXPORT void lean_pin_scope_begin() {
+    pin_scopes & s = get_pin_scopes();
+    s.m_starts.push_back(s.m_pinned.size());
+}
+
+extern "C" LEAN_EXPORT b_obj_res lean_pin(obj_arg o) {
+    pin_scopes & s = get_pin_scopes();
+    lean_assert(!s.m_starts.empty());
+    if (!lean_is_scalar(o))
+        s.m_pinned.push_back(o);
+    return o;
+}
+
+extern "C" LEAN_EXPORT lean_object * const * lean_pin_array(obj_arg a) {
+    lean_pin(a);
+    return lean_to_array(a)->m_data;
+}
+
+extern "C" LEAN_EXPORT void lean_pin_scope_end() {
+    pin_scopes & s = get_pin_scopes();
+    lean_assert(!s.m_starts.empty());
+    size_t start = s.m_starts.back();
+    s.m_starts.pop_back();
+    while (s.m_pinned.size() > start) {
+        lean_object * o = s.m_pinned.back();
+        s.m_pinned.pop_back();
+        lean_dec(o);
+    }
+}
+
 // =======================================
 // Natural numbers
 
+/* Per-thread pool of recycled `mpz_object`s. Big-Nat loops allocate and free
+   an `mpz_object` per intermediate result; recycling the objects with their
+   `mpz` value intact also retains the limb capacity, so tight loops stop
+   hitting both the object allocator and the bignum allocator. The pool is a
+   singly linked list threaded through the (dead) object headers. */
+#define LEAN_MPZ_POOL_SIZE 64
+LEAN_THREAD_PTR(mpz_object, g_mpz_pool);
+LEAN_THREAD_VALUE(unsigned, g_mpz_pool_num, 0);
+LEAN_THREAD_VALUE(bool, g_mpz_pool_finalizer_registered, false);
+
+static inline mpz_object * mpz_pool_next(mpz_object * o) {
+    return *reinterpret_cast<mpz_object **>(o);
+}
+
+static inline void set_mpz_pool_next(mpz_object * o, mpz_object * n) {
+    *reinterpret_cast<mpz_object **>(o) = n;
+}
+
+static void finalize_mpz_pool(void *) {
+    while (mpz_object * o = g_mpz_pool) {
+        g_mpz_pool = mpz_pool_next(o);
+        o->m_value.~mpz();
+        lean_free_small_object((lean_object*)o);
+    }
+    g_mpz_pool_num = 0;
+}
+
+static void dealloc_mpz(object * o) {
+    if (g_mpz_pool_num < LEAN_MPZ_POOL_SIZE) {
+        /* A thread may free big Nats it never allocated (e.g. a worker
+           consuming another task's result), so the finalizer must also be
+           registered before the first pooling here, not only on the
+           allocation path. */
+        if (!g_mpz_pool_finalizer_registered) {
+            g_mpz_pool_finalizer_registered = true;
+            register_thread_finalizer(finalize_mpz_pool, nullptr);
+        }
+        mpz_object * m = to_mpz(o);
+        set_mpz_pool_next(m, g_mpz_pool);
+        g_mpz_pool = m;
+        g_mpz_pool_num++;
+    } else {
+        to_mpz(o)->m_value.~mpz();
+        lean_free_small_object(o);
+    }
+}
+
 object * alloc_mpz(mpz const & m) {
+    if (mpz_object * o = g_mpz_pool) {
+        g_mpz_pool = mpz_pool_next(o);
+        g_mpz_pool_num--;
+        lean_set_st_header((lean_object*)o, LeanMPZ, 0);
+        o->m_value = m;
+        return (lean_object*)o;
+    }
+    if (!g_mpz_pool_finalizer_registered) {
+        g_mpz_pool_finalizer_registered = true;
+        register_thread_finalizer(finalize_mpz_pool, nullptr);
+    }
     void * mem = lean_alloc_small_object(sizeof(mpz_object));
     mpz_object * o = new (mem) mpz_object(m);
     lean_set_st_header((lean_object*)o, LeanMPZ, 0);
     return (lean_object*)o;
 }
 
+/* Move overload: the arithmetic primitives compute their result into an `mpz`
+   temporary; moving it into the object avoids copying the limb buffer. */
+object * alloc_mpz(mpz && m) {
+    if (mpz_object * o = g_mpz_pool) {
+        g_mpz_pool = mpz_pool_next(o);
+        g_mpz_pool_num--;
+        lean_set_st_header((lean_object*)o, LeanMPZ, 0);
+        o->m_value = std::move(m);
+        return (lean_object*)o;
+    }
+    if (!g_mpz_pool_finalizer_registered) {
+        g_mpz_pool_finalizer_registered = true;
+        register_thread_finalizer(finalize_mpz_pool, nullptr);
+    }
+    void * mem = lean_alloc_small_object(sizeof(mpz_object));
+    mpz_object * o = new (mem) mpz_object(std::move(m));
+    lean_set_st_header((lean_object*)o, LeanMPZ, 0);
+    return (lean_object*)o;
+}
+
 #ifdef LEAN_USE_GMP
 extern "C" LEAN_EXPORT lean_object * lean_alloc_mpz(mpz_t v) {
     return alloc_mpz(mpz(v));
@@ -1068,6 +2259,11 @@ object * mpz_to_nat_core(mpz const & m) {
     return alloc_mpz(m);
 }
 
+object * mpz_to_nat_core(mpz && m) {
+    lean_assert(!m.is_size_t() || m.get_size_t() > LEAN_MAX_SMALL_NAT);
+    return alloc_mpz(std::move(m));
+}
+
 static inline obj_res mpz_to_nat(mpz const & m) {
     if (m.is_size_t() && m.get_size_t() <= LEAN_MAX_SMALL_NAT)
         return lean_box(m.get_size_t());
@@ -1075,10 +2271,76 @@ static inline obj_res mpz_to_nat(mpz const & m) {
         return mpz_to_nat_core(m);
 }
 
+static inline obj_res mpz_to_nat(mpz && m) {
+    if (m.is_size_t() && m.get_size_t() <= LEAN_MAX_SMALL_NAT)
+        return lean_box(m.get_size_t());
+    else
+        return mpz_to_nat_core(std::move(m));
+}
+
 extern "C" LEAN_EXPORT object * lean_cstr_to_nat(char const * n) {
     return mpz_to_nat(mpz(n));
 }
 
+/* Digit-pair table: converting two digits per step halves the number of
+   divisions compared to the naive digit loop. */
+static char const g_two_digit_chars[] =
+    "00010203040506070809101112131415161718192021222324"
+    "25262728293031323334353637383940414243444546474849"
+    "50515253545556575859606162636465666768697071727374"
+    "75767778798081828384858687888990919293949596979899";
+
+/* Write the decimal representation of `v` to `buf` (at least 20 bytes, not
+   null-terminated) and return the number of characters written. */
+static size_t u64_to_chars(uint64 v, char * buf) {
+    char tmp[20];
+    char * it = tmp + sizeof(tmp);
+    while (v >= 100) {
+        uint64 r = v % 100;
+        v /= 100;
+        it -= 2;
+        memcpy(it, g_two_digit_chars + 2*r, 2);
+    }
+    if (v >= 10) {
+        it -= 2;
+        memcpy(it, g_two_digit_chars + 2*v, 2);
+    } else {
+        *--it = '0' + (char)v;
+    }
+    size_t len = tmp + sizeof(tmp) - it;
+    memcpy(buf, it, len);
+    return len;
+}
+
+extern "C" LEAN_EXPORT obj_res lean_nat_repr(b_obj_arg n) {
+    if (LEAN_LIKELY(lean_is_scalar(n))) {
+        char buf[20];
+        size_t len = u64_to_chars(lean_unbox(n), buf);
+        return lean_mk_string_from_bytes(buf, len);
+    } else {
+        std::string s = mpz_value(n).to_string();
+        return mk_string(s);
+    }
+}
+
+extern "C" LEAN_EXPORT obj_res lean_int_repr(b_obj_arg i) {
+    if (LEAN_LIKELY(lean_is_scalar(i))) {
+        char buf[21];
+        char * it = buf;
+        int64 v = lean_scalar_to_int64(i);
+        uint64 u = (uint64)v;
+        if (v < 0) {
+            *it++ = '-';
+            u = 0 - u;
+        }
+        size_t len = u64_to_chars(u, it) + (it - buf);
+        return lean_mk_string_from_bytes(buf, len);
+    } else {
+        std::string s = mpz_value(i).to_string();
+        return mk_string(s);
+    }
+}
+
 extern "C" LEAN_EXPORT object * lean_big_usize_to_nat(size_t n) {
     if (n <= LEAN_MAX_SMALL_NAT) {
         return lean_box(n);
@@ -1287,20 +2549,155 @@ extern "C" LEAN_EXPORT lean_obj_res lean_nat_pow(b_lean_obj_arg a1, b_lean_obj_a
         return mpz_to_nat(mpz_value(a1).pow(lean_unbox(a2)));
 }
 
+static inline unsigned nat_ctz(size_t v) {
+    lean_assert(v != 0);
+#ifdef __GNUC__
+    return sizeof(size_t) == 8 ? (unsigned)__builtin_ctzll(v) : (unsigned)__builtin_ctz((unsigned)v);
+#else
+    unsigned r = 0;
+    while ((v & 1) == 0) { v >>= 1; r++; }
+    return r;
+#endif
+}
+
 extern "C" LEAN_EXPORT lean_obj_res lean_nat_gcd(b_lean_obj_arg a1, b_lean_obj_arg a2) {
-    if (lean_is_scalar(a1)) {
-      if (lean_is_scalar(a2))
-        return mpz_to_nat(gcd(mpz::of_size_t(lean_unbox(a1)), mpz::of_size_t(lean_unbox(a2))));
-      else
+    if (LEAN_LIKELY(lean_is_scalar(a1) && lean_is_scalar(a2))) {
+        /* binary GCD: no divisions and no mpz temporaries */
+        size_t a = lean_unbox(a1);
+        size_t b = lean_unbox(a2);
+        if (a == 0) return lean_box(b);
+        if (b == 0) return lean_box(a);
+        unsigned az = nat_ctz(a);
+        unsigned bz = nat_ctz(b);
+        unsigned shift = az < bz ? az : bz;
+        a >>= az;
+        while (true) {
+            b >>= nat_ctz(b);
+            if (a > b) { size_t t = a; a = b; b = t; }
+            b -= a;
+            if (b == 0) break;
+        }
+        return lean_box(a << shift);
+    } else if (lean_is_scalar(a1)) {
         return mpz_to_nat(gcd(mpz::of_size_t(lean_unbox(a1)), mpz_value(a2)));
-    } else {
-      if (lean_is_scalar(a2))
+    } else if (lean_is_scalar(a2)) {
         return mpz_to_nat(gcd(mpz_value(a1), mpz::of_size_t(lean_unbox(a2))));
-      else
+    } else {
         return mpz_to_nat(gcd(mpz_value(a1), mpz_value(a2)));
     }
 }
 
+/* In-place accumulation: `acc` is owned, so when it is an unshared `mpz_object` we
+   may compute the result into it, reusing the object and (with GMP) its limb buffer.
+   `Nat.add` and friends take their arguments borrowed — good for the common scalar
+   case, but it means they can never mutate — so accumulation loops over big numbers
+   allocate an object per step; `Nat.addAcc`/`Nat.mulAcc` bind to these instead. */
+
+extern "C" LEAN_EXPORT lean_obj_res lean_nat_add_acc(lean_obj_arg acc, b_lean_obj_arg a) {
+    if (LEAN_LIKELY(lean_is_scalar(acc)))
+        return lean_nat_add(acc, a);
+    if (lean_is_exclusive(acc)) {
+        mpz & v = to_mpz(acc)->m_value;
+        if (lean_is_scalar(a))
+            v += static_cast<uint64>(lean_unbox(a));
+        else
+            v += mpz_value(a);
+        /* `acc` was big and we added a nonnegative number, so the sum stays big */
+        return acc;
+    }
+    object * r = lean_nat_add(acc, a);
+    lean_dec(acc);
+    return r;
+}
+
+extern "C" LEAN_EXPORT lean_obj_res lean_nat_mul_acc(lean_obj_arg acc, b_lean_obj_arg a) {
+    if (LEAN_LIKELY(lean_is_scalar(acc)))
+        return lean_nat_mul(acc, a);
+    if (lean_is_exclusive(acc)) {
+        if (lean_is_scalar(a) && lean_unbox(a) == 0) {
+            lean_dec(acc);
+            return lean_box(0);
+        }
+        mpz & v = to_mpz(acc)->m_value;
+        if (lean_is_scalar(a))
+            v *= static_cast<uint64>(lean_unbox(a));
+        else
+            v *= mpz_value(a);
+        /* `acc` was big and the multiplier is nonzero, so the product stays big */
+        return acc;
+    }
+    object * r = lean_nat_mul(acc, a);
+    lean_dec(acc);
+    return r;
+}
+
+static inline mpz nat_to_mpz(b_obj_arg a) {
+    return lean_is_scalar(a) ? mpz::of_size_t(lean_unbox(a)) : mpz_value(a);
+}
+
+/* Fused modular arithmetic: expression chains like `(a * b) % m` allocate a
+   boxed intermediate per step; these primitives keep every intermediate in an
+   unboxed machine word or a stack mpz temporary, boxing only the final
+   result. */
+
+extern "C" LEAN_EXPORT lean_obj_res lean_nat_mulmod(b_obj_arg a, b_obj_arg b, b_obj_arg m) {
+    if (lean_is_scalar(m)) {
+        size_t mv = lean_unbox(m);
+        if (mv == 1)
+            return lean_box(0);
+#ifdef __SIZEOF_INT128__
+        if (mv != 0 && lean_is_scalar(a) && lean_is_scalar(b)) {
+            uint64 r = (uint64)(((unsigned __int128)lean_unbox(a) * lean_unbox(b)) % mv);
+            return lean_box(r);
+        }
+#endif
+    }
+    mpz mm = nat_to_mpz(m);
+    mpz r  = nat_to_mpz(a) * nat_to_mpz(b);
+    if (!mm.is_zero())
+        r %= mm;
+    return mpz_to_nat(r);
+}
+
+extern "C" LEAN_EXPORT lean_obj_res lean_nat_powmod(b_obj_arg a, b_obj_arg b, b_obj_arg m) {
+#ifdef __SIZEOF_INT128__
+    if (lean_is_scalar(m) && lean_is_scalar(a) && lean_is_scalar(b)) {
+        size_t mv = lean_unbox(m);
+        if (mv != 0) {
+            uint64 base = lean_unbox(a) % mv;
+            size_t e    = lean_unbox(b);
+            uint64 r    = 1 % mv;
+            while (e > 0) {
+                if (e & 1)
+                    r = (uint64)(((unsigned __int128)r * base) % mv);
+                base = (uint64)(((unsigned __int128)base * base) % mv);
+                e >>= 1;
+            }
+            return lean_box(r);
+        }
+    }
+#endif
+    mpz mm = nat_to_mpz(m);
+    if (mm.is_zero()) {
+        /* x % 0 = x */
+        return lean_nat_pow(a, b);
+    }
+    mpz base = nat_to_mpz(a) % mm;
+    mpz e    = nat_to_mpz(b);
+    mpz r(1u);
+    r %= mm;
+    while (!e.is_zero()) {
+        if (e.mod64() & 1) {
+            r *= base;
+            r %= mm;
+        }
+        base = base * base;
+        base %= mm;
+        div2k(e, e, 1);
+    }
+    return mpz_to_nat(r);
+}
+
 extern "C" LEAN_EXPORT lean_obj_res lean_nat_log2(b_lean_obj_arg a) {
     if (lean_is_scalar(a)) {
       unsigned res = 0;
@@ -1323,6 +2720,11 @@ inline object * mpz_to_int_core(mpz const & m) {
     return alloc_mpz(m);
 }
 
+inline object * mpz_to_int_core(mpz && m) {
+    lean_assert(m < LEAN_MIN_SMALL_INT || m > LEAN_MAX_SMALL_INT);
+    return alloc_mpz(std::move(m));
+}
+
 static object * mpz_to_int(mpz const & m) {
     if (m < LEAN_MIN_SMALL_INT || m > LEAN_MAX_SMALL_INT)
         return mpz_to_int_core(m);
@@ -1330,6 +2732,13 @@ static object * mpz_to_int(mpz const & m) {
         return lean_box(static_cast<unsigned>(m.get_int()));
 }
 
+static object * mpz_to_int(mpz && m) {
+    if (m < LEAN_MIN_SMALL_INT || m > LEAN_MAX_SMALL_INT)
+        return mpz_to_int_core(std::move(m));
+    else
+        return lean_box(static_cast<unsigned>(m.get_int()));
+}
+
 extern "C" LEAN_EXPORT lean_obj_res lean_big_int_to_nat(lean_obj_arg a) {
     lean_assert(!lean_is_scalar(a));
     mpz m = mpz_value(a);
@@ -1474,8 +2883,21 @@ extern "C" LEAN_EXPORT uint32 lean_uint32_big_modn(uint32 a1, b_lean_obj_arg a2)
     return m.is_unsigned_int() ? a1 % m.get_unsigned_int() : a1;
 }
 
+/* `USize.ofNat` and `UInt64.ofNat` reduce modulo the target size; that is the specified
+   behavior, but an unintended wrap is otherwise invisible in production -- in particular
+   an index that fits on a 64-bit development machine and silently truncates on a 32-bit
+   target. Count the wraps so they stay observable (see `IO.natConversionWrapCount`).
+   The counters are touched only on the big-number paths, which already pay an mpz
+   operation per conversion; in-range conversions cost nothing extra. The small-width
+   conversions (`UInt8`/`UInt16`/`UInt32` on 64-bit) are not counted: reducing a big
+   `Nat` there is a common intended idiom (e.g. hashing), so wraps are not a signal. */
+static atomic<uint64> g_num_nat_conversion_wraps(0);
+
 extern "C" LEAN_EXPORT uint64 lean_uint64_of_big_nat(b_obj_arg a) {
-    return mpz_value(a).mod64();
+    mpz const & v = mpz_value(a);
+    if (LEAN_UNLIKELY(v.log2() >= 64))
+        g_num_nat_conversion_wraps++;
+    return v.mod64();
 }
 
 extern "C" LEAN_EXPORT uint64 lean_uint64_big_modn(uint64 a1, b_lean_obj_arg) {
@@ -1488,7 +2910,15 @@ extern "C" LEAN_EXPORT uint64 lean_uint64_mix_hash(uint64 a1, uint64 a2) {
 }
 
 extern "C" LEAN_EXPORT usize lean_usize_of_big_nat(b_obj_arg a) {
-    return mpz_value(a).get_size_t();
+    mpz const & v = mpz_value(a);
+    if (LEAN_UNLIKELY(!v.is_size_t()))
+        g_num_nat_conversion_wraps++;
+    return v.get_size_t();
+}
+
+/* natConversionWrapCount : BaseIO Nat */
+extern "C" LEAN_EXPORT obj_res lean_nat_conversion_wrap_count(obj_arg /* w */) {
+    return lean_io_result_mk_ok(lean_uint64_to_nat(g_num_nat_conversion_wraps.load()));
 }
 
 extern "C" LEAN_EXPORT usize lean_usize_big_modn(usize a1, b_lean_obj_arg) {
@@ -1592,6 +3022,83 @@ std::string string_to_std(b_obj_arg o) {
     return std::string(w_string_cstr(o), lean_string_size(o) - 1);
 }
 
+/*
+Atom table: bounded interning for short strings.
+
+Symbol-dense workloads (e.g. the parser/elaborator bridge) create the same
+tiny strings over and over: identifiers, keywords, field names. `mk_atom_string`
+returns a canonical, persistent string object for such strings, eliminating the
+allocation on every hit. Interned strings are marked persistent, so they are
+safe to share across threads, their RC operations are no-ops, and
+`lean_is_exclusive` is false for them — in-place update primitives such as
+`lean_string_push` automatically fall back to copying, preserving value
+semantics. Sharing also makes the pointer-equality fast path in
+`lean_string_eq` fire for repeated symbols.
+
+The table is bounded: persistent objects are never deallocated, so instead of
+evicting we simply stop interning once the table is full and fall back to a
+plain allocation.
+*/
+#define LEAN_MAX_ATOM_STRING_SIZE 23
+#define LEAN_ATOM_TABLE_CAPACITY  8192
+static mutex * g_atom_table_mutex = nullptr;
+static std::unordered_map<std::string, object *> * g_atom_table = nullptr;
+
+object * mk_atom_string(char const * s, size_t sz) {
+    if (g_atom_table && sz <= LEAN_MAX_ATOM_STRING_SIZE) {
+        std::string key(s, sz);
+        unique_lock<mutex> lock(*g_atom_table_mutex);
+        auto it = g_atom_table->find(key);
+        if (it != g_atom_table->end())
+            return it->second;
+        if (g_atom_table->size() < LEAN_ATOM_TABLE_CAPACITY) {
+            object * r = lean_mk_string_from_bytes(s, sz);
+            lean_mark_persistent(r);
+            g_atom_table->emplace(std::move(key), r);
+            return r;
+        }
+    }
+    return lean_mk_string_from_bytes(s, sz);
+}
+
+object * mk_atom_string(char const * s) {
+    return mk_atom_string(s, strlen(s));
+}
+
+/*
+String literals share the atom table, but are interned unconditionally: the set of
+literals occurring in compiled code is fixed at compile time, so unlike runtime
+strings they cannot grow the table without bound. Module initializers call
+`lean_mk_string_literal` for every string literal they materialize, so the N copies
+of "(" etc. produced by generated parsers and pretty printers collapse to a single
+immortal object per process.
+*/
+extern "C" LEAN_EXPORT obj_res lean_mk_string_literal(char const * s, size_t sz) {
+    if (g_atom_table) {
+        std::string key(s, sz);
+        unique_lock<mutex> lock(*g_atom_table_mutex);
+        auto it = g_atom_table->find(key);
+        if (it != g_atom_table->end())
+            return it->second;
+        object * r = lean_mk_string_from_bytes(s, sz);
+        lean_mark_persistent(r);
+        g_atom_table->emplace(std::move(key), r);
+        return r;
+    }
+    return lean_mk_string_from_bytes(s, sz);
+}
+
+void intern_immortal_string(object * o) {
+    lean_assert(!lean_has_rc(o));
+    size_t sz = lean_string_size(o) - 1;
+    if (!g_atom_table || sz > LEAN_MAX_ATOM_STRING_SIZE)
+        return;
+    std::string key(lean_string_cstr(o), sz);
+    unique_lock<mutex> lock(*g_atom_table_mutex);
+    if (g_atom_table->size() < LEAN_ATOM_TABLE_CAPACITY)
+        g_atom_table->emplace(std::move(key), o);
+}
+
 static size_t mk_capacity(size_t sz) {
     return sz*2;
 }
@@ -1834,19 +3341,238 @@ extern "C" LEAN_EXPORT obj_res lean_string_utf8_next(b_obj_arg s, b_obj_arg i0)
     return lean_box(i+1);
 }
 
+/* Return the end of the pure-ASCII run starting at `str[i]`, i.e. the first
+   index in `[i, size)` whose byte has the high bit set (or `size`). ASCII runs
+   dominate most inputs (source code, JSON, ...), and for them the full decoder
+   above wastes its time on continuation-byte branches, so the batched decoder
+   below skips over them 16 bytes at a time. */
+static usize ascii_run_end(char const * str, usize i, usize size) {
+#ifdef __SSE2__
+    while (i + 16 <= size) {
+        __m128i w = _mm_loadu_si128(reinterpret_cast<__m128i const *>(str + i));
+        if (_mm_movemask_epi8(w) != 0)
+            break;
+        i += 16;
+    }
+#else
+    while (i + 8 <= size) {
+        uint64 w;
+        memcpy(&w, str + i, 8);
+        if (w & 0x8080808080808080ull)
+            break;
+        i += 8;
+    }
+#endif
+    while (i < size && (static_cast<unsigned char>(str[i]) & 0x80) == 0)
+        i++;
+    return i;
+}
+
+/* Decode up to `n0` characters starting at position `i0`, returning the
+   decoded characters and the position after the last one. Equivalent to
+   iterating `get`/`next`, but amortizes the per-call boxing/extern overhead
+   over the whole batch and takes the vectorized `ascii_run_end` fast path
+   across ASCII runs. */
+extern "C" LEAN_EXPORT obj_res lean_string_utf8_decode_batch(b_obj_arg s, b_obj_arg i0, b_obj_arg n0) {
+    if (!lean_is_scalar(i0)) {
+        /* See comment at lean_string_utf8_get: `i0` cannot be a valid position. */
+        obj_res r = lean_alloc_ctor(0, 2, 0);
+        lean_ctor_set(r, 0, lean_alloc_array(0, 0));
+        lean_inc(i0);
+        lean_ctor_set(r, 1, i0);
+        return r;
+    }
+    usize i          = lean_unbox(i0);
+    usize n          = lean_is_scalar(n0) ? lean_unbox(n0) : std::numeric_limits<usize>::max();
+    char const * str = lean_string_cstr(s);
+    usize size       = lean_string_size(s) - 1;
+    /* Every character occupies at least one byte, so this capacity suffices. */
+    usize cap     = std::min(n, i < size ? size - i : 0);
+    obj_res cs    = lean_alloc_array(0, cap);
+    object ** dst = lean_array_cptr(cs);
+    usize count   = 0;
+    while (count < n && i < size) {
+        unsigned c = static_cast<unsigned char>(str[i]);
+        if ((c & 0x80) == 0) {
+            usize end  = ascii_run_end(str, i, size);
+            usize take = std::min(end - i, n - count);
+            for (usize j = 0; j < take; j++)
+                dst[count + j] = lean_box_uint32(static_cast<unsigned char>(str[i + j]));
+            count += take;
+            i     += take;
+        } else {
+            uint32 result;
+            if (!lean_string_utf8_get_core(str, size, i, result))
+                result = lean_char_default_value();
+            dst[count++] = lean_box_uint32(result);
+            /* Advance like `lean_string_utf8_next`, also on invalid UTF-8. */
+            if ((c & 0xe0) == 0xc0)      i += 2;
+            else if ((c & 0xf0) == 0xe0) i += 3;
+            else if ((c & 0xf8) == 0xf0) i += 4;
+            else                         i += 1;
+        }
+    }
+    lean_to_array(cs)->m_size = count;
+    obj_res r = lean_alloc_ctor(0, 2, 0);
+    lean_ctor_set(r, 0, cs);
+    lean_ctor_set(r, 1, lean_box(i));
+    return r;
+}
+
+/* UTF-16 position mapping. The editor protocol addresses positions in UTF-16
+   code units while Lean strings are UTF-8, and the language server translates
+   positions for every diagnostic and request. The primitives below walk the
+   byte array directly instead of decoding one character per extern call, and
+   skip ASCII runs via `ascii_run_end`. They match the reference
+   implementations in `Lean.Data.Lsp.Utf16`, including positions past the end
+   of the string, where `get` reads the default character 'A' (one UTF-16 code
+   unit) and `next` advances one byte. */
+
+/* Return the number of UTF-16 code units of the character at `str[i]` and
+   advance `i` past it, with the same semantics as `get`/`next`. */
+static inline unsigned string_utf16_csize_next(char const * str, usize size, usize & i) {
+    unsigned char c = static_cast<unsigned char>(str[i]);
+    uint32 r;
+    if (!lean_string_utf8_get_core(str, size, i, r))
+        r = lean_char_default_value();
+    if ((c & 0x80) == 0)         i += 1;
+    else if ((c & 0xe0) == 0xc0) i += 2;
+    else if ((c & 0xf0) == 0xe0) i += 3;
+    else if ((c & 0xf8) == 0xf0) i += 4;
+    else                         i += 1;
+    return r < 0x10000 ? 1 : 2;
+}
+
+/* String.utf16Length */
+extern "C" LEAN_EXPORT obj_res lean_string_utf16_length(b_obj_arg s) {
+    return lean_usize_to_nat(lean_utf8_n_strlen16(lean_string_cstr(s), lean_string_size(s) - 1));
+}
+
+/* String.codepointPosToUtf16PosFrom */
+extern "C" LEAN_EXPORT obj_res lean_string_codepoint_pos_to_utf16_pos_from(b_obj_arg s, b_obj_arg n0, b_obj_arg off0) {
+    char const * str = lean_string_cstr(s);
+    usize size       = lean_string_size(s) - 1;
+    if (!lean_is_scalar(off0) || lean_unbox(off0) >= size) {
+        /* every step from `off` on reads the default character: one unit each */
+        lean_inc(n0);
+        return n0;
+    }
+    usize i      = lean_unbox(off0);
+    usize n      = lean_is_scalar(n0) ? lean_unbox(n0) : std::numeric_limits<usize>::max();
+    usize n_init = n;
+    usize u16    = 0;
+    while (n > 0 && i < size) {
+        unsigned char c = static_cast<unsigned char>(str[i]);
+        if ((c & 0x80) == 0) {
+            usize end  = ascii_run_end(str, i, size);
+            usize take = std::min(end - i, n);
+            u16 += take; i += take; n -= take;
+        } else {
+            u16 += string_utf16_csize_next(str, size, i);
+            n--;
+        }
+    }
+    if (!lean_is_scalar(n0)) {
+        /* the whole string was consumed; the remaining steps read the default
+           character, so the result is `u16 + (n0 - steps)` */
+        obj_res steps = lean_usize_to_nat(n_init - n);
+        obj_res rest  = lean_nat_sub(n0, steps);
+        obj_res base  = lean_usize_to_nat(u16);
+        obj_res r     = lean_nat_add(base, rest);
+        lean_dec(steps); lean_dec(rest); lean_dec(base);
+        return r;
+    }
+    return lean_usize_to_nat(u16 + n);
+}
+
+/* String.utf16PosToCodepointPosFrom */
+extern "C" LEAN_EXPORT obj_res lean_string_utf16_pos_to_codepoint_pos_from(b_obj_arg s, b_obj_arg u0, b_obj_arg off0) {
+    char const * str = lean_string_cstr(s);
+    usize size       = lean_string_size(s) - 1;
+    if (!lean_is_scalar(off0) || lean_unbox(off0) >= size) {
+        /* each step consumes one unit (default character) and one codepoint */
+        lean_inc(u0);
+        return u0;
+    }
+    usize i      = lean_unbox(off0);
+    usize u      = lean_is_scalar(u0) ? lean_unbox(u0) : std::numeric_limits<usize>::max();
+    usize u_init = u;
+    usize cp     = 0;
+    while (u > 0 && i < size) {
+        unsigned char c = static_cast<unsigned char>(str[i]);
+        if ((c & 0x80) == 0) {
+            usize end  = ascii_run_end(str, i, size);
+            usize take = std::min(end - i, u);
+            cp += take; i += take; u -= take;
+        } else {
+            unsigned csize = string_utf16_csize_next(str, size, i);
+            cp++;
+            /* nat subtraction in the reference implementation truncates at 0 */
+            u = u > csize ? u - csize : 0;
+        }
+    }
+    if (!lean_is_scalar(u0)) {
+        obj_res consumed = lean_usize_to_nat(u_init - u);
+        obj_res rest     = lean_nat_sub(u0, consumed);
+        obj_res base     = lean_usize_to_nat(cp);
+        obj_res r        = lean_nat_add(base, rest);
+        lean_dec(consumed); lean_dec(rest); lean_dec(base);
+        return r;
+    }
+    return lean_usize_to_nat(cp + u);
+}
+
+/* String.codepointPosToUtf8PosFrom */
+extern "C" LEAN_EXPORT obj_res lean_string_codepoint_pos_to_utf8_pos_from(b_obj_arg s, b_obj_arg off0, b_obj_arg n0) {
+    char const * str = lean_string_cstr(s);
+    usize size       = lean_string_size(s) - 1;
+    if (!lean_is_scalar(off0)) {
+        /* past the end `next` advances one byte per step */
+        return lean_nat_add(off0, n0);
+    }
+    usize i      = lean_unbox(off0);
+    usize n      = lean_is_scalar(n0) ? lean_unbox(n0) : std::numeric_limits<usize>::max();
+    usize n_init = n;
+    while (n > 0 && i < size) {
+        unsigned char c = static_cast<unsigned char>(str[i]);
+        if ((c & 0x80) == 0) {
+            usize end  = ascii_run_end(str, i, size);
+            usize take = std::min(end - i, n);
+            i += take; n -= take;
+        } else {
+            /* advance like `lean_string_utf8_next`, also on invalid UTF-8 */
+            if ((c & 0xe0) == 0xc0)      i += 2;
+            else if ((c & 0xf0) == 0xe0) i += 3;
+            else if ((c & 0xf8) == 0xf0) i += 4;
+            else                         i += 1;
+            n--;
+        }
+    }
+    if (!lean_is_scalar(n0)) {
+        obj_res steps = lean_usize_to_nat(n_init - n);
+        obj_res rest  = lean_nat_sub(n0, steps);
+        obj_res base  = lean_usize_to_nat(i);
+        obj_res r     = lean_nat_add(base, rest);
+        lean_dec(steps); lean_dec(rest); lean_dec(base);
+        return r;
+    }
+    return lean_usize_to_nat(i + n);
+}
+
 static inline bool is_utf8_first_byte(unsigned char c) {
     return (c & 0x80) == 0 || (c & 0xe0) == 0xc0 || (c & 0xf0) == 0xe0 || (c & 0xf8) == 0xf0;
 }
 
 extern "C" LEAN_EXPORT obj_res lean_string_utf8_extract(b_obj_arg s, b_obj_arg b0, b_obj_arg e0) {
-    if (!lean_is_scalar(b0) || !lean_is_scalar(e0)) {
-        /* See comment at string_utf8_get */
-        return s;
-    }
+    usize sz = lean_string_size(s) - 1;
+    /* See comment at string_utf8_get: a non-scalar position cannot be a valid
+       index. So a non-scalar `b0` is past the end of the string, and a
+       non-scalar `e0` clamps to the end. */
+    if (!lean_is_scalar(b0))
+        return lean_mk_string("");
     usize b = lean_unbox(b0);
-    usize e = lean_unbox(e0);
+    usize e = lean_is_scalar(e0) ? lean_unbox(e0) : sz;
     char const * str = lean_string_cstr(s);
-    usize sz = lean_string_size(s) - 1;
     if (b >= e || b >= sz) return lean_mk_string("");
     /* In the reference implementation if `b` is not pointing to a valid UTF8
        character start position, the result is the empty string. */
@@ -1857,9 +3583,18 @@ extern "C" LEAN_EXPORT obj_res lean_string_utf8_extract(b_obj_arg s, b_obj_arg b
     /* In the reference implementation if `e` is not pointing to a valid UTF8
        character start position, it is assumed to be at the end. */
     if (e < sz && !is_utf8_first_byte(str[e])) e = sz;
+    if (b == 0 && e == sz) {
+        /* Whole-string slice (e.g. `Substring.toString` of a substring covering
+           the entire string): share the existing object instead of copying.
+           A proper offset+length view is not representable here -- compiled
+           code and the FFI read string bytes directly through the fixed
+           lean_string_object layout. */
+        lean_inc(s);
+        return s;
+    }
     usize new_sz = e - b;
     lean_assert(new_sz > 0);
-    return lean_mk_string_from_bytes(lean_string_cstr(s) + b, new_sz);
+    return lean_mk_string_from_bytes(str + b, new_sz);
 }
 
 extern "C" LEAN_EXPORT obj_res lean_string_utf8_prev(b_obj_arg s, b_obj_arg i0) {
@@ -2024,6 +3759,142 @@ extern "C" LEAN_EXPORT obj_res lean_byte_array_push(obj_arg a, uint8 b) {
     return r;
 }
 
+extern "C" LEAN_EXPORT obj_res lean_byte_array_find(b_obj_arg a, uint8 b, obj_arg start) {
+    size_t sz = lean_sarray_size(a);
+    /* see comment at lean_array_get: a non-scalar index is necessarily out of bounds */
+    if (!lean_is_scalar(start)) {
+        lean_dec(start);
+        return mk_option_none();
+    }
+    size_t i = lean_unbox(start);
+    if (i >= sz)
+        return mk_option_none();
+    uint8 const * p = lean_sarray_cptr(a);
+    void const * r = memchr(p + i, b, sz - i);
+    if (r == nullptr)
+        return mk_option_none();
+    return mk_option_some(lean_usize_to_nat(static_cast<uint8 const *>(r) - p));
+}
+
+extern "C" LEAN_EXPORT uint64 lean_byte_array_hash(b_obj_arg a) {
+    return hash_str(lean_sarray_size(a), lean_sarray_cptr(a), 11);
+}
+
+// =======================================
+// JSON streaming encoder
+
+/* Streaming JSON encoder primitives. Serializers that go through `String`
+   appends pay one allocation per fragment; these primitives append JSON
+   fragments directly into an exclusive `ByteArray` output buffer, so encoding
+   runs at memcpy speed. The escaping rules match `Lean.Data.Json.Printer`:
+   `"`, `\`, `\n` and `\r` use short escapes, other control characters use
+   `\uXXXX`, and all remaining UTF-8 bytes are copied verbatim. */
+
+static obj_res json_reserve(obj_arg a, size_t extra) {
+    return lean_sarray_ensure_exclusive(lean_sarray_ensure_capacity(a, lean_sarray_size(a) + extra, /* exact */ false));
+}
+
+static obj_res json_write_bytes(obj_arg a, char const * s, size_t len) {
+    object * r = json_reserve(a, len);
+    size_t & sz = lean_to_sarray(r)->m_size;
+    memcpy(lean_sarray_cptr(r) + sz, s, len);
+    sz += len;
+    return r;
+}
+
+extern "C" LEAN_EXPORT obj_res lean_json_write_null(obj_arg a) {
+    return json_write_bytes(a, "null", 4);
+}
+
+extern "C" LEAN_EXPORT obj_res lean_json_write_bool(obj_arg a, uint8 b) {
+    return b ? json_write_bytes(a, "true", 4) : json_write_bytes(a, "false", 5);
+}
+
+extern "C" LEAN_EXPORT obj_res lean_json_write_str(obj_arg a, b_obj_arg s) {
+    size_t len = lean_string_size(s) - 1;
+    unsigned char const * str = (unsigned char const *) lean_string_cstr(s);
+    /* first pass: compute the exact escaped size, so the buffer grows once */
+    size_t extra = 2;
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = str[i];
+        if (c == '"' || c == '\\' || c == '\n' || c == '\r')
+            extra += 2;
+        else if (c < 0x20)
+            extra += 6;
+        else
+            extra += 1;
+    }
+    object * r = json_reserve(a, extra);
+    size_t & sz = lean_to_sarray(r)->m_size;
+    uint8 * dest = lean_sarray_cptr(r) + sz;
+    *dest++ = '"';
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = str[i];
+        if (c == '"' || c == '\\') {
+            *dest++ = '\\'; *dest++ = c;
+        } else if (c == '\n') {
+            *dest++ = '\\'; *dest++ = 'n';
+        } else if (c == '\r') {
+            *dest++ = '\\'; *dest++ = 'r';
+        } else if (c < 0x20) {
+            static char const * hex = "0123456789abcdef";
+            *dest++ = '\\'; *dest++ = 'u'; *dest++ = '0'; *dest++ = '0';
+            *dest++ = hex[c >> 4]; *dest++ = hex[c & 0xf];
+        } else {
+            *dest++ = c;
+        }
+    }
+    *dest++ = '"';
+    sz += extra;
+    return r;
+}
+
+extern "C" LEAN_EXPORT obj_res lean_json_write_nat(obj_arg a, b_obj_arg n) {
+    if (lean_is_scalar(n)) {
+        char buf[20];
+        size_t len = u64_to_chars(lean_unbox(n), buf);
+        return json_write_bytes(a, buf, len);
+    } else {
+        std::string s = mpz_value(n).to_string();
+        return json_write_bytes(a, s.data(), s.size());
+    }
+}
+
+extern "C" LEAN_EXPORT obj_res lean_json_write_int(obj_arg a, b_obj_arg i) {
+    if (lean_is_scalar(i)) {
+        char buf[21];
+        char * it = buf;
+        int64 v = lean_scalar_to_int64(i);
+        uint64 u = (uint64)v;
+        if (v < 0) {
+            *it++ = '-';
+            u = 0 - u;
+        }
+        size_t len = u64_to_chars(u, it) + (it - buf);
+        return json_write_bytes(a, buf, len);
+    } else {
+        std::string s = mpz_value(i).to_string();
+        return json_write_bytes(a, s.data(), s.size());
+    }
+}
+
+extern "C" LEAN_EXPORT obj_res lean_json_write_float(obj_arg a, double f) {
+    if (!isfinite(f)) {
+        /* JSON has no literals for NaN or the infinities; like JavaScript's
+           JSON.stringify, encode them as null. */
+        return json_write_bytes(a, "null", 4);
+    }
+    char buf[32];
+    int len = 0;
+    /* shortest decimal representation that round-trips */
+    for (int prec = 15; prec <= 17; prec++) {
+        len = snprintf(buf, sizeof(buf), "%.*g", prec, f);
+        if (strtod(buf, nullptr) == f)
+            break;
+    }
+    return json_write_bytes(a, buf, len);
+}
+
 extern "C" LEAN_EXPORT obj_res lean_copy_float_array(obj_arg a) {
     return lean_copy_sarray(a, lean_sarray_capacity(a));
 }
@@ -2063,6 +3934,47 @@ extern "C" LEAN_EXPORT obj_res lean_float_array_push(obj_arg a, double d) {
     return r;
 }
 
+/* The reduction kernels below run over four independent accumulators: a single
+   strict-FP accumulator is a loop-carried dependence the compiler may not
+   reassociate, so it would serialize on the add latency. The accumulation order
+   is therefore not left-to-right; the Lean bindings are `opaque` for this reason. */
+
+extern "C" LEAN_EXPORT double lean_float_array_sum(b_obj_arg a) {
+    size_t sz        = lean_sarray_size(a);
+    double const * p = reinterpret_cast<double const *>(lean_sarray_cptr(a));
+    double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+    size_t i = 0;
+    for (; i + 4 <= sz; i += 4) {
+        s0 += p[i]; s1 += p[i+1]; s2 += p[i+2]; s3 += p[i+3];
+    }
+    for (; i < sz; i++)
+        s0 += p[i];
+    return (s0 + s1) + (s2 + s3);
+}
+
+extern "C" LEAN_EXPORT double lean_float_array_dot(b_obj_arg a, b_obj_arg b) {
+    size_t sz        = std::min(lean_sarray_size(a), lean_sarray_size(b));
+    double const * p = reinterpret_cast<double const *>(lean_sarray_cptr(a));
+    double const * q = reinterpret_cast<double const *>(lean_sarray_cptr(b));
+    double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+    size_t i = 0;
+    for (; i + 4 <= sz; i += 4) {
+        s0 += p[i] * q[i]; s1 += p[i+1] * q[i+1]; s2 += p[i+2] * q[i+2]; s3 += p[i+3] * q[i+3];
+    }
+    for (; i < sz; i++)
+        s0 += p[i] * q[i];
+    return (s0 + s1) + (s2 + s3);
+}
+
+extern "C" LEAN_EXPORT obj_res lean_float_array_scale(double s, obj_arg a) {
+    object * r = lean_sarray_ensure_exclusive(a);
+    size_t sz  = lean_sarray_size(r);
+    double * p = reinterpret_cast<double *>(lean_sarray_cptr(r));
+    for (size_t i = 0; i < sz; i++)
+        p[i] *= s;
+    return r;
+}
+
 // =======================================
 // Array functions for generated code
 
@@ -2078,10 +3990,11 @@ extern "C" LEAN_EXPORT object * lean_mk_array(obj_arg n, obj_arg v) {
     }
     object * r    = lean_alloc_array(sz, sz);
     object ** it  = lean_array_cptr(r);
-    object ** end = it + sz;
-    for (; it != end; ++it) {
-        *it = v;
-    }
+    /* std::fill of a pointer value compiles to a vectorized block fill; the reference
+       count is adjusted once by `sz - 1` below instead of per slot. (A memset fast
+       path does not apply here: even "scalar" elements are boxed pointer patterns,
+       and unboxed element storage is lean_sarray's job.) */
+    std::fill(it, it + sz, v);
     if (sz == 0) {
         lean_dec(v);
     } else if (sz > 1) {
@@ -2105,10 +4018,11 @@ extern "C" LEAN_EXPORT obj_res lean_copy_expand_array(obj_arg a, bool expand) {
         memcpy(dest, it, sz * sizeof(object *));
         lean_dealloc(a, lean_array_byte_size(a));
     } else {
-        for (; it != end; ++it, ++dest) {
-            *dest = *it;
+        /* copy the pointer block at memory bandwidth first, then retain; interleaving
+           the branchy lean_inc with the stores kept the copy from vectorizing */
+        memcpy(dest, it, sz * sizeof(object *));
+        for (; it != end; ++it)
             lean_inc(*it);
-        }
         lean_dec(a);
     }
     return r;
@@ -2132,9 +4046,37 @@ extern "C" LEAN_EXPORT object * lean_array_push(obj_arg a, obj_arg v) {
     return r;
 }
 
+/* Destination-free `Array.map`: map `f` over `a`, storing the results in `a`'s own
+   cells when `a` is exclusive. The reference-implementation loop (`mapMUnsafe`)
+   achieves the same reuse, but pays an exclusivity check and a boxed index per
+   element; here both are hoisted out of the loop. */
+extern "C" LEAN_EXPORT obj_res lean_array_map_inplace(obj_arg f, obj_arg a) {
+    a = lean_ensure_exclusive_array(a);
+    object ** it  = lean_array_cptr(a);
+    object ** end = it + lean_array_size(a);
+    for (; it != end; ++it) {
+        object * v = *it;
+        /* Park `box(0)` in the slot while `f` runs: ownership of `v` moves to the
+           application (so `v` stays unshared if possible), and the cell must hold
+           a valid object in case `f` triggers a panic that walks the array. */
+        *it = lean_box(0);
+        lean_inc(f);
+        *it = lean_apply_1(f, v);
+    }
+    lean_dec(f);
+    return a;
+}
+
 // =======================================
 // Name primitives
 
+/* Structural equality on names. The fast paths make a global interner (pointer
+   equality for equal names) unnecessary in practice: identical pointers answer
+   immediately, and since every `Name` caches its hash, differing names almost always
+   differ in `lean_name_hash_ptr` and never reach the component walk. Interning at
+   construction is not even possible here -- `Name.str` is an ordinary constructor
+   applied directly by compiled code, not a runtime entry point, and imported names
+   live in immutable compacted regions that cannot be redirected to a table. */
 extern "C" LEAN_EXPORT uint8 lean_name_eq(b_lean_obj_arg n1, b_lean_obj_arg n2) {
     if (n1 == n2)
         return true;
@@ -2151,7 +4093,7 @@ extern "C" LEAN_EXPORT uint8 lean_name_eq(b_lean_obj_arg n1, b_lean_obj_arg n2)
             if (!lean_string_eq(lean_ctor_get(n1, 1), lean_ctor_get(n2, 1)))
                 return false;
         } else {
-            if (!lean_nat_eq(lean_ctor_get(n1, 1), lean_ctor_get(n1, 1)))
+            if (!lean_nat_eq(lean_ctor_get(n1, 1), lean_ctor_get(n2, 1)))
                 return false;
         }
         n1 = lean_ctor_get(n1, 0);
@@ -2223,8 +4165,15 @@ extern "C" LEAN_EXPORT lean_external_class * lean_register_external_class(lean_e
 }
 
 void initialize_object() {
+    if (char const * v = std::getenv("LEAN_TASK_TIMESLICE"))
+        g_task_timeslice = std::strtoull(v, nullptr, 10) * 1000;
+    if (char const * v = std::getenv("LEAN_TASK_ALLOC_BUDGET"))
+        g_task_alloc_budget = std::strtoull(v, nullptr, 10) * 1000;
     g_ext_classes       = new std::vector<external_object_class*>();
     g_ext_classes_mutex = new mutex();
+    g_atom_table        = new std::unordered_map<std::string, object *>();
+    g_atom_table_mutex  = new mutex();
+    g_weak_refs         = new weak_ref_state();
     g_array_empty       = lean_alloc_array(0, 0);
     mark_persistent(g_array_empty);
 }
@@ -2233,5 +4182,9 @@ void finalize_object() {
     for (external_object_class * cls : *g_ext_classes) delete cls;
     delete g_ext_classes;
     delete g_ext_classes_mutex;
+    /* the interned strings themselves are persistent and are not deallocated */
+    delete g_atom_table;       g_atom_table = nullptr;
+    delete g_atom_table_mutex; g_atom_table_mutex = nullptr;
+    delete g_weak_refs;        g_weak_refs = nullptr;
 }
 }
@@ -28,6 +28,7 @@ struct mpz_object {
     mpz         m_value;
     mpz_object() {}
     explicit mpz_object(mpz const & m):m_value(m) {}
+    explicit mpz_object(mpz && m):m_value(std::move(m)) {}
 };
 
 typedef lean_external_class         external_object_class;
@@ -172,6 +173,7 @@ inline object* apply_16(object* f, object* a1, object* a2, object* a3, object* a
     return lean_apply_16(f, a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16);
 }
 inline object* apply_n(object* f, unsigned n, object** args) { return lean_apply_n(f, n, args); }
+inline object* closure_direct_call_n(object* f, unsigned n, object** args) { return lean_closure_direct_call_n(f, n, args); }
 // pre: n > 16
 inline object* apply_m(object* f, unsigned n, object** args) { return lean_apply_m(f, n, args); }
 
@@ -179,6 +181,7 @@ inline object* apply_m(object* f, unsigned n, object** args) { return lean_apply
 // MPZ
 
 object * alloc_mpz(mpz const &);
+object * alloc_mpz(mpz &&);
 inline mpz_object * to_mpz(object * o) { lean_assert(is_mpz(o)); return (mpz_object*)o; }
 
 // =======================================
@@ -240,6 +243,15 @@ inline uint32 char_default_value() { return lean_char_default_value(); }
 inline obj_res alloc_string(size_t size, size_t capacity, size_t len) { return lean_alloc_string(size, capacity, len); }
 inline obj_res mk_string(char const * s) { return lean_mk_string(s); }
 obj_res mk_string(std::string const & s);
+/* Like `mk_string`, but short strings (<= 23 bytes) are interned in a bounded
+   global atom table and returned as shared persistent objects. Use for
+   symbol-like strings (identifiers, keywords) that recur frequently. */
+obj_res mk_atom_string(char const * s);
+obj_res mk_atom_string(char const * s, size_t sz);
+/* Registers the immortal (non reference counted) string `o` as the canonical object
+   for its contents, making it available to `lean_mk_string_literal`. The first
+   registration for given contents wins. */
+void intern_immortal_string(object * o);
 std::string string_to_std(b_obj_arg o);
 inline char const * string_cstr(b_obj_arg o) { return lean_string_cstr(o); }
 inline size_t string_size(b_obj_arg o) { return lean_string_size(o); }
@@ -310,6 +322,7 @@ inline obj_res mk_option_some(obj_arg v) { obj_res r = alloc_cnstr(1, 1, 0); cns
 
 inline mpz const & mpz_value(b_obj_arg o) { return to_mpz(o)->m_value; }
 object * mpz_to_nat_core(mpz const & m);
+object * mpz_to_nat_core(mpz && m);
 inline object * mk_nat_obj_core(mpz const & m) { return mpz_to_nat_core(m); }
 inline obj_res mk_nat_obj(mpz const & m) {
     if (m.is_size_t() && m.get_size_t() <= LEAN_MAX_SMALL_NAT)
@@ -336,6 +349,11 @@ inline uint8 nat_dec_lt(b_obj_arg a1, b_obj_arg a2) { return lean_nat_dec_lt(a1,
 inline obj_res nat_land(b_obj_arg a1, b_obj_arg a2) { return lean_nat_land(a1, a2); }
 inline obj_res nat_lor(b_obj_arg a1, b_obj_arg a2) { return lean_nat_lor(a1, a2); }
 inline obj_res nat_lxor(b_obj_arg a1, b_obj_arg a2) { return lean_nat_lxor(a1, a2); }
+inline obj_res nat_shiftl(b_obj_arg a1, b_obj_arg a2) { return lean_nat_shiftl(a1, a2); }
+inline obj_res nat_shiftr(b_obj_arg a1, b_obj_arg a2) { return lean_nat_shiftr(a1, a2); }
+inline obj_res nat_pow(b_obj_arg a1, b_obj_arg a2) { return lean_nat_pow(a1, a2); }
+inline obj_res nat_gcd(b_obj_arg a1, b_obj_arg a2) { return lean_nat_gcd(a1, a2); }
+inline obj_res nat_log2(b_obj_arg a) { return lean_nat_log2(a); }
 
 // =======================================
 // Integers
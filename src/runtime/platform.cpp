@@ -5,9 +5,106 @@ Released under Apache 2.0 license as described in the file LICENSE.
 Author: Leonardo de Moura
 */
 #include "runtime/object.h"
+#include "runtime/platform.h"
 #include "githash.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#elif defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#endif
 
 namespace lean {
+static uint64 g_cpu_features = 0;
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+/* XCR0, i.e. which register state the OS saves across context switches.
+   AVX features must not be reported unless the OS preserves the wider
+   registers, even when the CPU supports them. */
+static uint64 xgetbv0() {
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    uint32_t eax, edx;
+    __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<uint64>(edx) << 32) | eax;
+#endif
+}
+
+static void cpuid(unsigned leaf, unsigned subleaf, unsigned & eax, unsigned & ebx, unsigned & ecx, unsigned & edx) {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuidex(info, static_cast<int>(leaf), static_cast<int>(subleaf));
+    eax = info[0]; ebx = info[1]; ecx = info[2]; edx = info[3];
+#else
+    __cpuid_count(leaf, subleaf, eax, ebx, ecx, edx);
+#endif
+}
+
+static uint64 probe_cpu_features() {
+    uint64 r = 0;
+    unsigned eax, ebx, ecx, edx;
+    cpuid(0, 0, eax, ebx, ecx, edx);
+    unsigned max_leaf = eax;
+    if (max_leaf < 1)
+        return r;
+    cpuid(1, 0, eax, ebx, ecx, edx);
+    if (edx & (1u << 26)) r |= LEAN_CPU_FEATURE_SSE2;
+    if (ecx & (1u << 9))  r |= LEAN_CPU_FEATURE_SSSE3;
+    if (ecx & (1u << 20)) r |= LEAN_CPU_FEATURE_SSE42;
+    bool osxsave    = (ecx & (1u << 27)) && (ecx & (1u << 28));
+    uint64 xcr0     = osxsave ? xgetbv0() : 0;
+    bool   avx_os   = (xcr0 & 0x6) == 0x6;   /* XMM and YMM state */
+    bool avx512_os  = (xcr0 & 0xe6) == 0xe6; /* + opmask and ZMM state */
+    if (max_leaf >= 7) {
+        cpuid(7, 0, eax, ebx, ecx, edx);
+        if (avx_os && (ebx & (1u << 5)))     r |= LEAN_CPU_FEATURE_AVX2;
+        if (avx512_os && (ebx & (1u << 16))) r |= LEAN_CPU_FEATURE_AVX512F;
+        if (ebx & (1u << 8))  r |= LEAN_CPU_FEATURE_BMI2;
+        if (ebx & (1u << 19)) r |= LEAN_CPU_FEATURE_ADX;
+    }
+    return r;
+}
+#elif defined(__aarch64__) || defined(_M_ARM64)
+static uint64 probe_cpu_features() {
+    /* Advanced SIMD is mandatory on AArch64. */
+    uint64 r = LEAN_CPU_FEATURE_NEON;
+#if defined(__linux__)
+    unsigned long hwcap = getauxval(AT_HWCAP);
+#if defined(HWCAP_CRC32)
+    if (hwcap & HWCAP_CRC32) r |= LEAN_CPU_FEATURE_ARM_CRC32;
+#else
+    (void) hwcap;
+#endif
+#elif defined(__APPLE__) || defined(_M_ARM64)
+    /* ARMv8.1 baseline on Apple silicon and Windows on ARM */
+    r |= LEAN_CPU_FEATURE_ARM_CRC32;
+#endif
+    return r;
+}
+#else
+static uint64 probe_cpu_features() {
+    return 0;
+}
+#endif
+
+/* See comment in platform.h. */
+LEAN_EXPORT uint64 cpu_features() {
+    return g_cpu_features;
+}
+
+extern "C" LEAN_EXPORT uint64 lean_system_platform_cpu_features(obj_arg) {
+    return g_cpu_features;
+}
+
+void initialize_platform() {
+    g_cpu_features = probe_cpu_features();
+}
+
+void finalize_platform() {
+}
+
 extern "C" LEAN_EXPORT obj_res lean_system_platform_nbits(obj_arg) {
     if (sizeof(void*) == 8) {
         return box(64);
@@ -5,8 +5,35 @@ Released under Apache 2.0 license as described in the file LICENSE.
 Author: Leonardo de Moura
 */
 #pragma once
+#include "runtime/int64.h"
+
+/* Bits of the mask returned by `cpu_features`. The assignments are stable and
+   mirrored by `System.Platform.cpuFeatures` on the Lean side; add new bits at
+   the end of the respective architecture block. */
+#define LEAN_CPU_FEATURE_SSE2      (1ull << 0)
+#define LEAN_CPU_FEATURE_SSSE3     (1ull << 1)
+#define LEAN_CPU_FEATURE_SSE42     (1ull << 2)
+#define LEAN_CPU_FEATURE_AVX2      (1ull << 3)
+#define LEAN_CPU_FEATURE_AVX512F   (1ull << 4)
+#define LEAN_CPU_FEATURE_BMI2      (1ull << 5)
+#define LEAN_CPU_FEATURE_ADX       (1ull << 6)
+#define LEAN_CPU_FEATURE_NEON      (1ull << 16)
+#define LEAN_CPU_FEATURE_ARM_CRC32 (1ull << 17)
 
 namespace lean {
+/* Central runtime CPU feature detection for vectorized kernels.
+
+   The host CPU is probed once (cpuid on x86-64, including the xgetbv check
+   that the OS actually saves the wider register state; HWCAP on AArch64
+   Linux) by `initialize_platform`, which runs before every other runtime
+   initializer. A kernel with multiple implementations declares a function
+   pointer per entry point and resolves it in its own `initialize_*` based on
+   `cpu_features()`, so detection happens in exactly one place and the
+   per-call dispatch cost is a single indirect call through an initialized
+   global. The mask is also exposed to Lean (`System.Platform.cpuFeatures`)
+   so `@[extern]` kernels shipped outside the runtime can dispatch the same
+   way. */
+uint64 cpu_features();
 void initialize_platform();
 void finalize_platform();
 }
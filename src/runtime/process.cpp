@@ -23,6 +23,11 @@ Author: Jared Roesch
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/wait.h>
+#if !defined(LEAN_EMSCRIPTEN)
+#include <spawn.h>
+#endif
+#include <cstring>
+#include <vector>
 #endif
 
 #include "runtime/object.h"
@@ -276,6 +281,101 @@ static optional<pipe> setup_stdio(stdio cfg) {
     lean_unreachable();
 }
 
+#if !defined(LEAN_EMSCRIPTEN)
+#if defined(__APPLE__) || (defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 29)))
+#define LEAN_SPAWN_CHDIR 1
+#endif
+
+extern "C" char ** environ;
+
+/* Spawn `proc_name` via `posix_spawnp` and return the pid, or -1 when the
+   configuration cannot be expressed with posix_spawn (the caller then falls
+   back to fork+exec). posix_spawn is vfork-backed, so process creation does
+   not copy the parent's page tables and its latency stays flat as the
+   parent's resident set grows. */
+static pid_t spawn_via_posix_spawn(string_ref const & proc_name, array_ref<string_ref> const & args,
+  optional<pipe> const & stdin_pipe, optional<pipe> const & stdout_pipe, optional<pipe> const & stderr_pipe,
+  stdio stdin_mode, stdio stdout_mode, stdio stderr_mode,
+  option_ref<string_ref> const & cwd, array_ref<pair_ref<string_ref, option_ref<string_ref>>> const & env) {
+#if !defined(LEAN_SPAWN_CHDIR)
+    if (cwd)
+        return -1;
+#endif
+    posix_spawn_file_actions_t fa;
+    posix_spawn_file_actions_init(&fa);
+    if (stdin_pipe) {
+        posix_spawn_file_actions_adddup2(&fa, stdin_pipe->m_read_fd, STDIN_FILENO);
+        posix_spawn_file_actions_addclose(&fa, stdin_pipe->m_write_fd);
+    } else if (stdin_mode == stdio::NUL) {
+        posix_spawn_file_actions_addopen(&fa, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    }
+    if (stdout_pipe) {
+        posix_spawn_file_actions_adddup2(&fa, stdout_pipe->m_write_fd, STDOUT_FILENO);
+        posix_spawn_file_actions_addclose(&fa, stdout_pipe->m_read_fd);
+    } else if (stdout_mode == stdio::NUL) {
+        posix_spawn_file_actions_addopen(&fa, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    }
+    if (stderr_pipe) {
+        posix_spawn_file_actions_adddup2(&fa, stderr_pipe->m_write_fd, STDERR_FILENO);
+        posix_spawn_file_actions_addclose(&fa, stderr_pipe->m_read_fd);
+    } else if (stderr_mode == stdio::NUL) {
+        posix_spawn_file_actions_addopen(&fa, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+    }
+#if defined(LEAN_SPAWN_CHDIR)
+    if (cwd)
+        posix_spawn_file_actions_addchdir_np(&fa, cwd.get()->data());
+#endif
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+#if defined(POSIX_SPAWN_USEVFORK)
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_USEVFORK);
+#endif
+
+    buffer<char *> pargs;
+    pargs.push_back(const_cast<char *>(proc_name.data()));
+    for (auto & arg : args)
+        pargs.push_back(const_cast<char *>(arg.data()));
+    pargs.push_back(NULL);
+
+    /* The fork path applies `env` via setenv/unsetenv in the child; here we
+       build the child environment up front instead. */
+    std::vector<std::string> env_storage;
+    buffer<char *> penv;
+    char ** envp = environ;
+    if (env.size() > 0) {
+        for (char ** e = environ; *e; e++) {
+            char const * eq  = strchr(*e, '=');
+            size_t name_len  = eq ? static_cast<size_t>(eq - *e) : strlen(*e);
+            bool overridden  = false;
+            for (auto & entry : env) {
+                if (strlen(entry.fst().data()) == name_len && memcmp(entry.fst().data(), *e, name_len) == 0) {
+                    overridden = true;
+                    break;
+                }
+            }
+            if (!overridden)
+                env_storage.push_back(*e);
+        }
+        for (auto & entry : env) {
+            if (entry.snd())
+                env_storage.push_back(std::string(entry.fst().data()) + "=" + entry.snd().get()->data());
+        }
+        for (auto & s : env_storage)
+            penv.push_back(const_cast<char *>(s.c_str()));
+        penv.push_back(NULL);
+        envp = penv.data();
+    }
+
+    pid_t pid;
+    int rc = posix_spawnp(&pid, pargs[0], &fa, &attr, pargs.data(), envp);
+    posix_spawn_file_actions_destroy(&fa);
+    posix_spawnattr_destroy(&attr);
+    if (rc != 0)
+        throw rc;
+    return pid;
+}
+#endif
+
 static obj_res spawn(string_ref const & proc_name, array_ref<string_ref> const & args, stdio stdin_mode, stdio stdout_mode,
   stdio stderr_mode, option_ref<string_ref> const & cwd, array_ref<pair_ref<string_ref, option_ref<string_ref>>> const & env) {
     /* Setup stdio based on process configuration. */
@@ -283,7 +383,23 @@ static obj_res spawn(string_ref const & proc_name, array_ref<string_ref> const &
     auto stdout_pipe = setup_stdio(stdout_mode);
     auto stderr_pipe = setup_stdio(stderr_mode);
 
-    int pid = fork();
+    int pid = -1;
+#if !defined(LEAN_EMSCRIPTEN)
+    pid = spawn_via_posix_spawn(proc_name, args, stdin_pipe, stdout_pipe, stderr_pipe,
+        stdin_mode, stdout_mode, stderr_mode, cwd, env);
+#endif
+    /* Error-reporting pipe for the fork fallback: the child writes the errno of a
+       failed chdir/exec before exiting, so a missing executable surfaces as the
+       same thrown IO error as on the posix_spawn path. The write end is CLOEXEC:
+       a successful exec closes it and the parent's read sees EOF. */
+    int err_fds[2] = { -1, -1 };
+    if (pid == -1) {
+        if (::pipe(err_fds) == -1)
+            throw errno;
+        fcntl(err_fds[0], F_SETFD, FD_CLOEXEC);
+        fcntl(err_fds[1], F_SETFD, FD_CLOEXEC);
+        pid = fork();
+    }
 
     if (pid == 0) {
         for (auto & entry : env) {
@@ -320,8 +436,9 @@ static obj_res spawn(string_ref const & proc_name, array_ref<string_ref> const &
 
         if (cwd) {
             if (chdir(cwd.get()->data()) < 0) {
-                std::cerr << "could not change directory to " << cwd.get()->data() << std::endl;
-                exit(-1);
+                int err = errno;
+                while (write(err_fds[1], &err, sizeof(err)) == -1 && errno == EINTR) {}
+                _exit(127);
             }
         }
 
@@ -331,12 +448,29 @@ static obj_res spawn(string_ref const & proc_name, array_ref<string_ref> const &
             pargs.push_back(strdup(arg.data()));
         pargs.push_back(NULL);
 
-        if (execvp(pargs[0], pargs.data()) < 0) {
-            std::cerr << "could not execute external process '" << pargs[0] << "'" << std::endl;
-            exit(-1);
-        }
+        execvp(pargs[0], pargs.data());
+        int err = errno;
+        while (write(err_fds[1], &err, sizeof(err)) == -1 && errno == EINTR) {}
+        _exit(127);
     } else if (pid == -1) {
-        throw errno;
+        int err = errno;
+        close(err_fds[0]);
+        close(err_fds[1]);
+        throw err;
+    }
+
+    if (err_fds[0] != -1) {
+        close(err_fds[1]);
+        int err = 0;
+        ssize_t n;
+        /* blocks until the exec closes the CLOEXEC write end (EOF) or the child
+           reports a failure */
+        do { n = read(err_fds[0], &err, sizeof(err)); } while (n == -1 && errno == EINTR);
+        close(err_fds[0]);
+        if (n == sizeof(err)) {
+            waitpid(pid, nullptr, 0); /* reap the failed child */
+            throw err;
+        }
     }
 
     object * parent_stdin  = box(0);
@@ -0,0 +1,142 @@
+/*
+Copyright (c) 2023 Microsoft Corporation. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <vector>
+#include "runtime/rcprof.h"
+#include "runtime/thread.h"
+#if !defined(LEAN_WINDOWS) && !defined(LEAN_EMSCRIPTEN)
+#include <dlfcn.h>
+#define LEAN_RCPROF_DLADDR
+#endif
+namespace lean {
+LEAN_EXPORT uint64 g_rcprof_interval = 0;
+LEAN_THREAD_VALUE(uint64, g_rcprof_countdown, 0);
+
+#define LEAN_RCPROF_DEFAULT_INTERVAL 64
+#define LEAN_RCPROF_TOP_OBJECTS      20
+#define LEAN_RCPROF_TOP_CALL_SITES   4
+
+struct rcprof_entry {
+    uint64   m_count = 0;
+    unsigned m_tag = 0;
+    size_t   m_byte_size = 0;
+    std::map<void *, uint64> m_call_sites;
+};
+/* The maps operate on the system allocator and must not reenter the Lean
+   heap. The mutex is taken once per sample, i.e. once per
+   g_rcprof_interval atomic RC operations per thread. */
+typedef std::map<object *, rcprof_entry> rcprof_samples;
+static mutex * g_rcprof_mutex = nullptr;
+static rcprof_samples * g_rcprof_samples = nullptr;
+
+static char const * rcprof_tag_name(unsigned tag) {
+    if (tag <= LeanMaxCtorTag) return "ctor";
+    switch (tag) {
+    case LeanClosure:         return "closure";
+    case LeanArray:           return "array";
+    case LeanStructArray:     return "struct array";
+    case LeanScalarArray:     return "scalar array";
+    case LeanString:          return "string";
+    case LeanMPZ:             return "mpz";
+    case LeanThunk:           return "thunk";
+    case LeanTask:            return "task";
+    case LeanRef:             return "ref";
+    case LeanExternal:        return "external";
+    default:                  return "unknown";
+    }
+}
+
+static void rcprof_display_call_site(std::ostream & out, void * call_site) {
+#ifdef LEAN_RCPROF_DLADDR
+    Dl_info info;
+    if (dladdr(call_site, &info) && info.dli_sname) {
+        out << info.dli_sname;
+        return;
+    }
+#endif
+    out << call_site;
+}
+
+static void rcprof_dump_core(std::ostream & out) {
+    lock_guard<mutex> lock(*g_rcprof_mutex);
+    std::vector<std::pair<object *, rcprof_entry const *>> entries;
+    uint64 total = 0;
+    for (auto const & entry : *g_rcprof_samples) {
+        entries.emplace_back(entry.first, &entry.second);
+        total += entry.second.m_count;
+    }
+    std::sort(entries.begin(), entries.end(),
+              [](auto const & e1, auto const & e2) { return e1.second->m_count > e2.second->m_count; });
+    out << "top contended objects (" << total << " sampled atomic RC ops, interval "
+        << g_rcprof_interval << "):\n";
+    size_t n = std::min<size_t>(entries.size(), LEAN_RCPROF_TOP_OBJECTS);
+    for (size_t i = 0; i < n; i++) {
+        rcprof_entry const & e = *entries[i].second;
+        out << "  " << entries[i].first << " " << rcprof_tag_name(e.m_tag)
+            << " (" << e.m_byte_size << " bytes): " << e.m_count << " samples\n";
+        std::vector<std::pair<void *, uint64>> sites(e.m_call_sites.begin(), e.m_call_sites.end());
+        std::sort(sites.begin(), sites.end(),
+                  [](auto const & s1, auto const & s2) { return s1.second > s2.second; });
+        size_t m = std::min<size_t>(sites.size(), LEAN_RCPROF_TOP_CALL_SITES);
+        for (size_t j = 0; j < m; j++) {
+            out << "    ";
+            rcprof_display_call_site(out, sites[j].first);
+            out << ": " << sites[j].second << "\n";
+        }
+    }
+}
+
+static void rcprof_dump() {
+    if (char const * fname = std::getenv("LEAN_RC_PROF_OUT")) {
+        std::ofstream out(fname);
+        rcprof_dump_core(out);
+    } else {
+        rcprof_dump_core(std::cerr);
+    }
+}
+
+void rcprof_tick(object * o, void * call_site) {
+    if (g_rcprof_countdown > 1) {
+        g_rcprof_countdown--;
+        return;
+    }
+    g_rcprof_countdown = g_rcprof_interval;
+    /* the caller still holds a reference, so `o` is alive here even when
+       sampled from a dec */
+    lock_guard<mutex> lock(*g_rcprof_mutex);
+    rcprof_entry & e = (*g_rcprof_samples)[o];
+    if (e.m_count == 0) {
+        e.m_tag       = lean_ptr_tag(o);
+        e.m_byte_size = lean_object_byte_size(o);
+    }
+    e.m_count++;
+    e.m_call_sites[call_site]++;
+}
+
+void initialize_rcprof() {
+    char const * interval = std::getenv("LEAN_RC_PROF");
+    if (interval == nullptr)
+        return;
+    uint64 v = std::strtoull(interval, nullptr, 10);
+    g_rcprof_mutex    = new mutex();
+    g_rcprof_samples  = new rcprof_samples();
+    g_rcprof_interval = v > 1 ? v : LEAN_RCPROF_DEFAULT_INTERVAL;
+}
+
+void finalize_rcprof() {
+    if (g_rcprof_interval == 0)
+        return;
+    rcprof_dump();
+    g_rcprof_interval = 0;
+    delete g_rcprof_samples;
+    g_rcprof_samples = nullptr;
+    delete g_rcprof_mutex;
+    g_rcprof_mutex = nullptr;
+}
+}
@@ -0,0 +1,36 @@
+/*
+Copyright (c) 2023 Microsoft Corporation. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#pragma once
+#include "runtime/object.h"
+
+/* Return address of the current function, used as the sampled call site. */
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define LEAN_RCPROF_CALL_SITE() _ReturnAddress()
+#else
+#define LEAN_RCPROF_CALL_SITE() __builtin_return_address(0)
+#endif
+
+namespace lean {
+/* Sampling profiler for contended reference-count operations.
+
+   Once an object is marked multi-threaded, every `lean_inc`/`lean_dec` on it
+   is an atomic RMW on a potentially shared cache line. This profiler samples
+   the cold (multi-threaded) RC paths: when `LEAN_RC_PROF=<interval>` is set
+   (`LEAN_RC_PROF=1` selects the default interval), every thread records one
+   out of every <interval> atomic RC operations, keyed by the object and the
+   call site. At process exit (or on `LEAN_RC_PROF_OUT` pointing elsewhere than
+   stderr) the objects with the most sampled operations are reported together
+   with their tag, byte size and top call sites, so that structural fixes
+   (e.g. borrowing instead of sharing) can be aimed at the real offenders.
+
+   Aggregation is by object address; a profile is therefore a heuristic --
+   an address can be reused after the object dies -- but the objects that
+   matter here are long-lived shared structures (environments, caches). */
+extern uint64 g_rcprof_interval;
+void rcprof_tick(object * o, void * call_site);
+void initialize_rcprof();
+void finalize_rcprof();
+}
@@ -6,8 +6,13 @@ Author: Leonardo de Moura
 */
 #include <vector>
 #include <cstring>
+#include <memory>
+#include <unordered_set>
+#include <unordered_map>
 #include "runtime/object.h"
 #include "runtime/hash.h"
+#include "runtime/thread.h"
+#include "runtime/stackinfo.h"
 
 namespace lean {
 
@@ -268,4 +273,310 @@ public:
 extern "C" LEAN_EXPORT obj_res lean_state_sharecommon(b_obj_arg tc, obj_arg s, obj_arg a) {
     return sharecommon_fn(tc, s)(a);
 }
+
+// =======================================
+// Multi-threaded sharing with persistent tables
+
+/*
+  `lean_state_sharecommon` threads Lean-side persistent maps through closure calls, so it
+  is inherently single-threaded; on multi-GB environment snapshots the walk takes tens of
+  seconds. The entry point below is a native variant for that use case (share a snapshot
+  once, then freeze it):
+
+  - The canonical-object table (content hash -> representative) and the processed cache
+    (input pointer -> representative) are sharded by hash with one mutex per shard, so
+    workers rarely contend.
+  - Independent subgraphs of the input are processed by worker threads. Two workers may
+    race into the same shared subgraph before either publishes its result; the work is
+    then duplicated, but both arrive at the same representative through the content
+    table, so the result is unaffected.
+  - The tables are process-lifetime: a later run over an extended snapshot hits the
+    processed cache at the boundary of the previously-shared subgraphs and skips them
+    wholesale, which is the incremental mode. The references retained by the tables are
+    intentional; representatives are meant to stay alive (and typically become
+    persistent, see `lean_mark_persistent`).
+
+  The input graph is marked multi-threaded up front and all representatives are marked
+  before they are published, so every reference-count update involved is atomic.
+*/
+
+#define LEAN_SHARECOMMON_NUM_SHARDS  64
+#define LEAN_SHARECOMMON_MAX_WORKERS 8
+#define LEAN_SHARECOMMON_SEED_FACTOR 8
+
+class sharecommon_mt_context {
+    struct canon_shard {
+        mutex m_mutex;
+        /* The deep content hash is computed once per candidate and stored as the key,
+           so collision probes and table rehashes never re-hash an object body. A
+           candidate's children have already been replaced by their representatives
+           when it is interned, and so have the children of every table entry, hence
+           the confirming `lean_sharecommon_eq` on a hash match is a bytewise compare
+           of canonical child pointers and scalar fields -- O(fields), not a deep
+           comparison. */
+        std::unordered_multimap<uint64, object *> m_map;
+    };
+    struct processed_shard {
+        mutex m_mutex;
+        std::unordered_map<object *, object *> m_map;
+    };
+    canon_shard     m_canon[LEAN_SHARECOMMON_NUM_SHARDS];
+    processed_shard m_processed[LEAN_SHARECOMMON_NUM_SHARDS];
+
+    static size_t ptr_shard(object * o) {
+        return (reinterpret_cast<size_t>(o) >> 3) % LEAN_SHARECOMMON_NUM_SHARDS;
+    }
+
+public:
+    /* Return the representative for already-processed input object `a`, or nullptr. */
+    object * find_processed(object * a) {
+        processed_shard & s = m_processed[ptr_shard(a)];
+        lock_guard<mutex> lock(s.m_mutex);
+        auto it = s.m_map.find(a);
+        return it == s.m_map.end() ? nullptr : it->second;
+    }
+
+    /* Return the canonical object structurally equal to `new_a`, consuming `new_a`.
+       If there is none yet, `new_a` becomes canonical. */
+    object * intern(object * new_a) {
+        uint64 h = lean_sharecommon_hash(new_a);
+        canon_shard & s = m_canon[h % LEAN_SHARECOMMON_NUM_SHARDS];
+        lock_guard<mutex> lock(s.m_mutex);
+        auto range = s.m_map.equal_range(h);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (lean_sharecommon_eq(it->second, new_a)) {
+                lean_dec(new_a);
+                return it->second;
+            }
+        }
+        /* `new_a` was built by this worker and is still thread-local; make it safe to
+           share before publishing it (cf. `intern_expr_node`). The table keeps the
+           reference. */
+        lean_mark_mt(new_a);
+        s.m_map.emplace(h, new_a);
+        return new_a;
+    }
+
+    void save_processed(object * a, object * canon) {
+        processed_shard & s = m_processed[ptr_shard(a)];
+        lock_guard<mutex> lock(s.m_mutex);
+        if (s.m_map.emplace(a, canon).second) {
+            /* The cache retains both the key and the representative. `a` has been marked
+               multi-threaded up front, so the updates are atomic. */
+            lean_inc(a);
+            lean_inc(canon);
+        }
+    }
+};
+
+static sharecommon_mt_context & get_sharecommon_mt_context() {
+    static sharecommon_mt_context * ctx = new sharecommon_mt_context();
+    return *ctx;
+}
+
+/* Counterpart of `sharecommon_fn` publishing into the shared context instead of
+   Lean-side maps. Multiple instances may run concurrently. */
+class sharecommon_mt_fn {
+    sharecommon_mt_context &  m_ctx;
+    std::vector<lean_object*> m_children;
+    std::vector<lean_object*> m_todo;
+
+    bool push_child(b_obj_arg a) {
+        if (lean_is_scalar(a)) {
+            m_children.push_back(a);
+            return true;
+        }
+        switch (lean_ptr_tag(a)) {
+        case LeanReserved:
+            lean_unreachable();
+        case LeanMPZ:      case LeanThunk:
+        case LeanTask:     case LeanRef:
+        case LeanExternal: case LeanClosure:
+            m_children.push_back(a);
+            return true;
+        default:
+            break;
+        }
+        if (object * r = m_ctx.find_processed(a)) {
+            m_children.push_back(r);
+            return true;
+        }
+        m_todo.push_back(a);
+        return false;
+    }
+
+    void save(b_obj_arg a, obj_arg new_a) {
+        lean_assert(m_todo.size() > 0);
+        lean_assert(m_todo.back() == a);
+        m_todo.pop_back();
+        m_ctx.save_processed(a, m_ctx.intern(new_a));
+    }
+
+    void visit_array(b_obj_arg a) {
+        m_children.clear();
+        bool missing_children = false;
+        size_t sz = array_size(a);
+        for (size_t i = 0; i < sz; i++) {
+            if (!push_child(lean_array_get_core(a, i)))
+                missing_children = true;
+        }
+        if (missing_children)
+            return;
+        object * new_a = lean_alloc_array(sz, sz);
+        for (size_t i = 0; i < sz; i++) {
+            lean_inc(m_children[i]);
+            lean_array_set_core(new_a, i, m_children[i]);
+        }
+        save(a, new_a);
+    }
+
+    void visit_sarray(b_obj_arg a) {
+        size_t sz        = lean_sarray_size(a);
+        unsigned elem_sz = lean_sarray_elem_size(a);
+        lean_sarray_object * new_a = (lean_sarray_object*)lean_alloc_sarray(elem_sz, sz, sz);
+        memcpy(new_a->m_data, lean_to_sarray(a)->m_data, elem_sz*sz);
+        save(a, (lean_object*)new_a);
+    }
+
+    void visit_string(b_obj_arg a) {
+        size_t sz     = lean_string_size(a);
+        size_t len    = lean_string_len(a);
+        lean_string_object * new_a = (lean_string_object*)lean_alloc_string(sz, sz, len);
+        lean_set_st_header((lean_object*)new_a, LeanString, 0);
+        new_a->m_size     = sz;
+        new_a->m_capacity = sz;
+        new_a->m_length   = len;
+        memcpy(new_a->m_data, lean_to_string(a)->m_data, sz);
+        save(a, (lean_object*)new_a);
+    }
+
+    void visit_ctor(b_obj_arg a) {
+        m_children.clear();
+        unsigned num_objs  = lean_ctor_num_objs(a);
+        bool missing_child = false;
+        for (unsigned i = 0; i < num_objs; i++) {
+            if (!push_child(lean_ctor_get(a, i)))
+                missing_child = true;
+        }
+        if (missing_child)
+            return;
+        unsigned tag           = lean_ptr_tag(a);
+        unsigned sz            = lean_object_byte_size(a);
+        unsigned scalar_offset = sizeof(lean_object) + num_objs*sizeof(void*);
+        unsigned scalar_sz     = sz - scalar_offset;
+        lean_object * new_a    = lean_alloc_ctor(tag, num_objs, scalar_sz);
+        for (unsigned i = 0; i < num_objs; i++) {
+            lean_inc(m_children[i]);
+            lean_ctor_set(new_a, i, m_children[i]);
+        }
+        if (scalar_sz > 0) {
+            memcpy(reinterpret_cast<char*>(new_a) + scalar_offset, reinterpret_cast<char*>(a) + scalar_offset, scalar_sz);
+        }
+        save(a, new_a);
+    }
+
+public:
+    sharecommon_mt_fn(sharecommon_mt_context & ctx):m_ctx(ctx) {}
+
+    /* Maximize sharing for the subgraph rooted at `a` (borrowed). */
+    void process_root(b_obj_arg a) {
+        if (push_child(a))
+            return;
+        while (!m_todo.empty()) {
+            b_obj_arg curr = m_todo.back();
+            switch (lean_ptr_tag(curr)) {
+            case LeanClosure:         lean_unreachable();
+            case LeanArray:           visit_array(curr); break;
+            case LeanScalarArray:     visit_sarray(curr); break;
+            case LeanString:          visit_string(curr); break;
+            case LeanMPZ:             lean_unreachable();
+            case LeanThunk:           lean_unreachable();
+            case LeanTask:            lean_unreachable();
+            case LeanRef:             lean_unreachable();
+            case LeanExternal:        lean_unreachable();
+            case LeanReserved:        lean_unreachable();
+            default:                  visit_ctor(curr); break;
+            }
+        }
+        m_children.clear();
+    }
+};
+
+/* Collect up to `max` subgraph roots (object children of `a`, breadth-first) to be used
+   as worker seeds. */
+static void sharecommon_mt_seeds(object * a, size_t max, std::vector<object *> & seeds) {
+    seeds.push_back(a);
+    size_t i = 0;
+    while (i < seeds.size() && seeds.size() < max) {
+        object * curr = seeds[i]; i++;
+        switch (lean_ptr_tag(curr)) {
+        case LeanArray: {
+            size_t sz = array_size(curr);
+            for (size_t j = 0; j < sz && seeds.size() < max; j++) {
+                object * c = lean_array_get_core(curr, j);
+                if (!lean_is_scalar(c))
+                    seeds.push_back(c);
+            }
+            break;
+        }
+        case LeanScalarArray: case LeanString:
+        case LeanMPZ: case LeanThunk: case LeanTask:
+        case LeanRef: case LeanExternal: case LeanClosure:
+            break;
+        default: {
+            unsigned num_objs = lean_ctor_num_objs(curr);
+            for (unsigned j = 0; j < num_objs && seeds.size() < max; j++) {
+                object * c = lean_ctor_get(curr, j);
+                if (!lean_is_scalar(c))
+                    seeds.push_back(c);
+            }
+            break;
+        }
+        }
+    }
+}
+
+/* Runtime.shareCommon (a : α) : BaseIO α */
+extern "C" LEAN_EXPORT obj_res lean_sharecommon_mt(obj_arg a, obj_arg /* w */) {
+    if (lean_is_scalar(a))
+        return lean_io_result_mk_ok(a);
+    switch (lean_ptr_tag(a)) {
+    case LeanMPZ:      case LeanThunk:
+    case LeanTask:     case LeanRef:
+    case LeanExternal: case LeanClosure:
+        return lean_io_result_mk_ok(a);
+    default:
+        break;
+    }
+    /* Make all reference-count updates on the input atomic before any worker sees it. */
+    lean_mark_mt(a);
+    sharecommon_mt_context & ctx = get_sharecommon_mt_context();
+    unsigned nw = hardware_concurrency();
+    if (nw > LEAN_SHARECOMMON_MAX_WORKERS)
+        nw = LEAN_SHARECOMMON_MAX_WORKERS;
+    if (nw > 1) {
+        std::vector<object *> seeds;
+        sharecommon_mt_seeds(a, nw * LEAN_SHARECOMMON_SEED_FACTOR, seeds);
+        std::vector<std::unique_ptr<lthread>> threads;
+        for (unsigned i = 0; i < nw; i++) {
+            threads.push_back(std::unique_ptr<lthread>(new lthread([&ctx, &seeds, i, nw]() {
+                save_stack_info(false);
+                sharecommon_mt_fn fn(ctx);
+                for (size_t j = i; j < seeds.size(); j += nw)
+                    fn.process_root(seeds[j]);
+            })));
+        }
+        for (auto & t : threads)
+            t->join();
+    }
+    /* Final sequential pass over the root; with the subgraphs above already in the
+       processed cache this only stitches the spine together. */
+    sharecommon_mt_fn fn(ctx);
+    fn.process_root(a);
+    object * r = ctx.find_processed(a);
+    lean_assert(r != nullptr);
+    lean_inc(r);
+    lean_dec(a);
+    return lean_io_result_mk_ok(r);
+}
 };
@@ -0,0 +1,371 @@
+/*
+Copyright (c) 2023 Microsoft Corporation. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+/* for REG_RIP etc. in <sys/ucontext.h>; must precede the first glibc header */
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "runtime/sigprof.h"
+#include "runtime/thread.h"
+#include "runtime/sstream.h"
+#if !defined(LEAN_WINDOWS) && !defined(LEAN_EMSCRIPTEN)
+#include <csignal>
+#include <sys/time.h>
+#include <dlfcn.h>
+#if defined(__linux__)
+#include <ucontext.h>
+#endif
+#define LEAN_SIGPROF
+#endif
+
+namespace lean {
+LEAN_EXPORT uint64 g_sigprof_interval_usec = 0;
+
+#define LEAN_SIGPROF_MAX_DEPTH  64
+#define LEAN_SIGPROF_MAX_NATIVE 24
+#define LEAN_SIGPROF_MAX_SAMPLES (1u << 14)
+#define LEAN_SIGPROF_DEFAULT_INTERVAL_USEC 10000
+
+/* Per-thread shadow of the interpreter call stack, readable from the signal
+   handler. `m_depth` may exceed the array capacity; only the bottom (root
+   side) LEAN_SIGPROF_MAX_DEPTH entries are kept, so a truncated chain is
+   still rooted correctly. */
+struct sigprof_shadow {
+    char const * m_frames[LEAN_SIGPROF_MAX_DEPTH];
+    size_t       m_depth;
+};
+#ifdef _MSC_VER
+static __declspec(thread) sigprof_shadow g_sigprof_shadow;
+#else
+static __thread sigprof_shadow g_sigprof_shadow;
+#endif
+
+void sigprof_push_frame(char const * fn) {
+    size_t d = g_sigprof_shadow.m_depth;
+    if (d < LEAN_SIGPROF_MAX_DEPTH) {
+        g_sigprof_shadow.m_frames[d] = fn;
+        /* the handler must not see the new depth before the frame entry */
+        std::atomic_signal_fence(std::memory_order_release);
+    }
+    g_sigprof_shadow.m_depth = d + 1;
+}
+
+void sigprof_pop_frame() {
+    if (g_sigprof_shadow.m_depth > 0)
+        g_sigprof_shadow.m_depth--;
+}
+
+void sigprof_replace_frame(char const * fn) {
+    size_t d = g_sigprof_shadow.m_depth;
+    if (d != 0 && d <= LEAN_SIGPROF_MAX_DEPTH)
+        g_sigprof_shadow.m_frames[d - 1] = fn;
+}
+
+size_t & sigprof_depth() {
+    return g_sigprof_shadow.m_depth;
+}
+
+/* One recorded hit. The handler fills raw words only; interning, dladdr and
+   aggregation are all deferred to dump time. */
+struct sigprof_sample {
+    void *       m_pcs[LEAN_SIGPROF_MAX_NATIVE];
+    char const * m_decls[LEAN_SIGPROF_MAX_DEPTH];
+    uint32       m_num_pcs;
+    uint32       m_num_decls;
+    void *       m_task;
+};
+static sigprof_sample * g_sigprof_samples = nullptr;
+static atomic<uint32>   g_sigprof_next(0);
+static atomic<uint32>   g_sigprof_dropped(0);
+static uint64           g_sigprof_start_nanos = 0;
+
+static mutex * g_sigprof_mutex = nullptr;
+static std::unordered_set<std::string> * g_sigprof_strings = nullptr;
+
+char const * sigprof_intern(std::string const & s) {
+    lock_guard<mutex> lock(*g_sigprof_mutex);
+    return g_sigprof_strings->insert(s).first->c_str();
+}
+
+#ifdef LEAN_SIGPROF
+/* Leaf PC from the interrupted context, then a frame-pointer walk with the
+   same sanity bounds as `allocprof_backtrace`. Where the register set is not
+   known we walk from the handler frame instead; the extra signal-trampoline
+   frames are cosmetic. */
+static unsigned sigprof_native_backtrace(void ** frames, unsigned max_frames, void * ucontext) {
+    unsigned n = 0;
+    void ** fp;
+#if defined(__linux__) && defined(__x86_64__)
+    ucontext_t * uc = static_cast<ucontext_t *>(ucontext);
+    frames[n++] = reinterpret_cast<void *>(uc->uc_mcontext.gregs[REG_RIP]);
+    fp = reinterpret_cast<void **>(uc->uc_mcontext.gregs[REG_RBP]);
+#elif defined(__linux__) && defined(__aarch64__)
+    ucontext_t * uc = static_cast<ucontext_t *>(ucontext);
+    frames[n++] = reinterpret_cast<void *>(uc->uc_mcontext.pc);
+    fp = reinterpret_cast<void **>(uc->uc_mcontext.regs[29]);
+#else
+    (void) ucontext;
+    fp = reinterpret_cast<void **>(__builtin_frame_address(0));
+#endif
+    while (n < max_frames && fp != nullptr) {
+        void ** next = reinterpret_cast<void **>(fp[0]);
+        void * ret   = fp[1];
+        if (ret == nullptr)
+            break;
+        frames[n++] = ret;
+        if (next <= fp ||
+            reinterpret_cast<char *>(next) - reinterpret_cast<char *>(fp) > 1024 * 1024 ||
+            (reinterpret_cast<uintptr_t>(next) & (sizeof(void *) - 1)) != 0)
+            break;
+        fp = next;
+    }
+    return n;
+}
+
+static void sigprof_handler(int, siginfo_t *, void * ucontext) {
+    int saved_errno = errno;
+    uint32 idx = atomic_fetch_add_explicit(&g_sigprof_next, 1u, memory_order_relaxed);
+    if (idx >= LEAN_SIGPROF_MAX_SAMPLES) {
+        g_sigprof_dropped++;
+        errno = saved_errno;
+        return;
+    }
+    sigprof_sample & s = g_sigprof_samples[idx];
+    s.m_num_pcs = sigprof_native_backtrace(s.m_pcs, LEAN_SIGPROF_MAX_NATIVE, ucontext);
+    std::atomic_signal_fence(std::memory_order_acquire);
+    size_t depth = g_sigprof_shadow.m_depth;
+    if (depth > LEAN_SIGPROF_MAX_DEPTH)
+        depth = LEAN_SIGPROF_MAX_DEPTH;
+    for (size_t i = 0; i < depth; i++)
+        s.m_decls[i] = g_sigprof_shadow.m_frames[i];
+    s.m_num_decls = static_cast<uint32>(depth);
+    s.m_task = g_runtime_tls.m_current_task;
+    errno = saved_errno;
+}
+#endif
+
+// =======================================
+// pprof profile.proto encoding (https://github.com/google/pprof/blob/main/proto/profile.proto).
+// The format is plain proto wire encoding; hand-rolling the few message types
+// we emit avoids a protobuf dependency. pprof accepts uncompressed profiles.
+
+static void pb_varint(std::string & out, uint64 v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<char>(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+static void pb_key(std::string & out, unsigned field, unsigned wire) {
+    pb_varint(out, (field << 3) | wire);
+}
+
+static void pb_u(std::string & out, unsigned field, uint64 v) {
+    pb_key(out, field, 0);
+    pb_varint(out, v);
+}
+
+static void pb_msg(std::string & out, unsigned field, std::string const & payload) {
+    pb_key(out, field, 2);
+    pb_varint(out, payload.size());
+    out += payload;
+}
+
+static void sigprof_dump(std::ostream & out) {
+    uint32 n = g_sigprof_next.load();
+    if (n > LEAN_SIGPROF_MAX_SAMPLES)
+        n = LEAN_SIGPROF_MAX_SAMPLES;
+    uint64 interval_ns = g_sigprof_interval_usec * 1000;
+
+    std::vector<std::string> strtab;
+    std::unordered_map<std::string, uint64> str_ids;
+    strtab.push_back("");
+    str_ids[""] = 0;
+    auto str_id = [&](std::string const & s) -> uint64 {
+        auto it = str_ids.find(s);
+        if (it != str_ids.end())
+            return it->second;
+        uint64 id = strtab.size();
+        strtab.push_back(s);
+        str_ids.emplace(s, id);
+        return id;
+    };
+
+    std::string functions;
+    std::unordered_map<uint64, uint64> func_ids; // string id -> function id
+    auto function_id = [&](std::string const & fn) -> uint64 {
+        uint64 sid = str_id(fn);
+        auto it = func_ids.find(sid);
+        if (it != func_ids.end())
+            return it->second;
+        uint64 id = func_ids.size() + 1;
+        func_ids.emplace(sid, id);
+        std::string f;
+        pb_u(f, 1, id);  // Function.id
+        pb_u(f, 2, sid); // Function.name
+        pb_u(f, 3, sid); // Function.system_name
+        pb_msg(functions, 5, f);
+        return id;
+    };
+
+    std::string locations;
+    /* keyed by PC, or by the interned name pointer for interpreter frames;
+       the two pointer spaces are disjoint */
+    std::unordered_map<void const *, uint64> loc_ids;
+    uint64 next_loc_id = 1;
+    auto native_loc = [&](void * pc) -> uint64 {
+        auto it = loc_ids.find(pc);
+        if (it != loc_ids.end())
+            return it->second;
+        uint64 id = next_loc_id++;
+        loc_ids.emplace(pc, id);
+        std::string l;
+        pb_u(l, 1, id);                                         // Location.id
+        pb_u(l, 3, reinterpret_cast<uintptr_t>(pc));            // Location.address
+#ifdef LEAN_SIGPROF
+        Dl_info info;
+        if (dladdr(pc, &info) && info.dli_sname) {
+            std::string line;
+            pb_u(line, 1, function_id(info.dli_sname));
+            pb_msg(l, 4, line);                                 // Location.line
+        }
+#endif
+        pb_msg(locations, 4, l);
+        return id;
+    };
+    auto decl_loc = [&](char const * fn) -> uint64 {
+        auto it = loc_ids.find(fn);
+        if (it != loc_ids.end())
+            return it->second;
+        uint64 id = next_loc_id++;
+        loc_ids.emplace(fn, id);
+        std::string l;
+        pb_u(l, 1, id);
+        std::string line;
+        pb_u(line, 1, function_id(fn));
+        pb_msg(l, 4, line);
+        pb_msg(locations, 4, l);
+        return id;
+    };
+
+    std::string samples;
+    for (uint32 i = 0; i < n; i++) {
+        sigprof_sample const & s = g_sigprof_samples[i];
+        /* leaf first: native PCs, then the interpreter chain beneath them */
+        std::string locs;
+        for (uint32 j = 0; j < s.m_num_pcs; j++)
+            pb_varint(locs, native_loc(s.m_pcs[j]));
+        for (uint32 j = s.m_num_decls; j > 0; j--)
+            pb_varint(locs, decl_loc(s.m_decls[j - 1]));
+        std::string smp;
+        pb_msg(smp, 1, locs);                                   // Sample.location_id (packed)
+        std::string vals;
+        pb_varint(vals, 1);
+        pb_varint(vals, interval_ns);
+        pb_msg(smp, 2, vals);                                   // Sample.value (packed)
+        if (s.m_task != nullptr) {
+            std::string lbl;
+            pb_u(lbl, 1, str_id("task"));                       // Label.key
+            pb_u(lbl, 3, reinterpret_cast<uintptr_t>(s.m_task)); // Label.num
+            pb_msg(smp, 3, lbl);
+        }
+        pb_msg(samples, 2, smp);
+    }
+
+    std::string profile;
+    {
+        std::string vt;
+        pb_u(vt, 1, str_id("samples"));
+        pb_u(vt, 2, str_id("count"));
+        pb_msg(profile, 1, vt);                                 // Profile.sample_type
+    }
+    {
+        std::string vt;
+        pb_u(vt, 1, str_id("cpu"));
+        pb_u(vt, 2, str_id("nanoseconds"));
+        pb_msg(profile, 1, vt);
+    }
+    profile += samples;
+    profile += locations;
+    profile += functions;
+    pb_u(profile, 9, g_sigprof_start_nanos);                    // Profile.time_nanos
+    uint64 now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    if (now > g_sigprof_start_nanos)
+        pb_u(profile, 10, now - g_sigprof_start_nanos);         // Profile.duration_nanos
+    {
+        std::string vt;
+        pb_u(vt, 1, str_id("cpu"));
+        pb_u(vt, 2, str_id("nanoseconds"));
+        pb_msg(profile, 11, vt);                                // Profile.period_type
+    }
+    pb_u(profile, 12, interval_ns);                             // Profile.period
+    if (uint32 dropped = g_sigprof_dropped.load())
+        pb_u(profile, 13, str_id((sstream() << dropped << " samples dropped (sample buffer full)").str()));
+    for (std::string const & s : strtab) {
+        pb_key(profile, 6, 2);                                  // Profile.string_table
+        pb_varint(profile, s.size());
+        profile += s;
+    }
+    out.write(profile.data(), profile.size());
+}
+
+void initialize_sigprof() {
+#ifdef LEAN_SIGPROF
+    char const * v = std::getenv("LEAN_SIGPROF");
+    if (v == nullptr)
+        return;
+    uint64 usec = std::strtoull(v, nullptr, 10);
+    if (usec <= 1)
+        usec = LEAN_SIGPROF_DEFAULT_INTERVAL_USEC;
+    g_sigprof_mutex   = new mutex();
+    g_sigprof_strings = new std::unordered_set<std::string>();
+    g_sigprof_samples = static_cast<sigprof_sample *>(malloc(sizeof(sigprof_sample) * LEAN_SIGPROF_MAX_SAMPLES));
+    g_sigprof_start_nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    struct sigaction act;
+    memset(&act, 0, sizeof(act));
+    act.sa_sigaction = sigprof_handler;
+    act.sa_flags     = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&act.sa_mask);
+    sigaction(SIGPROF, &act, nullptr);
+    struct itimerval tv;
+    tv.it_interval.tv_sec  = usec / 1000000;
+    tv.it_interval.tv_usec = usec % 1000000;
+    tv.it_value = tv.it_interval;
+    setitimer(ITIMER_PROF, &tv, nullptr);
+    /* published last: the interpreter hooks and `sigprof_intern` key off it */
+    g_sigprof_interval_usec = usec;
+#endif
+}
+
+void finalize_sigprof() {
+#ifdef LEAN_SIGPROF
+    if (g_sigprof_interval_usec == 0)
+        return;
+    struct itimerval tv;
+    memset(&tv, 0, sizeof(tv));
+    setitimer(ITIMER_PROF, &tv, nullptr);
+    signal(SIGPROF, SIG_IGN);
+    g_sigprof_interval_usec = 0;
+    char const * fname = std::getenv("LEAN_SIGPROF_OUT");
+    std::ofstream out(fname ? fname : "lean.sigprof.pb", std::ios::binary);
+    sigprof_dump(out);
+    free(g_sigprof_samples);   g_sigprof_samples = nullptr;
+    delete g_sigprof_strings;  g_sigprof_strings = nullptr;
+    delete g_sigprof_mutex;    g_sigprof_mutex = nullptr;
+#endif
+}
+}
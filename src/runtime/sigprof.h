@@ -0,0 +1,51 @@
+/*
+Copyright (c) 2023 Microsoft Corporation. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#pragma once
+#include <string>
+#include "runtime/object.h"
+
+namespace lean {
+/* Sampling CPU profiler.
+
+   External profilers see interpreter workloads as one opaque `eval_body`
+   frame; this profiler samples both sides. When LEAN_SIGPROF=<interval usec>
+   is set (LEAN_SIGPROF=1 selects the default 10ms period), a SIGPROF timer
+   interrupts the process at the given CPU-time interval and the handler
+   records the native program counters (leaf PC from the signal context plus
+   a frame-pointer walk) together with the interpreter's current declaration
+   chain, read from a per-thread shadow stack of interned C strings that the
+   interpreter maintains while the profiler is enabled. Each sample is also
+   tagged with the current task object, so per-task slices can be extracted
+   with `pprof -tagfocus`.
+
+   The handler only claims a slot in a preallocated sample buffer and copies
+   raw words into it, so it is async-signal-safe. At process exit (or when
+   LEAN_SIGPROF_OUT names the output file, `lean.sigprof.pb` by default) the
+   samples are written as an uncompressed pprof profile.proto, ready for
+   `pprof -http` / `pprof -top`. Unix only; on Windows the hooks compile to
+   no-ops. */
+extern uint64 g_sigprof_interval_usec;
+inline bool sigprof_enabled() { return g_sigprof_interval_usec != 0; }
+
+/* Intern `s` in the profiler's string table. The returned pointer is stable
+   until `finalize_sigprof`, so it may be stored in the shadow stack and read
+   from the signal handler after the originating object is gone. */
+char const * sigprof_intern(std::string const & s);
+
+/* Shadow-stack maintenance, called by the interpreter around each frame when
+   `sigprof_enabled()`. `fn` must be an interned string. Pushes beyond the
+   shadow capacity only bump the depth counter, so deep recursion truncates
+   the recorded chain at the root side instead of corrupting it. */
+void sigprof_push_frame(char const * fn);
+void sigprof_pop_frame();
+/* Rename the top frame in place (tail calls replace their frame). */
+void sigprof_replace_frame(char const * fn);
+/* Reference to the current thread's shadow depth; used with `flet` to
+   re-balance the shadow stack when an exception unwinds interpreter frames. */
+size_t & sigprof_depth();
+
+void initialize_sigprof();
+void finalize_sigprof();
+}
@@ -18,6 +18,7 @@ Port of the corresponding Rust code (see links below).
 #include <cstdlib>
 #include <cstring>
 #include <lean/lean.h>
+#include "runtime/stackinfo.h"
 #include "runtime/stack_overflow.h"
 
 namespace lean {
@@ -52,8 +53,24 @@ stack_guard::~stack_guard() {}
 // https://github.com/rust-lang/rust/blob/master/src/libstd/sys/unix/stack_overflow.rs
 
 
+// page size, cached at initialization so the signal handler does not call sysconf
+static size_t g_page_size = 4096;
+
 // https://github.com/rust-lang/rust/blob/7c8dbd969dd0ef2af6d8bab9e03ba7ce6cac41a2/src/libstd/sys/unix/thread.rs#L293
 bool is_within_stack_guard(void * addr) {
+    size_t lo, hi;
+    if (get_cached_stack_bounds(lo, hi)) {
+        /* Async-signal-safe path: decide from the bounds cached in TLS by
+           `save_stack_info` instead of querying pthread (pthread_getattr_np
+           allocates and reads /proc on glibc, which is not safe here). The
+           cached low bound sits a few frames above the true stack base, so we
+           accept a window of slack around it; a stray pointer landing in that
+           window would be misreported as a stack overflow, but either way the
+           process is about to abort. */
+        size_t a = reinterpret_cast<size_t>(addr);
+        return a + g_page_size > lo && a < lo + 16 * g_page_size;
+    }
+    /* Fallback for threads that never ran `save_stack_info`. */
     char * stackaddr;
 #ifdef __APPLE__
     stackaddr = static_cast<char *>(pthread_get_stackaddr_np(pthread_self())) - pthread_get_stacksize_np(pthread_self());
@@ -106,6 +123,7 @@ void initialize_stack_overflow() {
 #ifdef LEAN_WINDOWS
     AddVectoredExceptionHandler(0, stack_overflow_handler);
 #elif !defined(LEAN_EMSCRIPTEN)
+    g_page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
     struct sigaction action;
     memset(&action, 0, sizeof(struct sigaction));
     action.sa_flags = SA_SIGINFO | SA_ONSTACK;
@@ -6,6 +6,9 @@ Author: Leonardo de Moura
 */
 #include <memory.h>
 #include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <lean/lean.h>
 #include "runtime/thread.h"
 #include "runtime/exception.h"
 
@@ -100,5 +103,36 @@ void check_stack(char const * component_name) {
     if (curr_stack < g_stack_threshold)
         throw stack_space_exception(component_name);
 }
+
+/* Async-signal-safe read of the stack bounds cached by `save_stack_info`:
+   only TLS loads, no pthread calls. Returns false if the current thread has
+   not run `save_stack_info`. The low bound is approximate: it is derived from
+   the stack pointer observed at `save_stack_info` time, which sits at most a
+   few frames above the true stack base. */
+bool get_cached_stack_bounds(size_t & low, size_t & high) {
+    if (!g_stack_info_init || g_stack_size > g_stack_base)
+        return false;
+    low  = g_stack_base - g_stack_size;
+    high = g_stack_base;
+    return true;
+}
+
+/* Cheap stack probe for compiled code: a TLS load and a comparison on the fast
+   path, no syscalls. Unlike `check_stack`, it does not throw (compiled code
+   cannot unwind through the C ABI); it reports the overflow and aborts, like
+   the guard-page handler in stack_overflow.cpp, but while there is still
+   LEAN_STACK_BUFFER_SPACE left, so the report itself cannot fault. */
+extern "C" LEAN_EXPORT void lean_check_stack() {
+    if (LEAN_UNLIKELY(!g_stack_info_init))
+        save_stack_info(false);
+    char y;
+    if (LEAN_UNLIKELY(reinterpret_cast<size_t>(&y) < g_stack_threshold)) {
+        fprintf(stderr, "\nStack overflow detected. Aborting.\n");
+        abort();
+    }
 }
+}
+#else
+/* With split stacks there is nothing to probe. */
+extern "C" LEAN_EXPORT void lean_check_stack() {}
 #endif
@@ -15,6 +15,7 @@ inline size_t get_stack_size(bool ) { return 8192*1024; }
 inline void save_stack_info(bool = true) {}
 inline size_t get_used_stack_size() { return 0; }
 inline size_t get_available_stack_size() { return 8192*1024; }
+inline bool get_cached_stack_bounds(size_t &, size_t &) { return false; }
 #else
 size_t get_stack_size(bool main);
 void save_stack_info(bool main = true);
@@ -27,5 +28,12 @@ size_t get_available_stack_size();
    user which module is the potential offender.
 */
 void check_stack(char const * component_name);
+/**
+   \brief Async-signal-safe access to the stack bounds cached by \c save_stack_info
+   for the current thread (TLS reads only; safe to call from a signal handler).
+
+   \return false if \c save_stack_info has not run on this thread.
+*/
+bool get_cached_stack_bounds(size_t & low, size_t & high);
 #endif
 }
@@ -13,7 +13,7 @@ namespace lean {
 /* Wrapper for Lean string objects */
 class string_ref : public object_ref {
 public:
-    explicit string_ref(char const * s):object_ref(mk_string(s)) {}
+    explicit string_ref(char const * s):object_ref(mk_atom_string(s)) {}
     explicit string_ref(std::string const & s):object_ref(mk_string(s)) {}
     explicit string_ref(sstream const & strm):string_ref(strm.str()) {}
     string_ref(string_ref const & other):object_ref(other) {}
@@ -28,6 +28,8 @@ public:
     size_t num_bytes() const { return string_size(raw()) - 1; }
     /* The length is the number of unicode scalars. It is <= num_bytes. */
     size_t length() const { return string_len(raw()); }
+    /* Borrowed, null-terminated view of the UTF8 data; valid while this `string_ref`
+       (or another owner of the underlying object) is alive. No RC traffic. */
     char const * data() const { return string_cstr(raw()); }
     std::string to_std_string() const { return std::string(data(), num_bytes()); }
     friend bool operator==(string_ref const & s1, string_ref const & s2) { return string_eq(s1.raw(), s2.raw()); }
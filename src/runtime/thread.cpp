@@ -24,6 +24,14 @@ Author: Leonardo de Moura
 #endif
 
 namespace lean {
+/* Aggregated hot thread-locals; see the documentation in thread.h. Thread
+   storage is zero-initialized, matching the individual variables it replaces. */
+#ifdef _MSC_VER
+__declspec(thread) runtime_tls g_runtime_tls;
+#else
+__thread runtime_tls g_runtime_tls;
+#endif
+
 static std::vector<std::function<void()>> * g_thread_local_reset_fns;
 
 static void initialize_thread_local_reset_fns() {
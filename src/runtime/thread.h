@@ -8,6 +8,9 @@ Author: Leonardo de Moura
 #include <iostream>
 #include <chrono>
 #include <functional>
+#include "runtime/int64.h"
+
+struct lean_task; /* see lean.h */
 
 #ifndef LEAN_STACK_BUFFER_SPACE
 #define LEAN_STACK_BUFFER_SPACE 128*1024  // 128 Kb
@@ -216,6 +219,38 @@ static T & GETTER_NAME() {                                              \
 }
 
 namespace lean {
+namespace allocator { struct heap; struct page; }
+
+/* Aggregated thread-local block for the hottest runtime thread-locals.
+
+   On ELF targets an access to a `__thread` variable of the executable is a
+   single segment-relative load, but on macOS (code in dylibs) and Windows
+   every access of every separate thread-local goes through a TLS helper call
+   (`tlv_get_addr` / the TLS index lookup). Packing the hot pointers into one
+   block makes one address computation cover all of them: within a function
+   the compiler computes the block address once and folds further member
+   accesses into offsets, and the members share a cache line. The block is
+   zero-initialized exactly like the individual variables it replaces. Each
+   member is owned by the translation unit noted next to it, which accesses it
+   under its traditional `g_` name via a local macro. */
+struct runtime_tls {
+    /* allocator state (runtime/alloc.cpp) */
+    allocator::heap *  m_heap;
+    allocator::page ** m_curr_pages;
+    /* deterministic-timeout counter (runtime/interrupt.cpp) */
+    size_t             m_heartbeat;
+    /* task running on this worker and its heartbeat snapshot at the start of
+       the current step (runtime/object.cpp) */
+    ::lean_task *      m_current_task;
+    uint64             m_task_step_start_heartbeats;
+};
+
+#ifdef _MSC_VER
+extern __declspec(thread) runtime_tls g_runtime_tls;
+#else
+extern __thread runtime_tls g_runtime_tls;
+#endif
+
 void initialize_thread();
 void finalize_thread();
 
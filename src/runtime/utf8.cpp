@@ -5,6 +5,7 @@ Released under Apache 2.0 license as described in the file LICENSE.
 Author: Leonardo de Moura
 */
 #include <cstdlib>
+#include <cstring>
 #include <string>
 #include "runtime/debug.h"
 #include "runtime/optional.h"
@@ -33,26 +34,68 @@ unsigned get_utf8_size(unsigned char c) {
 }
 
 extern "C" LEAN_EXPORT size_t lean_utf8_strlen(char const * str) {
-    size_t r = 0;
-    while (*str != 0) {
-        unsigned sz = get_utf8_size(*str);
-        r++;
-        str += sz;
-    }
-    return r;
+    return lean_utf8_n_strlen(str, strlen(str));
 }
 
 size_t utf8_strlen(char const * str) {
     return lean_utf8_strlen(str);
 }
 
+/* In valid UTF-8, the number of codepoints is the number of bytes that are not
+   continuation bytes (0b10xxxxxx). We count them a word at a time: for each byte,
+   `(b >> 7) & ~(b >> 6) & 1` is 1 iff `b` is a continuation byte, and the per-byte
+   bits are summed with a multiply. This function sits on the hot path of
+   `lean_mk_string`, which ingests every source file and deserialized string. */
 extern "C" LEAN_EXPORT size_t lean_utf8_n_strlen(char const * str, size_t sz) {
+    unsigned char const * s = reinterpret_cast<unsigned char const *>(str);
+    size_t r = 0;
+    size_t i = 0;
+    /* scalar until word-aligned */
+    while (i < sz && reinterpret_cast<uintptr_t>(s + i) % sizeof(uint64_t) != 0) {
+        r += (s[i] & 0xC0) != 0x80;
+        i++;
+    }
+    for (; i + sizeof(uint64_t) <= sz; i += sizeof(uint64_t)) {
+        uint64_t w;
+        memcpy(&w, s + i, sizeof(uint64_t));
+        uint64_t cont = (w >> 7) & ~(w >> 6) & UINT64_C(0x0101010101010101);
+        /* `cont` has at most one bit set per byte, so the byte sum fits in the top byte. */
+        r += sizeof(uint64_t) - ((cont * UINT64_C(0x0101010101010101)) >> 56);
+    }
+    for (; i < sz; i++) {
+        r += (s[i] & 0xC0) != 0x80;
+    }
+    return r;
+}
+
+/* Return the number of UTF-16 code units needed to transcode the UTF-8 string
+   `str`: one per codepoint, plus one more per supplementary-plane codepoint,
+   i.e. per 0b11110xxx lead byte. Counted a word at a time like
+   `lean_utf8_n_strlen` above; this backs `String.utf16Length`, which the
+   language server needs for every position it exchanges with the editor. */
+extern "C" LEAN_EXPORT size_t lean_utf8_n_strlen16(char const * str, size_t sz) {
+    unsigned char const * s = reinterpret_cast<unsigned char const *>(str);
     size_t r = 0;
     size_t i = 0;
-    while (i < sz) {
-        unsigned d = get_utf8_size(str[i]);
-        r++;
-        i += d;
+    while (i < sz && reinterpret_cast<uintptr_t>(s + i) % sizeof(uint64_t) != 0) {
+        r += (s[i] & 0xC0) != 0x80;
+        r += (s[i] & 0xF8) == 0xF0;
+        i++;
+    }
+    for (; i + sizeof(uint64_t) <= sz; i += sizeof(uint64_t)) {
+        uint64_t w;
+        memcpy(&w, s + i, sizeof(uint64_t));
+        uint64_t cont = (w >> 7) & ~(w >> 6) & UINT64_C(0x0101010101010101);
+        uint64_t four = (w >> 7) & (w >> 6) & (w >> 5) & (w >> 4) & ~(w >> 3) & UINT64_C(0x0101010101010101);
+        /* per-byte unit count: 1 for each non-continuation byte, plus 1 for each
+           4-byte lead byte; at most 2 per byte, so the sum of a word fits in the
+           top byte of the multiply */
+        uint64_t units = (cont ^ UINT64_C(0x0101010101010101)) + four;
+        r += (units * UINT64_C(0x0101010101010101)) >> 56;
+    }
+    for (; i < sz; i++) {
+        r += (s[i] & 0xC0) != 0x80;
+        r += (s[i] & 0xF8) == 0xF0;
     }
     return r;
 }
@@ -0,0 +1,175 @@
+/*
+Copyright (c) 2023 Microsoft Corporation. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "runtime/object.h"
+#include "util/io.h"
+#include "kernel/environment.h"
+#include "kernel/type_checker.h"
+#include "kernel/kernel_exception.h"
+#include "initialize/init.h"
+
+/* kernel-bench: offline benchmark harness for the kernel type checker.
+
+   Loads the given .olean files (which must be listed in dependency order,
+   e.g. the output of `lean --deps`), installs every exported declaration in a
+   kernel environment without checking, and then re-checks declarations with a
+   fresh `type_checker` each, measuring wall-clock time and heartbeats (one
+   heartbeat per small-object allocation, so the heartbeat delta is an
+   allocation count). By default only the declarations of the last module are
+   re-checked -- the earlier modules are context -- so a run isolates one
+   module of interest; `--all` re-checks everything loaded.
+
+   This exercises exactly the code under src/kernel/ with none of the
+   elaborator on top, so type_checker changes can be measured and bisected
+   without full builds. */
+
+namespace lean {
+extern "C" object * lean_read_module_data(object * fname, object * w);
+extern "C" obj_res lean_io_get_num_heartbeats(obj_arg w);
+extern "C" object * lean_environment_add(object * env, object * cinfo);
+extern "C" object * lean_environment_mark_quot_init(object * env);
+
+static uint64 num_heartbeats() {
+    object * r = get_io_result<object_ref>(lean_io_get_num_heartbeats(io_mk_world())).steal();
+    lean_assert(lean_is_scalar(r));
+    return lean_unbox(r);
+}
+
+struct decl_timing {
+    name   m_name;
+    double m_us;
+    uint64 m_heartbeats;
+};
+
+/* Re-run on `ci` the checks `environment::add` would perform, with a fresh
+   type checker state so every declaration is measured from cold caches. */
+static void check_decl(environment const & env, constant_info const & ci) {
+    bool safe_only = false;
+    type_checker checker(env, safe_only);
+    expr sort = checker.check(ci.get_type(), ci.get_lparams());
+    checker.ensure_sort(sort, ci.get_type());
+    if (ci.has_value(true)) {
+        expr val_type = checker.check(ci.get_value(true), ci.get_lparams());
+        if (!checker.is_def_eq(val_type, ci.get_type()))
+            throw kernel_exception(env, "declaration type mismatch");
+    }
+}
+
+static void display_histogram(std::vector<decl_timing> const & timings) {
+    unsigned const num_buckets = 16; /* 1us .. 32ms, last bucket is open */
+    std::vector<unsigned> time_hist(num_buckets + 1, 0);
+    std::vector<unsigned> alloc_hist(num_buckets + 1, 0);
+    for (decl_timing const & t : timings) {
+        unsigned b = 0;
+        while (b < num_buckets && (1ull << b) <= (uint64)t.m_us) b++;
+        time_hist[b]++;
+        b = 0;
+        /* allocation histogram in units of 1K heartbeats */
+        while (b < num_buckets && (1ull << b) <= t.m_heartbeats / 1024) b++;
+        alloc_hist[b]++;
+    }
+    std::cout << "time per declaration:\n";
+    for (unsigned b = 0; b <= num_buckets; b++) {
+        if (time_hist[b] == 0) continue;
+        if (b < num_buckets)
+            std::cout << "  < " << (1ull << b) << " us: ";
+        else
+            std::cout << "  >= " << (1ull << (num_buckets - 1)) << " us: ";
+        std::cout << time_hist[b] << "\n";
+    }
+    std::cout << "heartbeats (~allocations) per declaration:\n";
+    for (unsigned b = 0; b <= num_buckets; b++) {
+        if (alloc_hist[b] == 0) continue;
+        if (b < num_buckets)
+            std::cout << "  < " << (1ull << b) << "K: ";
+        else
+            std::cout << "  >= " << (1ull << (num_buckets - 1)) << "K: ";
+        std::cout << alloc_hist[b] << "\n";
+    }
+}
+
+static void display_slowest(std::vector<decl_timing> & timings) {
+    size_t n = std::min<size_t>(timings.size(), 10);
+    std::partial_sort(timings.begin(), timings.begin() + n, timings.end(),
+                      [](decl_timing const & t1, decl_timing const & t2) { return t1.m_us > t2.m_us; });
+    std::cout << "slowest declarations:\n";
+    for (size_t i = 0; i < n; i++) {
+        std::cout << "  " << timings[i].m_name << ": " << (uint64)timings[i].m_us << " us, "
+                  << timings[i].m_heartbeats << " heartbeats\n";
+    }
+}
+
+static int main(int argc, char ** argv) {
+    bool check_all = false;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--all") == 0)
+            check_all = true;
+        else
+            files.push_back(argv[i]);
+    }
+    if (files.empty()) {
+        std::cerr << "usage: kernel-bench [--all] <mod1.olean> ... <modN.olean>\n"
+                  << "modules must be listed in dependency order; only the declarations of\n"
+                  << "the last module are re-checked unless --all is given\n";
+        return 1;
+    }
+
+    unsigned trust_lvl = 0;
+    environment env(trust_lvl);
+    std::vector<object_ref> regions; /* keep the compacted regions alive */
+    std::vector<constant_info> to_check;
+    for (size_t i = 0; i < files.size(); i++) {
+        object_ref mod_region = get_io_result<object_ref>(lean_read_module_data(mk_string(files[i]), io_mk_world()));
+        object * consts = cnstr_get(cnstr_get(mod_region.raw(), 0), 1); /* ModuleData.constants */
+        size_t n = array_size(consts);
+        for (size_t j = 0; j < n; j++) {
+            constant_info ci(array_cptr(consts)[j], true);
+            /* install without checking; environment::add_core is kernel-private */
+            env = environment(lean_environment_add(env.to_obj_arg(), ci.to_obj_arg()));
+            if (check_all || i + 1 == files.size())
+                to_check.push_back(ci);
+        }
+        regions.push_back(mod_region);
+    }
+    env = environment(lean_environment_mark_quot_init(env.to_obj_arg()));
+
+    std::vector<decl_timing> timings;
+    unsigned num_failures = 0;
+    double total_us = 0.0;
+    for (constant_info const & ci : to_check) {
+        uint64 hb0 = num_heartbeats();
+        auto t0    = std::chrono::steady_clock::now();
+        try {
+            check_decl(env, ci);
+        } catch (exception & ex) {
+            std::cerr << "failed to re-check '" << ci.get_name() << "': " << ex.what() << "\n";
+            num_failures++;
+            continue;
+        }
+        auto t1    = std::chrono::steady_clock::now();
+        double us  = std::chrono::duration<double, std::micro>(t1 - t0).count();
+        total_us  += us;
+        timings.push_back(decl_timing{ci.get_name(), us, num_heartbeats() - hb0});
+    }
+
+    std::cout << "re-checked " << timings.size() << " declaration(s) in "
+              << (uint64)(total_us / 1000) << " ms, " << num_failures << " failure(s)\n";
+    display_histogram(timings);
+    display_slowest(timings);
+    return num_failures == 0 ? 0 : 1;
+}
+}
+
+int main(int argc, char ** argv) {
+    lean::initializer init;
+    lean::io_mark_end_initialization();
+    return lean::main(argc, argv);
+}
@@ -0,0 +1,287 @@
+/*
+Copyright (c) 2023 Microsoft Corporation. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/* olean-delta: binary delta encoder for .olean artifacts.
+
+       olean-delta diff  <old.olean> <new.olean> <out.delta>
+       olean-delta patch <old.olean> <delta>     <out.olean>
+
+   `object_compactor` emits objects in a deterministic order (a depth-first
+   walk from the module roots), so changing one declaration perturbs a
+   localized span of the .olean while the bulk of the bytes is unchanged --
+   merely shifted when sizes differ. `diff` therefore splits both versions
+   into content-defined chunks (a gear rolling hash draws the boundaries from
+   the data itself, so an insertion only re-aligns the chunks around it) and
+   encodes the new file as copy ranges from the old file plus literal inserts.
+   With an unchanged module the delta is a single copy op; with one changed
+   declaration it is proportional to the change, not to the file, so an
+   artifact store only moves the semantic difference. `patch` reconstructs
+   the new file and verifies a whole-file checksum before replacing anything.
+
+   The tool is deliberately byte-level and self-contained (no runtime, no
+   third-party diff library): it does not interpret the object graph, so it
+   works on any .olean variant -- including compressed ones, though deltas are
+   far smaller when taken on the uncompressed form. */
+
+namespace {
+
+/* Content-defined chunking parameters: 8KB average (13 mask bits), bounded to
+   [2KB, 64KB] so pathological data can neither degenerate to per-byte chunks
+   nor defeat dedup with one giant chunk. */
+constexpr size_t CHUNK_MIN  = 2 * 1024;
+constexpr size_t CHUNK_AVG_MASK = (1 << 13) - 1;
+constexpr size_t CHUNK_MAX  = 64 * 1024;
+
+constexpr char DELTA_MAGIC[] = "oleandeltafile!!";
+constexpr size_t MAGIC_SIZE  = sizeof(DELTA_MAGIC) - 1;
+
+enum class op : uint8_t { copy = 0, insert = 1 };
+
+/* Deterministic pseudo-random byte table for the gear hash; both sides must
+   draw identical boundaries, so the table is generated from a fixed seed
+   (splitmix64) instead of being hardware- or run-dependent. */
+uint64_t const * gear_table() {
+    static uint64_t table[256];
+    static bool init = false;
+    if (!init) {
+        uint64_t x = 0x9e3779b97f4a7c15ull;
+        for (unsigned i = 0; i < 256; i++) {
+            x += 0x9e3779b97f4a7c15ull;
+            uint64_t z = x;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            table[i] = z ^ (z >> 31);
+        }
+        init = true;
+    }
+    return table;
+}
+
+uint64_t fnv1a(uint8_t const * data, size_t n, uint64_t h = 0xcbf29ce484222325ull) {
+    for (size_t i = 0; i < n; i++) {
+        h ^= data[i];
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+struct chunk {
+    size_t m_offset;
+    size_t m_size;
+};
+
+/* Split `data` at positions where the gear hash of the preceding bytes has its
+   low bits clear. The hash window is implicit (the shift ages bytes out after
+   64 steps), which keeps the loop to one table load, one shift and one add per
+   byte. */
+std::vector<chunk> chunk_file(std::vector<uint8_t> const & data) {
+    uint64_t const * gear = gear_table();
+    std::vector<chunk> chunks;
+    size_t begin = 0;
+    uint64_t h = 0;
+    for (size_t i = 0; i < data.size(); i++) {
+        h = (h << 1) + gear[data[i]];
+        size_t len = i + 1 - begin;
+        if ((len >= CHUNK_MIN && (h & CHUNK_AVG_MASK) == 0) || len >= CHUNK_MAX) {
+            chunks.push_back({begin, len});
+            begin = i + 1;
+            h = 0;
+        }
+    }
+    if (begin < data.size())
+        chunks.push_back({begin, data.size() - begin});
+    return chunks;
+}
+
+bool read_file(std::string const & fn, std::vector<uint8_t> & data) {
+    std::ifstream in(fn, std::ios_base::binary);
+    if (in.fail())
+        return false;
+    in.seekg(0, in.end);
+    data.resize(in.tellg());
+    in.seekg(0);
+    in.read(reinterpret_cast<char *>(data.data()), data.size());
+    return static_cast<bool>(in);
+}
+
+void write_u64(std::ofstream & out, uint64_t v) {
+    out.write(reinterpret_cast<char const *>(&v), sizeof(v));
+}
+
+bool read_u64(std::ifstream & in, uint64_t & v) {
+    in.read(reinterpret_cast<char *>(&v), sizeof(v));
+    return static_cast<bool>(in);
+}
+
+int diff(std::string const & old_fn, std::string const & new_fn, std::string const & delta_fn) {
+    std::vector<uint8_t> old_data, new_data;
+    if (!read_file(old_fn, old_data)) {
+        std::cerr << "failed to read '" << old_fn << "'\n";
+        return 1;
+    }
+    if (!read_file(new_fn, new_data)) {
+        std::cerr << "failed to read '" << new_fn << "'\n";
+        return 1;
+    }
+    /* Index the old chunks by hash; duplicates (the compactor dedups objects,
+       but e.g. padding repeats) keep the first occurrence, which is as good as
+       any for copying. */
+    std::vector<chunk> old_chunks = chunk_file(old_data);
+    std::unordered_map<uint64_t, chunk> old_index;
+    for (chunk const & c : old_chunks)
+        old_index.emplace(fnv1a(old_data.data() + c.m_offset, c.m_size), c);
+
+    std::ofstream out(delta_fn, std::ios_base::binary);
+    if (out.fail()) {
+        std::cerr << "failed to create '" << delta_fn << "'\n";
+        return 1;
+    }
+    out.write(DELTA_MAGIC, MAGIC_SIZE);
+    write_u64(out, new_data.size());
+    write_u64(out, fnv1a(new_data.data(), new_data.size()));
+
+    size_t copied = 0, inserted = 0, num_ops = 0;
+    /* Pending ops, merged before emission: adjacent copies of adjacent old
+       ranges coalesce (the common case, since unchanged spans cover many
+       chunks), as do adjacent inserts. */
+    bool   have_copy = false;
+    size_t copy_off = 0, copy_len = 0;
+    std::vector<uint8_t> pending_insert;
+    auto flush_insert = [&]() {
+        if (pending_insert.empty())
+            return;
+        out.put(static_cast<char>(op::insert));
+        write_u64(out, pending_insert.size());
+        out.write(reinterpret_cast<char const *>(pending_insert.data()), pending_insert.size());
+        inserted += pending_insert.size();
+        pending_insert.clear();
+        num_ops++;
+    };
+    auto flush_copy = [&]() {
+        if (!have_copy)
+            return;
+        out.put(static_cast<char>(op::copy));
+        write_u64(out, copy_off);
+        write_u64(out, copy_len);
+        copied += copy_len;
+        have_copy = false;
+        num_ops++;
+    };
+    for (chunk const & c : chunk_file(new_data)) {
+        uint64_t h = fnv1a(new_data.data() + c.m_offset, c.m_size);
+        auto it = old_index.find(h);
+        if (it != old_index.end() && it->second.m_size == c.m_size &&
+            memcmp(old_data.data() + it->second.m_offset, new_data.data() + c.m_offset, c.m_size) == 0) {
+            flush_insert();
+            if (have_copy && copy_off + copy_len == it->second.m_offset) {
+                copy_len += c.m_size;
+            } else {
+                flush_copy();
+                have_copy = true;
+                copy_off  = it->second.m_offset;
+                copy_len  = c.m_size;
+            }
+        } else {
+            flush_copy();
+            pending_insert.insert(pending_insert.end(), new_data.data() + c.m_offset,
+                                  new_data.data() + c.m_offset + c.m_size);
+        }
+    }
+    flush_insert();
+    flush_copy();
+    out.close();
+    if (out.fail()) {
+        std::cerr << "failed to write '" << delta_fn << "'\n";
+        return 1;
+    }
+    std::cerr << old_fn << " -> " << new_fn << ": " << new_data.size() << " bytes, "
+              << copied << " copied, " << inserted << " inserted, " << num_ops << " ops\n";
+    return 0;
+}
+
+int patch(std::string const & old_fn, std::string const & delta_fn, std::string const & out_fn) {
+    std::vector<uint8_t> old_data, delta;
+    if (!read_file(old_fn, old_data)) {
+        std::cerr << "failed to read '" << old_fn << "'\n";
+        return 1;
+    }
+    std::ifstream in(delta_fn, std::ios_base::binary);
+    char magic[MAGIC_SIZE];
+    in.read(magic, MAGIC_SIZE);
+    if (!in || memcmp(magic, DELTA_MAGIC, MAGIC_SIZE) != 0) {
+        std::cerr << "'" << delta_fn << "' is not an olean-delta file\n";
+        return 1;
+    }
+    uint64_t new_size, new_hash;
+    if (!read_u64(in, new_size) || !read_u64(in, new_hash)) {
+        std::cerr << "truncated delta '" << delta_fn << "'\n";
+        return 1;
+    }
+    std::vector<uint8_t> new_data;
+    new_data.reserve(new_size);
+    while (in.peek() != std::char_traits<char>::eof()) {
+        uint8_t tag = static_cast<uint8_t>(in.get());
+        if (tag == static_cast<uint8_t>(op::copy)) {
+            uint64_t off, len;
+            if (!read_u64(in, off) || !read_u64(in, len) || off + len > old_data.size()) {
+                std::cerr << "corrupted delta '" << delta_fn << "'\n";
+                return 1;
+            }
+            new_data.insert(new_data.end(), old_data.data() + off, old_data.data() + off + len);
+        } else if (tag == static_cast<uint8_t>(op::insert)) {
+            uint64_t len;
+            if (!read_u64(in, len)) {
+                std::cerr << "corrupted delta '" << delta_fn << "'\n";
+                return 1;
+            }
+            size_t pos = new_data.size();
+            new_data.resize(pos + len);
+            in.read(reinterpret_cast<char *>(new_data.data() + pos), len);
+            if (!in) {
+                std::cerr << "corrupted delta '" << delta_fn << "'\n";
+                return 1;
+            }
+        } else {
+            std::cerr << "corrupted delta '" << delta_fn << "'\n";
+            return 1;
+        }
+    }
+    if (new_data.size() != new_size || fnv1a(new_data.data(), new_data.size()) != new_hash) {
+        std::cerr << "checksum mismatch applying '" << delta_fn << "' to '" << old_fn
+                  << "' (wrong base version?)\n";
+        return 1;
+    }
+    /* Write to a temp file and rename, as `lean_save_module_data` does, so a
+       concurrent reader never sees a partially written .olean. */
+    std::string tmp_fn = out_fn + ".tmp";
+    std::ofstream out(tmp_fn, std::ios_base::binary);
+    out.write(reinterpret_cast<char const *>(new_data.data()), new_data.size());
+    out.close();
+    if (out.fail() || std::rename(tmp_fn.c_str(), out_fn.c_str()) != 0) {
+        std::cerr << "failed to write '" << out_fn << "'\n";
+        return 1;
+    }
+    return 0;
+}
+
+}
+
+int main(int argc, char * argv[]) {
+    if (argc == 5 && strcmp(argv[1], "diff") == 0)
+        return diff(argv[2], argv[3], argv[4]);
+    if (argc == 5 && strcmp(argv[1], "patch") == 0)
+        return patch(argv[2], argv[3], argv[4]);
+    std::cerr << "usage: olean-delta diff  <old.olean> <new.olean> <out.delta>\n"
+              << "       olean-delta patch <old.olean> <delta> <out.olean>\n";
+    return 1;
+}
@@ -0,0 +1,461 @@
+/*
+Copyright (c) 2014 Microsoft Corporation. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+
+Author: Leonardo de Moura
+*/
+#pragma once
+#include <utility>
+#include "runtime/debug.h"
+#include "util/rc.h"
+
+namespace lean {
+/**
+   \brief Persistent B-tree based maps.
+
+   Same contract as `rb_map`: O(1) copy, thread-safe structural sharing between
+   copies, destructive updates performed in place when the affected nodes are
+   unshared and by path copying otherwise. The difference is the node layout:
+   instead of one key per node, each node packs up to `max_entries` sorted
+   entries in a flat array, so a lookup touches O(log_B n) cache lines instead
+   of O(log_2 n) and never chases a pointer to compare two neighboring keys.
+   For the small keys this container is used with (`name`s are compared by a
+   pointer-and-tag walk that usually resolves in the first component) the
+   in-node scan is essentially free compared to the cache miss it replaces.
+
+   The fanout is deliberately modest: path copying duplicates whole nodes, so a
+   larger B would make persistent updates copy more than they share.
+
+   \c CMP is a functional object for comparing keys, with the same
+   -1/0/1 contract as in `rb_tree`. \c K and \c T must be default
+   constructible (as in `rb_map`, whose `find` already requires `T()`).
+*/
+template<typename K, typename T, typename CMP>
+class b_map : private CMP {
+    static constexpr unsigned max_entries = 8;
+    static constexpr unsigned min_entries = 3; /* so two minimal nodes + separator still fit in one */
+
+    struct node_cell;
+    struct node {
+        node_cell * m_ptr;
+        node():m_ptr(nullptr) {}
+        node(node_cell * ptr):m_ptr(ptr) { if (m_ptr) ptr->inc_ref(); }
+        node(node const & s):m_ptr(s.m_ptr) { if (m_ptr) m_ptr->inc_ref(); }
+        node(node && s):m_ptr(s.m_ptr) { s.m_ptr = nullptr; }
+        ~node() { if (m_ptr) m_ptr->dec_ref(); }
+        node & operator=(node const & n) { LEAN_COPY_REF(n); }
+        node & operator=(node && n) { LEAN_MOVE_REF(n); }
+        operator bool() const { return m_ptr != nullptr; }
+        bool is_shared() const { return m_ptr && m_ptr->get_rc() > 1; }
+        node_cell * operator->() const { lean_assert(m_ptr); return m_ptr; }
+        friend bool is_eqp(node const & n1, node const & n2) { return n1.m_ptr == n2.m_ptr; }
+        friend void swap(node & n1, node & n2) { std::swap(n1.m_ptr, n2.m_ptr); }
+        node steal() { node r; swap(r, *this); return r; }
+    };
+
+    struct node_cell {
+        unsigned m_num;  /* number of entries in use */
+        bool     m_leaf;
+        K        m_keys[max_entries];
+        T        m_vals[max_entries];
+        node     m_cs[max_entries + 1]; /* children; unused when m_leaf */
+        MK_LEAN_RC();
+        void dealloc() { delete this; }
+        explicit node_cell(bool leaf):m_num(0), m_leaf(leaf), m_rc(0) {}
+        node_cell(node_cell const & s):m_num(s.m_num), m_leaf(s.m_leaf), m_rc(0) {
+            for (unsigned i = 0; i < m_num; i++) {
+                m_keys[i] = s.m_keys[i];
+                m_vals[i] = s.m_vals[i];
+            }
+            if (!m_leaf) {
+                for (unsigned i = 0; i <= m_num; i++)
+                    m_cs[i] = s.m_cs[i];
+            }
+        }
+    };
+
+    int cmp(K const & k1, K const & k2) const {
+        return CMP::operator()(k1, k2);
+    }
+
+    static node ensure_unshared(node && n) {
+        if (n.is_shared()) {
+            return node(new node_cell(*n.m_ptr));
+        } else {
+            return n;
+        }
+    }
+
+    /* Split the full child `h->m_cs[i]` of the unshared, non-full node `h` around its
+       median entry, which moves up into slot `i` of `h`. */
+    void split_child(node & h, unsigned i) {
+        lean_assert(!h.is_shared());
+        lean_assert(h->m_num < max_entries);
+        node l = ensure_unshared(h->m_cs[i].steal());
+        lean_assert(l->m_num == max_entries);
+        unsigned mid = max_entries / 2;
+        node r(new node_cell(l->m_leaf));
+        for (unsigned j = mid + 1; j < max_entries; j++) {
+            r->m_keys[j - mid - 1] = std::move(l->m_keys[j]); l->m_keys[j] = K();
+            r->m_vals[j - mid - 1] = std::move(l->m_vals[j]); l->m_vals[j] = T();
+        }
+        if (!l->m_leaf) {
+            for (unsigned j = mid + 1; j <= max_entries; j++)
+                r->m_cs[j - mid - 1] = l->m_cs[j].steal();
+        }
+        r->m_num = max_entries - mid - 1;
+        for (unsigned j = h->m_num; j > i; j--) {
+            h->m_keys[j] = std::move(h->m_keys[j-1]);
+            h->m_vals[j] = std::move(h->m_vals[j-1]);
+        }
+        for (unsigned j = h->m_num + 1; j > i + 1; j--)
+            h->m_cs[j] = h->m_cs[j-1].steal();
+        h->m_keys[i] = std::move(l->m_keys[mid]); l->m_keys[mid] = K();
+        h->m_vals[i] = std::move(l->m_vals[mid]); l->m_vals[mid] = T();
+        l->m_num = mid;
+        h->m_cs[i]   = l.steal();
+        h->m_cs[i+1] = r.steal();
+        h->m_num++;
+    }
+
+    /* Insert into the subtree rooted at the non-full node `n`. Full children are split
+       on the way down, so the insertion into a leaf always has a free slot. */
+    node insert(node && n, K const & k, T const & v) {
+        lean_assert(n->m_num < max_entries);
+        node h = ensure_unshared(n.steal());
+        unsigned i = 0;
+        while (i < h->m_num) {
+            int c = cmp(k, h->m_keys[i]);
+            if (c == 0) {
+                h->m_vals[i] = v;
+                return h;
+            }
+            if (c < 0)
+                break;
+            i++;
+        }
+        if (h->m_leaf) {
+            for (unsigned j = h->m_num; j > i; j--) {
+                h->m_keys[j] = std::move(h->m_keys[j-1]);
+                h->m_vals[j] = std::move(h->m_vals[j-1]);
+            }
+            h->m_keys[i] = k;
+            h->m_vals[i] = v;
+            h->m_num++;
+            return h;
+        }
+        if (h->m_cs[i]->m_num == max_entries) {
+            split_child(h, i);
+            int c = cmp(k, h->m_keys[i]);
+            if (c == 0) {
+                h->m_vals[i] = v;
+                return h;
+            }
+            if (c > 0)
+                i++;
+        }
+        h->m_cs[i] = insert(h->m_cs[i].steal(), k, v);
+        return h;
+    }
+
+    static void find_max_entry(node_cell const * n, K & k, T & v) {
+        while (!n->m_leaf)
+            n = n->m_cs[n->m_num].m_ptr;
+        k = n->m_keys[n->m_num - 1];
+        v = n->m_vals[n->m_num - 1];
+    }
+
+    static void find_min_entry(node_cell const * n, K & k, T & v) {
+        while (!n->m_leaf)
+            n = n->m_cs[0].m_ptr;
+        k = n->m_keys[0];
+        v = n->m_vals[0];
+    }
+
+    static void remove_at(node & h, unsigned i) {
+        lean_assert(h->m_leaf);
+        for (unsigned j = i; j + 1 < h->m_num; j++) {
+            h->m_keys[j] = std::move(h->m_keys[j+1]);
+            h->m_vals[j] = std::move(h->m_vals[j+1]);
+        }
+        h->m_keys[h->m_num-1] = K();
+        h->m_vals[h->m_num-1] = T();
+        h->m_num--;
+    }
+
+    /* Merge `h->m_cs[i+1]` and the separator entry `i` into `h->m_cs[i]`. */
+    void merge_children(node & h, unsigned i) {
+        lean_assert(!h.is_shared());
+        node l = ensure_unshared(h->m_cs[i].steal());
+        node r = h->m_cs[i+1].steal();
+        lean_assert(l->m_num + r->m_num + 1 <= max_entries);
+        l->m_keys[l->m_num] = std::move(h->m_keys[i]);
+        l->m_vals[l->m_num] = std::move(h->m_vals[i]);
+        /* `r` may be shared with an older version of the map, so copy out of it
+           instead of stealing. */
+        for (unsigned j = 0; j < r->m_num; j++) {
+            l->m_keys[l->m_num + 1 + j] = r->m_keys[j];
+            l->m_vals[l->m_num + 1 + j] = r->m_vals[j];
+        }
+        if (!l->m_leaf) {
+            for (unsigned j = 0; j <= r->m_num; j++)
+                l->m_cs[l->m_num + 1 + j] = r->m_cs[j];
+        }
+        l->m_num += r->m_num + 1;
+        for (unsigned j = i; j + 1 < h->m_num; j++) {
+            h->m_keys[j] = std::move(h->m_keys[j+1]);
+            h->m_vals[j] = std::move(h->m_vals[j+1]);
+        }
+        for (unsigned j = i + 1; j + 1 <= h->m_num; j++)
+            h->m_cs[j] = h->m_cs[j+1].steal();
+        h->m_keys[h->m_num-1] = K();
+        h->m_vals[h->m_num-1] = T();
+        h->m_num--;
+        h->m_cs[i] = l.steal();
+    }
+
+    void borrow_from_prev(node & h, unsigned i) {
+        node c = ensure_unshared(h->m_cs[i].steal());
+        node l = ensure_unshared(h->m_cs[i-1].steal());
+        for (unsigned j = c->m_num; j > 0; j--) {
+            c->m_keys[j] = std::move(c->m_keys[j-1]);
+            c->m_vals[j] = std::move(c->m_vals[j-1]);
+        }
+        if (!c->m_leaf) {
+            for (unsigned j = c->m_num + 1; j > 0; j--)
+                c->m_cs[j] = c->m_cs[j-1].steal();
+        }
+        c->m_keys[0] = std::move(h->m_keys[i-1]);
+        c->m_vals[0] = std::move(h->m_vals[i-1]);
+        if (!c->m_leaf)
+            c->m_cs[0] = l->m_cs[l->m_num].steal();
+        h->m_keys[i-1] = std::move(l->m_keys[l->m_num-1]); l->m_keys[l->m_num-1] = K();
+        h->m_vals[i-1] = std::move(l->m_vals[l->m_num-1]); l->m_vals[l->m_num-1] = T();
+        l->m_num--;
+        c->m_num++;
+        h->m_cs[i-1] = l.steal();
+        h->m_cs[i]   = c.steal();
+    }
+
+    void borrow_from_next(node & h, unsigned i) {
+        node c = ensure_unshared(h->m_cs[i].steal());
+        node r = ensure_unshared(h->m_cs[i+1].steal());
+        c->m_keys[c->m_num] = std::move(h->m_keys[i]);
+        c->m_vals[c->m_num] = std::move(h->m_vals[i]);
+        if (!c->m_leaf)
+            c->m_cs[c->m_num+1] = r->m_cs[0].steal();
+        h->m_keys[i] = std::move(r->m_keys[0]);
+        h->m_vals[i] = std::move(r->m_vals[0]);
+        for (unsigned j = 0; j + 1 < r->m_num; j++) {
+            r->m_keys[j] = std::move(r->m_keys[j+1]);
+            r->m_vals[j] = std::move(r->m_vals[j+1]);
+        }
+        if (!r->m_leaf) {
+            for (unsigned j = 0; j + 1 <= r->m_num; j++)
+                r->m_cs[j] = r->m_cs[j+1].steal();
+        }
+        r->m_keys[r->m_num-1] = K();
+        r->m_vals[r->m_num-1] = T();
+        r->m_num--;
+        c->m_num++;
+        h->m_cs[i]   = c.steal();
+        h->m_cs[i+1] = r.steal();
+    }
+
+    /* Make sure `h->m_cs[i]` has more than `min_entries` entries before we descend into
+       it. Returns the child index to descend into, which decreases by one when the child
+       is merged into its left sibling. */
+    unsigned fill(node & h, unsigned i) {
+        if (i > 0 && h->m_cs[i-1]->m_num > min_entries) {
+            borrow_from_prev(h, i);
+        } else if (i < h->m_num && h->m_cs[i+1]->m_num > min_entries) {
+            borrow_from_next(h, i);
+        } else if (i < h->m_num) {
+            merge_children(h, i);
+        } else {
+            merge_children(h, i-1);
+            i--;
+        }
+        return i;
+    }
+
+    /* Remove `k` from the subtree rooted at `n`. Precondition (except for the root): `n`
+       has more than `min_entries` entries, so removing one cannot underflow it; every
+       descent re-establishes the precondition for the chosen child. */
+    node erase(node && n, K const & k) {
+        node h = ensure_unshared(n.steal());
+        unsigned i = 0;
+        while (i < h->m_num && cmp(h->m_keys[i], k) < 0)
+            i++;
+        if (i < h->m_num && cmp(h->m_keys[i], k) == 0) {
+            if (h->m_leaf) {
+                remove_at(h, i);
+            } else if (h->m_cs[i]->m_num > min_entries) {
+                /* replace the entry with its predecessor, then remove the predecessor */
+                K pk; T pv;
+                find_max_entry(h->m_cs[i].m_ptr, pk, pv);
+                h->m_keys[i] = pk;
+                h->m_vals[i] = std::move(pv);
+                h->m_cs[i] = erase(h->m_cs[i].steal(), pk);
+            } else if (h->m_cs[i+1]->m_num > min_entries) {
+                K sk; T sv;
+                find_min_entry(h->m_cs[i+1].m_ptr, sk, sv);
+                h->m_keys[i] = sk;
+                h->m_vals[i] = std::move(sv);
+                h->m_cs[i+1] = erase(h->m_cs[i+1].steal(), sk);
+            } else {
+                merge_children(h, i);
+                h->m_cs[i] = erase(h->m_cs[i].steal(), k);
+            }
+        } else if (!h->m_leaf) {
+            if (h->m_cs[i]->m_num <= min_entries)
+                i = fill(h, i);
+            h->m_cs[i] = erase(h->m_cs[i].steal(), k);
+        }
+        return h;
+    }
+
+    template<typename F>
+    static void for_each(F && f, node_cell const * n) {
+        for (unsigned i = 0; i < n->m_num; i++) {
+            if (!n->m_leaf)
+                for_each(f, n->m_cs[i].m_ptr);
+            f(n->m_keys[i], n->m_vals[i]);
+        }
+        if (!n->m_leaf)
+            for_each(f, n->m_cs[n->m_num].m_ptr);
+    }
+
+    unsigned check_invariant(node_cell const * n, bool DEBUG_CODE(is_root)) const {
+        lean_assert(n->m_num >= 1);
+        lean_assert(n->m_num <= max_entries);
+        lean_assert(is_root || n->m_num >= min_entries);
+        for (unsigned i = 0; i + 1 < n->m_num; i++)
+            lean_assert(cmp(n->m_keys[i], n->m_keys[i+1]) < 0);
+        if (n->m_leaf)
+            return 1;
+        unsigned depth = check_invariant(n->m_cs[0].m_ptr, false);
+        for (unsigned i = 0; i < n->m_num; i++) {
+            /* every key in m_cs[i] < m_keys[i] < every key in m_cs[i+1] */
+            lean_assert(cmp(n->m_cs[i]->m_keys[n->m_cs[i]->m_num - 1], n->m_keys[i]) < 0);
+            lean_assert(cmp(n->m_keys[i], n->m_cs[i+1]->m_keys[0]) < 0);
+            unsigned d = check_invariant(n->m_cs[i+1].m_ptr, false);
+            lean_assert(d == depth); (void) d;
+        }
+        return depth + 1;
+    }
+
+    node m_root;
+
+public:
+    b_map(CMP const & cmp = CMP()):CMP(cmp) {}
+    b_map(b_map const & s):CMP(s), m_root(s.m_root) {}
+    b_map(b_map && s):CMP(s), m_root(s.m_root) {}
+
+    b_map & operator=(b_map const & s) { m_root = s.m_root; return *this; }
+    b_map & operator=(b_map && s) { m_root = s.m_root; return *this; }
+
+    friend void swap(b_map & m1, b_map & m2) { swap(m1.m_root, m2.m_root); }
+    friend bool is_eqp(b_map const & m1, b_map const & m2) { return is_eqp(m1.m_root, m2.m_root); }
+
+    CMP const & get_cmp() const { return *this; }
+
+    unsigned get_rc() const { return m_root ? m_root->get_rc() : 0; }
+
+    bool empty() const { return m_root.m_ptr == nullptr; }
+
+    void clear() { m_root = node(); }
+
+    T const * find(K const & k) const {
+        node_cell const * it = m_root.m_ptr;
+        while (it) {
+            unsigned i = 0;
+            while (i < it->m_num) {
+                int c = cmp(k, it->m_keys[i]);
+                if (c == 0)
+                    return &it->m_vals[i];
+                if (c < 0)
+                    break;
+                i++;
+            }
+            if (it->m_leaf)
+                return nullptr;
+            it = it->m_cs[i].m_ptr;
+        }
+        return nullptr;
+    }
+
+    bool contains(K const & k) const { return find(k) != nullptr; }
+
+    void insert(K const & k, T const & v) {
+        if (!m_root) {
+            node r(new node_cell(true));
+            r->m_keys[0] = k;
+            r->m_vals[0] = v;
+            r->m_num = 1;
+            m_root = r.steal();
+            return;
+        }
+        if (m_root->m_num == max_entries) {
+            /* the tree grows at the root: the old root becomes the only child of a new
+               one and is split immediately */
+            node r(new node_cell(false));
+            r->m_cs[0] = m_root.steal();
+            split_child(r, 0);
+            m_root = r.steal();
+        }
+        m_root = insert(m_root.steal(), k, v);
+        lean_cond_assert("b_map", check_invariant());
+    }
+
+    void erase(K const & k) {
+        if (!contains(k))
+            return;
+        m_root = erase(m_root.steal(), k);
+        if (m_root->m_num == 0) {
+            /* the tree shrinks at the root */
+            if (m_root->m_leaf)
+                m_root = node();
+            else
+                m_root = node(m_root->m_cs[0]);
+        }
+        lean_cond_assert("b_map", check_invariant());
+    }
+
+    template<typename F>
+    void for_each(F && f) const {
+        node r = m_root;
+        if (r)
+            for_each(f, r.m_ptr);
+    }
+
+    unsigned size() const {
+        unsigned r = 0;
+        for_each([&](K const &, T const &) { r = r + 1; });
+        return r;
+    }
+
+    bool check_invariant() const {
+        if (m_root)
+            check_invariant(m_root.m_ptr, true);
+        return true;
+    }
+};
+
+template<typename K, typename T, typename CMP>
+b_map<K, T, CMP> insert(b_map<K, T, CMP> const & m, K const & k, T const & v) {
+    auto r = m;
+    r.insert(k, v);
+    return r;
+}
+template<typename K, typename T, typename CMP>
+b_map<K, T, CMP> erase(b_map<K, T, CMP> const & m, K const & k) {
+    auto r = m;
+    r.erase(k);
+    return r;
+}
+template<typename K, typename T, typename CMP, typename F>
+void for_each(b_map<K, T, CMP> const & m, F && f) {
+    return m.for_each(f);
+}
+}
@@ -9,6 +9,7 @@ Author: Leonardo de Moura
 #include "util/name.h"
 #include "util/name_generator.h"
 #include "util/options.h"
+#include "util/option_declarations.h"
 #include "util/format.h"
 
 namespace lean {
@@ -18,10 +19,12 @@ void initialize_util_module() {
     initialize_name();
     initialize_name_generator();
     initialize_options();
+    initialize_option_declarations();
     initialize_format();
 }
 void finalize_util_module() {
     finalize_format();
+    finalize_option_declarations();
     finalize_options();
     finalize_name_generator();
     finalize_name();
@@ -37,6 +37,18 @@ bool operator<(data_value const & a, data_value const & b) {
     return false;
 }
 
+bool kvmap_eq(kvmap const & a, kvmap const & b) {
+    if (a.raw() == b.raw())
+        return true;
+    auto i1 = a.begin(); auto e1 = a.end();
+    auto i2 = b.begin(); auto e2 = b.end();
+    for (; i1 != e1 && i2 != e2; ++i1, ++i2) {
+        if ((*i1).fst() != (*i2).fst() || (*i1).snd() != (*i2).snd())
+            return false;
+    }
+    return i1 == e1 && i2 == e2;
+}
+
 optional<data_value> find(kvmap m, name const & k) {
     while (!is_nil(m)) {
         if (head(m).fst() == k)
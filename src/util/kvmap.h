@@ -53,6 +53,9 @@ typedef list_ref<kvmap_entry> kvmap;
 
 optional<data_value> find(kvmap m, name const & k);
 
+/* Structural equality: the same bindings in the same order. */
+bool kvmap_eq(kvmap const & a, kvmap const & b);
+
 optional<string_ref> get_string(kvmap const & m, name const & k);
 optional<nat> get_nat(kvmap const & m, name const & k);
 optional<bool> get_bool(kvmap const & m, name const & k);
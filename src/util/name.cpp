@@ -24,7 +24,8 @@ extern "C" obj_res lean_name_mk_string(obj_arg p, obj_arg s);
 extern "C" obj_res lean_name_mk_numeral(obj_arg p, obj_arg n);
 
 static inline obj_res name_mk_string_of_cstr(obj_arg p, char const * s) {
-    return lean_name_mk_string(p, mk_string(s));
+    /* name components are symbol-like and highly repetitive */
+    return lean_name_mk_string(p, mk_atom_string(s));
 }
 
 constexpr char const * anonymous_str = "[anonymous]";
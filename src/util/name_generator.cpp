@@ -13,7 +13,8 @@ namespace lean {
 static name_set * g_ngen_prefixes = nullptr;
 static name * g_tmp_prefix = nullptr;
 
-name_generator::name_generator(name const & prefix):m_prefix(prefix), m_next_idx(0) {
+name_generator::name_generator(name const & prefix):
+    m_prefix(prefix), m_next_idx(0), m_end_idx(std::numeric_limits<unsigned>::max()) {
     lean_assert(!prefix.is_anonymous());
     lean_assert(uses_name_generator_prefix(prefix));
 }
@@ -21,10 +22,13 @@ name_generator::name_generator(name const & prefix):m_prefix(prefix), m_next_idx
 name_generator::name_generator():name_generator(*g_tmp_prefix) {}
 
 name name_generator::next() {
-    if (m_next_idx == std::numeric_limits<unsigned>::max()) {
-        // avoid overflow
-        m_prefix   = name(m_prefix, m_next_idx);
+    if (m_next_idx == m_end_idx) {
+        /* Block exhausted (or, for an unbounded generator, m_next_idx overflowed): the
+           deepening point m_end_idx was never minted as a flat name, so the subtree rooted
+           at name(m_prefix, m_end_idx) is exclusively ours. */
+        m_prefix   = name(m_prefix, m_end_idx);
         m_next_idx = 0;
+        m_end_idx  = std::numeric_limits<unsigned>::max();
     }
     name r(m_prefix, m_next_idx);
     m_next_idx++;
@@ -48,9 +52,23 @@ name name_generator::next_with(name const & base_prefix) {
     return replace_base_prefix(next(), base_prefix);
 }
 
+name_generator name_generator::mk_child(unsigned block_size) {
+    lean_assert(block_size >= 2);
+    if (m_end_idx - m_next_idx < block_size) {
+        // not enough room left in our own block; deepen as in `next` and start over
+        m_prefix   = name(m_prefix, m_end_idx);
+        m_next_idx = 0;
+        m_end_idx  = std::numeric_limits<unsigned>::max();
+    }
+    name_generator r(m_prefix, m_next_idx, m_next_idx + block_size - 1);
+    m_next_idx += block_size;
+    return r;
+}
+
 void swap(name_generator & a, name_generator & b) {
     swap(a.m_prefix, b.m_prefix);
     std::swap(a.m_next_idx, b.m_next_idx);
+    std::swap(a.m_end_idx, b.m_end_idx);
 }
 
 void register_name_generator_prefix(name const & n) {
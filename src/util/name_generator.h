@@ -17,6 +17,14 @@ namespace lean {
 class name_generator {
     name     m_prefix;
     unsigned m_next_idx;
+    /* Index reserved as the "deepening point" of this generator's suffix block: it is never
+       minted as a flat name; when m_next_idx reaches it, the prefix becomes
+       name(m_prefix, m_end_idx) and the block starts over. An unbounded generator uses
+       std::numeric_limits<unsigned>::max(), recovering the classic overflow behavior. */
+    unsigned m_end_idx;
+
+    name_generator(name const & prefix, unsigned next_idx, unsigned end_idx):
+        m_prefix(prefix), m_next_idx(next_idx), m_end_idx(end_idx) {}
 
     friend name_generator to_name_generator(obj_arg o);
     friend object_ref to_obj(name_generator const &);
@@ -49,6 +57,16 @@ public:
         names different from this name_generator and any other name_generator created with this generator. */
     name_generator mk_child() { return name_generator(next()); }
 
+    /**
+        \brief Similar to \c mk_child, but instead of extending the prefix, the child reserves
+        the next \c block_size integer suffixes of this generator's block for itself. All names
+        the child mints (until its block is exhausted and it falls back to deepening) therefore
+        consist of this generator's prefix pointer plus a single inline numeral, avoiding one
+        extra RC'd tree node per fresh name compared to the prefix-extending \c mk_child.
+
+        \pre block_size >= 2 (at least one mintable index plus the deepening point) */
+    name_generator mk_child(unsigned block_size);
+
     /**
        \brief Similar to \c mk_child, but the base prefix is replaced with the given one.
 
@@ -6,10 +6,14 @@ Author: Leonardo de Moura
 */
 #include "runtime/array_ref.h"
 #include "runtime/pair_ref.h"
+#include "runtime/mutex.h"
 #include "util/option_declarations.h"
 #include "util/io.h"
 
 namespace lean {
+static mutex *              g_option_indices_mutex = nullptr;
+static name_map<unsigned> * g_option_indices       = nullptr;
+static unsigned             g_next_option_idx      = 0;
 typedef object_ref option_decl;
 
 extern "C" object * lean_data_value_to_string (obj_arg d);
@@ -48,8 +52,38 @@ data_value mk_data_value(data_value_kind k, char const * val) {
 
 extern "C" object * lean_register_option(obj_arg name, obj_arg decl, obj_arg w);
 
-void register_option(name const & n, data_value_kind k, char const * default_value, char const * description) {
+unsigned register_option(name const & n, data_value_kind k, char const * default_value, char const * description) {
     object_ref decl = mk_cnstr(0, mk_data_value(k, default_value), string_ref(""), string_ref(description));
     consume_io_result(lean_register_option(n.to_obj_arg(), decl.to_obj_arg(), io_mk_world()));
+    lock_guard<mutex> lock(*g_option_indices_mutex);
+    if (unsigned const * idx = g_option_indices->find(n))
+        return *idx;
+    unsigned idx = g_next_option_idx++;
+    /* the map is read from arbitrary threads, so its keys must be persistent */
+    mark_persistent(n.raw());
+    g_option_indices->insert(n, idx);
+    return idx;
+}
+
+optional<unsigned> get_option_index(name const & n) {
+    lock_guard<mutex> lock(*g_option_indices_mutex);
+    if (unsigned const * idx = g_option_indices->find(n))
+        return optional<unsigned>(*idx);
+    return optional<unsigned>();
+}
+
+unsigned get_num_option_indices() {
+    lock_guard<mutex> lock(*g_option_indices_mutex);
+    return g_next_option_idx;
+}
+
+void initialize_option_declarations() {
+    g_option_indices_mutex = new mutex();
+    g_option_indices       = new name_map<unsigned>();
+}
+
+void finalize_option_declarations() {
+    delete g_option_indices;       g_option_indices = nullptr;
+    delete g_option_indices_mutex; g_option_indices_mutex = nullptr;
 }
 }
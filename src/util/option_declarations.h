@@ -36,8 +36,19 @@ public:
 
 typedef name_map<option_declaration> option_declarations;
 option_declarations get_option_declarations();
-void register_option(name const & n, data_value_kind k, char const * default_value, char const * description);
+/** \brief Register the option \c n, and return its handle: a dense index that
+    is stable for the lifetime of the process, usable with \c option_values for
+    array-indexed reads in hot paths. Registering the same name again returns
+    the same handle. */
+unsigned register_option(name const & n, data_value_kind k, char const * default_value, char const * description);
+/** \brief Return the handle assigned to option \c n by \c register_option, if any. */
+optional<unsigned> get_option_index(name const & n);
+/** \brief Number of handles assigned so far; all handles are smaller than this bound. */
+unsigned get_num_option_indices();
 #define register_bool_option(n, v, d) register_option(n, data_value_kind::Bool, LEAN_STR(v), d)
 #define register_unsigned_option(n, v, d) register_option(n, data_value_kind::Nat, LEAN_STR(v), d)
 #define register_string_option(n, v, d) register_option(n, data_value_kind::String, LEAN_STR(v), d)
+
+void initialize_option_declarations();
+void finalize_option_declarations();
 }
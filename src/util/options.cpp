@@ -6,7 +6,10 @@ Author: Leonardo de Moura
 */
 #include <memory>
 #include <string>
+#include <vector>
 #include "runtime/sstream.h"
+#include "runtime/object.h"
+#include "runtime/mutex.h"
 #include "util/options.h"
 #include "util/option_declarations.h"
 
@@ -19,7 +22,33 @@ static name * g_verbose    = nullptr;
 static name * g_max_memory = nullptr;
 static name * g_timeout    = nullptr;
 
+/* Pool for `options::intern`. Only a handful of distinct option sets is live
+   at any time (per-request/per-file configurations differ rarely and are
+   small), so a linear scan with structural equality beats maintaining a hash
+   table; the pool is simply reset if it ever fills up. */
+#define LEAN_OPTIONS_INTERN_POOL_CAPACITY 32
+static mutex *                 g_options_intern_mutex = nullptr;
+static std::vector<options> *  g_options_intern_pool  = nullptr;
+
+options options::intern() const {
+    if (empty())
+        return *this;
+    lock_guard<mutex> lock(*g_options_intern_mutex);
+    for (options const & o : *g_options_intern_pool) {
+        if (*this == o)
+            return o;
+    }
+    if (g_options_intern_pool->size() == LEAN_OPTIONS_INTERN_POOL_CAPACITY)
+        g_options_intern_pool->clear();
+    /* the canonical value is handed out to, and retained by, arbitrary threads */
+    mark_mt(m_value.raw());
+    g_options_intern_pool->push_back(*this);
+    return *this;
+}
+
 void initialize_options() {
+    g_options_intern_mutex = new mutex();
+    g_options_intern_pool  = new std::vector<options>();
     g_verbose    = new name("verbose");
     mark_persistent(g_verbose->raw());
     g_max_memory = new name("max_memory");
@@ -32,6 +61,8 @@ void finalize_options() {
     delete g_verbose;
     delete g_max_memory;
     delete g_timeout;
+    delete g_options_intern_pool;  g_options_intern_pool = nullptr;
+    delete g_options_intern_mutex; g_options_intern_mutex = nullptr;
 }
 
 name const & get_verbose_opt_name() {
@@ -65,4 +96,29 @@ void options::for_each(std::function<void(name const &)> const & fn) const {
         fn(e.fst());
     }
 }
+
+void options::display(std::ostream & out) const {
+    for (kvmap_entry const & e : m_value) {
+        out << e.fst() << "=";
+        data_value const & v = e.snd();
+        switch (v.kind()) {
+        case data_value_kind::String: out << v.get_string().data(); break;
+        case data_value_kind::Bool:   out << (v.get_bool() ? "true" : "false"); break;
+        case data_value_kind::Name:   out << v.get_name(); break;
+        case data_value_kind::Nat:    out << v.get_nat(); break;
+        }
+        out << "\n";
+    }
+}
+
+option_values::option_values(options const & opts) {
+    m_values.resize(get_num_option_indices());
+    for (kvmap_entry const & e : opts.m_value) {
+        if (optional<unsigned> idx = get_option_index(e.fst())) {
+            /* the first binding wins, matching `find` on the kvmap */
+            if (*idx < m_values.size() && !m_values[*idx])
+                m_values[*idx] = e.snd();
+        }
+    }
+}
 }
@@ -6,10 +6,12 @@ Author: Leonardo de Moura
 */
 #pragma once
 #include <algorithm>
+#include <vector>
 #include "util/name.h"
 #include "util/kvmap.h"
 
 namespace lean {
+class option_values;
 /** \brief Configuration options. */
 class options {
     kvmap m_value;
@@ -53,6 +55,9 @@ public:
 
     void for_each(std::function<void(name const &)> const & fn) const;
 
+    /** \brief Print the bindings as `name=value` lines, in binding order. */
+    void display(std::ostream & out) const;
+
     options update_if_undef(name const & n, bool v) const {
         if (contains(n))
             return *this;
@@ -62,6 +67,16 @@ public:
 
     friend bool is_eqp(options const & a, options const & b) { return a.m_value.raw() == b.m_value.raw(); }
 
+    friend bool operator==(options const & a, options const & b) { return is_eqp(a, b) || kvmap_eq(a.m_value, b.m_value); }
+    friend bool operator!=(options const & a, options const & b) { return !(a == b); }
+
+    /** \brief Return the canonical representative of this option set from a
+        small global pool, so structurally equal sets become pointer-equal
+        (`is_eqp`). Caches keyed on options by `is_eqp` miss whenever an
+        equal-but-reallocated value appears (e.g. one built per server
+        request); interning at the cache boundary restores those hits. */
+    options intern() const;
+
     /**
        \brief Combine the options opts1 and opts2. The assignment in
        opts2 overrides the ones in opts1.
@@ -69,6 +84,38 @@ public:
     friend options join(options const & opts1, options const & opts2);
 
     object * to_obj_arg() const { return m_value.to_obj_arg(); }
+
+    friend class option_values;
+};
+
+/** \brief Dense view of an \c options object, indexed by the handles returned
+    by \c register_option. Construction walks the underlying kvmap once; after
+    that, reads in hot paths are array indexing instead of association-list
+    search. */
+class option_values {
+    std::vector<optional<data_value>> m_values;
+public:
+    option_values() {}
+    explicit option_values(options const & opts);
+
+    bool get_bool(unsigned idx, bool default_value = false) const {
+        if (idx < m_values.size() && m_values[idx] && m_values[idx]->kind() == data_value_kind::Bool)
+            return m_values[idx]->get_bool();
+        return default_value;
+    }
+
+    unsigned get_unsigned(unsigned idx, unsigned default_value = 0) const {
+        if (idx < m_values.size() && m_values[idx] && m_values[idx]->kind() == data_value_kind::Nat)
+            if (m_values[idx]->get_nat().is_small())
+                return m_values[idx]->get_nat().get_small_value();
+        return default_value;
+    }
+
+    char const * get_string(unsigned idx, char const * default_value = nullptr) const {
+        if (idx < m_values.size() && m_values[idx] && m_values[idx]->kind() == data_value_kind::String)
+            return m_values[idx]->get_string().data(); // unsafe
+        return default_value;
+    }
 };
 
 bool get_verbose(options const & opts);
@@ -125,6 +125,29 @@ public:
     public:
         iterator(rb_map const & map):rb_tree<entry, entry_cmp>::iterator(map.m_map) {}
     };
+
+    /** \brief Key-aware wrapper around `rb_tree::snapshot`; see `freeze`. */
+    class snapshot {
+        typename rb_tree<entry, entry_cmp>::snapshot m_entries;
+    public:
+        snapshot() {}
+        explicit snapshot(rb_map const & m):m_entries(m.m_map.freeze()) {}
+        T const * find(K const & k) const {
+            entry const * e = m_entries.find(mk_pair(k, T()));
+            return e ? &e->second : nullptr;
+        }
+        bool contains(K const & k) const { return find(k) != nullptr; }
+        template<typename F>
+        void for_each(F && f) const {
+            m_entries.for_each([&](entry const & e) { f(e.first, e.second); });
+        }
+        unsigned size() const { return m_entries.size(); }
+        bool empty() const { return m_entries.empty(); }
+    };
+
+    /** \brief Copy the entries once into a contiguous sorted array for
+        read-heavy phases; see `rb_tree::snapshot` for the tradeoffs. */
+    snapshot freeze() const { return snapshot(*this); }
 };
 template<typename K, typename T, typename CMP>
 rb_map<K, T, CMP> insert(rb_map<K, T, CMP> const & m, K const & k, T const & v) {
@@ -12,6 +12,7 @@ Author: Leonardo de Moura
 #endif
 #include <utility>
 #include <algorithm>
+#include <vector>
 #include "runtime/optional.h"
 #include "runtime/debug.h"
 #include "runtime/buffer.h"
@@ -568,6 +569,52 @@ public:
         }
     };
 
+    /** \brief Read-optimized snapshot: the elements copied once, in order, into
+        a contiguous sorted array. Every traversal of the tree itself chases a
+        pointer per node; a phase that iterates or probes the same tree many
+        times after it has stopped changing is better served by `freeze()`ing
+        it once and scanning the flat array (`find` becomes a binary search
+        over adjacent cache lines). The snapshot shares no structure with the
+        tree: updates made to either afterwards are invisible to the other. */
+    class snapshot : private CMP {
+        std::vector<T> m_values;
+    public:
+        snapshot() {}
+        explicit snapshot(rb_tree const & t):CMP(t.get_cmp()) {
+            t.for_each([&](T const & v) { m_values.push_back(v); });
+        }
+
+        T const * find(T const & v) const {
+            unsigned lo = 0, hi = static_cast<unsigned>(m_values.size());
+            while (lo < hi) {
+                unsigned mid = lo + (hi - lo) / 2;
+                int c = CMP::operator()(m_values[mid], v);
+                if (c == 0)
+                    return &m_values[mid];
+                else if (c < 0)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            return nullptr;
+        }
+
+        bool contains(T const & v) const { return find(v) != nullptr; }
+
+        template<typename F>
+        void for_each(F && f) const {
+            for (T const & v : m_values)
+                f(v);
+        }
+
+        typename std::vector<T>::const_iterator begin() const { return m_values.begin(); }
+        typename std::vector<T>::const_iterator end() const { return m_values.end(); }
+        unsigned size() const { return static_cast<unsigned>(m_values.size()); }
+        bool empty() const { return m_values.empty(); }
+    };
+
+    snapshot freeze() const { return snapshot(*this); }
+
     /* Return true iff this and other have the same set of elements with respect to CMP.
        This method assumes the cmp for this and other are the same. */
     bool equal_elems(rb_tree const & other) const {
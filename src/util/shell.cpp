@@ -8,7 +8,9 @@ Author: Leonardo de Moura
 #include <fstream>
 #include <signal.h>
 #include <cctype>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <string>
 #include <utility>
 #include <vector>
@@ -21,6 +23,7 @@ Author: Leonardo de Moura
 #include "runtime/sstream.h"
 #include "runtime/load_dynlib.h"
 #include "runtime/array_ref.h"
+#include "runtime/hash.h"
 #include "util/timer.h"
 #include "util/macros.h"
 #include "util/io.h"
@@ -45,6 +48,9 @@ Author: Leonardo de Moura
 #include <getopt.h>
 #include <unistd.h>
 #endif
+#if defined(__linux__)
+#include <sys/wait.h>
+#endif
 #if defined(LEAN_EMSCRIPTEN)
 #include <emscripten.h>
 #endif
@@ -206,6 +212,12 @@ static void display_help(std::ostream & out) {
     std::cout << "  --plugin=file      load and initialize Lean shared library for registering linters etc.\n";
     std::cout << "  --load-dynlib=file load shared library to make its symbols available to the interpreter\n";
     std::cout << "  --deps             just print dependencies of a Lean input\n";
+    std::cout << "  --cache=dir        reuse .olean/.c artifacts from a content-addressed cache in the given\n"
+              << "                     directory; the key depends only on the source text, the transitive\n"
+              << "                     import contents, and the compiler build, never on timestamps\n";
+    std::cout << "  --zygote=mods      (Linux) pre-fork worker mode: import the comma-separated modules once,\n"
+              << "                     then fork a worker per build command read from stdin, one\n"
+              << "                     '<input.lean>TAB<out.olean>[TAB<out.c>]' per line\n";
     std::cout << "  --print-prefix     print the installation prefix for Lean and exit\n";
     std::cout << "  --print-libdir     print the installation directory for Lean's built-in libraries and exit\n";
     std::cout << "  --profile          display elaboration/type checking time for each definition/theorem\n";
@@ -235,6 +247,8 @@ static struct option g_long_options[] = {
     {"quiet",        no_argument,       0, 'q'},
     {"deps",         no_argument,       0, 'd'},
     {"deps-json",    no_argument,       0, 'J'},
+    {"cache",        required_argument, 0, 'C'},
+    {"zygote",       required_argument, 0, 'Z'},
     {"timeout",      optional_argument, 0, 'T'},
     {"c",            optional_argument, 0, 'c'},
     {"exitOnPanic",  no_argument,       0, 'e'},
@@ -255,7 +269,7 @@ static struct option g_long_options[] = {
 };
 
 static char const * g_opt_str =
-    "PdD:o:i:c:C:qgvht:012j:012rR:M:012T:012ap:e"
+    "PdD:o:i:c:C:Z:qgvht:012j:012rR:M:012T:012ap:e"
 #if defined(LEAN_MULTI_THREAD)
     "s:012"
 #endif
@@ -332,6 +346,7 @@ extern "C" object * lean_run_frontend(
     object * main_module_name,
     uint32_t trust_level,
     object * ilean_filename,
+    object * reuse_env,
     object * w
 );
 pair_ref<environment, object_ref> run_new_frontend(
@@ -339,12 +354,17 @@ pair_ref<environment, object_ref> run_new_frontend(
     options const & opts, std::string const & file_name,
     name const & main_module_name,
     uint32_t trust_level,
-    optional<std::string> const & ilean_file_name
+    optional<std::string> const & ilean_file_name,
+    optional<environment> const & reuse_env = optional<environment>()
 ) {
     object * oilean_file_name = mk_option_none();
     if (ilean_file_name) {
         oilean_file_name = mk_option_some(mk_string(*ilean_file_name));
     }
+    object * oreuse_env = mk_option_none();
+    if (reuse_env) {
+        oreuse_env = mk_option_some(reuse_env->to_obj_arg());
+    }
     return get_io_result<pair_ref<environment, object_ref>>(lean_run_frontend(
         mk_string(input),
         opts.to_obj_arg(),
@@ -352,6 +372,7 @@ pair_ref<environment, object_ref> run_new_frontend(
         main_module_name.to_obj_arg(),
         trust_level,
         oilean_file_name,
+        oreuse_env,
         io_mk_world()
     ));
 }
@@ -404,6 +425,183 @@ extern "C" object* lean_environment_free_regions(object * env, object * w);
 void environment_free_regions(environment && env) {
     consume_io_result(lean_environment_free_regions(env.steal(), io_mk_world()));
 }
+
+/* Content-addressed artifact cache (--cache=dir).
+
+   The cache key hashes everything the elaboration result depends on: the
+   compiler build (githash), the source text, the bytes of every .olean in the
+   transitive import closure, the option set (elaboration and codegen behavior
+   follows options such as `compiler.inline`), the trust level, and the bytes
+   of every loaded plugin/dynlib (they can register elaborators, linters, and
+   extern implementations). Timestamps play no role, so CI rebuilds that
+   merely touch upstream files without changing them reuse the cached .olean/.c
+   artifacts. The key is a 128-bit non-cryptographic hash; the cache directory
+   is assumed to be trusted (e.g. a CI cache volume). */
+
+/* def importClosurePaths (input : String) (fileName : Option String) : IO (Array String) */
+extern "C" object * lean_import_closure_paths(object * input, object * file_name, object * w);
+
+static optional<std::string> compute_cache_key(std::string const & contents, std::string const & mod_fn,
+                                               options const & opts, unsigned trust_lvl,
+                                               std::vector<std::string> const & native_libs) {
+    object * o = lean_import_closure_paths(mk_string(contents), mk_option_some(mk_string(mod_fn)), io_mk_world());
+    if (io_result_is_error(o)) {
+        /* e.g. a parse error in the header or a missing import; fall back to a
+           regular build, which will report the problem */
+        return optional<std::string>();
+    }
+    array_ref<string_ref> paths = get_io_result<array_ref<string_ref>>(o);
+    uint64 h1 = 17;
+    uint64 h2 = 31;
+    auto feed = [&](char const * s, size_t len) {
+        h1 = hash(h1, static_cast<uint64>(hash_str(len, reinterpret_cast<unsigned char const *>(s), 11)));
+        h2 = hash(h2, static_cast<uint64>(hash_str(len, reinterpret_cast<unsigned char const *>(s), 13)));
+    };
+    feed(LEAN_GITHASH, strlen(LEAN_GITHASH));
+    feed(contents.data(), contents.size());
+    {
+        std::ostringstream strm;
+        opts.display(strm);
+        strm << "trust=" << trust_lvl << "\n";
+        std::string s = strm.str();
+        feed(s.data(), s.size());
+    }
+    try {
+        for (std::string const & p : native_libs) {
+            std::string bytes = read_file(p, std::ios_base::binary);
+            feed(bytes.data(), bytes.size());
+        }
+        for (string_ref const & p : paths) {
+            std::string bytes = read_file(p.data(), std::ios_base::binary);
+            feed(bytes.data(), bytes.size());
+        }
+    } catch (lean::throwable &) {
+        return optional<std::string>();
+    }
+    char buf[33];
+    snprintf(buf, sizeof(buf), "%016llx%016llx",
+             static_cast<unsigned long long>(h1), static_cast<unsigned long long>(h2));
+    return optional<std::string>(buf);
+}
+
+/* Copy `from` over `to` via a temporary file and rename, so concurrent CI jobs
+   sharing a cache directory never observe a partially written artifact. */
+static bool copy_file_bytes(std::string const & from, std::string const & to) {
+    try {
+        std::string bytes = read_file(from, std::ios_base::binary);
+        std::string tmp = to + ".tmp";
+        std::ofstream out(tmp, std::ios_base::binary);
+        if (out.fail())
+            return false;
+        out.write(bytes.data(), bytes.size());
+        out.close();
+        if (!out.good())
+            return false;
+        return std::rename(tmp.c_str(), to.c_str()) == 0;
+    } catch (lean::throwable &) {
+        return false;
+    }
+}
+
+#if defined(__linux__) && defined(LEAN_MULTI_THREAD)
+/* def importModules (imports : List Import) (opts : Options) (trustLevel : UInt32) : IO Environment */
+extern "C" object * lean_import_modules(object * imports, object * opts, uint32_t trust_level, object * w);
+
+/* --zygote=Mod1,Mod2,... : pre-forking worker mode (Linux only).
+
+   The process imports the given modules once, paying the .olean reads and
+   compacted-region fix-up a single time, then reads build commands from stdin,
+   one tab-separated command per line:
+
+       <input.lean> TAB <output.olean> [TAB <output.c>]
+
+   and forks a worker per command. Workers inherit the fixed-up regions
+   copy-on-write, so their start latency is a fork instead of a full import. A
+   worker whose header requests exactly the pre-loaded import closure reuses
+   the warm environment directly; any other worker imports as usual, still
+   benefiting from the warm page cache. Workers report diagnostics on the
+   inherited stderr; the zygote exits 0 iff every worker succeeded. */
+static int run_zygote(std::string const & mods, options const & opts, unsigned trust_lvl,
+                      unsigned num_threads, optional<std::string> const & root_dir) {
+    std::vector<std::string> mod_names;
+    size_t pos = 0;
+    while (pos <= mods.size()) {
+        size_t comma = mods.find(',', pos);
+        if (comma == std::string::npos)
+            comma = mods.size();
+        if (comma > pos)
+            mod_names.push_back(mods.substr(pos, comma - pos));
+        pos = comma + 1;
+    }
+    object * imports = lean_box(0);
+    for (auto it = mod_names.rbegin(); it != mod_names.rend(); ++it) {
+        object * imp = lean_alloc_ctor(0, 1, 1);
+        lean_ctor_set(imp, 0, string_to_name(*it).to_obj_arg());
+        lean_ctor_set_uint8(imp, sizeof(object *), 0); /* runtimeOnly := false */
+        object * cons = lean_alloc_ctor(1, 2, 0);
+        lean_ctor_set(cons, 0, imp);
+        lean_ctor_set(cons, 1, imports);
+        imports = cons;
+    }
+    environment env = get_io_result<environment>(
+        lean_import_modules(imports, opts.to_obj_arg(), trust_lvl, io_mk_world()));
+
+    std::vector<pid_t> children;
+    bool ok = true;
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        if (line.empty())
+            continue;
+        size_t t1 = line.find('\t');
+        if (t1 == std::string::npos) {
+            std::cerr << "zygote: malformed command '" << line << "'\n";
+            ok = false;
+            continue;
+        }
+        std::string in_fn = line.substr(0, t1);
+        size_t t2 = line.find('\t', t1 + 1);
+        std::string olean_fn = line.substr(t1 + 1, t2 == std::string::npos ? std::string::npos : t2 - t1 - 1);
+        optional<std::string> c_fn;
+        if (t2 != std::string::npos)
+            c_fn = line.substr(t2 + 1);
+        pid_t pid = fork();
+        if (pid == -1) {
+            std::cerr << "zygote: fork failed for '" << in_fn << "'\n";
+            ok = false;
+        } else if (pid == 0) {
+            /* worker: only this thread exists here, so the task manager the
+               import ran on must be replaced before spawning any task */
+            lean_reinit_task_manager_after_fork(num_threads);
+            try {
+                std::string contents = read_file(in_fn);
+                optional<name> mod_name = module_name_of_file(in_fn, root_dir, /* optional */ false);
+                pair_ref<environment, object_ref> r =
+                    run_new_frontend(contents, opts, in_fn, *mod_name, trust_lvl,
+                                     optional<std::string>(), optional<environment>(env));
+                bool wok = unbox(r.snd().raw());
+                if (wok && !olean_fn.empty())
+                    write_module(r.fst(), olean_fn);
+                if (wok && c_fn) {
+                    std::ofstream out(*c_fn, std::ios_base::binary);
+                    out << ir::emit_c(r.fst(), *mod_name).data();
+                }
+                _exit(wok ? 0 : 1);
+            } catch (throwable & ex) {
+                std::cerr << ex.what() << "\n";
+                _exit(1);
+            }
+        } else {
+            children.push_back(pid);
+        }
+    }
+    for (pid_t pid : children) {
+        int status = 0;
+        if (waitpid(pid, &status, 0) == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            ok = false;
+    }
+    return ok ? 0 : 1;
+}
+#endif
 }
 
 extern "C" object * lean_get_prefix(object * w);
@@ -477,7 +675,11 @@ extern "C" LEAN_EXPORT int lean_main(int argc, char ** argv) {
     std::string native_output;
     optional<std::string> c_output;
     optional<std::string> root_dir;
+    optional<std::string> cache_dir;
+    optional<std::string> zygote_mods;
     buffer<string_ref> forwarded_args;
+    /* plugins and dynlibs loaded into this process, for the --cache key */
+    std::vector<std::string> native_libs;
 
     while (true) {
         int c = getopt_long(argc, argv, g_opt_str, g_long_options, NULL);
@@ -506,6 +708,14 @@ extern "C" LEAN_EXPORT int lean_main(int argc, char ** argv) {
                 check_optarg("c");
                 c_output = optarg;
                 break;
+            case 'C':
+                check_optarg("C");
+                cache_dir = optarg;
+                break;
+            case 'Z':
+                check_optarg("Z");
+                zygote_mods = optarg;
+                break;
             case 's':
                 lean::lthread::set_thread_stack_size(
                         static_cast<size_t>((atoi(optarg) / 4) * 4) * static_cast<size_t>(1024));
@@ -584,11 +794,13 @@ extern "C" LEAN_EXPORT int lean_main(int argc, char ** argv) {
                 check_optarg("p");
                 load_plugin(optarg);
                 forwarded_args.push_back(string_ref("--plugin=" + std::string(optarg)));
+                native_libs.push_back(optarg);
                 break;
             case 'l':
                 check_optarg("l");
                 lean::load_dynlib(optarg);
                 forwarded_args.push_back(string_ref("--load-dynlib=" + std::string(optarg)));
+                native_libs.push_back(optarg);
                 break;
             default:
                 std::cerr << "Unknown command line option\n";
@@ -639,6 +851,15 @@ extern "C" LEAN_EXPORT int lean_main(int argc, char ** argv) {
         else if (run_server == 2)
             return run_server_worker(opts);
 
+        if (zygote_mods) {
+#if defined(__linux__) && defined(LEAN_MULTI_THREAD)
+            return run_zygote(*zygote_mods, opts, trust_lvl, num_threads, root_dir);
+#else
+            std::cerr << "--zygote is only supported on multi-threaded Linux builds\n";
+            return 1;
+#endif
+        }
+
         if (only_deps && deps_json) {
             buffer<string_ref> fns;
             if (use_stdin) {
@@ -698,6 +919,24 @@ extern "C" LEAN_EXPORT int lean_main(int argc, char ** argv) {
 
         if (!main_module_name)
             main_module_name = name("_stdin");
+
+        /* Content-addressed cache lookup: only active for pure artifact builds
+           (an .ilean or `--run` request still needs real elaboration). */
+        optional<std::string> cache_key;
+        if (cache_dir && !use_stdin && !run && !ilean_fn && (olean_fn || c_output)) {
+            cache_key = compute_cache_key(contents, mod_fn, opts, trust_lvl, native_libs);
+            if (cache_key) {
+                std::string base = *cache_dir + "/" + *cache_key;
+                bool hit = true;
+                if (olean_fn && !copy_file_bytes(base + ".olean", *olean_fn))
+                    hit = false;
+                if (hit && c_output && !copy_file_bytes(base + ".c", *c_output))
+                    hit = false;
+                if (hit)
+                    return 0;
+            }
+        }
+
         pair_ref<environment, object_ref> r = run_new_frontend(contents, opts, mod_fn, *main_module_name, trust_lvl, ilean_fn);
         env = r.fst();
         bool ok = unbox(r.snd().raw());
@@ -727,7 +966,16 @@ extern "C" LEAN_EXPORT int lean_main(int argc, char ** argv) {
             out.close();
         }
 
+        if (cache_key && ok) {
+            std::string base = *cache_dir + "/" + *cache_key;
+            if (olean_fn)
+                copy_file_bytes(*olean_fn, base + ".olean");
+            if (c_output)
+                copy_file_bytes(*c_output, base + ".c");
+        }
+
         display_cumulative_profiling_times(std::cerr);
+        export_profiling_trace();
 
         return ok ? 0 : 1;
     } catch (lean::throwable & ex) {
@@ -8,4 +8,8 @@ def main : IO Unit := do
   getGlobalString >>= IO.println
   updateGlobalS (mkS 0 0 "world")
   getGlobalString >>= IO.println
+  let err ← testWeakRefs
+  unless err.isEmpty do
+    throw <| IO.userError s!"weak ref test failed: {err}"
+  IO.println "weak refs ok"
   pure ()
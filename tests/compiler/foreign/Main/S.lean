@@ -9,3 +9,6 @@ instance : Nonempty S := SPointed.property
 @[extern "lean_S_global_append"] opaque appendToGlobalS (str : @& String) : IO Unit
 @[extern "lean_S_global_string"] opaque getGlobalString : IO String
 @[extern "lean_S_update_global"] opaque updateGlobalS (s : @& S) : IO Unit
+-- Runs the C-side weak reference / finalizer checks; returns "" on success
+-- and the name of the failing check otherwise.
+@[extern "lean_test_weak_refs"] opaque testWeakRefs : IO String
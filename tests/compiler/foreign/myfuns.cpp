@@ -59,3 +59,42 @@ extern "C" LEAN_EXPORT lean_object * lean_S_update_global(b_lean_obj_arg s, lean
     g_s.m_s = to_S(s)->m_s;
     return lean_io_result_mk_ok(lean_box(0));
 }
+
+static bool g_finalizer_ran = false;
+
+static void mark_finalizer_ran(void * arg) {
+    *static_cast<bool *>(arg) = true;
+}
+
+// Exercises the weak reference / finalizer API from lean.h.
+// Returns "" on success and the name of the failing check otherwise.
+extern "C" LEAN_EXPORT lean_object * lean_test_weak_refs(lean_object * /* w */) {
+    char const * err = "";
+    lean_object * target = lean_mk_string("weak target");
+    lean_weak_ref * w = lean_weak_ref_create(target);
+    lean_object * r = lean_weak_ref_get(w);
+    if (r != target)
+        err = "get on a live target";
+    if (r != NULL)
+        lean_dec(r);
+    lean_register_finalizer(target, mark_finalizer_ran, &g_finalizer_ran);
+    // last token: the deletion walk nulls the cell and queues the finalizer
+    lean_dec(target);
+    if (*err == 0 && lean_weak_ref_get(w) != NULL)
+        err = "get on a dead target";
+    lean_weak_ref_free(w);
+    if (*err == 0) {
+        lean_run_pending_finalizers();
+        if (!g_finalizer_ran)
+            err = "finalizer did not run";
+    }
+    if (*err == 0) {
+        // cells observing scalars always succeed
+        lean_weak_ref * ws = lean_weak_ref_create(lean_box(42));
+        lean_object * rs = lean_weak_ref_get(ws);
+        if (rs != lean_box(42))
+            err = "get on a scalar target";
+        lean_weak_ref_free(ws);
+    }
+    return lean_io_result_mk_ok(lean_mk_string(err));
+}
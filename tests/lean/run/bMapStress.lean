@@ -0,0 +1,29 @@
+import Lean
+
+/- The C++ `name_map` (now backed by `b_map`) holds the compiler pass tables
+   and the IR interpreter's symbol/constant caches. Minting a few hundred
+   chained definitions and evaluating the last one drives those maps through
+   bulk inserts and point lookups for every name in the chain. -/
+
+open Lean Elab Command
+
+elab "genChain " n:num : command => do
+  for i in [0:n.getNat] do
+    let curr := mkIdent (Name.mkSimple s!"bmap_f{i}")
+    let prev := if i == 0 then mkIdent (Name.mkSimple "bmap_seed")
+                else mkIdent (Name.mkSimple s!"bmap_f{i-1}")
+    elabCommand (← `(def $curr : Nat := $prev + 1))
+
+def bmap_seed : Nat := 0
+
+genChain 300
+
+-- kernel-side lookup of every name in the chain
+def chainLen : bmap_f299 = 300 := rfl
+
+-- interpreter-side: each step resolves the previous constant through the
+-- IR constant cache
+#eval show IO Unit from do
+  unless bmap_f299 == 300 do
+    throw <| IO.userError "bad chain value"
+  IO.println "done"
@@ -0,0 +1,45 @@
+def check_eq {α} [BEq α] [Repr α] (tag : String) (expected actual : α) : IO Unit :=
+  unless (expected == actual) do
+    throw $ IO.userError $
+      s!"assertion failure \"{tag}\":\n  expected: {repr expected}\n  actual:   {repr actual}"
+
+/- `Nat.mulMod`/`Nat.powMod` must agree with the unfused `a * b % n` and
+   `a ^ b % n`, across the scalar, 128-bit-intermediate and mpz paths of
+   the runtime primitives. -/
+def checkMulMod (a b n : Nat) : IO Unit :=
+  check_eq s!"mulMod {a} {b} {n}" (a * b % n) (Nat.mulMod a b n)
+
+def checkPowMod (a b n : Nat) : IO Unit :=
+  check_eq s!"powMod {a} {b} {n}" (a ^ b % n) (Nat.powMod a b n)
+
+def main : IO Unit := do
+  -- small scalars
+  checkMulMod 7 9 10
+  checkMulMod 0 9 10
+  checkMulMod 7 0 10
+  -- n = 1 is always 0, n = 0 is the identity (`x % 0 = x`)
+  checkMulMod 7 9 1
+  checkMulMod 7 9 0
+  checkMulMod 123456789 987654321 0
+  -- scalar operands whose product needs the 128-bit intermediate
+  checkMulMod (2^62 + 3) (2^62 + 5) (2^61 - 1)
+  checkMulMod (2^63 - 1) (2^63 - 1) (2^62 + 11)
+  -- mpz operands
+  checkMulMod (2^80 + 1) (2^70 + 3) (2^65 + 7)
+  checkMulMod (2^200) (2^100 + 1) 97
+  checkMulMod 5 (2^90 + 1) (2^64 + 13)
+
+  checkPowMod 3 20 1000
+  checkPowMod 2 10 0      -- full power, no reduction
+  checkPowMod 7 0 10      -- exponent 0
+  checkPowMod 0 0 10
+  checkPowMod 0 5 10
+  checkPowMod 12345 6789 1
+  -- intermediates would overflow 64 bits without the fused reduction
+  checkPowMod (2^62 + 3) 1000 (2^61 - 1)
+  -- mpz modulus
+  checkPowMod 3 1000 (2^100 + 7)
+  checkPowMod (2^70 + 9) 50 (2^66 + 5)
+  IO.println "done"
+
+#eval main
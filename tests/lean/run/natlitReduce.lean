@@ -0,0 +1,34 @@
+/- Kernel literal reduction for `Nat.pow`, `Nat.gcd`, `Nat.log2` and the
+   bitwise operations. The literals are kept small enough for the elaborator,
+   which unfolds the recursive definitions; the kernel recheck then exercises
+   the GMP-backed fast paths. -/
+
+def pow1 : Nat.pow 2 16 = 65536 := rfl
+def pow2 : Nat.pow 3 5 = 243 := rfl
+def pow3 : Nat.pow 10 0 = 1 := rfl
+def pow4 : Nat.pow 0 0 = 1 := rfl
+def pow5 : Nat.pow 0 7 = 0 := rfl
+
+def gcd1 : Nat.gcd 12 18 = 6 := rfl
+def gcd2 : Nat.gcd 0 5 = 5 := rfl
+def gcd3 : Nat.gcd 5 0 = 5 := rfl
+def gcd4 : Nat.gcd 17 13 = 1 := rfl
+def gcd5 : Nat.gcd 252 105 = 21 := rfl
+
+def log1 : Nat.log2 1024 = 10 := rfl
+def log2 : Nat.log2 1023 = 9 := rfl
+def log3 : Nat.log2 1 = 0 := rfl
+def log4 : Nat.log2 0 = 0 := rfl
+
+def land1 : Nat.land 0b1100 0b1010 = 0b1000 := rfl
+def land2 : Nat.land 255 0 = 0 := rfl
+def lor1  : Nat.lor 0b1100 0b1010 = 0b1110 := rfl
+def lor2  : Nat.lor 0 255 = 255 := rfl
+def xor1  : Nat.xor 0b1100 0b1010 = 0b0110 := rfl
+def xor2  : Nat.xor 255 255 = 0 := rfl
+
+def shl1 : Nat.shiftLeft 1 10 = 1024 := rfl
+def shl2 : Nat.shiftLeft 5 3 = 40 := rfl
+def shr1 : Nat.shiftRight 1024 10 = 1 := rfl
+def shr2 : Nat.shiftRight 40 3 = 5 := rfl
+def shr3 : Nat.shiftRight 7 5 = 0 := rfl
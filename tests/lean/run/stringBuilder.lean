@@ -0,0 +1,44 @@
+def check_eq {α} [BEq α] [Repr α] (tag : String) (expected actual : α) : IO Unit :=
+  unless (expected == actual) do
+    throw $ IO.userError $
+      s!"assertion failure \"{tag}\":\n  expected: {repr expected}\n  actual:   {repr actual}"
+
+def pieces : List String :=
+  ["foo", "", "英語", "a longer piece that needs a capacity bump", "😀", "!"]
+
+def main : IO Unit := do
+  check_eq "empty" "" String.Builder.empty.toString
+  check_eq "isEmpty" true String.Builder.empty.isEmpty
+  check_eq "mkEmpty" "" (String.Builder.mkEmpty 64).toString
+  check_eq "mkEmpty isEmpty" true (String.Builder.mkEmpty 64).isEmpty
+
+  -- push, char by char, against String.push
+  let s := "abc英語😀xyz"
+  let mut b := String.Builder.empty
+  for c in s.toList do
+    b := b.push c
+  check_eq "push" s b.toString
+  check_eq "push utf8ByteSize" s.utf8ByteSize b.utf8ByteSize
+  check_eq "push isEmpty" false b.isEmpty
+
+  -- append against String concatenation, with and without reserved capacity
+  let expected := pieces.foldl (· ++ ·) ""
+  let mut b1 := String.Builder.empty
+  let mut b2 := String.Builder.mkEmpty 256
+  for p in pieces do
+    b1 := b1.append p
+    b2 := b2 ++ p                     -- via the HAppend instance
+  check_eq "append" expected b1.toString
+  check_eq "append with capacity" expected b2.toString
+  check_eq "append utf8ByteSize" expected.utf8ByteSize b1.utf8ByteSize
+
+  -- mixed pushes and appends in a longer loop
+  let mut b3 := String.Builder.mkEmpty 0
+  let mut ref := ""
+  for i in List.range 100 do
+    b3 := (b3 ++ toString i).push ','
+    ref := ref ++ toString i ++ ","
+  check_eq "mixed" ref b3.toString
+  IO.println "done"
+
+#eval main
@@ -0,0 +1,38 @@
+def check_eq {α} [BEq α] [Repr α] (tag : String) (expected actual : α) : IO Unit :=
+  unless (expected == actual) do
+    throw $ IO.userError $
+      s!"assertion failure \"{tag}\":\n  expected: {repr expected}\n  actual:   {repr actual}"
+
+/- Reference semantics: iterate `get`/`next`. `decodeBatch` must agree with
+   this at every position, including positions that are not character
+   boundaries (both sides then produce the default character and advance one
+   byte). -/
+partial def decodeRef (s : String) (p : String.Pos) (n : Nat) : Array Char × String.Pos :=
+  let rec go (n : Nat) (p : String.Pos) (cs : Array Char) : Array Char × String.Pos :=
+    if n == 0 || s.atEnd p then (cs, p)
+    else go (n - 1) (s.next p) (cs.push (s.get p))
+  go n p #[]
+
+def checkBatch (tag : String) (s : String) (p : String.Pos) (n : Nat) : IO Unit :=
+  check_eq tag (decodeRef s p n) (s.decodeBatch p n)
+
+def main : IO Unit := do
+  let ascii := "the quick brown fox jumps over the lazy dog"  -- > 16 bytes, pure ASCII
+  let mixed := "abc英語def日本語ghi😀jkl"                       -- 1-, 3- and 4-byte characters
+  -- non-ASCII straddling the 16-byte ASCII-run boundary
+  let straddle := "0123456789abcde英語"
+  for s in [ascii, mixed, straddle, "", "é", "x"] do
+    for n in [0, 1, 2, 3, 5, 100] do
+      checkBatch s!"({repr s}, 0, {n})" s ⟨0⟩ n
+      checkBatch s!"({repr s}, 4, {n})" s ⟨4⟩ n
+      checkBatch s!"({repr s}, end, {n})" s s.endPos n
+  -- start position inside a multi-byte character
+  checkBatch "mid-codepoint" mixed ⟨4⟩ 5
+  checkBatch "mid-codepoint 2" "英語" ⟨1⟩ 10
+  -- past-the-end position
+  checkBatch "past end" ascii ⟨1000⟩ 3
+  -- whole-string decode matches toList
+  check_eq "toList" mixed.toList (mixed.decodeBatch ⟨0⟩ mixed.length).fst.toList
+  IO.println "done"
+
+#eval main
@@ -0,0 +1,60 @@
+import Lean.Data.Lsp.Utf16
+
+def check_eq {α} [BEq α] [Repr α] (tag : String) (expected actual : α) : IO Unit :=
+  unless (expected == actual) do
+    throw $ IO.userError $
+      s!"assertion failure \"{tag}\":\n  expected: {repr expected}\n  actual:   {repr actual}"
+
+/- Pure reimplementations of the reference loops from `Lean.Data.Lsp.Utf16`,
+   so the `@[extern]` implementations are checked against independent code
+   rather than against themselves. -/
+def csize16 (c : Char) : Nat :=
+  if c.val ≤ 0xFFFF then 1 else 2
+
+def utf16LengthRef (s : String) : Nat :=
+  s.foldr (fun c acc => csize16 c + acc) 0
+
+partial def cpToUtf16Ref (s : String) : Nat → String.Pos → Nat → Nat
+  | 0,    _,       utf16pos => utf16pos
+  | cp+1, utf8pos, utf16pos => cpToUtf16Ref s cp (s.next utf8pos) (utf16pos + csize16 (s.get utf8pos))
+
+partial def utf16ToCpRef (s : String) : Nat → String.Pos → Nat → Nat
+  | 0,        _,       cp => cp
+  | utf16pos, utf8pos, cp => utf16ToCpRef s (utf16pos - csize16 (s.get utf8pos)) (s.next utf8pos) (cp + 1)
+
+partial def cpToUtf8Ref (s : String) : String.Pos → Nat → String.Pos
+  | utf8pos, 0   => utf8pos
+  | utf8pos, p+1 => cpToUtf8Ref s (s.next utf8pos) p
+
+def checkString (s : String) : IO Unit := do
+  check_eq s!"utf16Length {repr s}" (utf16LengthRef s) s.utf16Length
+  -- sweep every codepoint index, plus a few past the end
+  for n in List.range (s.length + 3) do
+    check_eq s!"cpToUtf16 {repr s} {n}"
+      (cpToUtf16Ref s n ⟨0⟩ 0) (s.codepointPosToUtf16PosFrom n ⟨0⟩)
+    check_eq s!"cpToUtf8 {repr s} {n}"
+      (cpToUtf8Ref s ⟨0⟩ n) (s.codepointPosToUtf8PosFrom ⟨0⟩ n)
+  -- sweep every UTF-16 offset, including offsets inside a surrogate pair,
+  -- plus a few past the end
+  for u in List.range (utf16LengthRef s + 3) do
+    check_eq s!"utf16ToCp {repr s} {u}"
+      (utf16ToCpRef s u ⟨0⟩ 0) (s.utf16PosToCodepointPosFrom u ⟨0⟩)
+  -- non-zero starting offsets
+  let mut p : String.Pos := ⟨0⟩
+  for _ in List.range s.length do
+    check_eq s!"cpToUtf16 from {repr s} {repr p}"
+      (cpToUtf16Ref s 2 p 0) (s.codepointPosToUtf16PosFrom 2 p)
+    check_eq s!"utf16ToCp from {repr s} {repr p}"
+      (utf16ToCpRef s 2 p 0) (s.utf16PosToCodepointPosFrom 2 p)
+    p := s.next p
+
+def main : IO Unit := do
+  checkString ""
+  checkString "hello, world"
+  checkString "café"                    -- 2-byte character
+  checkString "英語のテスト"             -- 3-byte characters
+  checkString "a😀b🀄c"                 -- 4-byte characters: surrogate pairs
+  checkString "mix: é英😀!"
+  IO.println "done"
+
+#eval main
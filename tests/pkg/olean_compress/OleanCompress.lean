@@ -0,0 +1,13 @@
+import OleanCompress.A
+
+/- Elaborating this module loads `OleanCompress.A`'s .olean, which `test.sh`
+   had written with `LEAN_OLEAN_COMPRESS` set; check the imported data
+   round-tripped intact before printing the marker the test greps for. -/
+#eval show IO Unit from do
+  unless OleanCompressA.nats.foldl (· + ·) 0 == 14850 do
+    throw <| IO.userError "nats corrupted"
+  unless OleanCompressA.str == "compressed 英語 😀" do
+    throw <| IO.userError "str corrupted"
+  unless OleanCompressA.tree.map List.length == List.range 20 do
+    throw <| IO.userError "tree corrupted"
+  IO.println "olean compress roundtrip ok"
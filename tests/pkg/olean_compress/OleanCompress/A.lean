@@ -0,0 +1,11 @@
+namespace OleanCompressA
+
+def nats : List Nat := (List.range 100).map (· * 3)
+
+def str : String := "compressed 英語 😀"
+
+def tree : List (List Nat) := (List.range 20).map List.range
+
+theorem two_two : 2 + 2 = 4 := rfl
+
+end OleanCompressA
@@ -0,0 +1,5 @@
+import Lake
+open System Lake DSL
+
+package olean_compress
+@[default_target] lean_lib OleanCompress
@@ -0,0 +1,7 @@
+#!/usr/bin/env bash
+
+# Round-trip .olean files written with compression enabled. In builds without
+# USE_ZSTD the variable is ignored and plain files are written, so the test
+# degrades to a regular build.
+rm -rf build
+LEAN_OLEAN_COMPRESS=1 lake build -v 2>&1 | grep 'olean compress roundtrip ok'